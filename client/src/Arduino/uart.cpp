@@ -17,24 +17,56 @@
 static void rmUARTSendMessage(const char* msg) {
     Serial.print(msg);
 }
+
+static void rmUARTSendData(const void* data, uint16_t len) {
+    Serial.write((const uint8_t*) data, len);
+}
+
+static uint16_t rmUARTTxSpace() {
+    return Serial.availableForWrite();
+}
 #endif
 
 #ifdef HAVE_HWSERIAL1
 static void rmUART1SendMessage(const char* msg) {
     Serial1.print(msg);
 }
+
+static void rmUART1SendData(const void* data, uint16_t len) {
+    Serial1.write((const uint8_t*) data, len);
+}
+
+static uint16_t rmUART1TxSpace() {
+    return Serial1.availableForWrite();
+}
 #endif
 
 #ifdef HAVE_HWSERIAL2
 static void rmUART2SendMessage(const char* msg) {
     Serial2.print(msg);
 }
+
+static void rmUART2SendData(const void* data, uint16_t len) {
+    Serial2.write((const uint8_t*) data, len);
+}
+
+static uint16_t rmUART2TxSpace() {
+    return Serial2.availableForWrite();
+}
 #endif
 
 #ifdef HAVE_HWSERIAL3
 static void rmUART3SendMessage(const char* msg) {
     Serial3.print(msg);
 }
+
+static void rmUART3SendData(const void* data, uint16_t len) {
+    Serial3.write((const uint8_t*) data, len);
+}
+
+static uint16_t rmUART3TxSpace() {
+    return Serial3.availableForWrite();
+}
 #endif
 
 #ifdef HAVE_HWSERIAL0
@@ -84,6 +116,8 @@ void rmConnectUART(unsigned long baud) {
     Serial.begin(baud);
     _rmRead = rmUARTRead;
     _rmSendMessage = rmUARTSendMessage;
+    _rmSendData = rmUARTSendData;
+    _rmTxSpace = rmUARTTxSpace;
     #endif
 }
 
@@ -97,6 +131,8 @@ void rmConnectUART1(unsigned long baud) {
     Serial1.begin(baud);
     _rmRead = rmUART1Read;
     _rmSendMessage = rmUART1SendMessage;
+    _rmSendData = rmUART1SendData;
+    _rmTxSpace = rmUART1TxSpace;
     #endif
 }
 
@@ -110,6 +146,8 @@ void rmConnectUART2(unsigned long baud) {
     Serial2.begin(baud);
     _rmRead = rmUART2Read;
     _rmSendMessage = rmUART2SendMessage;
+    _rmSendData = rmUART2SendData;
+    _rmTxSpace = rmUART2TxSpace;
     #endif
 }
 
@@ -123,5 +161,7 @@ void rmConnectUART3(unsigned long baud) {
     Serial3.begin(baud);
     _rmRead = rmUART3Read;
     _rmSendMessage = rmUART3SendMessage;
+    _rmSendData = rmUART3SendData;
+    _rmTxSpace = rmUART3TxSpace;
     #endif
 }
@@ -0,0 +1,55 @@
+/**
+ * @file attribute_private.h
+ * @brief Attributes shown by the client or manipulated by the station
+ * 
+ * Encoding helpers shared by the output attribute and sync modules.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#include "rm/attribute.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Encoders of an output attribute data type
+ */
+typedef struct _rmOutputCodec {
+    uint8_t (*text)(const void* data, char* buf);
+    uint8_t (*binary)(const void* data, uint8_t* buf);
+    uint8_t size;
+    uint8_t textSize;
+} rmOutputCodec;
+
+
+const rmOutputCodec* _rmOutputCodecGet(rmAttributeDataType t);
+
+uint8_t _rmOutputAttributeGetSize(rmOutputAttribute *attr);
+
+uint8_t _rmOutputAttributeGetTextSize(rmOutputAttribute *attr);
+
+uint8_t _rmOutputAttributeGetText(rmOutputAttribute *attr, char* buf);
+
+uint8_t _rmOutputAttributeGetBinaryData(rmOutputAttribute *attr,
+                                        uint8_t* buf);
+
+bool _rmOutputAttributeChanged(rmOutputAttribute *attr, const void* shadow);
+
+void _rmOutputAttributeStore(rmOutputAttribute *attr, void* shadow);
+
+uint8_t _rmEncodeUint(uint32_t u, char* buf);
+
+
+#ifdef __cplusplus
+}
+#endif
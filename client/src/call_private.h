@@ -26,6 +26,8 @@ typedef struct _rmCall {
 
 rmCall* _rmCallGet(const char* key);
 
+void _rmDescribeCalls();
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,58 @@
+/**
+ * @file cipher_private.h
+ * @brief ChaCha20, Poly1305 and X25519
+ * 
+ * The algorithms of RFC 8439 and RFC 7748 under the encryption of the
+ * connection. Shared by the device and the station, which builds
+ * rm_cipher.c into its library.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+static inline uint32_t _rmLoad32(const uint8_t* p) {
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) |
+           ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+
+static inline void _rmStore32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t) v;
+    p[1] = (uint8_t) (v >> 8);
+    p[2] = (uint8_t) (v >> 16);
+    p[3] = (uint8_t) (v >> 24);
+}
+
+
+void _rmChachaBlock(uint8_t* out, const uint8_t* key, uint32_t counter,
+                    const uint8_t* nonce);
+
+void _rmHChacha(uint8_t* out, const uint8_t* key, const uint8_t* in);
+
+void _rmChachaXor(uint8_t* data, size_t len, const uint8_t* key,
+                  uint32_t counter, const uint8_t* nonce);
+
+void _rmPoly1305(uint8_t* tag, const uint8_t* msg, size_t len,
+                 const uint8_t* key);
+
+void _rmAeadTag(uint8_t* tag, const uint8_t* aad, size_t aadLen,
+                const uint8_t* ct, size_t len, const uint8_t* key,
+                const uint8_t* nonce);
+
+void _rmX25519(uint8_t* out, const uint8_t* scalar, const uint8_t* point);
+
+
+#ifdef __cplusplus
+}
+#endif
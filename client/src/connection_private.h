@@ -21,7 +21,25 @@ extern "C" {
 
 
 #define RM_RX_BUFFER_SIZE 256
+#ifndef RM_TX_BUFFER_SIZE
 #define RM_TX_BUFFER_SIZE 512
+#endif
+
+#define RM_FRAME_START      0x01
+#define RM_FRAME_SYNC       0x10
+#define RM_FRAME_SYNC_DELTA 0x11
+#define RM_FRAME_SET        0x12
+#define RM_FRAME_SYNC_PART  0x13
+#define RM_FRAME_CRYPT      0x20
+
+#define RM_PROTOCOL_VERSION 1
+#define RM_MAX_SYNC_RATE    1000
+
+#define RM_CAP_BINARY 0x01
+#define RM_CAP_DELTA  0x02
+#define RM_CAP_RATE   0x04
+#define RM_CAP_SPLIT  0x08
+#define RM_CAP_COMPRESS 0x10
 
 
 extern char rmRxBuffer[];
@@ -29,18 +47,41 @@ extern uint8_t rmRxHead;
 extern uint8_t rmRxTail;
 
 extern char rmTxBuffer[];
-extern uint8_t rmTxHead;
-extern uint8_t rmTxTail;
+extern volatile uint16_t rmTxHead;
+extern volatile uint16_t rmTxTail;
 
 extern bool rmRxOn;
-extern bool rmTxOn;
+extern volatile bool rmTxOn;
 
 extern char (*_rmRead)();
 
 extern void (*_rmSendMessage)(const char*);
 
+extern void (*_rmSendData)(const void*, uint16_t);
+
 extern void (*_rmConnectionIdle)();
 
+extern uint16_t (*_rmTxSpace)();
+
+extern void (*_rmSyncScheduler)();
+
+extern void (*_rmDescribeInputs)();
+
+extern void (*_rmDescribeSyncs)();
+
+extern void (*_rmCryptReceive)(char);
+
+extern void (*_rmCryptFlush)();
+
+extern void (*_rmCompressSet)(bool, bool);
+
+
+void _rmProcessChar(char c);
+
+uint8_t _rmCrc8(uint8_t crc, const uint8_t* data, uint8_t len);
+
+void _rmSendFrame(uint8_t type, const uint8_t* payload, uint8_t len);
+
 
 #ifdef __cplusplus
 }
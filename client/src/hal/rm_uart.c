@@ -15,6 +15,8 @@
 #include "../connection_private.h"
 #include "../time.h"
 
+#include <string.h>
+
 
 #define DMA_RX_BUFFER_SIZE 128
 #define DMA_TX_BUFFER_SIZE 128
@@ -26,10 +28,11 @@ static uint8_t rxDMABuffer[DMA_RX_BUFFER_SIZE];
 static uint8_t txDMABuffer[DMA_TX_BUFFER_SIZE];
 
 
-static void rmUARTSendMessage(const char* msg) {
-    char c;
-    while((c = *msg++) != '\0') {
-        uint8_t i = (rmTxHead + 1) % RM_TX_BUFFER_SIZE;
+static void rmUARTSendData(const void* data, uint16_t len) {
+    const char* ptr = (const char*) data;
+    while(len--) {
+        char c = *ptr++;
+        uint16_t i = (rmTxHead + 1) % RM_TX_BUFFER_SIZE;
         
         // Waits for the TX to reduce the buffer
         if(i == rmTxTail) {
@@ -47,6 +50,10 @@ static void rmUARTSendMessage(const char* msg) {
         rmUARTLoadDMA();
 }
 
+static void rmUARTSendMessage(const char* msg) {
+    rmUARTSendData(msg, strlen(msg));
+}
+
 /**
  * @brief Initializes the UART connection
  * 
@@ -61,6 +68,7 @@ void rmConnectUART(UART_HandleTypeDef *huart, DMA_HandleTypeDef *hdma_rx,
     rxDMAHandler = hdma_rx;
     txDMAHandler = hdma_tx;
     _rmSendMessage = rmUARTSendMessage;
+    _rmSendData = rmUARTSendData;
     __HAL_UART_ENABLE_IT(huart, UART_IT_IDLE);
     HAL_UART_Receive_DMA(huart, rxDMABuffer, DMA_RX_BUFFER_SIZE);
 }
@@ -98,8 +106,8 @@ void rmUARTLoadDMA() {
     rmTxOn = false;
     if(rmTxTail == rmTxHead || rmRxOn)
         return;
-    uint8_t i = rmTxTail;
-    uint8_t count = 0;
+    uint16_t i = rmTxTail;
+    uint16_t count = 0;
     while(count < DMA_TX_BUFFER_SIZE) {
         if(i == rmTxHead)
             break;
@@ -2,6 +2,12 @@
  * @file usbd_cdc.c
  * @brief Connection to USB communication device class
  * 
+ * The TX ring is drained into a persistent staging buffer which stays valid
+ * while the USB peripheral reads it. Each transfer packs as many 64-byte
+ * full-speed packets as fit into RM_USBD_TX_TRANSFER_SIZE and the next one is
+ * started from the TX-complete callback, so the bus is kept busy without
+ * waiting for rmProcessMessage().
+ * 
  * @copyright Copyright (c) 2022 Khant Kyaw Khaung
  * 
  * @license{This project is released under the MIT License.}
@@ -16,9 +22,17 @@
 #include "../connection_private.h"
 #include "../time.h"
 
+#include <stdbool.h>
+#include <string.h>
+
+
+static uint8_t txStaging[RM_USBD_TX_TRANSFER_SIZE]
+    __attribute__((aligned(4)));
+static volatile bool zlpPending = false;
+
 
 static int8_t rmUSBDReceive(uint8_t* Buf, uint32_t* Len) {
-    for(uint8_t i=0; i<*Len; i++) {
+    for(uint32_t i=0; i<*Len; i++) {
         uint8_t j = (rmRxHead + 1) % RM_RX_BUFFER_SIZE;
         if(j == rmRxTail)
             break;
@@ -34,30 +48,54 @@ static int8_t rmUSBDReceive(uint8_t* Buf, uint32_t* Len) {
 static void rmUSBDTransmit() {
     USBD_CDC_HandleTypeDef *hcdc
         = (USBD_CDC_HandleTypeDef*) hUsbDeviceFS.pClassData;
-    if(hcdc->TxState != 0)
+    if(hcdc == NULL || hcdc->TxState != 0)
         return;
     
-    char buffer[128];
-    uint8_t count = 0;
-    while(count < 128) {
-        if(rmTxTail == rmTxHead)
-            break;
-        buffer[count] = rmTxBuffer[rmTxTail];
-        rmTxTail = (rmTxTail + 1) % RM_TX_BUFFER_SIZE;
-        count++;
+    uint16_t head = rmTxHead;
+    uint16_t tail = rmTxTail;
+    uint16_t count = 0;
+    
+    if(head == tail) {
+        // Only set with RM_USBD_SEND_ZLP
+        if(zlpPending) {
+            zlpPending = false;
+            rmTxOn = true;
+            USBD_CDC_SetTxBuffer(&hUsbDeviceFS, txStaging, 0);
+            USBD_CDC_TransmitPacket(&hUsbDeviceFS);
+        }
+        return;
+    }
+    
+    // Copies the ring in at most two contiguous chunks
+    while(tail != head && count < RM_USBD_TX_TRANSFER_SIZE) {
+        uint16_t end = (head > tail) ? head : RM_TX_BUFFER_SIZE;
+        uint16_t n = end - tail;
+        if(n > RM_USBD_TX_TRANSFER_SIZE - count)
+            n = RM_USBD_TX_TRANSFER_SIZE - count;
+        memcpy(&txStaging[count], &rmTxBuffer[tail], n);
+        count += n;
+        tail = (tail + n) % RM_TX_BUFFER_SIZE;
     }
-    USBD_CDC_SetTxBuffer(&hUsbDeviceFS, (uint8_t*) buffer, count);
+    rmTxTail = tail;
+    
+    #if RM_USBD_SEND_ZLP
+    zlpPending = (count % CDC_DATA_FS_MAX_PACKET_SIZE == 0);
+    #endif
+    rmTxOn = true;
+    USBD_CDC_SetTxBuffer(&hUsbDeviceFS, txStaging, count);
     USBD_CDC_TransmitPacket(&hUsbDeviceFS);
 }
 
 
-static void rmUSBDSendMessage(const char* msg) {
-    char c;
-    while((c = *msg++) != '\0') {
-        uint8_t i = (rmTxHead + 1) % RM_TX_BUFFER_SIZE;
+static void rmUSBDSendData(const void* data, uint16_t len) {
+    const char* ptr = (const char*) data;
+    while(len--) {
+        char c = *ptr++;
+        uint16_t i = (rmTxHead + 1) % RM_TX_BUFFER_SIZE;
         
         // Waits for the TX to reduce the buffer
         if(i == rmTxTail) {
+            rmUSBDTransmit();
             uint32_t t1 = _rmGetTime();
             while(i == rmTxTail) {
                 if(_rmGetTime() - t1 > 10)
@@ -72,13 +110,45 @@ static void rmUSBDSendMessage(const char* msg) {
 }
 
 
+static void rmUSBDSendMessage(const char* msg) {
+    rmUSBDSendData(msg, strlen(msg));
+}
+
+
+/**
+ * @brief Function to be called when the CDC transfer is completed
+ * 
+ * Starts the next transfer right away if the TX ring is not empty. The
+ * function is registered automatically unless RM_USBD_LEGACY_ITF is defined,
+ * in which case it should be called from CDC_TransmitCplt_FS().
+ */
+void rmUSBDTransmitCplt() {
+    rmTxOn = false;
+    rmUSBDTransmit();
+}
+
+
+#ifndef RM_USBD_LEGACY_ITF
+static int8_t rmUSBDTransmitCpltCallback(uint8_t *Buf, uint32_t *Len,
+                                         uint8_t epnum)
+{
+    rmUSBDTransmitCplt();
+    return 0U;
+}
+#endif
+
+
 /**
  * @brief Initializes the USB device connection
  */
 void rmConnectUSBD() {
     USBD_CDC_ItfTypeDef* fops = (USBD_CDC_ItfTypeDef*) hUsbDeviceFS.pUserData;
     fops->Receive = rmUSBDReceive;
+    #ifndef RM_USBD_LEGACY_ITF
+    fops->TransmitCplt = rmUSBDTransmitCpltCallback;
+    #endif
     _rmSendMessage = rmUSBDSendMessage;
+    _rmSendData = rmUSBDSendData;
     _rmConnectionIdle = rmUSBDTransmit;
 }
 
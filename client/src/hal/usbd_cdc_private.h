@@ -21,6 +21,7 @@ extern "C" {
 #define __IO volatile
 
 #define CDC_DATA_HS_MAX_PACKET_SIZE 512U
+#define CDC_DATA_FS_MAX_PACKET_SIZE 64U
 
 
 typedef struct {
@@ -42,6 +43,9 @@ typedef struct _USBD_CDC_Itf {
     int8_t (*DeInit)();
     int8_t (*Control)(uint8_t cmd, uint8_t *pbuf, uint16_t length);
     int8_t (*Receive)(uint8_t *Buf, uint32_t *Len);
+#ifndef RM_USBD_LEGACY_ITF
+    int8_t (*TransmitCplt)(uint8_t *Buf, uint32_t *Len, uint8_t epnum);
+#endif
 } USBD_CDC_ItfTypeDef;
 
 
@@ -101,6 +101,18 @@ void rmInputAttributeSetOnChange(const char* key, void (*func)());
 void rmOutputAttributeUpdate(rmOutputAttribute *attr);
 
 
+/**
+ * @brief Sends the attribute to the station in a binary frame
+ * 
+ * The frame carries the name, the data type code and the value in its native
+ * encoding, which saves the conversion to text on the client.
+ * A string longer than what the frame holds is cut.
+ * 
+ * @param attr The attribute
+ */
+void rmOutputAttributeUpdateBinary(rmOutputAttribute *attr);
+
+
 /**
  * @brief Converts the output attribute data to a string
  * 
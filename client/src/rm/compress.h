@@ -0,0 +1,69 @@
+/**
+ * @file compress.h
+ * @brief Compresses the command-lines sent to the station
+ * 
+ * Meant for the devices which stay on the text protocol over slow links.
+ * The repeated parts of the lines, like the values of a sync table that
+ * hardly change from one update to the next, are sent as 2-byte references
+ * to the last RM_COMPRESS_WINDOW characters sent. The characters below 128
+ * are sent as they are, so the lines stay readable apart from the
+ * references, and the binary frames are left alone.
+ * 
+ * The station asks for the compression once the device has offered it in
+ * the handshake. The station has to use the same window size.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_COMPRESS_H__
+#define __RM_COMPRESS_H__ ///< Header guard
+
+
+#include <stdbool.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * @brief Number of characters sent that the references can point into
+ * 
+ * 64, 128 or 256. Takes this many bytes of RAM and 64 more for the index.
+ */
+#ifndef RM_COMPRESS_WINDOW
+#define RM_COMPRESS_WINDOW 128
+#endif
+
+/**
+ * @brief Number of lines after which the window starts again empty
+ * 
+ * Limits how long the station stays out of step after losing bytes.
+ */
+#ifndef RM_COMPRESS_KEYFRAME_INTERVAL
+#define RM_COMPRESS_KEYFRAME_INTERVAL 32
+#endif
+
+
+/**
+ * @brief Offers the compression to the station
+ * 
+ * Call it after the port is connected, and after rmSetEncryptionKey() if
+ * the connection is also encrypted. The compression starts when the
+ * station asks for it.
+ * 
+ * @param en True for enable and false for otherwise
+ */
+void rmSetCompression(bool en);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -34,6 +34,16 @@ extern "C" {
 void rmProcessMessage();
 
 
+/**
+ * @brief Sets the name the station shows for the device
+ * 
+ * The name is sent to the station when it connects.
+ * 
+ * @param name The device name (maximum length is 31)
+ */
+void rmSetDeviceName(const char* name);
+
+
 /**
  * @brief Sends a command-line to the station
  * 
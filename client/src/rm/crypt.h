@@ -0,0 +1,72 @@
+/**
+ * @file crypt.h
+ * @brief Encrypts the connection to the station
+ * 
+ * The device and the station agree on a shared secret with X25519 from the
+ * device's key and the station's public key, which stays the same for the
+ * pair and is worked out once here. Each connection derives a pair of
+ * session keys from the secret and a nonce from each side, and everything
+ * after that is sealed with ChaCha20-Poly1305. The messages that fail the
+ * check or come again are dropped.
+ * 
+ * The station's public key is the file "<key>.pub" made by rmGenerateKey()
+ * on the station, and the station only talks to the devices whose public
+ * keys are in its file "<key>.known". The device nonce is derived from a
+ * seed the application gives for each boot and a count of the key
+ * exchanges, so the session keys are new even for a station nonce that
+ * comes again.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_CRYPT_H__
+#define __RM_CRYPT_H__ ///< Header guard
+
+
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define RM_KEY_SIZE 32 ///< Size of the private and public keys
+#define RM_CRYPT_SEED_SIZE 16 ///< Size of the seed of the device nonces
+
+
+/**
+ * @brief Sets the keys and encrypts the connection from now on
+ * 
+ * Call it after the port is connected. Takes the time of two X25519
+ * operations, so it is better called once at startup. From then on, the
+ * device only takes the messages sealed for the station with the private key
+ * and sends nothing until that station has connected.
+ * 
+ * @param devicePrivate The device's private key, 32 random bytes
+ * @param stationPublic The station's public key
+ * @param seed RM_CRYPT_SEED_SIZE bytes which are never the same at two
+ *             boots, from a hardware random number generator or a count of
+ *             the boots kept in flash. The device nonces are derived from it.
+ */
+void rmSetEncryptionKey(const uint8_t* devicePrivate,
+                        const uint8_t* stationPublic, const uint8_t* seed);
+
+
+/**
+ * @brief Gets the device's public key
+ * 
+ * @param pub Output buffer of RM_KEY_SIZE bytes
+ */
+void rmGetPublicKey(uint8_t* pub);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -12,6 +12,34 @@
 #ifndef __RM_USBD_CDC_H__
 #define __RM_USBD_CDC_H__ ///< Header guard
 
+
+/**
+ * @brief Maximum number of bytes handed to the USB peripheral per transfer
+ * 
+ * The transfer is split into 64-byte full-speed packets by the peripheral.
+ * Larger values reduce the per-transfer overhead at the cost of RAM.
+ */
+#ifndef RM_USBD_TX_TRANSFER_SIZE
+#define RM_USBD_TX_TRANSFER_SIZE 512
+#endif
+
+/**
+ * @brief Whether to end a transfer of whole packets with a zero-length packet
+ * 
+ * The host only completes a transfer of whole 64-byte packets once a short
+ * packet arrives. The middleware with the TransmitCplt callback sends the
+ * zero-length packet itself before calling it, so it is only sent from here
+ * with RM_USBD_LEGACY_ITF by default.
+ */
+#ifndef RM_USBD_SEND_ZLP
+#ifdef RM_USBD_LEGACY_ITF
+#define RM_USBD_SEND_ZLP 1
+#else
+#define RM_USBD_SEND_ZLP 0
+#endif
+#endif
+
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -22,6 +50,15 @@ extern "C" {
  */
 void rmConnectUSBD();
 
+/**
+ * @brief Function to be called when the CDC transfer is completed
+ * 
+ * Starts the next transfer right away if the TX ring is not empty. The
+ * function is registered automatically unless RM_USBD_LEGACY_ITF is defined,
+ * in which case it should be called from CDC_TransmitCplt_FS().
+ */
+void rmUSBDTransmitCplt();
+
 
 #ifdef __cplusplus
 }
@@ -25,6 +25,38 @@ extern "C" {
 #endif
 
 
+/**
+ * @brief Number of delta updates between two full keyframes by default
+ */
+#ifndef RM_SYNC_KEYFRAME_INTERVAL
+#define RM_SYNC_KEYFRAME_INTERVAL 20
+#endif
+
+/**
+ * @brief Maximum number of times a table period is doubled on saturation
+ */
+#ifndef RM_SYNC_MAX_DEGRADE
+#define RM_SYNC_MAX_DEGRADE 4
+#endif
+
+/**
+ * @brief Interval in milliseconds at which the scheduled rates are adjusted
+ */
+#ifndef RM_SYNC_ADJUST_INTERVAL
+#define RM_SYNC_ADJUST_INTERVAL 100
+#endif
+
+
+/**
+ * @brief Flags for how a sync table is sent to the station
+ */
+typedef enum _rmSyncMode {
+    RM_SYNC_FULL   = 0b00000000, ///< Sends every attribute as a text line
+    RM_SYNC_DELTA  = 0b00000001, ///< Sends only the changed attributes
+    RM_SYNC_BINARY = 0b00000010  ///< Sends a binary frame instead of text
+} rmSyncMode;
+
+
 /**
  * @brief Creates a new sync table
  * 
@@ -45,9 +77,45 @@ void rmCreateOutputAttribute(const char* key, void* ptr, rmAttributeDataType t,
                              uint8_t sync_id);
 
 
+/**
+ * @brief Sets how the sync table is sent
+ * 
+ * @param id The sync table ID
+ * @param mode Combination of rmSyncMode flags
+ */
+void rmSyncSetMode(uint8_t id, uint8_t mode);
+
+
+/**
+ * @brief Sets the number of updates between two full keyframes in delta mode
+ * 
+ * @param id The sync table ID
+ * @param n Number of updates. 0 sends a keyframe only on the station's
+ *          request.
+ */
+void rmSyncSetKeyframeInterval(uint8_t id, uint8_t n);
+
+
+/**
+ * @brief Publishes the sync table automatically at a target rate
+ * 
+ * The tables due are sent from rmProcessMessage() in the order of priority.
+ * When the TX buffer cannot keep up, the tables with lower priority are slowed
+ * down first by doubling their periods.
+ * 
+ * @param id The sync table ID
+ * @param hz Number of updates per second. 0 stops the automatic updates.
+ * @param priority Priority of the table. 0 is the highest.
+ */
+void rmSyncSetRate(uint8_t id, uint16_t hz, uint8_t priority);
+
+
 /**
  * @brief Performs an update operation for all the attributes in the table
  * 
+ * In delta mode, only the attributes changed since the last update are sent
+ * and nothing is sent if there is no change.
+ * 
  * @param id The sync table ID
  */
 void rmSyncUpdate(uint8_t id);
@@ -16,6 +16,8 @@
 #include "rm/call.h"
 #include "call_private.h"
 
+#include "connection_private.h"
+
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -51,6 +53,8 @@ static uint8_t binarySearch(int8_t low, int8_t high, const char* key) {
 
 
 rmCall* _rmCallGet(const char* key) {
+    if(count == 0)
+        return NULL;
     uint8_t pos = binarySearch(0, count - 1, key);
     if(cmp == 0)
         return &calls[pos];
@@ -58,6 +62,31 @@ rmCall* _rmCallGet(const char* key) {
 }
 
 
+// Lists the names of the calls for the station's connect handshake
+void _rmDescribeCalls() {
+    char msg[256] = "$lsc ";
+    uint8_t len = 5;
+    for(uint8_t i=0; i<count; i++) {
+        uint8_t n = strlen(calls[i].name);
+        if(len + n + 3 > 248) {
+            msg[len++] = '\n';
+            msg[len] = '\0';
+            _rmSendMessage(msg);
+            len = 5;
+        }
+        if(len > 5)
+            msg[len++] = ',';
+        memcpy(msg + len, calls[i].name, n);
+        len += n;
+    }
+    if(len > 5) {
+        msg[len++] = '\n';
+        msg[len] = '\0';
+        _rmSendMessage(msg);
+    }
+}
+
+
 /**
  * @brief Creates a named callback and appends it to the list
  * 
@@ -0,0 +1,459 @@
+/**
+ * @file rm_cipher.c
+ * @brief ChaCha20, Poly1305 and X25519
+ * 
+ * The algorithms of RFC 8439 and RFC 7748 in plain C, small and fast enough
+ * for microcontrollers. The station builds this same file into its library,
+ * so both ends of a connection run the same code.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#include "cipher_private.h"
+
+#include <stddef.h>
+#include <string.h>
+
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define QUARTER_ROUND(a, b, c, d) \
+    a += b; d ^= a; d = ROTL32(d, 16); \
+    c += d; b ^= c; b = ROTL32(b, 12); \
+    a += b; d ^= a; d = ROTL32(d, 8); \
+    c += d; b ^= c; b = ROTL32(b, 7)
+
+
+static void chachaInit(uint32_t* s, const uint8_t* key, const uint8_t* in) {
+    s[0] = 0x61707865;
+    s[1] = 0x3320646e;
+    s[2] = 0x79622d32;
+    s[3] = 0x6b206574;
+    for(uint8_t i=0; i<8; i++)
+        s[4 + i] = _rmLoad32(&key[4 * i]);
+    for(uint8_t i=0; i<4; i++)
+        s[12 + i] = _rmLoad32(&in[4 * i]);
+}
+
+
+static void chachaRounds(uint32_t* x) {
+    for(uint8_t i=0; i<10; i++) {
+        QUARTER_ROUND(x[0], x[4], x[8],  x[12]);
+        QUARTER_ROUND(x[1], x[5], x[9],  x[13]);
+        QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+        QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+        QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+        QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+        QUARTER_ROUND(x[2], x[7], x[8],  x[13]);
+        QUARTER_ROUND(x[3], x[4], x[9],  x[14]);
+    }
+}
+
+
+/**
+ * @brief Makes one 64-byte block of the ChaCha20 keystream
+ * 
+ * @param out The block
+ * @param key The key of 32 bytes
+ * @param counter The block counter
+ * @param nonce The nonce of 12 bytes
+ */
+void _rmChachaBlock(uint8_t* out, const uint8_t* key, uint32_t counter,
+                    const uint8_t* nonce)
+{
+    uint8_t in[16];
+    uint32_t s[16];
+    uint32_t x[16];
+    _rmStore32(in, counter);
+    memcpy(&in[4], nonce, 12);
+    chachaInit(s, key, in);
+    memcpy(x, s, sizeof(x));
+    chachaRounds(x);
+    for(uint8_t i=0; i<16; i++)
+        _rmStore32(&out[4 * i], x[i] + s[i]);
+}
+
+
+/**
+ * @brief Derives a key from a key and 16 bytes of input with HChaCha20
+ * 
+ * @param out The key of 32 bytes
+ * @param key The key of 32 bytes to derive from
+ * @param in The input of 16 bytes
+ */
+void _rmHChacha(uint8_t* out, const uint8_t* key, const uint8_t* in) {
+    uint32_t x[16];
+    chachaInit(x, key, in);
+    chachaRounds(x);
+    for(uint8_t i=0; i<4; i++) {
+        _rmStore32(&out[4 * i], x[i]);
+        _rmStore32(&out[16 + 4 * i], x[12 + i]);
+    }
+}
+
+
+/**
+ * @brief Encrypts or decrypts in place with ChaCha20
+ * 
+ * @param data The bytes
+ * @param len Number of bytes
+ * @param key The key of 32 bytes
+ * @param counter The counter of the first block
+ * @param nonce The nonce of 12 bytes
+ */
+void _rmChachaXor(uint8_t* data, size_t len, const uint8_t* key,
+                  uint32_t counter, const uint8_t* nonce)
+{
+    uint8_t block[64];
+    while(len > 0) {
+        _rmChachaBlock(block, key, counter++, nonce);
+        uint8_t n = (len < 64) ? len : 64;
+        for(uint8_t i=0; i<n; i++)
+            data[i] ^= block[i];
+        data += n;
+        len -= n;
+    }
+}
+
+
+
+
+typedef struct _poly1305 {
+    uint32_t r[5];
+    uint32_t h[5];
+    uint32_t pad[4];
+} poly1305;
+
+
+static void polyInit(poly1305* p, const uint8_t* key) {
+    p->r[0] = _rmLoad32(&key[0]) & 0x3ffffff;
+    p->r[1] = (_rmLoad32(&key[3]) >> 2) & 0x3ffff03;
+    p->r[2] = (_rmLoad32(&key[6]) >> 4) & 0x3ffc0ff;
+    p->r[3] = (_rmLoad32(&key[9]) >> 6) & 0x3f03fff;
+    p->r[4] = (_rmLoad32(&key[12]) >> 8) & 0x00fffff;
+    for(uint8_t i=0; i<5; i++)
+        p->h[i] = 0;
+    for(uint8_t i=0; i<4; i++)
+        p->pad[i] = _rmLoad32(&key[16 + 4 * i]);
+}
+
+
+// Adds whole 16-byte blocks with the limbs of 26 bits. The bit above each
+// block is 1 << 24 in the top limb, or 0 for a short last block padded by
+// the caller.
+static void polyBlocks(poly1305* p, const uint8_t* m, size_t len,
+                       uint32_t hibit)
+{
+    const uint32_t r0 = p->r[0], r1 = p->r[1], r2 = p->r[2];
+    const uint32_t r3 = p->r[3], r4 = p->r[4];
+    const uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+    uint32_t h0 = p->h[0], h1 = p->h[1], h2 = p->h[2];
+    uint32_t h3 = p->h[3], h4 = p->h[4];
+    
+    while(len >= 16) {
+        h0 += _rmLoad32(&m[0]) & 0x3ffffff;
+        h1 += (_rmLoad32(&m[3]) >> 2) & 0x3ffffff;
+        h2 += (_rmLoad32(&m[6]) >> 4) & 0x3ffffff;
+        h3 += (_rmLoad32(&m[9]) >> 6) & 0x3ffffff;
+        h4 += (_rmLoad32(&m[12]) >> 8) | hibit;
+        
+        uint64_t d0 = (uint64_t) h0 * r0 + (uint64_t) h1 * s4 +
+                      (uint64_t) h2 * s3 + (uint64_t) h3 * s2 +
+                      (uint64_t) h4 * s1;
+        uint64_t d1 = (uint64_t) h0 * r1 + (uint64_t) h1 * r0 +
+                      (uint64_t) h2 * s4 + (uint64_t) h3 * s3 +
+                      (uint64_t) h4 * s2;
+        uint64_t d2 = (uint64_t) h0 * r2 + (uint64_t) h1 * r1 +
+                      (uint64_t) h2 * r0 + (uint64_t) h3 * s4 +
+                      (uint64_t) h4 * s3;
+        uint64_t d3 = (uint64_t) h0 * r3 + (uint64_t) h1 * r2 +
+                      (uint64_t) h2 * r1 + (uint64_t) h3 * r0 +
+                      (uint64_t) h4 * s4;
+        uint64_t d4 = (uint64_t) h0 * r4 + (uint64_t) h1 * r3 +
+                      (uint64_t) h2 * r2 + (uint64_t) h3 * r1 +
+                      (uint64_t) h4 * r0;
+        
+        uint32_t c;
+        c = (uint32_t) (d0 >> 26); h0 = (uint32_t) d0 & 0x3ffffff;
+        d1 += c; c = (uint32_t) (d1 >> 26); h1 = (uint32_t) d1 & 0x3ffffff;
+        d2 += c; c = (uint32_t) (d2 >> 26); h2 = (uint32_t) d2 & 0x3ffffff;
+        d3 += c; c = (uint32_t) (d3 >> 26); h3 = (uint32_t) d3 & 0x3ffffff;
+        d4 += c; c = (uint32_t) (d4 >> 26); h4 = (uint32_t) d4 & 0x3ffffff;
+        h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+        h1 += c;
+        
+        m += 16;
+        len -= 16;
+    }
+    
+    p->h[0] = h0;
+    p->h[1] = h1;
+    p->h[2] = h2;
+    p->h[3] = h3;
+    p->h[4] = h4;
+}
+
+
+static void polyFinish(poly1305* p, uint8_t* tag) {
+    uint32_t h0 = p->h[0], h1 = p->h[1], h2 = p->h[2];
+    uint32_t h3 = p->h[3], h4 = p->h[4];
+    uint32_t c;
+    c = h1 >> 26; h1 &= 0x3ffffff;
+    h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+    h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+    h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+    h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+    h1 += c;
+    
+    // h - p, kept if it does not borrow
+    uint32_t g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+    uint32_t g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+    uint32_t g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+    uint32_t g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+    uint32_t g4 = h4 + c - (1 << 26);
+    uint32_t mask = (g4 >> 31) - 1;
+    h0 = (h0 & ~mask) | (g0 & mask);
+    h1 = (h1 & ~mask) | (g1 & mask);
+    h2 = (h2 & ~mask) | (g2 & mask);
+    h3 = (h3 & ~mask) | (g3 & mask);
+    h4 = (h4 & ~mask) | (g4 & mask);
+    
+    h0 = h0 | (h1 << 26);
+    h1 = (h1 >> 6) | (h2 << 20);
+    h2 = (h2 >> 12) | (h3 << 14);
+    h3 = (h3 >> 18) | (h4 << 8);
+    
+    uint64_t f;
+    f = (uint64_t) h0 + p->pad[0];
+    _rmStore32(&tag[0], (uint32_t) f);
+    f = (uint64_t) h1 + p->pad[1] + (f >> 32);
+    _rmStore32(&tag[4], (uint32_t) f);
+    f = (uint64_t) h2 + p->pad[2] + (f >> 32);
+    _rmStore32(&tag[8], (uint32_t) f);
+    f = (uint64_t) h3 + p->pad[3] + (f >> 32);
+    _rmStore32(&tag[12], (uint32_t) f);
+}
+
+
+// Adds the bytes padded with zeros to a whole number of blocks
+static void polyPadded(poly1305* p, const uint8_t* m, size_t len) {
+    uint8_t block[16];
+    polyBlocks(p, m, len & ~15, 1 << 24);
+    if(len & 15) {
+        memset(block, 0, 16);
+        memcpy(block, &m[len & ~15], len & 15);
+        polyBlocks(p, block, 16, 1 << 24);
+    }
+}
+
+
+/**
+ * @brief Works out the Poly1305 tag of a message
+ * 
+ * @param tag The tag of 16 bytes
+ * @param msg The message
+ * @param len Length of the message
+ * @param key The one-time key of 32 bytes
+ */
+void _rmPoly1305(uint8_t* tag, const uint8_t* msg, size_t len,
+                 const uint8_t* key)
+{
+    poly1305 p;
+    uint8_t block[16];
+    polyInit(&p, key);
+    polyBlocks(&p, msg, len & ~15, 1 << 24);
+    if(len & 15) {
+        // The last block is padded with a 1 and not counted as full
+        memset(block, 0, 16);
+        memcpy(block, &msg[len & ~15], len & 15);
+        block[len & 15] = 1;
+        polyBlocks(&p, block, 16, 0);
+    }
+    polyFinish(&p, tag);
+}
+
+
+/**
+ * @brief Works out the tag of ChaCha20-Poly1305
+ * 
+ * @param tag The tag of 16 bytes
+ * @param aad The associated data. Null if there is none.
+ * @param aadLen Length of the associated data
+ * @param ct The ciphertext
+ * @param len Length of the ciphertext
+ * @param key The key of 32 bytes
+ * @param nonce The nonce of 12 bytes
+ */
+void _rmAeadTag(uint8_t* tag, const uint8_t* aad, size_t aadLen,
+                const uint8_t* ct, size_t len, const uint8_t* key,
+                const uint8_t* nonce)
+{
+    uint8_t block[64];
+    poly1305 p;
+    _rmChachaBlock(block, key, 0, nonce);
+    polyInit(&p, block);
+    polyPadded(&p, aad, aadLen);
+    polyPadded(&p, ct, len);
+    memset(block, 0, 16);
+    _rmStore32(&block[0], (uint32_t) aadLen);
+    _rmStore32(&block[8], (uint32_t) len);
+    polyBlocks(&p, block, 16, 1 << 24);
+    polyFinish(&p, tag);
+}
+
+
+
+
+typedef int64_t fe[16];
+
+static const fe fe121665 = {0xdb41, 1};
+
+
+static void feCarry(fe o) {
+    for(uint8_t i=0; i<16; i++) {
+        o[i] += (int64_t) 1 << 16;
+        int64_t c = o[i] >> 16;
+        if(i < 15)
+            o[i + 1] += c - 1;
+        else
+            o[0] += 38 * (c - 1);
+        o[i] -= c * 65536;
+    }
+}
+
+
+// Swaps p and q if b is 1 without branching on it
+static void feSwap(fe p, fe q, int64_t b) {
+    int64_t c = ~(b - 1);
+    for(uint8_t i=0; i<16; i++) {
+        int64_t t = c & (p[i] ^ q[i]);
+        p[i] ^= t;
+        q[i] ^= t;
+    }
+}
+
+
+static void fePack(uint8_t* o, const fe n) {
+    fe m, t;
+    memcpy(t, n, sizeof(fe));
+    feCarry(t);
+    feCarry(t);
+    feCarry(t);
+    for(uint8_t j=0; j<2; j++) {
+        m[0] = t[0] - 0xffed;
+        for(uint8_t i=1; i<15; i++) {
+            m[i] = t[i] - 0xffff - ((m[i - 1] >> 16) & 1);
+            m[i - 1] &= 0xffff;
+        }
+        m[15] = t[15] - 0x7fff - ((m[14] >> 16) & 1);
+        int64_t b = (m[15] >> 16) & 1;
+        m[14] &= 0xffff;
+        feSwap(t, m, 1 - b);
+    }
+    for(uint8_t i=0; i<16; i++) {
+        o[2 * i] = (uint8_t) t[i];
+        o[2 * i + 1] = (uint8_t) (t[i] >> 8);
+    }
+}
+
+
+static void feUnpack(fe o, const uint8_t* n) {
+    for(uint8_t i=0; i<16; i++)
+        o[i] = n[2 * i] + ((int64_t) n[2 * i + 1] << 8);
+    o[15] &= 0x7fff;
+}
+
+
+static void feAdd(fe o, const fe a, const fe b) {
+    for(uint8_t i=0; i<16; i++)
+        o[i] = a[i] + b[i];
+}
+
+
+static void feSub(fe o, const fe a, const fe b) {
+    for(uint8_t i=0; i<16; i++)
+        o[i] = a[i] - b[i];
+}
+
+
+static void feMul(fe o, const fe a, const fe b) {
+    int64_t t[31];
+    memset(t, 0, sizeof(t));
+    for(uint8_t i=0; i<16; i++) {
+        for(uint8_t j=0; j<16; j++)
+            t[i + j] += a[i] * b[j];
+    }
+    for(uint8_t i=0; i<15; i++)
+        t[i] += 38 * t[i + 16];
+    memcpy(o, t, sizeof(fe));
+    feCarry(o);
+    feCarry(o);
+}
+
+
+static void feInvert(fe o, const fe in) {
+    fe c;
+    memcpy(c, in, sizeof(fe));
+    for(int a=253; a>=0; a--) {
+        feMul(c, c, c);
+        if(a != 2 && a != 4)
+            feMul(c, c, in);
+    }
+    memcpy(o, c, sizeof(fe));
+}
+
+
+/**
+ * @brief Multiplies a point on Curve25519 by a scalar with X25519
+ * 
+ * The Montgomery ladder of RFC 7748, in constant time.
+ * 
+ * @param out The resulting point of 32 bytes
+ * @param scalar The scalar of 32 bytes, clamped here
+ * @param point The point of 32 bytes
+ */
+void _rmX25519(uint8_t* out, const uint8_t* scalar, const uint8_t* point) {
+    uint8_t z[32];
+    fe x, a, b, c, d, e, f;
+    memcpy(z, scalar, 32);
+    z[31] = (z[31] & 127) | 64;
+    z[0] &= 248;
+    feUnpack(x, point);
+    for(uint8_t i=0; i<16; i++) {
+        b[i] = x[i];
+        a[i] = c[i] = d[i] = 0;
+    }
+    a[0] = d[0] = 1;
+    
+    for(int i=254; i>=0; i--) {
+        int64_t r = (z[i >> 3] >> (i & 7)) & 1;
+        feSwap(a, b, r);
+        feSwap(c, d, r);
+        feAdd(e, a, c);
+        feSub(a, a, c);
+        feAdd(c, b, d);
+        feSub(b, b, d);
+        feMul(d, e, e);
+        feMul(f, a, a);
+        feMul(a, c, a);
+        feMul(c, b, e);
+        feAdd(e, a, c);
+        feSub(a, a, c);
+        feMul(b, a, a);
+        feSub(c, d, f);
+        feMul(a, c, fe121665);
+        feAdd(a, a, d);
+        feMul(c, c, a);
+        feMul(a, d, f);
+        feMul(d, b, x);
+        feMul(b, e, e);
+        feSwap(a, b, r);
+        feSwap(c, d, r);
+    }
+    feInvert(c, c);
+    feMul(a, a, c);
+    fePack(out, a);
+}
@@ -0,0 +1,194 @@
+/**
+ * @file rm_compress.c
+ * @brief Compresses the command-lines sent to the station
+ * 
+ * An LZ77 coder over a small window of the characters sent. The bytes from
+ * 0x80 to 0xFB start a reference, with the length less 3 in the low bits
+ * and the distance back into the window in the next byte. Each line starts
+ * with either a reset of the window to the primer both sides know, or a
+ * CRC-8 of the window with which the station finds out that it has lost
+ * bytes. The matches are looked up in a 64-entry table of the 3-character
+ * sequences, so each character costs a hash and one comparison.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#include "rm/compress.h"
+#include "connection_private.h"
+
+#include "rm/connection.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+#define CODE_MATCH  0x80 ///< Up to 0xFB with the length less 3
+#define CODE_ESCAPE 0xFC ///< A character of 128 and above follows
+#define CODE_RESET  0xFD ///< The window starts again from the primer
+#define CODE_CHECK  0xFE ///< The CRC-8 of the window follows
+
+#define MIN_MATCH 3
+#define MAX_MATCH (CODE_ESCAPE - 1 - CODE_MATCH + MIN_MATCH)
+#define INDEX_SIZE 64
+#define WINDOW_MASK (RM_COMPRESS_WINDOW - 1)
+
+
+// What the window holds after a reset, the same as on the station
+static const char primer[] = "$sync $syncd $set $echo $resp 0.000,-0.0";
+
+static uint8_t window[RM_COMPRESS_WINDOW];
+static uint8_t position = 0;
+static uint8_t lookup[INDEX_SIZE];
+static uint8_t lines = 0;
+static bool active = false;
+
+static void (*sendMessageNext)(const char*) = NULL;
+
+static uint8_t out[32];
+static uint8_t outLen = 0;
+
+
+static uint8_t hash(uint8_t a, uint8_t b, uint8_t c) {
+    return ((a << 4) ^ (b << 2) ^ c ^ (c >> 3)) & (INDEX_SIZE - 1);
+}
+
+
+static void insert(uint8_t c) {
+    window[position & WINDOW_MASK] = c;
+    position++;
+    uint8_t p = position - MIN_MATCH;
+    lookup[hash(window[p & WINDOW_MASK], window[(p + 1) & WINDOW_MASK],
+               window[(p + 2) & WINDOW_MASK])] = p;
+}
+
+
+static void reset() {
+    memset(window, 0, sizeof(window));
+    memset(lookup, 0, sizeof(lookup));
+    position = 0;
+    for(uint8_t i=0; primer[i] != '\0'; i++)
+        insert(primer[i]);
+}
+
+
+static uint8_t checksum() {
+    uint8_t crc = 0;
+    for(uint16_t i=0; i<RM_COMPRESS_WINDOW; i+=64)
+        crc = _rmCrc8(crc, &window[i], 64);
+    return crc;
+}
+
+
+static void emit(uint8_t c) {
+    out[outLen++] = c;
+    if(outLen == sizeof(out)) {
+        _rmSendData(out, outLen);
+        outLen = 0;
+    }
+}
+
+
+static void sendMessage(const char* msg) {
+    if(!active) {
+        sendMessageNext(msg);
+        return;
+    }
+    
+    const uint8_t* str = (const uint8_t*) msg;
+    uint16_t len = strlen(msg);
+    if(str[0] == '$') {
+        if(++lines >= RM_COMPRESS_KEYFRAME_INTERVAL) {
+            lines = 0;
+            reset();
+            emit(CODE_RESET);
+        }
+        else {
+            emit(CODE_CHECK);
+            emit(checksum());
+        }
+    }
+    
+    uint16_t i = 0;
+    while(i < len) {
+        uint8_t n = 0;
+        uint8_t dist = 0;
+        if(i + MIN_MATCH <= len) {
+            uint8_t from = lookup[hash(str[i], str[i + 1], str[i + 2])];
+            dist = position - from;
+            // The match ends before the characters it is being compared to
+            while(n < dist && n < MAX_MATCH && i + n < len &&
+                  window[(from + n) & WINDOW_MASK] == str[i + n])
+                n++;
+            if(dist >= RM_COMPRESS_WINDOW)
+                n = 0;
+        }
+        
+        if(n >= MIN_MATCH) {
+            emit(CODE_MATCH + n - MIN_MATCH);
+            emit(dist);
+        }
+        else {
+            n = 1;
+            // The start of a binary frame never shows up in a line
+            if(str[i] == RM_FRAME_START) {
+                i++;
+                continue;
+            }
+            if(str[i] >= CODE_MATCH)
+                emit(CODE_ESCAPE);
+            emit(str[i]);
+        }
+        for(uint8_t j=0; j<n; j++)
+            insert(str[i + j]);
+        i += n;
+    }
+    
+    if(outLen > 0) {
+        _rmSendData(out, outLen);
+        outLen = 0;
+    }
+}
+
+
+/*
+ * Starts or stops the compression. The station asks with "$compress" and
+ * the device answers with the window size before the first compressed
+ * line. Both sides start from the primer. A new connection stops it without
+ * a word.
+ */
+static void setCompressed(bool en, bool reply) {
+    if(en && !active) {
+        rmSendCommand("compress 1 %d", RM_COMPRESS_WINDOW);
+        reset();
+        lines = 0;
+        active = true;
+    }
+    else if(!en && active) {
+        active = false;
+        if(reply)
+            rmSendCommand("compress 0");
+    }
+}
+
+
+/**
+ * @brief Offers the compression to the station
+ * 
+ * Call it after the port is connected, and after rmSetEncryptionKey() if
+ * the connection is also encrypted. The compression starts when the
+ * station asks for it.
+ * 
+ * @param en True for enable and false for otherwise
+ */
+void rmSetCompression(bool en) {
+    if(sendMessageNext == NULL) {
+        sendMessageNext = _rmSendMessage;
+        _rmSendMessage = &sendMessage;
+    }
+    active = false;
+    _rmCompressSet = en ? &setCompressed : NULL;
+}
@@ -27,11 +27,11 @@ uint8_t rmRxHead = 0;
 uint8_t rmRxTail = 0;
 
 char rmTxBuffer[RM_TX_BUFFER_SIZE];
-uint8_t rmTxHead = 0;
-uint8_t rmTxTail = 0;
+volatile uint16_t rmTxHead = 0;
+volatile uint16_t rmTxTail = 0;
 
 bool rmRxOn = false;
-bool rmTxOn = false;
+volatile bool rmTxOn = false;
 
 
 
@@ -49,12 +49,76 @@ static char readDefault() {
 
 static void sendMessageDefault(const char* msg) {}
 
+static void sendDataDefault(const void* data, uint16_t len) {}
+
+static uint16_t txSpaceDefault() {
+    return (rmTxTail + RM_TX_BUFFER_SIZE - rmTxHead - 1) % RM_TX_BUFFER_SIZE;
+}
+
 char (*_rmRead)() = &readDefault;
 
 void (*_rmSendMessage)(const char*) = &sendMessageDefault;
 
+void (*_rmSendData)(const void*, uint16_t) = &sendDataDefault;
+
 void (*_rmConnectionIdle)() = NULL;
 
+uint16_t (*_rmTxSpace)() = &txSpaceDefault;
+
+void (*_rmSyncScheduler)() = NULL;
+
+void (*_rmDescribeInputs)() = NULL;
+
+void (*_rmDescribeSyncs)() = NULL;
+
+void (*_rmCryptReceive)(char) = NULL;
+
+void (*_rmCryptFlush)() = NULL;
+
+void (*_rmCompressSet)(bool, bool) = NULL;
+
+
+static char deviceName[32] = "";
+
+
+/**
+ * @brief Sets the name the station shows for the device
+ * 
+ * The name is sent to the station when it connects.
+ * 
+ * @param name The device name (maximum length is 31)
+ */
+void rmSetDeviceName(const char* name) {
+    strncpy(deviceName, name, 31);
+    deviceName[31] = '\0';
+}
+
+
+/*
+ * Replies to the station's "connect" with everything it needs to know about
+ * the device in one burst, so that it does not have to request the attribute
+ * lists one by one once the data starts arriving. The burst ends with
+ * "ready".
+ */
+static void describeDevice() {
+    uint8_t caps = RM_CAP_BINARY | RM_CAP_DELTA | RM_CAP_RATE | RM_CAP_SPLIT;
+    if(_rmCompressSet != NULL) {
+        // A new station starts with the lines uncompressed
+        _rmCompressSet(false, false);
+        caps |= RM_CAP_COMPRESS;
+    }
+    rmSendCommand("hello %d %d %d %d %d", RM_PROTOCOL_VERSION, caps,
+                  RM_RX_BUFFER_SIZE, RM_TX_BUFFER_SIZE, RM_MAX_SYNC_RATE);
+    if(deviceName[0] != '\0')
+        rmSendCommand("name %s", deviceName);
+    if(_rmDescribeInputs != NULL)
+        _rmDescribeInputs();
+    _rmDescribeCalls();
+    if(_rmDescribeSyncs != NULL)
+        _rmDescribeSyncs();
+    rmSendCommand("ready");
+}
+
 
 
 
@@ -63,6 +127,66 @@ void (*_rmConnectionIdle)() = NULL;
 #define PROCESS_SEPERATOR 0b11
 
 
+static char cmd[256];
+static char* tokens[8];
+static uint8_t cmdLen = 0;
+static uint8_t tokenCount = 0;
+static uint8_t flag = PROCESS_DEFAULT;
+
+
+/*
+ * Takes a character of the command-lines from the station. The encryption
+ * passes the characters here once they are decrypted.
+ */
+void _rmProcessChar(char c) {
+    if(cmdLen == 255)
+        c = '\n';
+    
+    if(flag & PROCESS_STARTED) {
+        rmCall* call;
+        switch(c) {
+          case ' ':
+            cmd[cmdLen++] = '\0';
+            flag = PROCESS_SEPERATOR;
+            break;
+          
+          case '\n':
+            cmd[cmdLen] = '\0';
+            if(strcmp(cmd, "connect") == 0) {
+                describeDevice();
+                flag = PROCESS_DEFAULT;
+                break;
+            }
+            if(strcmp(cmd, "compress") == 0) {
+                if(_rmCompressSet != NULL && tokenCount > 0)
+                    _rmCompressSet(tokens[0][0] != '0', true);
+                flag = PROCESS_DEFAULT;
+                break;
+            }
+            call = _rmCallGet(cmd);
+            if(call != NULL)
+                call->callback(tokenCount, tokens);
+            flag = PROCESS_DEFAULT;
+            break;
+          
+          default:
+            if(flag == PROCESS_SEPERATOR) {
+                if(tokenCount == 8)
+                    break;
+                tokens[tokenCount++] = &cmd[cmdLen];
+                flag = PROCESS_STARTED;
+            }
+            cmd[cmdLen++] = c;
+        }
+    }
+    else if(c == '$') {
+        cmdLen = 0;
+        tokenCount = 0;
+        flag = PROCESS_STARTED;
+    }
+}
+
+
 /**
  * @brief Reads a message and processes it
  */
@@ -70,50 +194,65 @@ void rmProcessMessage() {
     if(_rmConnectionIdle != NULL)
         _rmConnectionIdle();
     
-    static char cmd[256];
-    static char* tokens[8];
-    static uint8_t i = 0;
-    static uint8_t tokenCount = 0;
-    static uint8_t flag = PROCESS_DEFAULT;
-    
     char c = _rmRead();
     while(c != '\0') {
-        if(i == 255)
-            c = '\n';
-        
-        if(flag & PROCESS_STARTED) {
-            rmCall* call;
-            switch(c) {
-              case ' ':
-                cmd[i++] = '\0';
-                flag = PROCESS_SEPERATOR;
-                break;
-                
-              case '\n':
-                cmd[i] = '\0';
-                call = _rmCallGet(cmd);
-                if(call != NULL)
-                    call->callback(tokenCount, tokens);
-                flag = PROCESS_DEFAULT;
-                break;
-                
-              default:
-                if(flag == PROCESS_SEPERATOR) {
-                    if(tokenCount == 8)
-                        break;
-                    tokens[tokenCount++] = &cmd[i];
-                    flag = PROCESS_STARTED;
-                }
-                cmd[i++] = c;
-            }
-        }
-        else if(c == '$') {
-            i = 0;
-            tokenCount = 0;
-            flag = PROCESS_STARTED;
-        }
+        if(_rmCryptReceive != NULL)
+            _rmCryptReceive(c);
+        else
+            _rmProcessChar(c);
         c = _rmRead();
     }
+    
+    if(_rmSyncScheduler != NULL)
+        _rmSyncScheduler();
+    if(_rmCryptFlush != NULL)
+        _rmCryptFlush();
+}
+
+
+// CRC-8 of each nibble with the polynomial 0x07
+static const uint8_t crcTable[16] = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+    0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D
+};
+
+
+/**
+ * @brief Computes the CRC-8 that ends a binary frame
+ * 
+ * @param crc The CRC of the bytes before
+ * @param data The bytes to add
+ * @param len Number of bytes
+ * 
+ * @return The CRC with the bytes added
+ */
+uint8_t _rmCrc8(uint8_t crc, const uint8_t* data, uint8_t len) {
+    while(len--) {
+        crc ^= *data++;
+        crc = (crc << 4) ^ crcTable[crc >> 4];
+        crc = (crc << 4) ^ crcTable[crc >> 4];
+    }
+    return crc;
+}
+
+
+/**
+ * @brief Sends a binary frame to the station
+ * 
+ * The frame is the start byte, the frame type, the payload length, the
+ * payload and a CRC-8 of everything after the start byte.
+ * 
+ * @param type Frame type
+ * @param payload Frame content
+ * @param len Payload length
+ */
+void _rmSendFrame(uint8_t type, const uint8_t* payload, uint8_t len) {
+    uint8_t header[3] = {RM_FRAME_START, type, len};
+    uint8_t crc = _rmCrc8(0, &header[1], 2);
+    crc = _rmCrc8(crc, payload, len);
+    _rmSendData(header, 3);
+    _rmSendData(payload, len);
+    _rmSendData(&crc, 1);
 }
 
 
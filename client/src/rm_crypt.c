@@ -0,0 +1,337 @@
+/**
+ * @file rm_crypt.c
+ * @brief Encrypts the connection to the station
+ * 
+ * The station starts a session with "$crypt" and its nonce, and the device
+ * answers with its public key and its own nonce. Both are sent in the clear
+ * and the rest is sealed with ChaCha20-Poly1305 under the session keys.
+ * While a session is going on, the keys of a new exchange are only taken
+ * once a message sealed with them comes, so a "$crypt" from anyone else
+ * cannot end it.
+ * 
+ * The station's messages come as "$~" lines of the sealed bytes in base64.
+ * The device's messages are staged and sealed in place into one binary frame
+ * of type RM_FRAME_CRYPT, which is handed to the port's TX buffer at the end
+ * of rmProcessMessage() or when the frame is full. A sealed message is the
+ * 32-bit counter used as the nonce, the ciphertext and a 16-byte tag.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#include "rm/crypt.h"
+#include "cipher_private.h"
+#include "connection_private.h"
+
+#include <stddef.h>
+#include <string.h>
+
+
+#ifndef RM_CRYPT_FRAME_SIZE
+#define RM_CRYPT_FRAME_SIZE 235 ///< Largest message sealed in one frame
+#endif
+
+#define RM_CRYPT_NONCE_SIZE 8
+#define RM_CRYPT_TAG_SIZE 16
+#define RM_CRYPT_OVERHEAD 20
+
+
+static uint8_t sharedKey[32];
+static uint8_t publicKey[RM_KEY_SIZE];
+static uint8_t nonceKey[32];
+static uint8_t rxKey[32];
+static uint8_t txKey[32];
+static uint8_t nextRxKey[32];
+static uint8_t nextTxKey[32];
+static uint32_t rxCounter = 0;
+static uint32_t txCounter = 0;
+static uint32_t exchangeCount = 0;
+static bool session = false;
+static bool pending = false;
+
+static void (*sendMessageHal)(const char*) = NULL;
+static void (*sendDataHal)(const void*, uint16_t) = NULL;
+
+// Start byte, type and length, the counter, the message, the tag and CRC
+static uint8_t txFrame[3 + 4 + RM_CRYPT_FRAME_SIZE + RM_CRYPT_TAG_SIZE + 1];
+static uint8_t txLen = 0;
+
+static char rxLine[256];
+static uint16_t rxLen = 0;
+static bool rxStarted = false;
+
+
+static const char hexDigits[] = "0123456789abcdef";
+
+
+static void encodeHex(char* out, const uint8_t* data, uint8_t len) {
+    for(uint8_t i=0; i<len; i++) {
+        *out++ = hexDigits[data[i] >> 4];
+        *out++ = hexDigits[data[i] & 0x0F];
+    }
+    *out = '\0';
+}
+
+
+static bool decodeHex(uint8_t* out, const char* str, uint8_t len) {
+    for(uint8_t i=0; i<2*len; i++) {
+        char c = str[i];
+        uint8_t v;
+        if(c >= '0' && c <= '9')
+            v = c - '0';
+        else if(c >= 'a' && c <= 'f')
+            v = c - 'a' + 10;
+        else if(c >= 'A' && c <= 'F')
+            v = c - 'A' + 10;
+        else
+            return false;
+        if(i & 1)
+            out[i >> 1] = (out[i >> 1] << 4) | v;
+        else
+            out[i >> 1] = v;
+    }
+    return str[2 * len] == '\0';
+}
+
+
+static int8_t base64Value(char c) {
+    if(c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if(c >= 'a' && c <= 'z')
+        return c - 'a' + 26;
+    if(c >= '0' && c <= '9')
+        return c - '0' + 52;
+    if(c == '+')
+        return 62;
+    if(c == '/')
+        return 63;
+    return -1;
+}
+
+
+// Decodes up to the padding or the end, which may be done in place
+static uint16_t decodeBase64(uint8_t* out, const char* str) {
+    uint32_t acc = 0;
+    uint8_t bits = 0;
+    uint16_t n = 0;
+    int8_t v = base64Value(*str++);
+    while(v >= 0) {
+        acc = ((acc << 6) | v) & 0xFFFF;
+        bits += 6;
+        if(bits >= 8) {
+            bits -= 8;
+            out[n++] = (uint8_t) (acc >> bits);
+        }
+        v = base64Value(*str++);
+    }
+    return n;
+}
+
+
+static void flush() {
+    if(txLen == 0 || !session)
+        return;
+    uint8_t nonce[12] = {0};
+    uint8_t* msg = &txFrame[7];
+    _rmStore32(nonce, txCounter);
+    _rmChachaXor(msg, txLen, txKey, 1, nonce);
+    _rmAeadTag(&msg[txLen], NULL, 0, msg, txLen, txKey, nonce);
+    
+    uint8_t len = 4 + txLen + RM_CRYPT_TAG_SIZE;
+    txFrame[0] = RM_FRAME_START;
+    txFrame[1] = RM_FRAME_CRYPT;
+    txFrame[2] = len;
+    _rmStore32(&txFrame[3], txCounter);
+    uint8_t crc = _rmCrc8(0, &txFrame[1], 2);
+    txFrame[3 + len] = _rmCrc8(crc, &txFrame[3], len);
+    sendDataHal(txFrame, len + 4);
+    txCounter++;
+    txLen = 0;
+}
+
+
+static void sendData(const void* data, uint16_t len) {
+    if(!session)
+        return;
+    const uint8_t* ptr = (const uint8_t*) data;
+    while(len > 0) {
+        uint8_t n = RM_CRYPT_FRAME_SIZE - txLen;
+        if(n > len)
+            n = len;
+        memcpy(&txFrame[7 + txLen], ptr, n);
+        txLen += n;
+        ptr += n;
+        len -= n;
+        if(txLen == RM_CRYPT_FRAME_SIZE)
+            flush();
+    }
+}
+
+
+static void sendMessage(const char* msg) {
+    sendData(msg, strlen(msg));
+}
+
+
+// Takes the keys of the last exchange from now on
+static void startSession() {
+    memcpy(rxKey, nextRxKey, 32);
+    memcpy(txKey, nextTxKey, 32);
+    rxCounter = 0;
+    txCounter = 0;
+    txLen = 0;
+    session = true;
+    pending = false;
+    if(_rmCompressSet != NULL)
+        _rmCompressSet(false, false);
+}
+
+
+/*
+ * Answers "$crypt" with the device's public key and nonce. The nonce is a
+ * block of the keystream under the key of this boot for the count of the
+ * exchanges, so it does not come again for the same station nonce. The new
+ * keys are taken at once if there is no session. Otherwise, they wait for a
+ * message sealed with them, as anyone can send "$crypt".
+ */
+static void exchangeKeys(const char* stationNonce) {
+    uint8_t in[16];
+    if(!decodeHex(in, stationNonce, RM_CRYPT_NONCE_SIZE))
+        return;
+    
+    uint8_t nonce[12] = {0};
+    uint8_t block[64];
+    _rmStore32(nonce, ++exchangeCount);
+    _rmChachaBlock(block, nonceKey, 0, nonce);
+    memcpy(&in[8], block, RM_CRYPT_NONCE_SIZE);
+    
+    char reply[8 + 2*RM_KEY_SIZE + 1 + 2*RM_CRYPT_NONCE_SIZE + 2];
+    memcpy(reply, "$crypt ", 7);
+    encodeHex(&reply[7], publicKey, RM_KEY_SIZE);
+    reply[7 + 2*RM_KEY_SIZE] = ' ';
+    encodeHex(&reply[8 + 2*RM_KEY_SIZE], &in[8], RM_CRYPT_NONCE_SIZE);
+    strcat(reply, "\n");
+    sendMessageHal(reply);
+    
+    // The first block under the session key holds both directions' keys
+    uint8_t key[32];
+    _rmStore32(nonce, 0);
+    _rmHChacha(key, sharedKey, in);
+    _rmChachaBlock(block, key, 0, nonce);
+    memcpy(nextRxKey, &block[0], 32);
+    memcpy(nextTxKey, &block[32], 32);
+    pending = true;
+    if(!session)
+        startSession();
+}
+
+
+// Checks a sealed message with a key and opens it in place
+static bool openSealed(uint8_t* buf, uint16_t len, const uint8_t* key) {
+    uint8_t nonce[12] = {0};
+    uint8_t tag[RM_CRYPT_TAG_SIZE];
+    uint8_t diff = 0;
+    memcpy(nonce, buf, 4);
+    _rmAeadTag(tag, NULL, 0, &buf[4], len, key, nonce);
+    for(uint8_t i=0; i<RM_CRYPT_TAG_SIZE; i++)
+        diff |= tag[i] ^ buf[4 + len + i];
+    if(diff != 0)
+        return false;
+    _rmChachaXor(&buf[4], len, key, 1, nonce);
+    return true;
+}
+
+
+static void receiveLine() {
+    if(strncmp(rxLine, "crypt ", 6) == 0) {
+        exchangeKeys(&rxLine[6]);
+        return;
+    }
+    if(rxLine[0] != '~' || !session)
+        return;
+    
+    uint8_t* buf = (uint8_t*) rxLine;
+    uint16_t len = decodeBase64(buf, &rxLine[1]);
+    if(len < RM_CRYPT_OVERHEAD)
+        return;
+    len -= RM_CRYPT_OVERHEAD;
+    uint32_t counter = _rmLoad32(buf);
+    if(counter >= rxCounter && openSealed(buf, len, rxKey)) {
+        rxCounter = counter + 1;
+    }
+    else if(pending && openSealed(buf, len, nextRxKey)) {
+        // The station has the keys of the last exchange
+        startSession();
+        rxCounter = counter + 1;
+    }
+    else {
+        return;
+    }
+    for(uint16_t i=0; i<len; i++)
+        _rmProcessChar((char) buf[4 + i]);
+}
+
+
+static void receive(char c) {
+    if(c == '$') {
+        rxLen = 0;
+        rxStarted = true;
+    }
+    else if(rxStarted) {
+        if(c == '\n' || rxLen == sizeof(rxLine) - 1) {
+            rxLine[rxLen] = '\0';
+            rxStarted = false;
+            receiveLine();
+        }
+        else
+            rxLine[rxLen++] = c;
+    }
+}
+
+
+/**
+ * @brief Sets the keys and encrypts the connection from now on
+ * 
+ * Call it after the port is connected. Takes the time of two X25519
+ * operations, so it is better called once at startup. From then on, the
+ * device only takes the messages sealed for the station with the private key
+ * and sends nothing until that station has connected.
+ * 
+ * @param devicePrivate The device's private key, 32 random bytes
+ * @param stationPublic The station's public key
+ * @param seed RM_CRYPT_SEED_SIZE bytes which are never the same at two
+ *             boots, from a hardware random number generator or a count of
+ *             the boots kept in flash. The device nonces are derived from it.
+ */
+void rmSetEncryptionKey(const uint8_t* devicePrivate,
+                        const uint8_t* stationPublic, const uint8_t* seed)
+{
+    static const uint8_t basePoint[32] = {9};
+    _rmX25519(publicKey, devicePrivate, basePoint);
+    _rmX25519(sharedKey, devicePrivate, stationPublic);
+    _rmHChacha(nonceKey, sharedKey, seed);
+    session = false;
+    pending = false;
+    rxStarted = false;
+    
+    if(_rmCryptReceive == NULL) {
+        sendMessageHal = _rmSendMessage;
+        sendDataHal = _rmSendData;
+        _rmSendMessage = &sendMessage;
+        _rmSendData = &sendData;
+        _rmCryptReceive = &receive;
+        _rmCryptFlush = &flush;
+    }
+}
+
+
+/**
+ * @brief Gets the device's public key
+ * 
+ * @param pub Output buffer of RM_KEY_SIZE bytes
+ */
+void rmGetPublicKey(uint8_t* pub) {
+    memcpy(pub, publicKey, RM_KEY_SIZE);
+}
@@ -11,6 +11,7 @@
 #include "rm/attribute.h"
 
 #include "rm/call.h"
+#include "connection_private.h"
 
 #include <math.h>
 #include <stdlib.h>
@@ -65,6 +66,7 @@ static rmInputAttribute* _rmInputAttributeGet(const char* key) {
 
 
 static void callbackSet(int argc, char* argv[]);
+static void describeInputs();
 
 
 
@@ -109,6 +111,7 @@ void rmCreateInputAttribute(const char* key, void* ptr, rmAttributeDataType t)
     static bool init = false;
     if(!init) {
         rmCreateCall("set", callbackSet);
+        _rmDescribeInputs = describeInputs;
         init = true;
     }
 }
@@ -116,6 +119,56 @@ void rmCreateInputAttribute(const char* key, void* ptr, rmAttributeDataType t)
 
 
 
+char* rm_ftoa(float f);
+
+
+// Lists the names and types of the input attributes for the station's
+// connect handshake. The bounded ones are followed by the lower and upper
+// bounds.
+static void describeInputs() {
+    static const char hexDigits[] = "0123456789abcdef";
+    char msg[256] = "$lsi ";
+    uint8_t len = 5;
+    for(uint8_t i=0; i<count; i++) {
+        uint8_t n = strlen(attributes[i].name);
+        if(len + n + 36 > 248) {
+            msg[len++] = '\n';
+            msg[len] = '\0';
+            _rmSendMessage(msg);
+            len = 5;
+        }
+        if(len > 5)
+            msg[len++] = ',';
+        memcpy(msg + len, attributes[i].name, n);
+        len += n;
+        uint8_t t = attributes[i].type;
+        msg[len++] = ':';
+        msg[len++] = hexDigits[t >> 4];
+        msg[len++] = hexDigits[t & 0x0F];
+        if(!isnan(attributes[i].lowerBound) &&
+           !isnan(attributes[i].upperBound))
+        {
+            const float bounds[2] = {
+                attributes[i].lowerBound,
+                attributes[i].upperBound
+            };
+            for(uint8_t j=0; j<2; j++) {
+                char* str = rm_ftoa(bounds[j]);
+                n = strlen(str);
+                msg[len++] = ':';
+                memcpy(msg + len, str, n);
+                len += n;
+            }
+        }
+    }
+    if(len > 5) {
+        msg[len++] = '\n';
+        msg[len] = '\0';
+        _rmSendMessage(msg);
+    }
+}
+
+
 static void attributeSetValue(rmInputAttribute* attr, const char* str) {
     bool changed = false;
     
@@ -2,6 +2,9 @@
  * @file output.c
  * @brief Attribute to string conversion functions for the output messages
  * 
+ * The encoders for each data type are looked up from a table indexed by the
+ * type and write straight into the caller's message buffer.
+ * 
  * @copyright Copyright (c) 2022 Khant Kyaw Khaung
  * 
  * @license{This project is released under the MIT License.}
@@ -9,12 +12,178 @@
 
 
 #include "rm/attribute.h"
+#include "attribute_private.h"
 
 #include "connection_private.h"
 
+#include <math.h>
 #include <string.h>
 
 
+static uint8_t encodeUint(uint32_t u, char* buf) {
+    char tmp[10];
+    uint8_t n = 0;
+    do {
+        tmp[n++] = '0' + (u % 10);
+        u /= 10;
+    } while(u);
+    for(uint8_t i=0; i<n; i++)
+        buf[i] = tmp[n - 1 - i];
+    return n;
+}
+
+
+static uint8_t encodeInt(int32_t i, char* buf) {
+    if(i < 0) {
+        buf[0] = '-';
+        return encodeUint(-(uint32_t) i, &buf[1]) + 1;
+    }
+    return encodeUint(i, buf);
+}
+
+
+static uint8_t textBool(const void* data, char* buf) {
+    buf[0] = *((const bool*) data) ? '1' : '0';
+    return 1;
+}
+
+static uint8_t textChar(const void* data, char* buf) {
+    buf[0] = *((const char*) data);
+    return 1;
+}
+
+static uint8_t textString(const void* data, char* buf) {
+    const rmString* str = (const rmString*) data;
+    uint8_t n = strnlen(str->data, str->size);
+    memcpy(buf, str->data, n);
+    return n;
+}
+
+static uint8_t textUint8(const void* data, char* buf) {
+    return encodeUint(*((const uint8_t*) data), buf);
+}
+
+static uint8_t textUint16(const void* data, char* buf) {
+    return encodeUint(*((const uint16_t*) data), buf);
+}
+
+static uint8_t textUint32(const void* data, char* buf) {
+    return encodeUint(*((const uint32_t*) data), buf);
+}
+
+static uint8_t textInt8(const void* data, char* buf) {
+    return encodeInt(*((const int8_t*) data), buf);
+}
+
+static uint8_t textInt16(const void* data, char* buf) {
+    return encodeInt(*((const int16_t*) data), buf);
+}
+
+static uint8_t textInt32(const void* data, char* buf) {
+    return encodeInt(*((const int32_t*) data), buf);
+}
+
+static uint8_t textFloat(const void* data, char* buf) {
+    float f = *((const float*) data);
+    uint8_t n = 0;
+    if(f < 0) {
+        buf[n++] = '-';
+        f = -f;
+    }
+    if(f > 4294967295 || isnan(f)) {
+        memcpy(&buf[n], "nan", 3);
+        return n + 3;
+    }
+    uint32_t d = (uint32_t) f;
+    uint16_t rem = (uint16_t) ((f - d + 0.0005f) * 1000);
+    if(rem >= 1000) {
+        d++;
+        rem -= 1000;
+    }
+    n += encodeUint(d, &buf[n]);
+    buf[n++] = '.';
+    for(uint8_t i=3; i--; ) {
+        buf[n + i] = '0' + (rem % 10);
+        rem /= 10;
+    }
+    return n + 3;
+}
+
+
+static uint8_t binaryBool(const void* data, uint8_t* buf) {
+    buf[0] = *((const bool*) data) ? 1 : 0;
+    return 1;
+}
+
+static uint8_t binaryString(const void* data, uint8_t* buf) {
+    const rmString* str = (const rmString*) data;
+    uint8_t n = strnlen(str->data, str->size < 254 ? str->size : 254);
+    buf[0] = n;
+    memcpy(&buf[1], str->data, n);
+    return n + 1;
+}
+
+static uint8_t binary1(const void* data, uint8_t* buf) {
+    buf[0] = *((const uint8_t*) data);
+    return 1;
+}
+
+static uint8_t binary2(const void* data, uint8_t* buf) {
+    uint16_t u = *((const uint16_t*) data);
+    buf[0] = u;
+    buf[1] = u >> 8;
+    return 2;
+}
+
+static uint8_t binary4(const void* data, uint8_t* buf) {
+    uint32_t u;
+    memcpy(&u, data, 4);
+    buf[0] = u;
+    buf[1] = u >> 8;
+    buf[2] = u >> 16;
+    buf[3] = u >> 24;
+    return 4;
+}
+
+
+static const rmOutputCodec codecBool   = {textBool,   binaryBool,   1, 1};
+static const rmOutputCodec codecChar   = {textChar,   binary1,      1, 1};
+static const rmOutputCodec codecString = {textString, binaryString, 0, 0};
+static const rmOutputCodec codecUint8  = {textUint8,  binary1,      1, 3};
+static const rmOutputCodec codecUint16 = {textUint16, binary2,      2, 5};
+static const rmOutputCodec codecUint32 = {textUint32, binary4,      4, 10};
+static const rmOutputCodec codecInt8   = {textInt8,   binary1,      1, 4};
+static const rmOutputCodec codecInt16  = {textInt16,  binary2,      2, 6};
+static const rmOutputCodec codecInt32  = {textInt32,  binary4,      4, 11};
+static const rmOutputCodec codecFloat  = {textFloat,  binary4,      4, 15};
+
+// Indexed by the lower 5 bits of rmAttributeDataType
+static const rmOutputCodec* const codecs[32] = {
+    [RM_ATTRIBUTE_BOOL]   = &codecBool,
+    [RM_ATTRIBUTE_CHAR]   = &codecChar,
+    [RM_ATTRIBUTE_STRING] = &codecString,
+    [RM_ATTRIBUTE_UINT8]  = &codecUint8,
+    [RM_ATTRIBUTE_UINT16] = &codecUint16,
+    [RM_ATTRIBUTE_UINT32] = &codecUint32,
+    [RM_ATTRIBUTE_INT8]   = &codecInt8,
+    [RM_ATTRIBUTE_INT16]  = &codecInt16,
+    [RM_ATTRIBUTE_INT32]  = &codecInt32,
+    [RM_ATTRIBUTE_FLOAT]  = &codecFloat
+};
+
+
+const rmOutputCodec* _rmOutputCodecGet(rmAttributeDataType t) {
+    const rmOutputCodec* codec = codecs[t & 0x1F];
+    return (codec != NULL) ? codec : &codecUint8;
+}
+
+
+// Kept out of rmOutputAttribute so that the public struct keeps its layout
+static inline const rmOutputCodec* getCodec(rmOutputAttribute *attr) {
+    return _rmOutputCodecGet(attr->type);
+}
+
+
 /**
  * @brief Sends the key and the present data of the attribute to the station
  * 
@@ -25,20 +194,51 @@
  * @param attr The attribute
  */
 void rmOutputAttributeUpdate(rmOutputAttribute *attr) {
-    char msg[128] = "$set ";
-    char* str = rmOutputAttributeGetStringData(attr);
-    strcpy(msg, attr->name);
-    strcpy(msg, " ");
-    strcpy(msg, str);
-    strcpy(msg, "\n");
+    char msg[280] = "$set ";
+    uint16_t len = 5;
+    uint8_t n = strnlen(attr->name, 11);
+    memcpy(&msg[len], attr->name, n);
+    len += n;
+    msg[len++] = ' ';
+    len += getCodec(attr)->text(attr->data, &msg[len]);
+    msg[len++] = '\n';
+    msg[len] = '\0';
+    // A line of text, so it goes through the compression like the others
     _rmSendMessage(msg);
 }
 
 
-char* rm_itoa(int i);
-char* rm_ftoa(float f);
-
-static char charStr[2] = {'x', '\0'};
+/**
+ * @brief Sends the attribute to the station in a binary frame
+ * 
+ * The frame carries the name, the data type code and the value in its native
+ * encoding, which saves the conversion to text on the client.
+ * A string longer than what the frame holds is cut.
+ * 
+ * @param attr The attribute
+ */
+void rmOutputAttributeUpdateBinary(rmOutputAttribute *attr) {
+    uint8_t payload[270];
+    uint16_t n = strnlen(attr->name, 11);
+    payload[0] = n;
+    memcpy(&payload[1], attr->name, n);
+    n++;
+    payload[n++] = attr->type;
+    if(attr->type == RM_ATTRIBUTE_STRING) {
+        // Cut to what the frame holds after the name, the type and the length
+        const rmString* str = (const rmString*) attr->data;
+        uint8_t m = strnlen(str->data, str->size);
+        if(m > 254 - n)
+            m = 254 - n;
+        payload[n++] = m;
+        memcpy(&payload[n], str->data, m);
+        n += m;
+    }
+    else {
+        n += getCodec(attr)->binary(attr->data, &payload[n]);
+    }
+    _rmSendFrame(RM_FRAME_SET, payload, n);
+}
 
 
 /**
@@ -51,62 +251,61 @@ static char charStr[2] = {'x', '\0'};
  *         allocated in a temporary memory.
  */
 char* rmOutputAttributeGetStringData(rmOutputAttribute *attr) {
-    char* ptr = NULL;
-    
-    if(attr->type == RM_ATTRIBUTE_BOOL) {
-        bool* b = (bool*) attr->data;
-        if(*b)
-            charStr[0] = '1';
-        else
-            charStr[0] = '0';
-        ptr = charStr;
-    }
-    
-    else if(attr->type == RM_ATTRIBUTE_CHAR) {
-        char* c = (char*) attr->data;
-        charStr[0] = *c;
-        ptr = charStr;
-    }
-    
-    else if(attr->type == RM_ATTRIBUTE_STRING) {
+    static char buffer[16];
+    if(attr->type == RM_ATTRIBUTE_STRING)
+        return ((rmString*) attr->data)->data;
+    uint8_t n = getCodec(attr)->text(attr->data, buffer);
+    buffer[n] = '\0';
+    return buffer;
+}
+
+
+uint8_t _rmOutputAttributeGetSize(rmOutputAttribute *attr) {
+    if(attr->type == RM_ATTRIBUTE_STRING)
+        return ((rmString*) attr->data)->size + 1;
+    return getCodec(attr)->size;
+}
+
+
+uint8_t _rmOutputAttributeGetTextSize(rmOutputAttribute *attr) {
+    if(attr->type == RM_ATTRIBUTE_STRING) {
         rmString* str = (rmString*) attr->data;
-        ptr = str->data;
+        return strnlen(str->data, str->size);
     }
-    
-    else if(attr->type == RM_ATTRIBUTE_FLOAT) {
-        float* f = (float*) attr->data;
-        ptr = rm_ftoa(*f);
+    return getCodec(attr)->textSize;
+}
+
+
+uint8_t _rmOutputAttributeGetText(rmOutputAttribute *attr, char* buf) {
+    return getCodec(attr)->text(attr->data, buf);
+}
+
+
+uint8_t _rmOutputAttributeGetBinaryData(rmOutputAttribute *attr,
+                                        uint8_t* buf)
+{
+    return getCodec(attr)->binary(attr->data, buf);
+}
+
+
+uint8_t _rmEncodeUint(uint32_t u, char* buf) { return encodeUint(u, buf); }
+
+
+bool _rmOutputAttributeChanged(rmOutputAttribute *attr, const void* shadow) {
+    if(attr->type == RM_ATTRIBUTE_STRING) {
+        rmString* str = (rmString*) attr->data;
+        return strncmp((const char*) shadow, str->data, str->size) != 0;
     }
-    
-    else if(attr->type & 0b00010000) {
-        if(attr->type & 0b00001000) {
-            if(attr->type == RM_ATTRIBUTE_INT8) {
-                int8_t* i = (int8_t*) attr->data;
-                ptr = rm_itoa(*i);
-            }
-            else if(attr->type == RM_ATTRIBUTE_INT16) {
-                int16_t* i = (int16_t*) attr->data;
-                ptr = rm_itoa(*i);
-            }
-            else if(attr->type == RM_ATTRIBUTE_INT32) {
-                int32_t* i = (int32_t*) attr->data;
-                ptr = rm_itoa(*i);
-            }
-        }
-        else {
-            if(attr->type == RM_ATTRIBUTE_UINT8) {
-                uint8_t* i = (uint8_t*) attr->data;
-                ptr = rm_itoa(*i);
-            }
-            else if(attr->type == RM_ATTRIBUTE_UINT16) {
-                uint16_t* i = (uint16_t*) attr->data;
-                ptr = rm_itoa(*i);
-            }
-            else if(attr->type == RM_ATTRIBUTE_UINT32) {
-                uint32_t* i = (uint32_t*) attr->data;
-                ptr = rm_itoa(*i);
-            }
-        }
+    return memcmp(shadow, attr->data, _rmOutputAttributeGetSize(attr)) != 0;
+}
+
+
+void _rmOutputAttributeStore(rmOutputAttribute *attr, void* shadow) {
+    if(attr->type == RM_ATTRIBUTE_STRING) {
+        rmString* str = (rmString*) attr->data;
+        strncpy((char*) shadow, str->data, str->size);
+        ((char*) shadow)[str->size] = '\0';
+        return;
     }
-    return ptr;
+    memcpy(shadow, attr->data, _rmOutputAttributeGetSize(attr));
 }
@@ -6,6 +6,19 @@
  * updates a good number of attributes at the same time in the most efficient
  * way.
  * 
+ * In delta mode, a shadow copy of the values last transmitted is kept for each
+ * table and only the changed indices are sent. A full keyframe is sent every
+ * few updates or on the station's request so that a station which has just
+ * connected can resynchronize.
+ * 
+ * A table too large for a single line or frame is split into several, each
+ * carrying the index of its first value.
+ * 
+ * Tables given a rate are published automatically from rmProcessMessage().
+ * The due tables are sent in priority order while there is room in the TX
+ * buffer. When the link saturates, the periods of the lower-priority tables
+ * are doubled first and restored once the link has room again.
+ * 
  * @copyright Copyright (c) 2022 Khant Kyaw Khaung
  * 
  * @license{This project is released under the MIT License.}
@@ -13,9 +26,11 @@
 
 
 #include "rm/sync.h"
+#include "attribute_private.h"
 
 #include "connection_private.h"
 #include "rm/call.h"
+#include "time.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -24,42 +39,134 @@
 
 typedef struct _rmSync {
     rmOutputAttribute* attributes;
+    uint16_t* offsets;
+    uint8_t* shadow;
+    uint16_t shadowSize;
     uint8_t count;
+    uint8_t mode;
+    uint8_t keyframeInterval;
+    uint8_t sinceKeyframe;
+    bool keyframeDue;
+    uint32_t lastUpdate;
+    uint16_t period;
+    uint16_t lastSize;
+    uint8_t priority;
+    uint8_t degrade;
 } rmSync;
 
 
 static rmSync* syncTables = NULL;
 static uint8_t tableCount = 0;
 
+static uint8_t* schedule = NULL;
+static uint8_t scheduleCount = 0;
+static uint16_t txCapacity = 0;
+
+static const char hexDigits[] = "0123456789abcdef";
+
+
+// Longest text line the station accepts, leaving room for the new line
+#define RM_SYNC_LINE_SIZE 250
+
+
+// Writes the names and types of a table's attributes from the start index.
+// The list which does not fit in a line ends with '+' and the index to
+// continue from, and the continued list starts with '@' and the same index.
+// Returns that index or 0 if the list is complete.
+static uint8_t writeList(rmSync* sync, uint8_t start, char* msg, uint8_t* len)
+{
+    uint8_t l = *len;
+    uint8_t next = 0;
+    if(start > 0) {
+        msg[l++] = '@';
+        l += _rmEncodeUint(start, &msg[l]);
+        msg[l++] = ',';
+    }
+    
+    for(uint8_t i=start; i<sync->count; i++) {
+        char* str = sync->attributes[i].name;
+        uint8_t n = strlen(str);
+        if(i > start)
+            msg[l++] = ',';
+        if(l + n + 3 > 248) {
+            msg[l++] = '+';
+            l += _rmEncodeUint(i, &msg[l]);
+            next = i;
+            break;
+        }
+        memcpy(msg + l, str, n);
+        l += n;
+        uint8_t t = sync->attributes[i].type;
+        msg[l++] = ':';
+        msg[l++] = hexDigits[t >> 4];
+        msg[l++] = hexDigits[t & 0x0F];
+    }
+    msg[l++] = '\n';
+    msg[l++] = '\0';
+    *len = l;
+    return next;
+}
+
 
 static void listAttributes(int argc, char *argv[]) {
-    if(argc != 1)
+    if(argc < 1)
         return;
     
     uint8_t id = atoi(argv[0]);
     if(id >= tableCount)
         return;
+    uint8_t start = (argc > 1) ? atoi(argv[1]) : 0;
     
-    rmSync sync = syncTables[id];
+    // The rest of a long list is sent on another request from the station
     char msg[256] = "$resp ";
     uint8_t len = 6;
-    
-    for(uint8_t i=0; i<sync.count; i++) {
-        char* str = sync.attributes[i].name;
-        uint8_t n = strlen(str);
-        if(n > 254 - len)
-            n = 254 - len;
-        memcpy(msg + len, str, n);
-        len += n;
-        if(i < sync.count - 1 && len < 254)
-            msg[len++] = ','; 
-    }
-    msg[len++] = '\n';
-    msg[len++] = '\0';
+    writeList(&syncTables[id], start, msg, &len);
     _rmSendMessage(msg);
 }
 
 
+// Sends the lists of all tables for the station's connect handshake
+static void describeSyncs() {
+    for(uint8_t id=0; id<tableCount; id++) {
+        rmSync* sync = &syncTables[id];
+        uint8_t start = 0;
+        do {
+            char msg[256] = "$lst ";
+            uint8_t len = 5;
+            len += _rmEncodeUint(id, &msg[len]);
+            msg[len++] = ' ';
+            start = writeList(sync, start, msg, &len);
+            _rmSendMessage(msg);
+        } while(start != 0);
+        
+        // The station which has just connected needs every value
+        sync->keyframeDue = true;
+    }
+}
+
+
+static void requestKeyframe(int argc, char *argv[]) {
+    if(argc != 1)
+        return;
+    
+    uint8_t id = atoi(argv[0]);
+    if(id >= tableCount)
+        return;
+    syncTables[id].keyframeDue = true;
+}
+
+
+static void changeRate(int argc, char *argv[]) {
+    if(argc != 2)
+        return;
+    
+    uint8_t id = atoi(argv[0]);
+    if(id >= tableCount)
+        return;
+    rmSyncSetRate(id, atoi(argv[1]), syncTables[id].priority);
+}
+
+
 /**
  * @brief Creates a new sync table
  * 
@@ -68,12 +175,28 @@ static void listAttributes(int argc, char *argv[]) {
 uint8_t rmCreateSync() {
     size_t size = sizeof(rmSync) * (tableCount + 1);
     syncTables = (rmSync*) realloc(syncTables, size);
-    syncTables[tableCount].attributes = NULL;
-    syncTables[tableCount].count = 0;
+    rmSync *sync = &syncTables[tableCount];
+    sync->attributes = NULL;
+    sync->offsets = NULL;
+    sync->shadow = NULL;
+    sync->shadowSize = 0;
+    sync->count = 0;
+    sync->mode = RM_SYNC_FULL;
+    sync->keyframeInterval = RM_SYNC_KEYFRAME_INTERVAL;
+    sync->sinceKeyframe = 0;
+    sync->keyframeDue = true;
+    sync->lastUpdate = 0;
+    sync->period = 0;
+    sync->lastSize = 0;
+    sync->priority = 0;
+    sync->degrade = 0;
     
     static bool init = false;
     if(!init) {
         rmCreateCall("lsa", listAttributes);
+        rmCreateCall("syncf", requestKeyframe);
+        rmCreateCall("rate", changeRate);
+        _rmDescribeSyncs = describeSyncs;
         init = true;
     }
     
@@ -92,44 +215,321 @@ uint8_t rmCreateSync() {
 void rmCreateOutputAttribute(const char* key, void* ptr, rmAttributeDataType t,
                              uint8_t sync_id)
 {
+    rmSync *sync = &syncTables[sync_id];
+    if(sync->count == 255)
+        return;
+    
     rmOutputAttribute attr;
     strncpy(attr.name, key, 11);
     attr.name[11] = '\0';
     attr.data = ptr;
     attr.type = t;
-    rmSync *sync = &syncTables[sync_id];
     size_t size = sizeof(rmOutputAttribute) * (sync->count + 1);
     sync->attributes = (rmOutputAttribute*) realloc(sync->attributes, size);
     sync->attributes[sync->count] = attr;
+    
+    size = sizeof(uint16_t) * (sync->count + 1);
+    sync->offsets = (uint16_t*) realloc(sync->offsets, size);
+    sync->offsets[sync->count] = sync->shadowSize;
+    sync->shadowSize += _rmOutputAttributeGetSize(&attr);
+    sync->shadow = (uint8_t*) realloc(sync->shadow, sync->shadowSize);
+    _rmOutputAttributeStore(&attr, &sync->shadow[sync->offsets[sync->count]]);
     sync->count++;
 }
 
 
+/**
+ * @brief Sets how the sync table is sent
+ * 
+ * @param id The sync table ID
+ * @param mode Combination of rmSyncMode flags
+ */
+void rmSyncSetMode(uint8_t id, uint8_t mode) {
+    if(id >= tableCount)
+        return;
+    syncTables[id].mode = mode;
+    syncTables[id].keyframeDue = true;
+}
+
+
+/**
+ * @brief Sets the number of updates between two full keyframes in delta mode
+ * 
+ * @param id The sync table ID
+ * @param n Number of updates. 0 sends a keyframe only on the station's
+ *          request.
+ */
+void rmSyncSetKeyframeInterval(uint8_t id, uint8_t n) {
+    if(id >= tableCount)
+        return;
+    syncTables[id].keyframeInterval = n;
+}
+
+
+static uint16_t flushText(char* msg, uint16_t len, bool keyframe,
+                          uint8_t start)
+{
+    // A keyframe line not starting from the first attribute is followed by
+    // the index of its first value
+    if(keyframe && start > 0) {
+        msg[len++] = ' ';
+        len += _rmEncodeUint(start, &msg[len]);
+    }
+    msg[len++] = '\n';
+    msg[len] = '\0';
+    _rmSendMessage(msg);
+    return len;
+}
+
+
+static uint16_t sendText(uint8_t id, rmSync* sync, bool keyframe) {
+    char msg[272];
+    uint16_t head = keyframe ? 6 : 7;
+    memcpy(msg, keyframe ? "$sync " : "$syncd ", head);
+    head += _rmEncodeUint(id, &msg[head]);
+    msg[head++] = ' ';
+    
+    uint16_t len = head;
+    uint16_t total = 0;
+    uint8_t start = 0;
+    bool empty = true;
+    
+    for(uint8_t i=0; i<sync->count; i++) {
+        rmOutputAttribute* attr = &sync->attributes[i];
+        void* shadow = &sync->shadow[sync->offsets[i]];
+        if(!keyframe && !_rmOutputAttributeChanged(attr, shadow))
+            continue;
+        
+        // Room for the separator, the index of a delta or the start index of
+        // a keyframe, and the value
+        uint16_t need = 5 + _rmOutputAttributeGetTextSize(attr);
+        if(len + need > RM_SYNC_LINE_SIZE) {
+            if(!empty) {
+                total += flushText(msg, len, keyframe, start);
+                len = head;
+                empty = true;
+            }
+            if(len + need > RM_SYNC_LINE_SIZE)
+                continue;
+        }
+        
+        if(empty)
+            start = i;
+        else
+            msg[len++] = ',';
+        if(!keyframe) {
+            len += _rmEncodeUint(i, &msg[len]);
+            msg[len++] = ':';
+        }
+        len += _rmOutputAttributeGetText(attr, &msg[len]);
+        empty = false;
+        if(sync->mode & RM_SYNC_DELTA)
+            _rmOutputAttributeStore(attr, shadow);
+    }
+    if(!empty || (keyframe && total == 0))
+        total += flushText(msg, len, keyframe, start);
+    return total;
+}
+
+
+static uint16_t sendBinary(uint8_t id, rmSync* sync, bool keyframe) {
+    uint8_t payload[255];
+    uint8_t value[256];
+    uint8_t type = keyframe ? RM_FRAME_SYNC : RM_FRAME_SYNC_DELTA;
+    uint8_t len = 0;
+    uint16_t total = 0;
+    bool empty = true;
+    
+    for(uint8_t i=0; i<sync->count; i++) {
+        rmOutputAttribute* attr = &sync->attributes[i];
+        void* shadow = &sync->shadow[sync->offsets[i]];
+        if(!keyframe && !_rmOutputAttributeChanged(attr, shadow))
+            continue;
+        
+        uint8_t n = _rmOutputAttributeGetBinaryData(attr, value);
+        uint16_t m = keyframe ? n : n + 1;
+        if(!empty && m > 255 - len) {
+            _rmSendFrame(type, payload, len);
+            total += len + 4;
+            empty = true;
+        }
+        if(empty) {
+            // The keyframe frames after the first one carry the index of
+            // their first value
+            payload[0] = id;
+            len = 1;
+            if(keyframe && i > 0) {
+                type = RM_FRAME_SYNC_PART;
+                payload[len++] = i;
+            }
+        }
+        if(m > 255 - len)
+            continue;
+        
+        if(!keyframe)
+            payload[len++] = i;
+        memcpy(&payload[len], value, n);
+        len += n;
+        empty = false;
+        if(sync->mode & RM_SYNC_DELTA)
+            _rmOutputAttributeStore(attr, shadow);
+    }
+    if(empty) {
+        if(!keyframe || total > 0)
+            return total;
+        payload[0] = id;
+        len = 1;
+    }
+    _rmSendFrame(type, payload, len);
+    return total + len + 4;
+}
+
+
+static uint16_t update(uint8_t id) {
+    rmSync* sync = &syncTables[id];
+    bool keyframe = true;
+    if(sync->mode & RM_SYNC_DELTA) {
+        keyframe = sync->keyframeDue ||
+                   (sync->keyframeInterval != 0 &&
+                    sync->sinceKeyframe >= sync->keyframeInterval);
+        if(keyframe) {
+            sync->sinceKeyframe = 0;
+            sync->keyframeDue = false;
+        }
+        else if(sync->sinceKeyframe < 255) {
+            sync->sinceKeyframe++;
+        }
+    }
+    
+    if(sync->mode & RM_SYNC_BINARY)
+        return sendBinary(id, sync, keyframe);
+    else
+        return sendText(id, sync, keyframe);
+}
+
+
 /**
  * @brief Performs an update operation for all the attributes in the table
  * 
+ * In delta mode, only the attributes changed since the last update are sent
+ * and nothing is sent if there is no change.
+ * 
  * @param id The sync table ID
  */
 void rmSyncUpdate(uint8_t id) {
     if(id >= tableCount)
         return;
+    update(id);
+}
+
+
+static void adjustRates(bool saturated) {
+    if(saturated) {
+        // Slows down the table with the lowest priority first
+        for(int16_t k=scheduleCount-1; k>=0; k--) {
+            rmSync* sync = &syncTables[schedule[k]];
+            if(sync->degrade < RM_SYNC_MAX_DEGRADE) {
+                sync->degrade++;
+                return;
+            }
+        }
+    }
+    else {
+        // Restores the table with the highest priority first
+        for(uint8_t k=0; k<scheduleCount; k++) {
+            rmSync* sync = &syncTables[schedule[k]];
+            if(sync->degrade == 0)
+                continue;
+            if(_rmTxSpace() >= 2 * sync->lastSize)
+                sync->degrade--;
+            return;
+        }
+    }
+}
+
+
+static void runScheduler() {
+    static uint32_t lastAdjust = 0;
+    static bool saturated = false;
+    uint32_t now = _rmGetTime();
     
-    char msg[256] = "$sync i ";
-    uint8_t len = 8;
-    msg[6] = '0' + id;
-    rmSync sync = syncTables[id];
+    for(uint8_t k=0; k<scheduleCount; k++) {
+        uint8_t id = schedule[k];
+        rmSync* sync = &syncTables[id];
+        uint32_t period = (uint32_t) sync->period << sync->degrade;
+        if(now - sync->lastUpdate < period)
+            continue;
+        
+        // A table larger than the TX buffer waits for it to be empty
+        uint16_t space = _rmTxSpace();
+        if(space > txCapacity)
+            txCapacity = space;
+        uint16_t need = sync->lastSize;
+        if(need > txCapacity)
+            need = txCapacity;
+        if(space < need) {
+            // Keeps the space for this table rather than letting the tables
+            // with lower priority take it
+            saturated = true;
+            break;
+        }
+        
+        uint16_t n = update(id);
+        if(n > 0)
+            sync->lastSize = n;
+        sync->lastUpdate = now;
+    }
     
-    for(uint8_t i=0; i<sync.count; i++) {
-        char* str = rmOutputAttributeGetStringData(&sync.attributes[i]);
-        uint8_t n = strlen(str);
-        if(n > 254 - len)
-            n = 254 - len;
-        memcpy(&msg[len], str, n);
-        len += n;
-        if(i < sync.count - 1 && len < 254)
-            msg[len++] = ','; 
+    if(now - lastAdjust >= RM_SYNC_ADJUST_INTERVAL) {
+        adjustRates(saturated);
+        saturated = false;
+        lastAdjust = now;
     }
-    msg[len++] = '\n';
-    msg[len++] = '\0';
-    _rmSendMessage(msg);
+}
+
+
+/**
+ * @brief Publishes the sync table automatically at a target rate
+ * 
+ * The tables due are sent from rmProcessMessage() in the order of priority.
+ * When the TX buffer cannot keep up, the tables with lower priority are slowed
+ * down first by doubling their periods.
+ * 
+ * @param id The sync table ID
+ * @param hz Number of updates per second. 0 stops the automatic updates.
+ * @param priority Priority of the table. 0 is the highest.
+ */
+void rmSyncSetRate(uint8_t id, uint16_t hz, uint8_t priority) {
+    if(id >= tableCount)
+        return;
+    
+    rmSync* sync = &syncTables[id];
+    sync->period = (hz == 0) ? 0 : (hz >= 1000) ? 1 : 1000 / hz;
+    sync->priority = priority;
+    sync->degrade = 0;
+    sync->lastUpdate = _rmGetTime() - sync->period;
+    
+    // Removes the table from the schedule
+    uint8_t k = 0;
+    while(k < scheduleCount && schedule[k] != id)
+        k++;
+    if(k < scheduleCount) {
+        for(; k<scheduleCount-1; k++)
+            schedule[k] = schedule[k + 1];
+        scheduleCount--;
+    }
+    
+    // Inserts the table after the others of the same priority
+    if(sync->period != 0) {
+        size_t size = sizeof(uint8_t) * (scheduleCount + 1);
+        schedule = (uint8_t*) realloc(schedule, size);
+        k = scheduleCount;
+        while(k > 0 && syncTables[schedule[k - 1]].priority > priority) {
+            schedule[k] = schedule[k - 1];
+            k--;
+        }
+        schedule[k] = id;
+        scheduleCount++;
+    }
+    _rmSyncScheduler = (scheduleCount > 0) ? runScheduler : NULL;
 }
@@ -18,7 +18,9 @@
 
 #include "rm/attribute.h"
 #include "rm/call.h"
+#include "rm/compress.h"
 #include "rm/connection.h"
+#include "rm/crypt.h"
 #include "rm/request.h"
 #include "rm/string.h"
 #include "rm/sync.h"
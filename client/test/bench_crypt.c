@@ -0,0 +1,107 @@
+/**
+ * @file bench_crypt.c
+ * @brief Measures the cost of the encryption on the host
+ * 
+ * Times the key setup, the key exchange with the station and the sealing of
+ * the messages into frames of each size. The frames are sent to a sink which
+ * only counts the bytes.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#include <robotmonitor.h>
+#include <connection_private.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+
+#define KEY_ITERATIONS 50
+#define EXCHANGE_ITERATIONS 20000
+#define BYTES (64 << 20)
+
+
+static unsigned long bytes = 0;
+static const char* input = "";
+
+
+static void sinkMessage(const char* msg) {
+    bytes += strlen(msg);
+}
+
+
+static void sinkData(const void* data, uint16_t len) {
+    bytes += len;
+}
+
+
+static char readInput() {
+    if(*input == '\0')
+        return '\0';
+    return *input++;
+}
+
+
+static double now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+
+static void bench(uint8_t size) {
+    uint8_t msg[255];
+    memset(msg, 'm', sizeof(msg));
+    long count = BYTES / size;
+    bytes = 0;
+    double t = now();
+    for(long i=0; i<count; i++) {
+        _rmSendData(msg, size);
+        // Seals the frame as the end of rmProcessMessage() does
+        _rmCryptFlush();
+    }
+    t = now() - t;
+    printf("%5d bytes %10.1f MB/s %8.1f ns/frame %6.1f%% overhead\n", size,
+           count * size / t / 1e6, t * 1e9 / count,
+           100.0 * (bytes - count * size) / (count * size));
+}
+
+
+int main() {
+    uint8_t devicePrivate[RM_KEY_SIZE];
+    uint8_t stationPublic[RM_KEY_SIZE];
+    uint8_t seed[RM_CRYPT_SEED_SIZE] = {0};
+    for(uint8_t i=0; i<RM_KEY_SIZE; i++) {
+        devicePrivate[i] = i * 7 + 1;
+        stationPublic[i] = i * 13 + 5;
+    }
+    stationPublic[31] &= 0x7F;
+    _rmSendMessage = sinkMessage;
+    _rmSendData = sinkData;
+    _rmRead = readInput;
+    
+    double t = now();
+    for(int i=0; i<KEY_ITERATIONS; i++)
+        rmSetEncryptionKey(devicePrivate, stationPublic, seed);
+    t = now() - t;
+    printf("key setup    %8.1f us (two X25519)\n", t * 1e6 / KEY_ITERATIONS);
+    
+    t = now();
+    for(int i=0; i<EXCHANGE_ITERATIONS; i++) {
+        input = "$crypt 0123456789abcdef\n";
+        rmProcessMessage();
+    }
+    t = now() - t;
+    printf("key exchange %8.1f us\n", t * 1e6 / EXCHANGE_ITERATIONS);
+    
+    printf("ChaCha20-Poly1305, %d MB sealed at each size\n", BYTES >> 20);
+    bench(16);
+    bench(64);
+    bench(128);
+    bench(235);
+    return 0;
+}
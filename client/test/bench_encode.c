@@ -0,0 +1,97 @@
+/**
+ * @file bench_encode.c
+ * @brief Measures the cost of encoding a sync table on the host
+ * 
+ * The messages are sent to a sink which only counts the bytes so that the
+ * time measured is the encoding of the attributes.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#include <robotmonitor.h>
+#include <connection_private.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+
+#define ITERATIONS 200000
+
+
+static unsigned long bytes = 0;
+
+
+static void sinkMessage(const char* msg) {
+    while(*msg++)
+        bytes++;
+}
+
+
+static void sinkData(const void* data, uint16_t len) {
+    bytes += len;
+}
+
+
+static double now() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+
+bool flag;
+char letter = 'x';
+rmString text;
+uint8_t u8 = 200;
+uint16_t u16 = 51234;
+uint32_t u32 = 3000000000u;
+int8_t i8 = -100;
+int16_t i16 = -30000;
+int32_t i32 = -2000000000;
+float f1 = 3.14159f;
+float f2 = -2718.28f;
+
+
+static void bench(const char* label, uint8_t id, uint8_t mode) {
+    rmSyncSetMode(id, mode);
+    bytes = 0;
+    double t = now();
+    for(long i=0; i<ITERATIONS; i++) {
+        // Changes a value so that the delta modes have something to send
+        f1 += 0.001f;
+        rmSyncUpdate(id);
+    }
+    t = now() - t;
+    printf("%-8s %8.1f ns/table %8.1f bytes/table\n", label,
+           t * 1e9 / ITERATIONS, (double) bytes / ITERATIONS);
+}
+
+
+int main() {
+    text = rmCreateString("robot", 12);
+    uint8_t id = rmCreateSync();
+    rmCreateOutputAttribute("flag", &flag, RM_ATTRIBUTE_BOOL, id);
+    rmCreateOutputAttribute("letter", &letter, RM_ATTRIBUTE_CHAR, id);
+    rmCreateOutputAttribute("text", &text, RM_ATTRIBUTE_STRING, id);
+    rmCreateOutputAttribute("u8", &u8, RM_ATTRIBUTE_UINT8, id);
+    rmCreateOutputAttribute("u16", &u16, RM_ATTRIBUTE_UINT16, id);
+    rmCreateOutputAttribute("u32", &u32, RM_ATTRIBUTE_UINT32, id);
+    rmCreateOutputAttribute("i8", &i8, RM_ATTRIBUTE_INT8, id);
+    rmCreateOutputAttribute("i16", &i16, RM_ATTRIBUTE_INT16, id);
+    rmCreateOutputAttribute("i32", &i32, RM_ATTRIBUTE_INT32, id);
+    rmCreateOutputAttribute("f1", &f1, RM_ATTRIBUTE_FLOAT, id);
+    rmCreateOutputAttribute("f2", &f2, RM_ATTRIBUTE_FLOAT, id);
+    _rmSendMessage = sinkMessage;
+    _rmSendData = sinkData;
+    
+    printf("%d attributes, %d updates\n", 11, ITERATIONS);
+    bench("full", id, RM_SYNC_FULL);
+    bench("delta", id, RM_SYNC_DELTA);
+    bench("binary", id, RM_SYNC_BINARY);
+    bench("bin+dlt", id, RM_SYNC_BINARY | RM_SYNC_DELTA);
+    return 0;
+}
@@ -21,7 +21,7 @@ static uint8_t rx2Count = 0;
 
 
 static void loadTX() {
-    uint8_t i = rmTxTail;
+    uint16_t i = rmTxTail;
     while(rx2Count < RM_RX_BUFFER_SIZE - 1) {
         if(i == rmTxHead)
             break;
@@ -34,10 +34,11 @@ static void loadTX() {
 }
 
 
-static void sendMessage(const char* msg) {
-    char c;
-    while((c = *msg++) != '\0') {
-        uint8_t i = (rmTxHead + 1) % RM_TX_BUFFER_SIZE;
+static void sendData(const void* data, uint16_t len) {
+    const char* ptr = (const char*) data;
+    while(len--) {
+        char c = *ptr++;
+        uint16_t i = (rmTxHead + 1) % RM_TX_BUFFER_SIZE;
         while(i == rmTxTail) {
             return;
         }
@@ -48,11 +49,17 @@ static void sendMessage(const char* msg) {
 }
 
 
+static void sendMessage(const char* msg) {
+    sendData(msg, strlen(msg));
+}
+
+
 /**
  * @brief Initializes the virtual connection
  */
 void rmConnectVirtual() {
     _rmSendMessage = &sendMessage;
+    _rmSendData = &sendData;
     rx2Buffer[RX2_BUFFER_SIZE - 1] = '\0';
 }
 
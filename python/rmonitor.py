@@ -0,0 +1,292 @@
+"""
+Python bindings of the robot monitor station library.
+
+Built on the C interface of librmonitor (rm/capi.h) through ctypes. The
+recorded samples are read in batches straight into NumPy arrays, or into
+array.array objects when NumPy is not installed, so no Python object is
+created per sample.
+
+Example:
+
+    import rmonitor
+
+    with rmonitor.Client("/dev/ttyACM0", 115200) as cli:
+        cli.watch("speed", capacity=1000000)
+        cli.send("start")
+        ...
+        times, values = cli.read("speed")
+
+The library is looked up with ctypes.util.find_library. Set RMONITOR_LIB to
+the path of the library to use another one.
+
+read_columns() loads the column chunked files written by rmexport and does
+not need the library.
+"""
+
+import array
+import ctypes
+import ctypes.util
+import os
+import struct
+import zlib
+
+try:
+    import numpy
+except ImportError:
+    numpy = None
+
+
+CAPI_VERSION = 1
+
+NORMAL = 0
+ERROR = 1
+WARNING = 2
+
+
+def _load():
+    path = os.environ.get("RMONITOR_LIB") or ctypes.util.find_library("rmonitor")
+    if path is None:
+        raise OSError("librmonitor is not found, set RMONITOR_LIB")
+    lib = ctypes.CDLL(path)
+
+    handle = ctypes.c_void_p
+    double_p = ctypes.POINTER(ctypes.c_double)
+    signatures = {
+        "rmGetVersion": (ctypes.c_int, []),
+        "rmClientCreate": (handle, []),
+        "rmClientDestroy": (None, [handle]),
+        "rmClientConnect": (ctypes.c_int, [handle, ctypes.c_char_p,
+                                           ctypes.c_uint32]),
+        "rmClientDisconnect": (None, [handle]),
+        "rmClientIsConnected": (ctypes.c_int, [handle]),
+        "rmClientSendCommand": (ctypes.c_int, [handle, ctypes.c_char_p]),
+        "rmClientWatch": (ctypes.c_int, [handle, ctypes.c_char_p,
+                                         ctypes.c_size_t]),
+        "rmClientAvailable": (ctypes.c_size_t, [handle, ctypes.c_int]),
+        "rmClientRead": (ctypes.c_size_t, [handle, ctypes.c_int, double_p,
+                                           double_p, ctypes.c_size_t]),
+        "rmClientDropped": (ctypes.c_uint64, [handle, ctypes.c_int]),
+        "rmClientGetValue": (ctypes.c_int, [handle, ctypes.c_char_p,
+                                            double_p]),
+        "rmClientGetString": (ctypes.c_int, [handle, ctypes.c_char_p,
+                                             ctypes.c_char_p,
+                                             ctypes.c_size_t]),
+        "rmClientReadEcho": (ctypes.c_int, [handle, ctypes.c_char_p,
+                                            ctypes.c_size_t,
+                                            ctypes.POINTER(ctypes.c_int)]),
+    }
+    for name, (restype, argtypes) in signatures.items():
+        func = getattr(lib, name)
+        func.restype = restype
+        func.argtypes = argtypes
+
+    version = lib.rmGetVersion()
+    if version != CAPI_VERSION:
+        raise OSError("librmonitor C interface %d is not supported" % version)
+    return lib
+
+
+_lib = None
+
+
+def _library():
+    global _lib
+    if _lib is None:
+        _lib = _load()
+    return _lib
+
+
+def _empty(n):
+    """Creates an array of n doubles and a pointer to its memory."""
+    if numpy is not None:
+        arr = numpy.empty(n, dtype=numpy.float64)
+        ptr = arr.ctypes.data_as(ctypes.POINTER(ctypes.c_double))
+    else:
+        arr = array.array("d", bytes(8 * n))
+        ptr = (ctypes.c_double * n).from_buffer(arr) if n > 0 else None
+    return arr, ptr
+
+
+class Client:
+    """
+    A client device connected to the station.
+
+    Watched attributes are recorded by the library as they change, so
+    reading them in batches keeps up with high sample rates.
+    """
+
+    def __init__(self, port=None, baud=115200):
+        self._lib = _library()
+        self._h = self._lib.rmClientCreate()
+        self._watches = {}
+        if port is not None:
+            self.connect(port, baud)
+
+    def __del__(self):
+        self.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def close(self):
+        """Disconnects and frees the client."""
+        if getattr(self, "_h", None):
+            self._lib.rmClientDestroy(self._h)
+            self._h = None
+
+    def connect(self, port, baud=115200):
+        """Opens the serial port. Raises OSError on failure."""
+        if not self._lib.rmClientConnect(self._h, port.encode(), baud):
+            raise OSError("cannot open %s" % port)
+
+    def disconnect(self):
+        self._lib.rmClientDisconnect(self._h)
+
+    @property
+    def connected(self):
+        return bool(self._lib.rmClientIsConnected(self._h))
+
+    def send(self, command):
+        """Sends a command such as "set speed 10" to the device."""
+        if not self._lib.rmClientSendCommand(self._h, command.encode()):
+            raise OSError("cannot send the command")
+
+    def watch(self, name, capacity=65536):
+        """
+        Starts recording an attribute. Samples beyond the capacity that are
+        not read in time are dropped, see dropped().
+        """
+        wid = self._lib.rmClientWatch(self._h, name.encode(), capacity)
+        if wid < 0:
+            raise ValueError("cannot watch %r" % name)
+        self._watches[name] = wid
+        return wid
+
+    def available(self, name):
+        """Number of samples of the attribute waiting to be read."""
+        return self._lib.rmClientAvailable(self._h, self._watches[name])
+
+    def dropped(self, name):
+        """Number of samples of the attribute lost to a full buffer."""
+        return self._lib.rmClientDropped(self._h, self._watches[name])
+
+    def read(self, name, max=None):
+        """
+        Takes the recorded samples of an attribute.
+
+        Returns the times in seconds since the epoch and the values as two
+        arrays of float64. Strings are recorded as NaN.
+        """
+        wid = self._watches[name]
+        if max is None:
+            max = self._lib.rmClientAvailable(self._h, wid)
+        times, tp = _empty(max)
+        values, vp = _empty(max)
+        n = self._lib.rmClientRead(self._h, wid, tp, vp, max) if max else 0
+        if n < max:
+            times, values = times[:n], values[:n]
+        return times, values
+
+    def value(self, name):
+        """The current value of an attribute as a number."""
+        v = ctypes.c_double()
+        if not self._lib.rmClientGetValue(self._h, name.encode(),
+                                          ctypes.byref(v)):
+            raise KeyError(name)
+        return v.value
+
+    def string(self, name):
+        """The current value of an attribute as text."""
+        buf = ctypes.create_string_buffer(256)
+        n = self._lib.rmClientGetString(self._h, name.encode(), buf, 256)
+        if n < 0:
+            raise KeyError(name)
+        if n >= 256:
+            buf = ctypes.create_string_buffer(n + 1)
+            self._lib.rmClientGetString(self._h, name.encode(), buf, n + 1)
+        return buf.value.decode(errors="replace")
+
+    def echoes(self):
+        """Takes the echoed messages as a list of (status, text)."""
+        out = []
+        buf = ctypes.create_string_buffer(256)
+        status = ctypes.c_int()
+        while self._lib.rmClientReadEcho(self._h, buf, 256,
+                                         ctypes.byref(status)):
+            out.append((status.value, buf.value.decode(errors="replace")))
+        return out
+
+
+# Array type codes of the wire data types in the column chunked files
+_COLUMN_TYPES = {
+    0x00: "B", 0x01: "B", 0x10: "B", 0x11: "H", 0x12: "I",
+    0x18: "b", 0x19: "h", 0x1A: "i", 0x1C: "f", 0xFF: "q",
+}
+_WIRE_STRING = 0x02
+
+
+def read_columns(path):
+    """
+    Reads a column chunked file (.rmcol) written by rmexport.
+
+    Returns a dict from the column name to its values, NumPy arrays or
+    array.array objects for the numbers and lists for the strings. The "time"
+    column is in microseconds since the epoch.
+    """
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:5] != b"RMCOL":
+        raise ValueError("%s is not a column chunked file" % path)
+    version, count = struct.unpack_from("<II", data, 8)
+    if version != 1:
+        raise ValueError("version %d is not supported" % version)
+    pos = 16
+    columns = []
+    for _ in range(count):
+        kind, n = data[pos], data[pos + 1]
+        columns.append((data[pos + 2:pos + 2 + n].decode(errors="replace"),
+                        kind))
+        pos += 2 + n
+
+    parts = [[] for _ in columns]
+    while True:
+        (rows,) = struct.unpack_from("<I", data, pos)
+        pos += 4
+        if rows == 0:
+            break
+        for i, (name, kind) in enumerate(columns):
+            encoding, size, plain = struct.unpack_from("<BII", data, pos)
+            pos += 9
+            block = data[pos:pos + size]
+            pos += size
+            if encoding == 1:
+                block = zlib.decompress(block)
+            if kind != _WIRE_STRING:
+                parts[i].append(block)
+                continue
+            (n,) = struct.unpack_from("<I", block, 0)
+            at = 4
+            words = []
+            for _ in range(n):
+                k = block[at]
+                words.append(block[at + 1:at + 1 + k].decode(errors="replace"))
+                at += 1 + k
+            index = array.array("I", block[at:at + 4 * rows])
+            parts[i].append([words[j] for j in index])
+
+    out = {}
+    for (name, kind), chunks in zip(columns, parts):
+        if kind == _WIRE_STRING:
+            out[name] = [s for chunk in chunks for s in chunk]
+            continue
+        code = _COLUMN_TYPES.get(kind, "I")
+        raw = b"".join(chunks)
+        if numpy is not None:
+            values = numpy.frombuffer(raw, dtype=numpy.dtype(code))
+            out[name] = values.astype(bool) if kind == 0x00 else values
+        else:
+            out[name] = array.array(code, raw)
+    return out
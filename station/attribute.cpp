@@ -72,7 +72,7 @@ rmAttribute::rmAttribute(const char* key, rmAttributeDataType t, float lower,
  */
 rmAttribute::~rmAttribute() {
     if(type == RM_ATTRIBUTE_STRING && data.s != nullptr)
-        delete data.s;
+        delete[] data.s;
 }
 
 /**
@@ -304,15 +304,18 @@ void rmAttribute::setValue(const char* value) {
         break;
         
       case RM_ATTRIBUTE_STRING:
-        if(data.s != NULL) {
-            if(strcmp(value, data.s) == 0)
-                return;
-            delete data.s;
-        }
+        if(data.s != NULL && strcmp(value, data.s) == 0)
+            return;
+        
+        // The new string is allocated before the old one is freed, so that a
+        // change is always seen as a different pointer
         size_t len = strnlen(value, 127);
-        data.s = new char[len + 1];
-        memcpy(data.s, value, len);
-        data.s[len] = '\0';
+        char* str = new char[len + 1];
+        memcpy(str, value, len);
+        str[len] = '\0';
+        if(data.s != NULL)
+            delete[] data.s;
+        data.s = str;
     }
 }
     
@@ -351,7 +354,7 @@ std::string rmAttribute::getValueString() const {
         return std::string(buff);
         
       case RM_ATTRIBUTE_STRING:
-        return std::string(data.s);
+        return (data.s != NULL) ? std::string(data.s) : std::string();
         
       default:
         return std::string();
@@ -365,6 +368,31 @@ std::string rmAttribute::getValueString() const {
  */
 rmAttributeDataType rmAttribute::getType() const { return type; }
 
+/**
+ * @brief Changes the data type of the value
+ * 
+ * The current value is converted to the new type and the boundary is removed.
+ * 
+ * @param t The new data type
+ */
+void rmAttribute::setType(rmAttributeDataType t) {
+    if(t == type)
+        return;
+    std::string str;
+    if(type != RM_ATTRIBUTE_STRING)
+        str = getValueString();
+    else if(data.s != nullptr) {
+        str = data.s;
+        delete[] data.s;
+    }
+    data.s = nullptr;
+    type = t;
+    lowerBound = NAN;
+    upperBound = NAN;
+    if(!str.empty())
+        setValue(str.c_str());
+}
+
 /**
  * @brief Sets the boundary
  * 
@@ -418,6 +446,45 @@ void rmAttribute::setNotifier(rmAttributeNotifier* noti) { notifier = noti; }
  */
 rmAttributeNotifier* rmAttribute::getNotifier() const { return notifier; }
 
+/**
+ * @brief Sets the listener that sees the changes of every attribute
+ * 
+ * @param l The listener
+ */
+void rmAttribute::setListener(rmAttributeListener* l) { listener = l; }
+
+/**
+ * @brief Gets the listener of this attribute
+ * 
+ * @return The listener. Returns null if it doesn't have.
+ */
+rmAttributeListener* rmAttribute::getListener() const { return listener; }
+
+/**
+ * @brief Tells the notifier and the listener that the value has changed
+ */
+void rmAttribute::notifyChange() {
+    if(notifier != nullptr)
+        notifier->onAttributeChange();
+    if(listener != nullptr)
+        listener->onAttributeUpdate(this);
+}
+
+/**
+ * @brief Tells the listener of a value received from the client device
+ * 
+ * The listener sees every value received, so the repeated values are
+ * recorded as well. The notifier is only told of a change.
+ * 
+ * @param changed True if the value differs from the one before
+ */
+void rmAttribute::notifyUpdate(bool changed) {
+    if(changed && notifier != nullptr)
+        notifier->onAttributeChange();
+    if(listener != nullptr)
+        listener->onAttributeUpdate(this);
+}
+
 /**
  * @brief Triggers on attribute value change
  * 
@@ -425,3 +492,10 @@ rmAttributeNotifier* rmAttribute::getNotifier() const { return notifier; }
  * reports.
  */
 void rmAttributeNotifier::onAttributeChange() {}
+
+/**
+ * @brief Triggers on attribute value update
+ * 
+ * @param attr The attribute updated
+ */
+void rmAttributeListener::onAttributeUpdate(rmAttribute* attr) {}
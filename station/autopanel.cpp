@@ -0,0 +1,360 @@
+/**
+ * @file autopanel.cpp
+ * @brief A panel generated from the attributes and calls of the client
+ * 
+ * Lists every attribute and call the client device has described with a
+ * widget suited to it. Only the rows in view are painted and their widgets
+ * are constructed the first time they are scrolled into view.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_WX_EXPORT
+
+
+#include "rm/autopanel.hpp"
+
+#include "rm/button.hpp"
+#include "rm/checkbox.hpp"
+#include "rm/slider.hpp"
+#include "rm/textctrl.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <unordered_set>
+
+#include <wx/dcclient.h>
+#include <wx/settings.h>
+
+
+// Interval to repaint the values in view in milliseconds
+#define RM_AUTOPANEL_INTERVAL 100
+
+
+// The calls the client library creates for itself
+static const char* builtinCalls[] = { "lsa", "rate", "set", "syncf" };
+
+
+long rmAutoPanel::getWxID() {
+    if(wx_id == 0)
+        wx_id = wxNewId();
+    return wx_id;
+}
+
+/**
+ * @brief Constructs an automatic panel
+ * 
+ * @param parent The parent window
+ * @param cli The client
+ */
+rmAutoPanel::rmAutoPanel(wxWindow* parent, rmClient* cli)
+            :wxVScrolledWindow(parent, wxID_ANY)
+{
+    client = cli;
+    rowHeight = GetCharHeight() + 16;
+    labelWidth = GetCharWidth() * 14;
+    refreshTimer.SetOwner(this, getWxID());
+    
+    Connect(
+        wxEVT_PAINT,
+        wxPaintEventHandler(rmAutoPanel::onPaint),
+        NULL,
+        this
+    );
+    Connect(
+        wxEVT_SIZE,
+        wxSizeEventHandler(rmAutoPanel::onSize),
+        NULL,
+        this
+    );
+    Connect(
+        wx_id,
+        wxEVT_TIMER,
+        wxTimerEventHandler(rmAutoPanel::onTimer),
+        NULL,
+        this
+    );
+    rebuild();
+    refreshTimer.Start(RM_AUTOPANEL_INTERVAL);
+}
+
+/**
+ * @brief Lists the attributes and calls of the client again
+ * 
+ * This is called by itself when the client device describes new attributes or
+ * calls. The widgets already constructed are kept and the ones of the rows
+ * gone are destroyed.
+ */
+void rmAutoPanel::rebuild() {
+    // The attributes of the sync tables are the outputs of the device
+    std::vector<rmAttribute*> vec = client->getSyncAttributes();
+    std::unordered_set<rmAttribute*> outputs(vec.begin(), vec.end());
+    
+    // The widgets already constructed are hidden until they are placed again
+    std::vector<rmAutoPanelRow> old;
+    old.swap(rows);
+    std::unordered_set<rmAttributeNotifier*> own;
+    for(auto it=old.begin(); it!=old.end(); it++) {
+        if(it->window != nullptr)
+            it->window->Hide();
+        if(it->widget != nullptr)
+            own.insert(it->widget);
+    }
+    
+    attrCount = client->getAttributeCount();
+    for(size_t i=0; i<attrCount; i++) {
+        rmAttribute* attr = client->getAttributeAt(i);
+        if(attr == nullptr)
+            break;
+        
+        rmAutoPanelRow row;
+        strncpy(row.name, attr->getName(), 11);
+        row.attribute = attr;
+        rmAttributeDataType t = attr->getType();
+        if(outputs.count(attr) > 0)
+            row.kind = RM_AUTO_TEXT;
+        else if(attr->getNotifier() != nullptr &&
+                own.count(attr->getNotifier()) == 0)
+            row.kind = RM_AUTO_TEXT; // Already shown by another widget
+        else if(t == RM_ATTRIBUTE_BOOL)
+            row.kind = RM_AUTO_CHECKBOX;
+        else if((t == RM_ATTRIBUTE_INT || t == RM_ATTRIBUTE_FLOAT) &&
+                !std::isnan(attr->getLowerBound()))
+            row.kind = RM_AUTO_SLIDER;
+        else
+            row.kind = RM_AUTO_TEXTCTRL;
+        rows.push_back(row);
+    }
+    
+    callCount = client->getDeviceCallCount();
+    for(size_t i=0; i<callCount; i++) {
+        std::string name = client->getDeviceCall(i);
+        bool builtin = false;
+        for(const char* str : builtinCalls) {
+            if(name == str)
+                builtin = true;
+        }
+        if(builtin || name.empty())
+            continue;
+        
+        rmAutoPanelRow row;
+        strncpy(row.name, name.c_str(), 11);
+        row.kind = RM_AUTO_BUTTON;
+        rows.push_back(row);
+    }
+    
+    // The attributes and then the calls are sorted by name in both lists, so
+    // the widgets are matched in one pass
+    auto before = [](const rmAutoPanelRow& a, const rmAutoPanelRow& b) {
+        bool callA = (a.kind == RM_AUTO_BUTTON);
+        bool callB = (b.kind == RM_AUTO_BUTTON);
+        if(callA != callB)
+            return callB;
+        return strcmp(a.name, b.name) < 0;
+    };
+    size_t k = 0;
+    for(auto it=rows.begin(); it!=rows.end(); it++) {
+        while(k < old.size() && before(old[k], *it))
+            k++;
+        if(k < old.size() && old[k].kind == it->kind &&
+           strcmp(old[k].name, it->name) == 0)
+        {
+            it->widget = old[k].widget;
+            it->window = old[k].window;
+            old[k].widget = nullptr;
+            old[k].window = nullptr;
+            k++;
+        }
+    }
+    
+    // The widgets of the rows gone are detached and destroyed
+    for(auto it=old.begin(); it!=old.end(); it++) {
+        if(it->window == nullptr)
+            continue;
+        if(it->attribute != nullptr &&
+           it->attribute->getNotifier() == it->widget)
+            it->attribute->setNotifier(nullptr);
+        client->removeWidget(it->widget);
+        it->window->Destroy();
+    }
+    
+    SetRowCount(rows.size());
+    layoutBegin = 0;
+    layoutEnd = 0;
+    Refresh();
+}
+
+/**
+ * @brief Gets the height of a row
+ * 
+ * @param row Index of the row
+ * 
+ * @return The row height in pixels
+ */
+wxCoord rmAutoPanel::OnGetRowHeight(size_t row) const { return rowHeight; }
+
+
+void rmAutoPanel::createWidget(rmAutoPanelRow* row) {
+    rmAttribute* attr = row->attribute;
+    switch(row->kind) {
+      case RM_AUTO_SLIDER:
+        if(attr->getType() == RM_ATTRIBUTE_INT) {
+            rmSlider* slider = new rmSlider(this, client, row->name,
+                                            (int) attr->getLowerBound(),
+                                            (int) attr->getUpperBound());
+            row->widget = slider;
+            row->window = slider;
+        }
+        else {
+            rmSlider* slider = new rmSlider(this, client, row->name,
+                                            attr->getLowerBound(),
+                                            attr->getUpperBound());
+            row->widget = slider;
+            row->window = slider;
+        }
+        break;
+      
+      case RM_AUTO_CHECKBOX: {
+        rmCheckBox* checkBox = new rmCheckBox(this, client, row->name, "");
+        row->widget = checkBox;
+        row->window = checkBox;
+        break;
+      }
+      
+      case RM_AUTO_TEXTCTRL: {
+        rmTextCtrl* textCtrl = new rmTextCtrl(this, client, row->name,
+                                              attr->getType());
+        row->widget = textCtrl;
+        row->window = textCtrl;
+        break;
+      }
+      
+      case RM_AUTO_BUTTON: {
+        rmButton* button = new rmButton(this, client, row->name, row->name);
+        row->widget = button;
+        row->window = button;
+        break;
+      }
+      
+      default:
+        return;
+    }
+    
+    row->widget->setEnabled(client->isConnected());
+    if(attr != nullptr && attr->getNotifier() == row->widget)
+        row->widget->onAttributeChange();
+}
+
+
+/*
+ * Places the widgets of the rows in view and hides the rest. The widgets are
+ * constructed on the first time their rows come into view.
+ */
+void rmAutoPanel::layoutWidgets() {
+    size_t begin = GetVisibleRowsBegin();
+    size_t end = GetVisibleRowsEnd();
+    if(end > rows.size())
+        end = rows.size();
+    
+    for(size_t i=layoutBegin; i<layoutEnd && i<rows.size(); i++) {
+        if((i < begin || i >= end) && rows[i].window != nullptr)
+            rows[i].window->Hide();
+    }
+    
+    int width = GetClientSize().GetWidth() - labelWidth - 8;
+    if(width < 40)
+        width = 40;
+    for(size_t i=begin; i<end; i++) {
+        rmAutoPanelRow* row = &rows[i];
+        if(row->kind == RM_AUTO_TEXT)
+            continue;
+        if(row->window == nullptr)
+            createWidget(row);
+        if(row->window == nullptr)
+            continue;
+        int y = (int) (i - begin) * rowHeight;
+        row->window->SetSize(labelWidth, y + 2, width, rowHeight - 4);
+        row->window->Show();
+    }
+    layoutBegin = begin;
+    layoutEnd = end;
+}
+
+/**
+ * @brief Paints the rows in view
+ * 
+ * @param evt The event object
+ */
+void rmAutoPanel::onPaint(wxPaintEvent& evt) {
+    wxPaintDC dc(this);
+    wxSize size = GetClientSize();
+    dc.SetFont(GetFont());
+    dc.SetTextForeground(wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOWTEXT));
+    
+    size_t begin = GetVisibleRowsBegin();
+    size_t end = GetVisibleRowsEnd();
+    if(end > rows.size())
+        end = rows.size();
+    
+    // The widgets are moved outside the paint event
+    if(begin != layoutBegin || end != layoutEnd)
+        CallAfter(&rmAutoPanel::layoutWidgets);
+    
+    int textY = (rowHeight - GetCharHeight()) / 2;
+    for(size_t i=begin; i<end; i++) {
+        const rmAutoPanelRow* row = &rows[i];
+        int y = (int) (i - begin) * rowHeight;
+        if(i % 2 == 1) {
+            dc.SetPen(*wxTRANSPARENT_PEN);
+            dc.SetBrush(wxBrush(wxSystemSettings::GetColour(
+                wxSYS_COLOUR_BTNFACE)));
+            dc.DrawRectangle(0, y, size.GetWidth(), rowHeight);
+        }
+        if(row->kind == RM_AUTO_BUTTON)
+            continue;
+        dc.DrawText(wxString(row->name), 4, y + textY);
+        if(row->kind != RM_AUTO_TEXT)
+            continue;
+        
+        rmAttribute* attr = row->attribute;
+        wxString value;
+        if(attr->getType() != RM_ATTRIBUTE_STRING ||
+           attr->getValue().s != nullptr)
+            value = wxString(attr->getValueString());
+        dc.DrawText(value, labelWidth, y + textY);
+    }
+}
+
+/**
+ * @brief Fits the widgets to the new width
+ * 
+ * @param evt The event object
+ */
+void rmAutoPanel::onSize(wxSizeEvent& evt) {
+    CallAfter(&rmAutoPanel::layoutWidgets);
+    evt.Skip();
+}
+
+/**
+ * @brief Repaints the values in view and picks up new attributes
+ * 
+ * @param evt Timer event object
+ */
+void rmAutoPanel::onTimer(wxTimerEvent& evt) {
+    if(client->getAttributeCount() != attrCount ||
+       client->getDeviceCallCount() != callCount)
+    {
+        rebuild();
+        return;
+    }
+    
+    size_t begin = GetVisibleRowsBegin();
+    size_t end = GetVisibleRowsEnd();
+    if(end > rows.size())
+        end = rows.size();
+    if(end > begin)
+        RefreshRows(begin, end - 1);
+}
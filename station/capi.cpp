@@ -0,0 +1,307 @@
+/**
+ * @file capi.cpp
+ * @brief C interface of the client for scripts and other languages
+ * 
+ * Wraps an rmClient that records the watched attributes into ring buffers
+ * the scripts drain in batches.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_EXPORT
+#define RM_NO_WX
+
+
+#include "rm/capi.h"
+
+#include "rm/client.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/*
+ * Samples of a watched attribute. The times and the values are kept in
+ * separate rings so a batch is copied out with two memcpy calls each.
+ */
+struct rmCapiWatch {
+    std::string name;
+    std::vector<double> times;
+    std::vector<double> values;
+    size_t head = 0;
+    size_t count = 0;
+    uint64_t dropped = 0;
+};
+
+
+struct rmCapiEcho {
+    std::string msg;
+    int status;
+};
+
+
+struct _rmClientHandle: public rmAttributeListener, public rmEcho {
+    rmClient client;
+    std::vector<rmCapiWatch*> watches;
+    std::unordered_map<rmAttribute*, int> ids;
+    std::deque<rmCapiEcho> echoes;
+    std::mutex m;
+    
+    virtual ~_rmClientHandle() = default;
+    void onAttributeUpdate(rmAttribute* attr) override;
+    void echo(const char* msg, int status=0) override;
+};
+
+
+static double getTime() {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration<double>(now).count();
+}
+
+
+static bool getNumber(rmAttribute* attr, double* value) {
+    rmAttributeData data = attr->getValue();
+    switch(attr->getType()) {
+    case RM_ATTRIBUTE_BOOL:
+        *value = data.b ? 1.0 : 0.0;
+        return true;
+    case RM_ATTRIBUTE_CHAR:
+        *value = data.c;
+        return true;
+    case RM_ATTRIBUTE_INT:
+        *value = data.i;
+        return true;
+    case RM_ATTRIBUTE_FLOAT:
+        *value = data.f;
+        return true;
+    default:
+        *value = NAN;
+        return false;
+    }
+}
+
+
+/*
+ * Called from the connection thread for every value received, so a value
+ * repeated by the device is recorded as a sample of its own. The watch of an
+ * attribute is looked up by name only on its first update.
+ */
+void _rmClientHandle::onAttributeUpdate(rmAttribute* attr) {
+    double t = getTime();
+    double value;
+    getNumber(attr, &value);
+    
+    std::lock_guard<std::mutex> lock(m);
+    int id;
+    auto it = ids.find(attr);
+    if(it != ids.end()) {
+        id = it->second;
+    }
+    else {
+        id = -1;
+        for(size_t i=0; i<watches.size(); i++) {
+            if(watches[i]->name == attr->getName()) {
+                id = (int) i;
+                break;
+            }
+        }
+        ids[attr] = id;
+    }
+    if(id < 0)
+        return;
+    
+    rmCapiWatch* w = watches[id];
+    size_t cap = w->values.size();
+    size_t pos = (w->head + w->count) % cap;
+    if(w->count == cap) {
+        w->head = (w->head + 1) % cap;
+        w->dropped++;
+    }
+    else {
+        w->count++;
+    }
+    w->times[pos] = t;
+    w->values[pos] = value;
+}
+
+
+void _rmClientHandle::echo(const char* msg, int status) {
+    std::lock_guard<std::mutex> lock(m);
+    echoes.push_back({ msg, status });
+    if(echoes.size() > RM_CAPI_ECHO_COUNT)
+        echoes.pop_front();
+}
+
+
+int rmGetVersion(void) { return RM_CAPI_VERSION; }
+
+
+rmClientHandle* rmClientCreate(void) {
+    rmClientHandle* h = new rmClientHandle();
+    h->client.setEcho(h);
+    h->client.setAttributeListener(h);
+    return h;
+}
+
+
+void rmClientDestroy(rmClientHandle* h) {
+    if(h == nullptr)
+        return;
+    h->client.disconnect();
+    h->client.setAttributeListener(nullptr);
+    h->client.setEcho(nullptr);
+    for(rmCapiWatch* w : h->watches)
+        delete w;
+    delete h;
+}
+
+
+/*
+ * Ports not listed by the system, such as pseudo terminals of the test rigs,
+ * are opened by name.
+ */
+int rmClientConnect(rmClientHandle* h, const char* port, uint32_t baud) {
+    if(strlen(port) >= sizeof(rmSerialPortInfo::port))
+        return 0;
+    rmSerialPortInfo info;
+    memset(&info, 0, sizeof(info));
+    strcpy(info.port, port);
+    rmSerialPortList ports = rmSerialPort::listPorts();
+    for(auto it=ports.begin(); it!=ports.end(); ++it) {
+        if(strcmp(it->port, port) == 0) {
+            info = *it;
+            break;
+        }
+    }
+    h->client.connectSerial(info, baud);
+    return h->client.isConnected() ? 1 : 0;
+}
+
+
+void rmClientDisconnect(rmClientHandle* h) { h->client.disconnect(); }
+
+
+int rmClientIsConnected(rmClientHandle* h) {
+    return h->client.isConnected() ? 1 : 0;
+}
+
+
+int rmClientSendCommand(rmClientHandle* h, const char* cmd) {
+    if(!h->client.isConnected() || strlen(cmd) >= 250)
+        return 0;
+    h->client.sendCommand("%s", cmd);
+    return 1;
+}
+
+
+int rmClientWatch(rmClientHandle* h, const char* key, size_t capacity) {
+    if(key == nullptr || key[0] == '\0' || strlen(key) > 11 || capacity == 0)
+        return -1;
+    std::lock_guard<std::mutex> lock(h->m);
+    for(size_t i=0; i<h->watches.size(); i++) {
+        if(h->watches[i]->name == key)
+            return (int) i;
+    }
+    rmCapiWatch* w = new rmCapiWatch();
+    w->name = key;
+    w->times.resize(capacity);
+    w->values.resize(capacity);
+    h->watches.push_back(w);
+    
+    // Attributes already seen are looked up again on their next update
+    h->ids.clear();
+    return (int) h->watches.size() - 1;
+}
+
+
+size_t rmClientAvailable(rmClientHandle* h, int id) {
+    std::lock_guard<std::mutex> lock(h->m);
+    if(id < 0 || (size_t) id >= h->watches.size())
+        return 0;
+    return h->watches[id]->count;
+}
+
+
+size_t rmClientRead(rmClientHandle* h, int id, double* times,
+                    double* values, size_t max)
+{
+    std::lock_guard<std::mutex> lock(h->m);
+    if(id < 0 || (size_t) id >= h->watches.size())
+        return 0;
+    rmCapiWatch* w = h->watches[id];
+    size_t n = (max < w->count) ? max : w->count;
+    size_t cap = w->values.size();
+    
+    // At most two runs, up to the end of the ring and from its start
+    size_t done = 0;
+    while(done < n) {
+        size_t run = cap - w->head;
+        if(run > n - done)
+            run = n - done;
+        if(times != nullptr)
+            memcpy(times + done, &w->times[w->head], run * sizeof(double));
+        memcpy(values + done, &w->values[w->head], run * sizeof(double));
+        w->head = (w->head + run) % cap;
+        w->count -= run;
+        done += run;
+    }
+    return n;
+}
+
+
+uint64_t rmClientDropped(rmClientHandle* h, int id) {
+    std::lock_guard<std::mutex> lock(h->m);
+    if(id < 0 || (size_t) id >= h->watches.size())
+        return 0;
+    return h->watches[id]->dropped;
+}
+
+
+int rmClientGetValue(rmClientHandle* h, const char* key, double* value) {
+    rmAttribute* attr = h->client.getAttribute(key);
+    if(attr == nullptr)
+        return 0;
+    return getNumber(attr, value) ? 1 : 0;
+}
+
+
+int rmClientGetString(rmClientHandle* h, const char* key, char* buf,
+                      size_t len)
+{
+    rmAttribute* attr = h->client.getAttribute(key);
+    if(attr == nullptr)
+        return -1;
+    std::string str = attr->getValueString();
+    if(len > 0) {
+        size_t n = (str.size() < len) ? str.size() : len - 1;
+        memcpy(buf, str.c_str(), n);
+        buf[n] = '\0';
+    }
+    return (int) str.size();
+}
+
+
+int rmClientReadEcho(rmClientHandle* h, char* buf, size_t len, int* status) {
+    std::lock_guard<std::mutex> lock(h->m);
+    if(h->echoes.empty())
+        return 0;
+    rmCapiEcho& e = h->echoes.front();
+    if(len > 0) {
+        size_t n = (e.msg.size() < len) ? e.msg.size() : len - 1;
+        memcpy(buf, e.msg.c_str(), n);
+        buf[n] = '\0';
+    }
+    if(status != nullptr)
+        *status = e.status;
+    h->echoes.pop_front();
+    return 1;
+}
@@ -17,10 +17,15 @@
 
 #include "rm/client.hpp"
 
-#include <cstring>
+#include "rm/frame.hpp"
 
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 
-static std::mutex m;
 
 void rmCallbackEcho(int argc, char *argv[], rmClient* cli);
 void rmCallbackWarn(int argc, char *argv[], rmClient* cli);
@@ -29,6 +34,15 @@ void rmCallbackResp(int argc, char *argv[], rmClient* cli);
 
 static void callbackSet (int argc, char *argv[], rmClient* cli);
 static void callbackSync(int argc, char *argv[], rmClient* cli);
+static void callbackSyncDelta(int argc, char *argv[], rmClient* cli);
+static void callbackHello(int argc, char *argv[], rmClient* cli);
+static void callbackName(int argc, char *argv[], rmClient* cli);
+static void callbackListInputs(int argc, char *argv[], rmClient* cli);
+static void callbackListCalls(int argc, char *argv[], rmClient* cli);
+static void callbackListSync(int argc, char *argv[], rmClient* cli);
+static void callbackReady(int argc, char *argv[], rmClient* cli);
+static void callbackCrypt(int argc, char *argv[], rmClient* cli);
+static void callbackCompress(int argc, char *argv[], rmClient* cli);
 
 
 /**
@@ -41,15 +55,49 @@ rmClient::rmClient() {
     appendCall(new rmBuiltinCall("resp", rmCallbackResp, this));
     appendCall(new rmBuiltinCall("set", callbackSet, this));
     appendCall(new rmBuiltinCall("sync", callbackSync, this));
+    appendCall(new rmBuiltinCall("syncd", callbackSyncDelta, this));
+    appendCall(new rmBuiltinCall("hello", callbackHello, this));
+    appendCall(new rmBuiltinCall("name", callbackName, this));
+    appendCall(new rmBuiltinCall("lsi", callbackListInputs, this));
+    appendCall(new rmBuiltinCall("lsc", callbackListCalls, this));
+    appendCall(new rmBuiltinCall("lst", callbackListSync, this));
+    appendCall(new rmBuiltinCall("ready", callbackReady, this));
+    appendCall(new rmBuiltinCall("crypt", callbackCrypt, this));
+    appendCall(new rmBuiltinCall("compress", callbackCompress, this));
+}
+
+
+static bool decodeHex(uint8_t* out, const char* str, size_t len) {
+    if(strlen(str) != 2 * len)
+        return false;
+    for(size_t i=0; i<len; i++) {
+        unsigned int v;
+        if(!isxdigit(str[2*i]) || !isxdigit(str[2*i + 1]) ||
+           sscanf(&str[2*i], "%2x", &v) != 1)
+            return false;
+        out[i] = (uint8_t) v;
+    }
+    return true;
+}
+
+
+static void callbackCrypt(int argc, char *argv[], rmClient* cli) {
+    if(argc < 2)
+        return;
+    uint8_t pub[RM_PUBLIC_KEY_SIZE];
+    uint8_t nonce[RM_CRYPT_NONCE_SIZE];
+    if(decodeHex(pub, argv[0], sizeof(pub)) &&
+       decodeHex(nonce, argv[1], sizeof(nonce)))
+        cli->startEncryption(pub, nonce);
 }
 
 /**
  * @brief Destructor
  */
 rmClient::~rmClient() {
-    m.lock();
+    attrMutex.lock();
     widgetCount = 0;
-    m.unlock();
+    attrMutex.unlock();
     disconnect();
     if(attributes != nullptr) {
         for(size_t i=0; i<attrCount; i++)
@@ -63,6 +111,10 @@ rmClient::~rmClient() {
     }
     if(widgets != nullptr)
         delete widgets;
+    for(size_t i=0; i<256; i++) {
+        if(syncs[i] != nullptr)
+            delete syncs[i];
+    }
 }
 
 /**
@@ -113,6 +165,8 @@ bool rmClient::appendAttribute(rmAttribute* attr) {
     }
     newArr[pos] = attr;
     attrCount++;
+    attr->setListener(&clientListener);
+    clientListener.onAttributeUpdate(attr);
     
     if(attributes != nullptr)
         delete attributes;
@@ -120,27 +174,44 @@ bool rmClient::appendAttribute(rmAttribute* attr) {
     return true;
 }
 
+/*
+ * Takes over an attribute created by a sync table for a widget. The widgets
+ * set themselves as the notifier, so an attribute without one is not used by
+ * any other widget.
+ */
+rmAttribute* rmClient::adoptAttribute(const char* key, rmAttributeDataType t) {
+    size_t pos = binarySearch1(0, attrCount - 1, key);
+    if(pos >= attrCount || strcmp(attributes[pos]->getName(), key) != 0)
+        return nullptr;
+    rmAttribute* attr = attributes[pos];
+    if(attr->getNotifier() != nullptr)
+        return nullptr;
+    attr->setType(t);
+    return attr;
+}
+
 /**
  * @brief Creates an attribute in the map structure
  * 
  * @param key Unique name of the attribute with maximum 11 characters
  * @param t Data type of the value stored
  * 
- * @return The newly created attribute. Null if the attribute with the same
- *         name already exists or the creation is invalid.
+ * @return The newly created attribute. An attribute created by a sync table
+ *         and not used by any widget yet is returned with the new type. Null
+ *         if the attribute with the same name already exists or the creation
+ *         is invalid.
  */
 rmAttribute* rmClient::createAttribute(const char* key, rmAttributeDataType t)
 {
-    m.lock();
+    attrMutex.lock();
     rmAttribute* attr = new rmAttribute(key, t);
     bool valid = appendAttribute(attr);
-    m.unlock();
-    if(valid)
-        return attr;
-    else {
+    if(!valid) {
         delete attr;
-        return nullptr;
+        attr = adoptAttribute(key, t);
     }
+    attrMutex.unlock();
+    return attr;
 }
 
 /**
@@ -152,22 +223,25 @@ rmAttribute* rmClient::createAttribute(const char* key, rmAttributeDataType t)
  *              of the same type as t.
  * @param upper Upper bound value
  * 
- * @return The newly created attribute. Null if the attribute with the same
- *         name already exists or the creation is invalid.
+ * @return The newly created attribute. An attribute created by a sync table
+ *         and not used by any widget yet is returned with the new type. Null
+ *         if the attribute with the same name already exists or the creation
+ *         is invalid.
  */
 rmAttribute* rmClient::createAttribute(const char* key, rmAttributeDataType t,
                                        float lower, float upper)
 {
-    m.lock();
+    attrMutex.lock();
     rmAttribute* attr = new rmAttribute(key, t, lower, upper);
     bool valid = appendAttribute(attr);
-    m.unlock();
-    if(valid)
-        return attr;
-    else {
+    if(!valid) {
         delete attr;
-        return nullptr;
+        attr = adoptAttribute(key, t);
+        if(attr != nullptr)
+            attr->setBoundary(lower, upper);
     }
+    attrMutex.unlock();
+    return attr;
 }
 
 /**
@@ -178,34 +252,57 @@ rmAttribute* rmClient::createAttribute(const char* key, rmAttributeDataType t,
  * @return Requested attribute. Null if the request is unavailable.
  */
 rmAttribute* rmClient::getAttribute(const char* key) {
-    m.lock();
+    attrMutex.lock();
     if(attributes != nullptr) {
         size_t pos = binarySearch1(0, attrCount - 1, key);
         if(pos < attrCount) {
             if(strcmp(attributes[pos]->getName(), key) == 0) {
-                m.unlock();
+                attrMutex.unlock();
                 return attributes[pos];
             }
         }
     }
-    m.unlock();
+    attrMutex.unlock();
     return nullptr;
 }
 
+/**
+ * @brief Gets the number of attributes in the map
+ * 
+ * @return The attribute count
+ */
+size_t rmClient::getAttributeCount() const { return attrCount; }
+
+/**
+ * @brief Gets an attribute by its position in the map
+ * 
+ * The attributes are sorted by name.
+ * 
+ * @param i Index of the attribute
+ * 
+ * @return The attribute. Null if the index is out of range.
+ */
+rmAttribute* rmClient::getAttributeAt(size_t i) {
+    attrMutex.lock();
+    rmAttribute* attr = (i < attrCount) ? attributes[i] : nullptr;
+    attrMutex.unlock();
+    return attr;
+}
+
 /**
  * @brief Removes an attribute from the map by name
  * 
  * @param key Unique name
  */
 void rmClient::removeAttribute(const char* key) {
-    m.lock();
+    attrMutex.lock();
     if(attrCount == 0) {
-        m.unlock();
+        attrMutex.unlock();
         return;
     }
     size_t pos = binarySearch1(0, attrCount - 1, key);
     if(strcmp(attributes[pos]->getName(), key) != 0) {
-        m.unlock();
+        attrMutex.unlock();
         return;
     }
     delete attributes[pos];
@@ -222,7 +319,7 @@ void rmClient::removeAttribute(const char* key) {
     if(attributes != nullptr)
         delete attributes;
     attributes = newArr;
-    m.unlock();
+    attrMutex.unlock();
 }
 
 
@@ -292,10 +389,10 @@ bool rmClient::appendCall(rmCall* call) {
  *         already exists or the creation is invalid.
  */
 rmCall* rmClient::createCall(const char* key, void (*func)(int, char**)) {
-    m.lock();
+    attrMutex.lock();
     rmCall* call = new rmCall(key, func);
     bool valid = appendCall(call);
-    m.unlock();
+    attrMutex.unlock();
     if(valid)
         return call;
     else {
@@ -312,17 +409,17 @@ rmCall* rmClient::createCall(const char* key, void (*func)(int, char**)) {
  * @return Requested call. Null if the request is unavailable.
  */
 rmCall* rmClient::getCall(const char* key) {
-    m.lock();
+    attrMutex.lock();
     if(calls != nullptr) {
         size_t pos = binarySearch2(0, callCount - 1, key);
         if(pos < callCount) {
             if(strcmp(calls[pos]->getName(), key) == 0) {
-                m.unlock();
+                attrMutex.unlock();
                 return calls[pos];
             }
         }
     }
-    m.unlock();
+    attrMutex.unlock();
     return nullptr;
 }
 
@@ -332,14 +429,14 @@ rmCall* rmClient::getCall(const char* key) {
  * @param key Unique name
  */
 void rmClient::removeCall(const char* key) {
-    m.lock();
+    attrMutex.lock();
     if(callCount == 0) {
-        m.unlock();
+        attrMutex.unlock();
         return;
     }
     size_t pos = binarySearch2(0, callCount - 1, key);
     if(strcmp(calls[pos]->getName(), key) != 0) {
-        m.unlock();
+        attrMutex.unlock();
         return;
     }
     delete calls[pos];
@@ -356,7 +453,7 @@ void rmClient::removeCall(const char* key) {
     if(calls != nullptr)
         delete calls;
     calls = newArr;
-    m.unlock();
+    attrMutex.unlock();
 }
 
 /**
@@ -365,7 +462,7 @@ void rmClient::removeCall(const char* key) {
  * @param widget The widget
  */
 void rmClient::appendWidget(rmWidget* widget) {
-    m.lock();
+    attrMutex.lock();
     rmWidget** newArr = new rmWidget*[widgetCount + 1];
     for(size_t i=0; i<widgetCount; i++)
         newArr[i] = widgets[i];
@@ -374,7 +471,7 @@ void rmClient::appendWidget(rmWidget* widget) {
     if(widgets != nullptr)
         delete widgets;
     widgets = newArr;
-    m.unlock();
+    attrMutex.unlock();
 }
 
 /**
@@ -383,17 +480,17 @@ void rmClient::appendWidget(rmWidget* widget) {
  * @param widget The widget
  */
 void rmClient::removeWidget(rmWidget* widget) {
-    m.lock();
+    attrMutex.lock();
     for(size_t i=0; i<widgetCount; i++) {
         if(widgets[i] == widget) {
             for(size_t j=i+1; j<widgetCount; j++)
                 widgets[j - 1] = widgets[j];
             widgetCount--;
-            m.unlock();
+            attrMutex.unlock();
             return;
         }
     }
-    m.unlock();
+    attrMutex.unlock();
 }
 
 
@@ -405,11 +502,7 @@ static void callbackSet(int argc, char *argv[], rmClient* cli) {
     if(attr != nullptr) {
         rmAttributeData prev = attr->getValue();
         attr->setValue(argv[1]);
-        if(attr->getValue().i != prev.i) {
-            rmAttributeNotifier* noti = attr->getNotifier();
-            if(noti != nullptr)
-                noti->onAttributeChange();
-        }
+        attr->notifyUpdate(attr->getValue().i != prev.i);
     }
 }
 
@@ -418,5 +511,129 @@ static void callbackSync(int argc, char *argv[], rmClient* cli) {
     if(argc < 2)
         return;
     uint8_t i = atoi(argv[0]);
-    cli->syncUpdate(i, argv[1]);
+    size_t start = (argc > 2) ? atoi(argv[2]) : 0;
+    cli->syncUpdate(i, argv[1], start);
+}
+
+
+static void callbackSyncDelta(int argc, char *argv[], rmClient* cli) {
+    if(argc < 2)
+        return;
+    uint8_t i = atoi(argv[0]);
+    cli->syncDeltaUpdate(i, argv[1]);
+}
+
+
+/*
+ * The connect handshake. The device answers "connect" with its protocol
+ * version, capabilities, buffer sizes and highest sync rate, then lists its
+ * name, input attributes, calls and sync tables and ends with "ready".
+ */
+static void callbackHello(int argc, char *argv[], rmClient* cli) {
+    if(argc < 5)
+        return;
+    rmDeviceInfo info;
+    info.version = atoi(argv[0]);
+    info.capabilities = atoi(argv[1]);
+    info.rxBufferSize = atoi(argv[2]);
+    info.txBufferSize = atoi(argv[3]);
+    info.maxRate = atoi(argv[4]);
+    cli->setDeviceInfo(info);
+    if(info.capabilities & RM_DEVICE_COMPRESS)
+        cli->sendCommand("compress 1");
+}
+
+
+static void callbackCompress(int argc, char *argv[], rmClient* cli) {
+    if(argc >= 2 && strcmp(argv[0], "1") == 0)
+        cli->startCompression(atoi(argv[1]));
+    else if(argc >= 1 && strcmp(argv[0], "0") == 0)
+        cli->stopCompression();
+}
+
+
+static void callbackName(int argc, char *argv[], rmClient* cli) {
+    if(argc < 1)
+        return;
+    std::string str = argv[0];
+    for(int i=1; i<argc; i++) {
+        str += ' ';
+        str += argv[i];
+    }
+    cli->setDeviceName(str.c_str());
+}
+
+
+static void callbackListInputs(int argc, char *argv[], rmClient* cli) {
+    if(argc != 1)
+        return;
+    
+    char* token = argv[0];
+    while(*token != '\0') {
+        char* sep = strchr(token, ',');
+        if(sep != NULL)
+            *sep = '\0';
+        // Items are the name, the type and optionally the bounds
+        char* colon = strchr(token, ':');
+        uint8_t type = RM_WIRE_STRING;
+        float lower = NAN;
+        float upper = NAN;
+        if(colon != NULL) {
+            *colon = '\0';
+            type = (uint8_t) strtoul(colon + 1, &colon, 16);
+            if(*colon == ':') {
+                lower = strtof(colon + 1, &colon);
+                if(*colon == ':')
+                    upper = strtof(colon + 1, NULL);
+            }
+        }
+        rmAttributeDataType t = rmFrameAttributeType(type);
+        rmAttribute* attr = cli->getAttribute(token);
+        if(attr == nullptr) {
+            if(std::isnan(lower) || std::isnan(upper))
+                cli->createAttribute(token, t);
+            else
+                cli->createAttribute(token, t, lower, upper);
+        }
+        else if(!std::isnan(lower) && !std::isnan(upper) &&
+                std::isnan(attr->getLowerBound()))
+        {
+            attr->setBoundary(lower, upper);
+        }
+        if(sep == NULL)
+            break;
+        token = sep + 1;
+    }
+}
+
+
+static void callbackListCalls(int argc, char *argv[], rmClient* cli) {
+    if(argc != 1)
+        return;
+    
+    char* token = argv[0];
+    while(*token != '\0') {
+        char* sep = strchr(token, ',');
+        if(sep != NULL)
+            *sep = '\0';
+        cli->appendDeviceCall(token);
+        if(sep == NULL)
+            break;
+        token = sep + 1;
+    }
+}
+
+
+static void callbackListSync(int argc, char *argv[], rmClient* cli) {
+    if(argc != 2)
+        return;
+    uint8_t i = atoi(argv[0]);
+    cli->syncListUpdate(i, argv[1], false);
+}
+
+
+static void callbackReady(int argc, char *argv[], rmClient* cli) {
+    rmDeviceInfo info = *cli->getDeviceInfo();
+    info.ready = true;
+    cli->setDeviceInfo(info);
 }
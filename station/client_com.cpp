@@ -17,180 +17,501 @@
 
 #include "rm/client.hpp"
 
+#include "rm/frame.hpp"
+
 #include <algorithm>
 #include <chrono>
 #include <cstdarg>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <mutex>
+#include <random>
 #include <thread>
 
+#if defined(__linux__)
+#include <poll.h>
+#endif
+
 
 static std::vector<rmClient*> clients;
 static std::thread thread;
-static std::mutex m;
+static std::mutex threadMutex; // Guards the clients of the thread
 
 static void respCallbackLsa(rmResponse resp);
 
 
-#define PROCESS_DEFAULT   0b00
-#define PROCESS_STARTED   0b01
-#define PROCESS_SEPERATOR 0b11
+static int64_t getTime() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+}
+
+
+#define PROCESS_DEFAULT   0b000
+#define PROCESS_STARTED   0b001
+#define PROCESS_SEPERATOR 0b011
+#define PROCESS_FRAME     0b100
 
 
 /**
  * @brief Checks the connection and processes the incoming messages
  */
-void rmClient::onIdle() {
-    char c = read();
-    while(c != '\0') {
-        if(rx_i == 255)
-            c = '\n';
-        
-        if(rx_flag & PROCESS_STARTED) {
-            rmCall* call;
-            switch(c) {
-              case ' ':
-                rx_cmd[rx_i++] = '\0';
-                rx_flag = PROCESS_SEPERATOR;
-                break;
-                
-              case '\n':
-                rx_cmd[rx_i] = '\0';
-                call = getCall(rx_cmd);
-                if(call != NULL)
-                    call->invoke(rx_tokenCount, rx_tokens);
+void rmClient::onIdle() { onIdle(-1); }
+
+/**
+ * @brief Checks the connection and processes the incoming messages for a
+ *        limited time
+ * 
+ * The bytes are read and processed in chunks of 256 until there are no more
+ * or the time is up, so a burst is taken over several calls.
+ * 
+ * @param budget Time to process the messages in microseconds. Negative for
+ *               no limit.
+ * 
+ * @return Number of bytes processed
+ */
+size_t rmClient::onIdle(long budget) {
+    auto start = std::chrono::steady_clock::now();
+    uint8_t buf[256];
+    size_t total = 0;
+    size_t n = read(buf, sizeof(buf));
+    while(n > 0) {
+        for(size_t i=0; i<n; i++) {
+            if(cryptChannel.isActive())
+                processCryptByte((char) buf[i]);
+            else
+                processByte((char) buf[i]);
+        }
+        total += n;
+        if(budget >= 0 && std::chrono::steady_clock::now() - start >=
+                          std::chrono::microseconds(budget))
+            break;
+        n = read(buf, sizeof(buf));
+    }
+    if(useEncryption && !cryptWarned && !cryptChannel.isActive() &&
+       getTime() - handshakeStart > RM_HANDSHAKE_TIMEOUT)
+    {
+        cryptWarned = true;
+        echo("The device does not answer the key exchange", 1);
+    }
+    if(rx_discarded > 0) {
+        linkBudget.onError(RM_LINK_DISCARDED, rx_discarded);
+        rx_discarded = 0;
+    }
+    linkBudget.update(this);
+    return total;
+}
+
+
+void rmClient::processByte(char c) {
+    rx_count++;
+    if(rx_flag == PROCESS_FRAME) {
+        rx_frame[rx_frameLen++] = (uint8_t) c;
+        // Type, length, payload and checksum
+        if(rx_frameLen >= 2 && rx_frameLen == rx_frame[1] + 3) {
+            uint8_t type = rx_frame[0];
+            if((type == RM_FRAME_SYNC || type == RM_FRAME_SYNC_DELTA ||
+                type == RM_FRAME_SYNC_PART) && rx_frame[1] >= 1)
+                linkBudget.onReceived(rx_frame[2], rx_count);
+            else
+                linkBudget.onReceived(RM_LINK_OTHER, rx_count);
+            rx_count = 0;
+            processFrame();
+            rx_flag = PROCESS_DEFAULT;
+        }
+        return;
+    }
+    
+    // The frames are sent as they are between the compressed lines
+    if(rx_compressed && !(c == RM_FRAME_START && decompressor.isIdle())) {
+        char text[RM_COMPRESS_MAX_MATCH];
+        int n = decompressor.push((uint8_t) c, text);
+        if(n < 0) {
+            // The rest of the line is lost along with the bytes missed
+            linkBudget.onError(RM_LINK_CHECKSUM);
+            rx_flag = PROCESS_DEFAULT;
+        }
+        else if(decompressor.isBroken()) {
+            rx_discarded++;
+        }
+        for(int i=0; i<n; i++)
+            processText(text[i]);
+        return;
+    }
+    processText(c);
+}
+
+
+/*
+ * Parses the command-lines and starts the frames, after the decompression.
+ */
+void rmClient::processText(char c) {
+    if(rx_i == 255 && (rx_flag & PROCESS_STARTED)) {
+        c = '\n';
+        linkBudget.onError(RM_LINK_TRUNCATED);
+    }
+    
+    if(rx_flag & PROCESS_STARTED) {
+        rmCall* call;
+        switch(c) {
+          case '\0':
+            break;
+          
+          case ' ':
+            rx_cmd[rx_i++] = '\0';
+            rx_flag = PROCESS_SEPERATOR;
+            break;
+          
+          case '\n':
+            rx_cmd[rx_i] = '\0';
+            if(rx_tokenCount > 0 && (strcmp(rx_cmd, "sync") == 0 ||
+                                     strcmp(rx_cmd, "syncd") == 0))
+                linkBudget.onReceived(atoi(rx_tokens[0]), rx_count);
+            else
+                linkBudget.onReceived(RM_LINK_OTHER, rx_count);
+            rx_count = 0;
+            // Only the key exchange is taken in the clear when encrypted
+            if(useEncryption && !rx_trusted && strcmp(rx_cmd, "crypt") != 0) {
+                rx_discarded += rx_i + 2;
                 rx_flag = PROCESS_DEFAULT;
                 break;
-                
-              default:
-                if(rx_flag == PROCESS_SEPERATOR) {
-                    if(rx_tokenCount == 8)
-                        break;
-                    rx_tokens[rx_tokenCount++] = &rx_cmd[rx_i];
-                    rx_flag = PROCESS_STARTED;
-                }
-                rx_cmd[rx_i++] = c;
+            }
+            call = getCall(rx_cmd);
+            if(call != NULL)
+                call->invoke(rx_tokenCount, rx_tokens);
+            else
+                linkBudget.onError(RM_LINK_UNKNOWN);
+            rx_flag = PROCESS_DEFAULT;
+            break;
+          
+          default:
+            if(rx_flag == PROCESS_SEPERATOR) {
+                if(rx_tokenCount == 8)
+                    break;
+                rx_tokens[rx_tokenCount++] = &rx_cmd[rx_i];
+                rx_flag = PROCESS_STARTED;
+            }
+            rx_cmd[rx_i++] = c;
+        }
+    }
+    else if(c == '$') {
+        rx_i = 0;
+        rx_tokenCount = 0;
+        rx_flag = PROCESS_STARTED;
+    }
+    else if(c == RM_FRAME_START) {
+        rx_frameLen = 0;
+        rx_flag = PROCESS_FRAME;
+    }
+    else if(c != '\r' && c != '\n' && c != '\0') {
+        rx_discarded++;
+    }
+}
+
+
+void rmClient::processFrame() {
+    uint8_t type = rx_frame[0];
+    uint8_t len = rx_frame[1];
+    uint8_t* payload = &rx_frame[2];
+    if(rmFrameChecksum(0, rx_frame, len + 2) != rx_frame[len + 2]) {
+        linkBudget.onError(RM_LINK_CHECKSUM);
+        return;
+    }
+    if(useEncryption && !rx_trusted) {
+        rx_discarded += len + 4;
+        return;
+    }
+    
+    switch(type) {
+      case RM_FRAME_SYNC:
+      case RM_FRAME_SYNC_DELTA:
+        if(len >= 1) {
+            rmSync* sync = getSync(payload[0]);
+            if(sync != nullptr) {
+                sync->onSyncBinary(&payload[1], len - 1,
+                                   type == RM_FRAME_SYNC_DELTA);
+                recordSync(sync);
+            }
+        }
+        break;
+      
+      case RM_FRAME_SYNC_PART:
+        if(len >= 2) {
+            rmSync* sync = getSync(payload[0]);
+            if(sync != nullptr) {
+                sync->onSyncBinary(&payload[2], len - 2, false, payload[1]);
+                recordSync(sync);
             }
         }
-        else if(c == '$') {
-            rx_i = 0;
-            rx_tokenCount = 0;
-            rx_flag = PROCESS_STARTED;
+        break;
+      
+      case RM_FRAME_SET:
+        if(len >= 2 && payload[0] + 2 <= len) {
+            char key[12];
+            uint8_t n = (payload[0] < 11) ? payload[0] : 11;
+            memcpy(key, &payload[1], n);
+            key[n] = '\0';
+            uint8_t* value = &payload[payload[0] + 1];
+            rmFrameDecodeValue(getAttribute(key), value[0], &value[1],
+                               len - payload[0] - 2);
         }
-        c = read();
+        break;
+    }
+}
+
+
+/*
+ * Takes the bytes of an encrypted connection. The device sends everything
+ * sealed in RM_FRAME_CRYPT frames and the messages opened are passed on to
+ * processByte() as if they came in the clear.
+ */
+void rmClient::processCryptByte(char c) {
+    if(!rx_cryptStarted) {
+        if(c == RM_FRAME_START) {
+            rx_cryptLen = 0;
+            rx_cryptStarted = true;
+        }
+        else if(c != '\r' && c != '\n' && c != '\0') {
+            rx_discarded++;
+        }
+        return;
+    }
+    
+    rx_cryptFrame[rx_cryptLen++] = (uint8_t) c;
+    if(rx_cryptLen < 2 || rx_cryptLen != rx_cryptFrame[1] + 3)
+        return;
+    rx_cryptStarted = false;
+    uint8_t len = rx_cryptFrame[1];
+    // The counter, the tag and the frame around them
+    linkBudget.onReceived(RM_LINK_OTHER, RM_CRYPT_OVERHEAD + 4);
+    if(rx_cryptFrame[0] != RM_FRAME_CRYPT ||
+       rmFrameChecksum(0, rx_cryptFrame, len + 2) != rx_cryptFrame[len + 2])
+    {
+        linkBudget.onError(RM_LINK_CHECKSUM);
+        return;
+    }
+    
+    m.lock();
+    long n = cryptChannel.open(&rx_cryptFrame[2], len);
+    m.unlock();
+    if(n < 0) {
+        linkBudget.onError(RM_LINK_CHECKSUM);
+        return;
     }
+    rx_trusted = true;
+    for(long i=0; i<n; i++)
+        processByte((char) rx_cryptFrame[6 + i]);
+    rx_trusted = false;
 }
 
 
+// Wakes on the bytes received by any of the clients, or after 10 ms for the
+// timeouts and the clients reconnecting
+static void waitForClients(const std::vector<rmClient*>& vec) {
+#if defined(__linux__)
+    std::vector<struct pollfd> fds;
+    for(auto it=vec.begin(); it!=vec.end(); it++) {
+        int fd = (*it)->getSerialFd();
+        if(fd >= 0)
+            fds.push_back({ fd, POLLIN, 0 });
+    }
+    if(fds.size() > 0) {
+        poll(fds.data(), fds.size(), 10);
+        return;
+    }
+#endif
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+}
+
 static void connectionThread() {
     do {
-        m.lock();
+        threadMutex.lock();
         if(clients.size() == 0) {
-            m.unlock();
+            threadMutex.unlock();
             break;
         }
         auto vec = clients;
-        m.unlock();
+        threadMutex.unlock();
         
         for(auto it=vec.begin(); it!=vec.end(); it++) {
             if((*it)->isConnected() == false) {
+                if((*it)->reconnect())
+                    continue;
                 (*it)->echo("Port disconnected", 1);
-                m.lock();
+                threadMutex.lock();
                 auto it2 = std::find(clients.begin(), clients.end(), *it);
                 clients.erase(it2);
-                m.unlock();
+                threadMutex.unlock();
                 (*it)->onDisconnected();
             }
             (*it)->onIdle();
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        waitForClients(vec);
     } while(true);
 }
 
 
+/*
+ * Starts processing the connection and asks the device to describe itself.
+ * The reply to "connect" comes in as the hello, name, lsi, lsc and lst
+ * commands followed by ready. Devices without the handshake ignore it, and
+ * their sync tables are listed on request once RM_HANDSHAKE_TIMEOUT has
+ * passed.
+ */
 void rmClient::startConnection() {
-    /*char cmd[256];
-    char* tokens[4];
-    uint8_t i = 0;
-    uint8_t tokenCount = 0;
-    bool space = false;
-    sendMessage("connect", false);
-    bool connectionOk = false;
-    long t = 0;
+    m.lock();
+    if(myEcho != nullptr) {
+        myEcho->setEnabled(true);
+    }
+    for(size_t i=0; i<widgetCount; i++)
+        widgets[i]->setEnabled(true);
+    m.unlock();
     
-    do {
-        if(connectionMethod == RM_CONNECTION_SERIAL) {
-            if(!mySerial->isConnected()) {
-                echo("Port disconnected", 1);
-                break;
-            }
-        }
-        
-        char c = read();
-        while(c != '\0') {
-            if(i == 255)
-                c = '\n';
-            
-            switch(c) {
-              case ' ':
-                if(!space) {
-                    cmd[i++] = '\0';
-                    space = true;
-                }
-                break;
-                
-              case '\n':
-                cmd[i] = '\0';
-                if(strcmp(cmd, "connect")) {
-                    connectionOk = true;
-                }
-                i = 0;
-                tokenCount = 0;
-                space = false;
-                break;
-                
-              default:
-                if(space) {
-                    tokens[tokenCount++] = cmd + i;
-                    space = false;
-                }
-                cmd[i++] = c;
-            }
-            if(connectionOk)
-                break;
-            c = read();
-        }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(20));
-        t += 20;
-        if(t > 5000) {
-            echo("Client device not responding", 1);
-            break;
-        }
-    } while(true);
-    */
-    //if(connectionOk) {
-    if(1) {
+    if(timer != nullptr) {
+        timer->appendClient(this);
+    }
+    else {
+        threadMutex.lock();
+        if(clients.size() == 0)
+            thread = std::thread(&connectionThread);
+        clients.push_back(this);
+        threadMutex.unlock();
+    }
+    startHandshake();
+}
+
+
+/*
+ * Sends "connect", or on an encrypted connection, "$crypt" with a new nonce
+ * in the clear. The device answers that with its public key and nonce, and
+ * startEncryption() sends "connect" sealed. Nothing else is sent until then.
+ */
+void rmClient::startHandshake() {
+    handshakeStart = getTime();
+    if(!useEncryption) {
+        // The device starts again with the lines uncompressed
         m.lock();
-        if(myEcho != nullptr) {
-            myEcho->setEnabled(true);
-        }
-        for(size_t i=0; i<widgetCount; i++)
-            widgets[i]->setEnabled(true);
+        rx_compressed = false;
         m.unlock();
-        
-        if(timer != nullptr) {
-            timer->appendClient(this);
-        }
-        else {
-            m.lock();
-            if(clients.size() == 0)
-                thread = std::thread(&connectionThread);
-            clients.push_back(this);
-            m.unlock();
-        }
+        sendCommand("connect");
+        return;
+    }
+    
+    std::random_device rd;
+    char buff[8 + 2*RM_CRYPT_NONCE_SIZE + 2];
+    strcpy(buff, "$crypt ");
+    for(size_t i=0; i<RM_CRYPT_NONCE_SIZE; i++) {
+        cryptNonce[i] = (uint8_t) rd();
+        snprintf(&buff[7 + 2*i], 3, "%02x", cryptNonce[i]);
+    }
+    strcat(buff, "\n");
+    m.lock();
+    cryptChannel.stop();
+    cryptWarned = false;
+    rx_cryptStarted = false;
+    rx_compressed = false;
+    mySerial.write(buff);
+    m.unlock();
+}
+
+/**
+ * @brief Starts the session with the keys the device answered with
+ * 
+ * Called by the reply to "$crypt". The messages held back during the key
+ * exchange are sealed and sent along with "connect". A device whose key is
+ * not trusted with rmTrustDevice() is refused.
+ * 
+ * @param pub The device's public key of RM_PUBLIC_KEY_SIZE bytes
+ * @param nonce The device's nonce of RM_CRYPT_NONCE_SIZE bytes
+ * 
+ * @return False if the client is not waiting for the keys or the device
+ *         is not trusted
+ */
+bool rmClient::startEncryption(const uint8_t* pub, const uint8_t* nonce) {
+    const uint8_t* priv = rmGetPrivateKey();
+    m.lock();
+    if(!useEncryption || cryptChannel.isActive() || priv == nullptr) {
+        m.unlock();
+        return false;
     }
+    if(!rmIsTrustedDevice(pub)) {
+        m.unlock();
+        char buff[20 + 2*RM_PUBLIC_KEY_SIZE];
+        strcpy(buff, "Unknown device key ");
+        for(size_t i=0; i<RM_PUBLIC_KEY_SIZE; i++)
+            snprintf(&buff[19 + 2*i], 3, "%02x", pub[i]);
+        echo(buff, 1);
+        return false;
+    }
+    uint8_t secret[32];
+    rmX25519(secret, priv, pub);
+    cryptChannel.start(secret, cryptNonce, nonce);
+    memcpy(key, pub, RM_PUBLIC_KEY_SIZE);
+    rx_compressed = false;
+    std::vector<std::string> writes;
+    writes.swap(pendingWrites);
+    m.unlock();
+    
+    handshakeStart = getTime();
+    sendCommand("connect");
+    for(auto it=writes.begin(); it!=writes.end(); ++it)
+        sendMessage(it->c_str());
+    return true;
+}
+
+/**
+ * @brief Checks if the connection is encrypted
+ * 
+ * @return True once the device has answered the key exchange
+ */
+bool rmClient::isEncrypted() {
+    m.lock();
+    bool b = cryptChannel.isActive();
+    m.unlock();
+    return b;
+}
+
+/**
+ * @brief Decompresses the lines from now on
+ * 
+ * Called by the device's answer to "$compress 1".
+ * 
+ * @param window Window size the device compresses with
+ * 
+ * @return False if the window size is not supported, in which case the
+ *         device is asked to stop
+ */
+bool rmClient::startCompression(uint16_t window) {
+    m.lock();
+    bool b = decompressor.reset(window);
+    rx_compressed = b;
+    m.unlock();
+    if(!b)
+        sendCommand("compress 0");
+    return b;
+}
+
+/**
+ * @brief Takes the lines as they come from now on
+ * 
+ * Called by the device's answer to "$compress 0".
+ */
+void rmClient::stopCompression() {
+    m.lock();
+    rx_compressed = false;
+    m.unlock();
+}
+
+/**
+ * @brief Checks if the device compresses its lines
+ * 
+ * @return True once the device has answered "$compress 1"
+ */
+bool rmClient::isCompressed() {
+    m.lock();
+    bool b = rx_compressed;
+    m.unlock();
+    return b;
 }
 
 /**
@@ -199,19 +520,27 @@ void rmClient::startConnection() {
  * @param port The address of the serial port, which would be something like
  *             'COM1' on Windows and '/dev/ttyACM0' on Linux.
  * @param baud Baudrate
- * @param crypt Enable encryption
+ * @param crypt Encrypt the connection with the key opened by rmOpenKey()
  */
 void rmClient::connectSerial(const char* port, uint32_t baud, bool crypt) {
     disconnect();
+    if(crypt && rmGetPrivateKey() == nullptr) {
+        echo("No key is open for the encryption", 1);
+        return;
+    }
+    useEncryption = crypt;
     mySerial.connect(port, baud);
+    baudrate = baud;
+    linkBudget.reset();
+    linkBudget.setBaudrate(baud);
     
     if(mySerial.isConnected()) {
         startConnection();
     }
     else {
-        char buff[33];
-        snprintf(buff, 32, "Cannot open port %s", port);
-        buff[32] = '\0';
+        char buff[96];
+        snprintf(buff, sizeof(buff), "Cannot open port %s: %s", port,
+                 rmSerialFd::getErrorString(mySerial.getError()));
         echo(buff, 1);
     }
 }
@@ -221,21 +550,29 @@ void rmClient::connectSerial(const char* port, uint32_t baud, bool crypt) {
  * 
  * @param portInfo The serial port information for the device
  * @param baud Baudrate
- * @param crypt Enable encryption
+ * @param crypt Encrypt the connection with the key opened by rmOpenKey()
  */
 void rmClient::connectSerial(rmSerialPortInfo portInfo, uint32_t baud,
                              bool crypt)
 {
     disconnect();
+    if(crypt && rmGetPrivateKey() == nullptr) {
+        echo("No key is open for the encryption", 1);
+        return;
+    }
+    useEncryption = crypt;
     mySerial.connect(portInfo, baud);
+    baudrate = baud;
+    linkBudget.reset();
+    linkBudget.setBaudrate(baud);
     
     if(mySerial.isConnected()) {
         startConnection();
     }
     else {
-        char buff[34];
-        snprintf(buff, 33, "Cannot open port %s", portInfo.port);
-        buff[33] = '\0';
+        char buff[96];
+        snprintf(buff, sizeof(buff), "Cannot open port %s: %s", portInfo.port,
+                 rmSerialFd::getErrorString(mySerial.getError()));
         echo(buff, 1);
     }
 }
@@ -244,20 +581,29 @@ void rmClient::connectSerial(rmSerialPortInfo portInfo, uint32_t baud,
  * @brief Disconnects the current connection
  */
 void rmClient::disconnect() {
+    m.lock();
+    bool wasReconnecting = reconnecting;
+    reconnecting = false;
+    pendingWrites.clear();
+    m.unlock();
+    if(wasReconnecting)
+        rmHotplug::removeListener(&reconnector);
+    
     if(timer != nullptr) {
         timer->removeClient(this);
         onDisconnected();
     }
     else {
-        m.lock();
+        threadMutex.lock();
         auto it = std::find(clients.begin(), clients.end(), this);
         if(it != clients.end())
             clients.erase(it);
         if(clients.size() == 0 && thread.joinable()) {
-            m.unlock();
+            threadMutex.unlock();
             thread.join();
+            return;
         }
-        m.unlock();
+        threadMutex.unlock();
     }
 }
 
@@ -265,6 +611,13 @@ void rmClient::disconnect() {
  * @brief Function triggers on disconnected
  */
 void rmClient::onDisconnected() {
+    syncMutex.lock();
+    for(size_t i=0; i<256; i++) {
+        if(syncs[i] != nullptr)
+            syncs[i]->clear();
+        syncListRequested[i] = 0;
+    }
+    syncMutex.unlock();
     m.lock();
     if(myEcho != nullptr) {
         myEcho->setEnabled(false);
@@ -272,13 +625,149 @@ void rmClient::onDisconnected() {
     for(size_t i=0; i<widgetCount; i++) {
         widgets[i]->setEnabled(false);
     }
-    for(uint8_t i=0; i<10; i++) {
-        syncs[i] = rmSync();
-    }
+    deviceInfo = rmDeviceInfo();
+    deviceCalls.clear();
+    cryptChannel.stop();
     mySerial.disconnect();
     m.unlock();
 }
 
+/**
+ * @brief Reconnects the client device when the port is lost
+ * 
+ * Once enabled, a client whose port closes without disconnect() being called
+ * keeps its sync tables and looks for the port with the same hardware ID,
+ * which may come back under another address. The attempts start after
+ * RM_RECONNECT_MIN_DELAY and back off up to RM_RECONNECT_MAX_DELAY, or are
+ * made at once when rmHotplug reports the device. The messages sent in the
+ * meantime are kept and sent after the handshake along with the sync rates
+ * last commanded.
+ * 
+ * @param en True for enable and false for otherwise
+ */
+void rmClient::setAutoReconnect(bool en) {
+    m.lock();
+    autoReconnect = en;
+    m.unlock();
+}
+
+/**
+ * @brief Checks if the client is waiting for its device to come back
+ * 
+ * @return True while reconnecting
+ */
+bool rmClient::isReconnecting() {
+    m.lock();
+    bool b = reconnecting;
+    m.unlock();
+    return b;
+}
+
+/**
+ * @brief Tries to get back the connection lost
+ * 
+ * Called in place of onDisconnected() by the thread or the timer that
+ * processes the client when it finds the port closed.
+ * 
+ * @return True while the client reconnects, false if auto reconnection is
+ *         disabled and the client should be dropped
+ */
+bool rmClient::reconnect() {
+    // rmHotplug calls the reconnector with its own lock held, so it is only
+    // called here with the client unlocked
+    m.lock();
+    if(!autoReconnect) {
+        bool wasReconnecting = reconnecting;
+        reconnecting = false;
+        pendingWrites.clear();
+        m.unlock();
+        if(wasReconnecting)
+            rmHotplug::removeListener(&reconnector);
+        return false;
+    }
+    
+    int64_t now = getTime();
+    if(!reconnecting) {
+        reconnecting = true;
+        identity = mySerial.getInfo();
+        reconnectDelay = RM_RECONNECT_MIN_DELAY;
+        reconnectTime = now + reconnectDelay;
+        int err = mySerial.getError();
+        mySerial.disconnect();
+        m.unlock();
+        if(err == RM_SERIAL_OK || err == RM_SERIAL_DISCONNECTED) {
+            echo("Port disconnected, reconnecting", 1);
+        }
+        else {
+            char buff[96];
+            snprintf(buff, sizeof(buff), "Port disconnected (%s), reconnecting",
+                     rmSerialFd::getErrorString(err));
+            echo(buff, 1);
+        }
+        rmHotplug::addListener(&reconnector);
+        return true;
+    }
+    if(now < reconnectTime) {
+        m.unlock();
+        return true;
+    }
+    rmSerialPortInfo info = identity;
+    m.unlock();
+    
+    // A port without a hardware ID can only be opened at the same address
+    bool found = (strcmp(info.hardware_id, "n/a") == 0);
+    if(!found) {
+        rmSerialPortList ports = rmHotplug::getPorts();
+        for(auto it=ports.begin(); it!=ports.end(); ++it) {
+            if(strcmp(it->hardware_id, info.hardware_id) == 0) {
+                info = *it;
+                found = true;
+                break;
+            }
+        }
+    }
+    
+    m.lock();
+    if(found)
+        mySerial.connect(info, baudrate);
+    if(!mySerial.isConnected()) {
+        reconnectDelay *= 2;
+        if(reconnectDelay > RM_RECONNECT_MAX_DELAY)
+            reconnectDelay = RM_RECONNECT_MAX_DELAY;
+        reconnectTime = getTime() + reconnectDelay;
+        m.unlock();
+        return true;
+    }
+    reconnecting = false;
+    rx_flag = PROCESS_DEFAULT;
+    rx_count = 0;
+    cryptChannel.stop();
+    deviceInfo = rmDeviceInfo();
+    deviceCalls.clear();
+    std::vector<std::string> writes;
+    writes.swap(pendingWrites);
+    m.unlock();
+    rmHotplug::removeListener(&reconnector);
+    linkBudget.onError(RM_LINK_RECONNECT);
+    
+    char buff[96];
+    snprintf(buff, sizeof(buff), "Port reconnected at %s", info.port);
+    echo(buff);
+    
+    // The sync tables are kept, so the values are decoded from the first
+    // update on. The device lists them again in the handshake if it has one.
+    // On an encrypted connection, the rest waits for the key exchange.
+    startHandshake();
+    for(int i=0; i<RM_LINK_TABLE_COUNT; i++) {
+        uint16_t hz = linkBudget.getStats(i).rate;
+        if(hz > 0)
+            sendCommand("rate %d %d", i, hz);
+    }
+    for(auto it=writes.begin(); it!=writes.end(); ++it)
+        sendMessage(it->c_str());
+    return true;
+}
+
 /**
  * @brief Checks if the client is connected
  * 
@@ -298,10 +787,57 @@ bool rmClient::isConnected() {
  */
 void rmClient::sendMessage(const char* msg) {
     m.lock();
-    mySerial.write(msg);
+    if(reconnecting || (useEncryption && !cryptChannel.isActive())) {
+        if(pendingWrites.size() < RM_PENDING_WRITE_COUNT)
+            pendingWrites.push_back(msg);
+    }
+    else if(useEncryption)
+        writeSealed(msg);
+    else
+        mySerial.write(msg);
     m.unlock();
 }
 
+
+static const char base64Digits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/*
+ * Seals the message in pieces of up to RM_CRYPT_LINE_SIZE characters, each
+ * sent as "$~" and the sealed bytes in base64. The device reads the port as
+ * text, so the bytes are not sent as they are.
+ */
+void rmClient::writeSealed(const char* msg) {
+    uint8_t buf[RM_CRYPT_LINE_SIZE + RM_CRYPT_OVERHEAD];
+    char line[4 + (sizeof(buf) + 2) / 3 * 4];
+    size_t len = strlen(msg);
+    do {
+        size_t n = (len < RM_CRYPT_LINE_SIZE) ? len : RM_CRYPT_LINE_SIZE;
+        memcpy(&buf[4], msg, n);
+        size_t sealed = cryptChannel.seal(buf, n);
+        
+        char* ptr = line;
+        *ptr++ = '$';
+        *ptr++ = '~';
+        for(size_t i=0; i<sealed; i+=3) {
+            uint32_t v = buf[i] << 16;
+            if(i + 1 < sealed)
+                v |= buf[i + 1] << 8;
+            if(i + 2 < sealed)
+                v |= buf[i + 2];
+            *ptr++ = base64Digits[(v >> 18) & 0x3F];
+            *ptr++ = base64Digits[(v >> 12) & 0x3F];
+            *ptr++ = (i + 1 < sealed) ? base64Digits[(v >> 6) & 0x3F] : '=';
+            *ptr++ = (i + 2 < sealed) ? base64Digits[v & 0x3F] : '=';
+        }
+        *ptr++ = '\n';
+        *ptr = '\0';
+        mySerial.write(line);
+        msg += n;
+        len -= n;
+    } while(len > 0);
+}
+
 /**
  * @brief Sends a command to the client device
  * 
@@ -329,6 +865,14 @@ char rmClient::read() {
     return c;
 }
 
+
+size_t rmClient::read(uint8_t* buf, size_t len) {
+    m.lock();
+    size_t n = mySerial.read(buf, len);
+    m.unlock();
+    return n;
+}
+
 /**
  * @brief Sends the value of attribute to the client
  * 
@@ -340,19 +884,19 @@ void rmClient::updateAttribute(rmAttribute* attr) {
       case RM_ATTRIBUTE_BOOL:
         sendCommand("set %s %d", name, attr->getValue().b);
         break;
-        
+      
       case RM_ATTRIBUTE_CHAR:
         sendCommand("set %s %c", name, attr->getValue().c);
         break;
-        
+      
       case RM_ATTRIBUTE_INT:
         sendCommand("set %s %d", name, attr->getValue().i);
         break;
-        
+      
       case RM_ATTRIBUTE_FLOAT:
         sendCommand("set %s %.3f", name, attr->getValue().f);
         break;
-        
+      
       case RM_ATTRIBUTE_STRING:
         sendCommand("set %s %s", name, attr->getValue().s);
         break;
@@ -364,22 +908,299 @@ void rmClient::updateAttribute(rmAttribute* attr) {
  * 
  * @param i Sync table ID
  * @param value The string representing the array of attribute values
+ * @param start Index of the first value for the tables split into several
+ *              lines
  */
-void rmClient::syncUpdate(uint8_t i, const char* value) {
-    if(i < 10) {
-        if(syncs[i].getCount() == 0) {
-            char msg[6] = "lsa i";
-            msg[4] = '0' + i;
-            rmRequest req = rmRequest(msg, respCallbackLsa, this, &syncs[i],
-                                      3000);
-            sendRequest(req);
-        }
-        else {
-            syncs[i].onSync(value);
-        }
+void rmClient::syncUpdate(uint8_t i, const char* value, size_t start) {
+    rmSync* sync = getSync(i);
+    if(sync != nullptr) {
+        sync->onSync(value, start);
+        recordSync(sync);
     }
 }
 
+/**
+ * @brief Updates the attributes changed since the last sync update
+ * 
+ * @param i Sync table ID
+ * @param value The string of index and value pairs
+ */
+void rmClient::syncDeltaUpdate(uint8_t i, const char* value) {
+    rmSync* sync = getSync(i);
+    if(sync != nullptr) {
+        sync->onSyncDelta(value);
+        recordSync(sync);
+    }
+}
+
+/**
+ * @brief Changes the rate the client device publishes a sync table at
+ * 
+ * @param i Sync table ID
+ * @param hz Number of updates per second. 0 stops the automatic updates.
+ */
+void rmClient::setSyncRate(uint8_t i, uint16_t hz) {
+    linkBudget.setTargetRate(i, hz);
+    sendCommand("rate %d %d", i, hz);
+}
+
+/**
+ * @brief Gets the manager of the link capacity
+ * 
+ * Can be used to display the traffic and error statistics or to let the
+ * station reduce the sync rates when the link saturates.
+ * 
+ * @return The link budget of the connection
+ */
+rmLinkBudget* rmClient::getLinkBudget() { return &linkBudget; }
+
+/**
+ * @brief Reads the line errors the driver counted on the port
+ * 
+ * The link budget reads them at every interval into its error statistics.
+ * 
+ * @param counts Output counters
+ * 
+ * @return False if the port is closed or the driver does not count the errors
+ */
+bool rmClient::getSerialErrorCounts(serial::ErrorCounts* counts) {
+    m.lock();
+    bool b = mySerial.getErrorCounts(counts);
+    m.unlock();
+    return b;
+}
+
+/**
+ * @brief Gets the file descriptor of the serial port to wait on
+ * 
+ * The thread that processes the clients waits on it for the bytes received
+ * instead of sleeping.
+ * 
+ * @return The descriptor. -1 if there is none to wait on.
+ */
+int rmClient::getSerialFd() {
+    m.lock();
+    int fd = mySerial.getFd();
+    m.unlock();
+    return fd;
+}
+
+
+/**
+ * @brief Updates the attribute list of a sync table
+ * 
+ * @param i Sync table ID
+ * @param list The response to the list request
+ * @param request True if the list was requested, false if the device sent it
+ *                on connection along with the rest of the list
+ */
+void rmClient::syncListUpdate(uint8_t i, const char* list, bool request) {
+    rmSync* sync = request ? syncs[i] : createSync(i);
+    if(sync == nullptr)
+        return;
+    syncMutex.lock();
+    sync->updateList(list, this, request);
+    syncMutex.unlock();
+}
+
+/**
+ * @brief Requests the attribute list of a sync table
+ * 
+ * @param i Sync table ID
+ * @param start Index of the first attribute to list
+ */
+void rmClient::requestSyncList(uint8_t i, size_t start) {
+    if(syncs[i] == nullptr)
+        return;
+    char msg[16];
+    if(start == 0)
+        snprintf(msg, sizeof(msg), "lsa %d", i);
+    else
+        snprintf(msg, sizeof(msg), "lsa %d %d", i, (int) start);
+    // The response finds the table again by its ID
+    rmRequest req = rmRequest(msg, respCallbackLsa, this, (void*) (uintptr_t) i,
+                              RM_SYNC_LIST_TIMEOUT);
+    syncListRequested[i] = getTime();
+    sendRequest(req);
+}
+
+
+/**
+ * @brief Gets what the client device reported on connection
+ * 
+ * @return The device information. The version is 0 if the device has not
+ *         answered the handshake.
+ */
+const rmDeviceInfo* rmClient::getDeviceInfo() const { return &deviceInfo; }
+
+/**
+ * @brief Sets what the client device reported on connection
+ * 
+ * @param info The device information
+ */
+void rmClient::setDeviceInfo(const rmDeviceInfo& info) {
+    deviceInfo = info;
+}
+
+/**
+ * @brief Sets the name of the client device
+ * 
+ * @param str The device name
+ */
+void rmClient::setDeviceName(const char* str) {
+    strncpy(name, str, sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+}
+
+/**
+ * @brief Adds a call to the list of calls the client device provides
+ * 
+ * @param key Name of the call
+ */
+void rmClient::appendDeviceCall(const char* key) {
+    m.lock();
+    std::string str = key;
+    auto it = std::lower_bound(deviceCalls.begin(), deviceCalls.end(), str);
+    if(it == deviceCalls.end() || *it != str)
+        deviceCalls.insert(it, str);
+    m.unlock();
+}
+
+/**
+ * @brief Checks if the client device provides a call
+ * 
+ * @param key Name of the call
+ * 
+ * @return True if the device listed the call on connection
+ */
+bool rmClient::hasDeviceCall(const char* key) const {
+    m.lock();
+    bool found = std::binary_search(deviceCalls.begin(), deviceCalls.end(),
+                                    std::string(key));
+    m.unlock();
+    return found;
+}
+
+/**
+ * @brief Gets the number of calls the client device provides
+ * 
+ * @return The call count. 0 if the device has not answered the handshake.
+ */
+size_t rmClient::getDeviceCallCount() const {
+    m.lock();
+    size_t n = deviceCalls.size();
+    m.unlock();
+    return n;
+}
+
+/**
+ * @brief Gets the name of a call the client device provides
+ * 
+ * The calls are sorted by name.
+ * 
+ * @param i Index of the call
+ * 
+ * @return The call name. Empty if the index is out of range.
+ */
+std::string rmClient::getDeviceCall(size_t i) const {
+    m.lock();
+    std::string str = (i < deviceCalls.size()) ? deviceCalls[i] : "";
+    m.unlock();
+    return str;
+}
+
+/**
+ * @brief Gets a sync table to read its values directly
+ * 
+ * The table is kept as long as the client, so the pointer stays valid, and so
+ * are the arrays read from it. Its list is emptied when the client
+ * disconnects.
+ * 
+ * @param i Sync table ID
+ * 
+ * @return The sync table. Null if the client device has not sent the table
+ *         yet.
+ */
+const rmSync* rmClient::getSyncTable(uint8_t i) const {
+    m.lock();
+    const rmSync* sync = syncs[i];
+    m.unlock();
+    if(sync == nullptr || sync->getCount() == 0)
+        return nullptr;
+    return sync;
+}
+
+
+/**
+ * @brief Gets the attributes of all the sync tables
+ * 
+ * The lists are read under the lock the client updates them with, so it can
+ * be called from another thread than the one processing the client.
+ * 
+ * @return The output attributes of the client device in the order of the
+ *         tables
+ */
+std::vector<rmAttribute*> rmClient::getSyncAttributes() const {
+    const rmSync* tables[256];
+    m.lock();
+    memcpy(tables, syncs, sizeof(tables));
+    m.unlock();
+    
+    std::vector<rmAttribute*> vec;
+    syncMutex.lock();
+    for(size_t i=0; i<256; i++) {
+        if(tables[i] == nullptr)
+            continue;
+        for(size_t j=0; j<tables[i]->getCount(); j++)
+            vec.push_back(tables[i]->getAttribute(j));
+    }
+    syncMutex.unlock();
+    return vec;
+}
+
+
+// The tables are only deleted along with the client, so the pointers handed
+// out by getSyncTable() are never left dangling
+rmSync* rmClient::createSync(uint8_t i) {
+    m.lock();
+    if(syncs[i] == nullptr)
+        syncs[i] = new rmSync(i);
+    rmSync* sync = syncs[i];
+    m.unlock();
+    return sync;
+}
+
+
+rmSync* rmClient::getSync(uint8_t i) {
+    rmSync* sync = createSync(i);
+    if(sync->getCount() == 0 || !sync->isComplete()) {
+        // The lists are on their way while the handshake is going on
+        bool pending;
+        if(deviceInfo.version == 0)
+            pending = (getTime() - handshakeStart < RM_HANDSHAKE_TIMEOUT);
+        else
+            pending = !deviceInfo.ready;
+        // Asked once, and again only if the answer has not come in time
+        if(!pending &&
+           getTime() - syncListRequested[i] >= RM_SYNC_LIST_TIMEOUT)
+            requestSyncList(i, sync->getCount());
+        if(sync->getCount() == 0)
+            return nullptr;
+    }
+    return sync;
+}
+
+
+// Recorded under the lock the recorder is set with, so it is not destroyed in
+// the middle of a record
+void rmClient::recordSync(const rmSync* sync) {
+    sinkMutex.lock();
+    if(sessionRecorder != nullptr)
+        sessionRecorder->record(sync);
+    sinkMutex.unlock();
+}
+
+
 /**
  * @brief Sends a request to the station
  * 
@@ -410,6 +1231,129 @@ void rmClient::setEcho(rmEcho* printer) {
     m.unlock();
 }
 
+/**
+ * @brief Sets the store to record the echoed messages in
+ * 
+ * The messages are recorded with the time they arrived and can be searched
+ * later through the store.
+ * 
+ * @param store The store opened for writing. Null to stop recording.
+ */
+void rmClient::setEchoStore(rmEchoStore* store) {
+    m.lock();
+    echoStore = store;
+    m.unlock();
+}
+
+/**
+ * @brief Sets the recorder of the sync table updates
+ * 
+ * Every update of a sync table is written into the session log with the
+ * time it arrived. Remove the recorder here before destroying it. A record
+ * being written is waited for, so the recorder is not used once this returns.
+ * 
+ * @param rec The recorder with its log open. Null to stop recording.
+ */
+void rmClient::setSessionRecorder(rmSessionRecorder* rec) {
+    sinkMutex.lock();
+    sessionRecorder = rec;
+    sinkMutex.unlock();
+}
+
+/**
+ * @brief Sets the listener that sees the changes of every attribute
+ * 
+ * The listener is also given to the attributes created later. It is called
+ * once for each attribute as it is listed and then on every value received,
+ * even one the same as before, from the thread that processes the
+ * connection. A call going on is waited for, so the listener removed is not
+ * called once this returns.
+ * 
+ * @param l The listener. Null to remove.
+ */
+void rmClient::setAttributeListener(rmAttributeListener* l) {
+    attrMutex.lock();
+    sinkMutex.lock();
+    attributeListener = l;
+    if(l != nullptr) {
+        for(size_t i=0; i<attrCount; i++)
+            l->onAttributeUpdate(attributes[i]);
+    }
+    sinkMutex.unlock();
+    attrMutex.unlock();
+}
+
+/**
+ * @brief Sets the shared memory to mirror the attribute values in
+ * 
+ * Every attribute is written into the memory now and again on each change, so
+ * other processes can read the latest values without asking the client.
+ * Remove the memory here before closing it. A write going on is waited for, so
+ * the memory is not written once this returns.
+ * 
+ * @param shm The memory created for writing. Null to stop mirroring.
+ */
+void rmClient::setSharedMemory(rmSharedMemory* shm) {
+    attrMutex.lock();
+    sinkMutex.lock();
+    sharedMemory = shm;
+    if(shm != nullptr) {
+        for(size_t i=0; i<attrCount; i++)
+            shm->update(attributes[i]);
+    }
+    sinkMutex.unlock();
+    attrMutex.unlock();
+}
+
+
+/**
+ * @brief Constructs the listener of a client
+ * 
+ * @param cli The client
+ */
+rmClientListener::rmClientListener(rmClient* cli) { client = cli; }
+
+/**
+ * @brief Passes the change on
+ * 
+ * @param attr The attribute changed
+ */
+void rmClientListener::onAttributeUpdate(rmAttribute* attr) {
+    // Passed on under the lock the memory and the listener are set with, so
+    // neither is removed in the middle of a call
+    client->sinkMutex.lock();
+    if(client->sharedMemory != nullptr)
+        client->sharedMemory->update(attr);
+    if(client->attributeListener != nullptr)
+        client->attributeListener->onAttributeUpdate(attr);
+    client->sinkMutex.unlock();
+}
+
+
+/**
+ * @brief Constructs the reconnector of a client
+ * 
+ * @param cli The client
+ */
+rmClientReconnector::rmClientReconnector(rmClient* cli) { client = cli; }
+
+/**
+ * @brief Lets the client try at once if the port is its device
+ * 
+ * @param info The new port
+ */
+void rmClientReconnector::onPortAdded(const rmSerialPortInfo& info) {
+    client->m.lock();
+    const rmSerialPortInfo& id = client->identity;
+    if(client->reconnecting && (strcmp(info.hardware_id, id.hardware_id) == 0 ||
+                                strcmp(info.port, id.port) == 0))
+    {
+        client->reconnectDelay = RM_RECONNECT_MIN_DELAY;
+        client->reconnectTime = 0;
+    }
+    client->m.unlock();
+}
+
 
 /**
  * @brief Echos the messages
@@ -428,6 +1372,8 @@ void rmClient::echo(const char* msg, int status) {
         myEcho->echo(msg, status);
     else
         std::cout << msg << std::endl;
+    if(echoStore != nullptr)
+        echoStore->append(msg, status);
     m.unlock();
 }
 
@@ -444,6 +1390,6 @@ void rmClient::setTimer(rmTimerBase* t) { timer = t; }
 
 
 static void respCallbackLsa(rmResponse resp) {
-    rmSync* sync = (rmSync*) resp.userdata;
-    sync->updateList(resp.message, resp.client);
+    uint8_t i = (uint8_t) (uintptr_t) resp.userdata;
+    resp.client->syncListUpdate(i, resp.message);
 }
@@ -0,0 +1,150 @@
+/**
+ * @file compress.cpp
+ * @brief Decompresses the command-lines sent by the client device
+ * 
+ * The devices on slow links may send their lines through an LZ77 coder over
+ * the last 64, 128 or 256 characters sent. The characters below 128 come as
+ * they are and the bytes from 0x80 start a 2-byte reference back into the
+ * window. Each line starts with either a reset of the window to a primer
+ * both sides know or a CRC-8 of the window, so the lines lost to a dropped
+ * byte are found and skipped until the next reset.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_EXPORT
+#define RM_NO_WX
+
+
+#include "rm/compress.hpp"
+
+#include "rm/frame.hpp"
+
+#include <cstring>
+
+
+#define CODE_MATCH  0x80 // Up to 0xFB with the length less 3
+#define CODE_ESCAPE 0xFC // A character of 128 and above follows
+#define CODE_RESET  0xFD // The window starts again from the primer
+#define CODE_CHECK  0xFE // The CRC-8 of the window follows
+
+#define MIN_MATCH 3
+
+
+// What the window holds after a reset, the same as on the device
+static const char primer[] = "$sync $syncd $set $echo $resp 0.000,-0.0";
+
+
+/**
+ * @brief Starts again with a window size
+ * 
+ * @param window Window size of the device, 64, 128 or 256
+ * 
+ * @return False if the window size is not supported
+ */
+bool rmDecompressor::reset(uint16_t window) {
+    if(window != 64 && window != 128 && window != 256)
+        return false;
+    size = window;
+    restart();
+    return true;
+}
+
+void rmDecompressor::restart() {
+    memset(window, 0, sizeof(window));
+    position = 0;
+    code = 0;
+    broken = false;
+    for(size_t i=0; primer[i] != '\0'; i++)
+        insert((uint8_t) primer[i]);
+}
+
+void rmDecompressor::insert(uint8_t c) {
+    window[position & (size - 1)] = c;
+    position++;
+}
+
+/**
+ * @brief Checks if the decoder is between the codes
+ * 
+ * The start byte of a binary frame is only a frame when it comes here,
+ * since the second byte of a code may have any value.
+ * 
+ * @return True if no code is half received
+ */
+bool rmDecompressor::isIdle() const { return code == 0; }
+
+/**
+ * @brief Checks if the window is out of step with the device
+ * 
+ * @return True from a failed check until the next reset
+ */
+bool rmDecompressor::isBroken() const { return broken; }
+
+/**
+ * @brief Decodes a byte
+ * 
+ * @param c The byte received
+ * @param out Buffer of RM_COMPRESS_MAX_MATCH characters for the output
+ * 
+ * @return Number of characters decoded. -1 if the window is found out of
+ *         step, after which the output stops until the next reset.
+ */
+int rmDecompressor::push(uint8_t c, char* out) {
+    if(size == 0)
+        return -1;
+    
+    if(code == 0) {
+        if(c == CODE_RESET) {
+            restart();
+            return 0;
+        }
+        if(c > CODE_CHECK) {
+            bool b = broken;
+            broken = true;
+            return b ? 0 : -1;
+        }
+        if(c >= CODE_MATCH) {
+            code = c;
+            return 0;
+        }
+        if(broken)
+            return 0;
+        insert(c);
+        out[0] = (char) c;
+        return 1;
+    }
+    
+    uint8_t first = code;
+    code = 0;
+    if(broken)
+        return 0;
+    if(first == CODE_CHECK) {
+        if(c == rmFrameChecksum(0, window, size))
+            return 0;
+        broken = true;
+        return -1;
+    }
+    if(first == CODE_ESCAPE) {
+        insert(c);
+        out[0] = (char) c;
+        return 1;
+    }
+    
+    // A reference reaching before the window only comes from lost bytes
+    if(c == 0 || c >= size) {
+        broken = true;
+        return -1;
+    }
+    int n = first - CODE_MATCH + MIN_MATCH;
+    uint8_t from = position - c;
+    for(int i=0; i<n; i++) {
+        uint8_t b = window[(uint8_t) (from + i) & (size - 1)];
+        insert(b);
+        out[i] = (char) b;
+    }
+    return n;
+}
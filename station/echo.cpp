@@ -46,20 +46,14 @@ void rmEcho::setEnabled(bool en) {}
 
 static void echo(rmClient *client, int status, int argc, char *argv[]) {
     char str[128];
-    int i=0, j=0, k=0;
-    while(i < argc) {
-        char c;
-        while((c = argv[i][j++]) != '\0')
-            str[k++] = c;
-        if(i < argc - 1)
+    int k = 0;
+    for(int i=0; i<argc && k<127; i++) {
+        if(i > 0)
             str[k++] = ' ';
-        i++;
-        j = 0;
-        if(k == 127)
-            break;
+        for(int j=0; argv[i][j] != '\0' && k < 127; j++)
+            str[k++] = argv[i][j];
     }
     str[k] = '\0';
-    str[127] = '\0';
     client->echo(str, status);
 }
 
@@ -0,0 +1,169 @@
+/**
+ * @file echobuffer.cpp
+ * @brief Ring buffer of the messages echoed by the client device
+ * 
+ * Keeps the latest lines of the console output with their status codes in
+ * slots of fixed size.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_EXPORT
+#define RM_NO_WX
+
+
+#include "rm/echobuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+
+#define RM_ECHO_FILTER_CHUNK 256 // Lines copied out at a time by filter()
+
+
+/**
+ * @brief Constructs a buffer
+ * 
+ * @param n Number of lines kept
+ */
+rmEchoBuffer::rmEchoBuffer(size_t n) {
+    capacity = (n > 0) ? n : 1;
+    lines = new rmEchoLine[capacity];
+}
+
+/**
+ * @brief Destructor
+ */
+rmEchoBuffer::~rmEchoBuffer() { delete[] lines; }
+
+/**
+ * @brief Appends a line
+ * 
+ * The oldest line is overwritten once the buffer is full. Messages longer than
+ * the slot are cut.
+ * 
+ * @param msg The message
+ * @param status The status code. Codes other than 0 and 2 are errors.
+ */
+void rmEchoBuffer::append(const char* msg, int status) {
+    std::lock_guard<std::mutex> lock(m);
+    rmEchoLine* line = &lines[total % capacity];
+    strncpy(line->text, msg, RM_ECHO_LINE_SIZE - 1);
+    line->text[RM_ECHO_LINE_SIZE - 1] = '\0';
+    line->status = (status == 0 || status == 2) ? status : 1;
+    total++;
+}
+
+/**
+ * @brief Removes all the lines
+ * 
+ * The sequence numbers keep counting.
+ */
+void rmEchoBuffer::clear() {
+    std::lock_guard<std::mutex> lock(m);
+    first = total;
+}
+
+// Oldest line kept, to be called with the lock held
+uint64_t rmEchoBuffer::oldest() const {
+    if(total - first > capacity)
+        return total - capacity;
+    return first;
+}
+
+/**
+ * @brief Gets the number of lines kept at most
+ * 
+ * @return The capacity
+ */
+size_t rmEchoBuffer::getCapacity() const { return capacity; }
+
+/**
+ * @brief Gets the number of lines appended ever
+ * 
+ * @return The sequence number of the next line
+ */
+uint64_t rmEchoBuffer::getTotal() const {
+    std::lock_guard<std::mutex> lock(m);
+    return total;
+}
+
+/**
+ * @brief Gets the oldest line still kept
+ * 
+ * @return Sequence number of the oldest line
+ */
+uint64_t rmEchoBuffer::getOldest() const {
+    std::lock_guard<std::mutex> lock(m);
+    return oldest();
+}
+
+/**
+ * @brief Copies a line
+ * 
+ * @param seq Sequence number of the line
+ * @param line Output line
+ * 
+ * @return False if the line has been overwritten or does not exist yet
+ */
+bool rmEchoBuffer::get(uint64_t seq, rmEchoLine* line) const {
+    std::lock_guard<std::mutex> lock(m);
+    if(seq >= total || seq < oldest())
+        return false;
+    *line = lines[seq % capacity];
+    return true;
+}
+
+/**
+ * @brief Finds the lines matching a status mask and a substring
+ * 
+ * Scans only the lines from a sequence number on, so that a filtered view is
+ * kept up to date by passing the returned value on the next call.
+ * 
+ * @param from Sequence number to start at
+ * @param mask Combination of RM_ECHO_NORMAL, RM_ECHO_ERROR and RM_ECHO_WARNING
+ * @param str The substring. Null or empty to match every line.
+ * @param out The sequence numbers matched are appended here
+ * 
+ * @return Sequence number to start at the next time
+ */
+uint64_t rmEchoBuffer::filter(uint64_t from, uint8_t mask, const char* str,
+                              std::vector<uint64_t>* out) const
+{
+    bool any = (str == nullptr || str[0] == '\0');
+    uint64_t end;
+    {
+        std::lock_guard<std::mutex> lock(m);
+        end = total;
+    }
+    
+    // The lines are copied out a chunk at a time and searched without the
+    // lock, so an append waits for a copy at most
+    std::vector<rmEchoLine> chunk(RM_ECHO_FILTER_CHUNK);
+    uint64_t seq = from;
+    while(true) {
+        size_t n;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            if(seq < oldest())
+                seq = oldest();
+            if(seq >= end)
+                break;
+            n = (size_t) std::min<uint64_t>(end - seq, chunk.size());
+            for(size_t i=0; i<n; i++)
+                chunk[i] = lines[(seq + i) % capacity];
+        }
+        for(size_t i=0; i<n; i++) {
+            if((mask & (1 << chunk[i].status)) == 0)
+                continue;
+            if(any || strstr(chunk[i].text, str) != nullptr)
+                out->push_back(seq + i);
+        }
+        seq += n;
+    }
+    return end;
+}
@@ -0,0 +1,202 @@
+/**
+ * @file echolog.cpp
+ * @brief A log widget that shows the console output messages
+ * 
+ * Unlike the echo box, the messages are kept in a large ring buffer and only
+ * the rows in view are painted. The messages are taken in at most once per
+ * frame.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_WX_EXPORT
+
+
+#include "rm/echolog.hpp"
+
+#include <vector>
+
+#include <wx/dcclient.h>
+#include <wx/settings.h>
+
+
+// Interval to take in the new lines in milliseconds
+#define RM_ECHOLOG_INTERVAL 33
+
+
+long rmEchoLog::getWxID() {
+    if(wx_id == 0)
+        wx_id = wxNewId();
+    return wx_id;
+}
+
+/**
+ * @brief Constructs a echo log widget
+ * 
+ * @param parent The parent window
+ * @param cli The client
+ * @param n Number of lines kept
+ */
+rmEchoLog::rmEchoLog(wxWindow* parent, rmClient* cli, size_t n)
+          :wxVScrolledWindow(parent, wxID_ANY), buffer(n)
+{
+    rowHeight = GetCharHeight() + 2;
+    refreshTimer.SetOwner(this, getWxID());
+    
+    Connect(
+        wxEVT_PAINT,
+        wxPaintEventHandler(rmEchoLog::onPaint),
+        NULL,
+        this
+    );
+    Connect(
+        wx_id,
+        wxEVT_TIMER,
+        wxTimerEventHandler(rmEchoLog::onTimer),
+        NULL,
+        this
+    );
+    SetRowCount(0);
+    cli->setEcho(this);
+    refreshTimer.Start(RM_ECHOLOG_INTERVAL);
+}
+
+/**
+ * @brief Echos the messages
+ * 
+ * Only stores the message. The rows are updated on the next frame.
+ * 
+ * @param msg The message
+ * @param status The status code. Status code other than 0 may print red
+ *         messages.
+ */
+void rmEchoLog::echo(const char* msg, int status) {
+    buffer.append(msg, status);
+}
+
+/**
+ * @brief Enables or disables the user input
+ * 
+ * The log stays scrollable while the client is disconnected.
+ * 
+ * @param en True for enable and false for otherwise
+ */
+void rmEchoLog::setEnabled(bool en) {}
+
+/**
+ * @brief Shows only the lines matching a status mask and a substring
+ * 
+ * @param mask Combination of RM_ECHO_NORMAL, RM_ECHO_ERROR and RM_ECHO_WARNING
+ * @param str The substring. Null or empty to show every line.
+ */
+void rmEchoLog::setFilter(uint8_t mask, const char* str) {
+    statusMask = mask;
+    pattern = (str != nullptr) ? str : "";
+    rows.clear();
+    scanned = 0;
+    SetRowCount(0);
+    Refresh();
+    update();
+}
+
+/**
+ * @brief Removes all the lines
+ */
+void rmEchoLog::clear() {
+    buffer.clear();
+    rows.clear();
+    scanned = buffer.getTotal();
+    SetRowCount(0);
+    Refresh();
+}
+
+/**
+ * @brief Gets the lines stored
+ * 
+ * @return The ring buffer of the lines
+ */
+const rmEchoBuffer* rmEchoLog::getBuffer() const { return &buffer; }
+
+/**
+ * @brief Gets the height of a row
+ * 
+ * @param row Index of the row
+ * 
+ * @return The row height in pixels
+ */
+wxCoord rmEchoLog::OnGetRowHeight(size_t row) const { return rowHeight; }
+
+
+/*
+ * Appends the rows of the new lines matching the filter and removes the rows
+ * of the lines overwritten in the buffer. The view keeps following the last
+ * line if it was at the bottom.
+ */
+void rmEchoLog::update() {
+    uint64_t total = buffer.getTotal();
+    uint64_t oldest = buffer.getOldest();
+    if(total == scanned && (rows.empty() || rows.front() >= oldest))
+        return;
+    
+    size_t count = rows.size();
+    size_t top = GetVisibleRowsBegin();
+    bool follow = (GetVisibleRowsEnd() >= count);
+    
+    std::vector<uint64_t> found;
+    scanned = buffer.filter(scanned, statusMask, pattern.c_str(), &found);
+    rows.insert(rows.end(), found.begin(), found.end());
+    oldest = buffer.getOldest();
+    size_t dropped = 0;
+    while(!rows.empty() && rows.front() < oldest) {
+        rows.pop_front();
+        dropped++;
+    }
+    if(found.empty() && dropped == 0)
+        return;
+    
+    SetRowCount(rows.size());
+    if(follow && !rows.empty())
+        ScrollToRow(rows.size() - 1);
+    else if(dropped > 0)
+        ScrollToRow((top > dropped) ? top - dropped : 0);
+    Refresh();
+}
+
+/**
+ * @brief Paints the rows in view
+ * 
+ * @param evt The event object
+ */
+void rmEchoLog::onPaint(wxPaintEvent& evt) {
+    wxPaintDC dc(this);
+    dc.SetFont(GetFont());
+    wxColour colors[3] = {
+        wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOWTEXT),
+        wxColour(230, 0, 0),
+        wxColour(230, 173, 0)
+    };
+    
+    size_t begin = GetVisibleRowsBegin();
+    size_t end = GetVisibleRowsEnd();
+    if(end > rows.size())
+        end = rows.size();
+    
+    rmEchoLine line;
+    for(size_t i=begin; i<end; i++) {
+        if(!buffer.get(rows[i], &line))
+            continue;
+        int y = (int) (i - begin) * rowHeight;
+        dc.SetTextForeground(colors[line.status]);
+        dc.DrawText(wxString(line.text), 4, y + 1);
+    }
+}
+
+/**
+ * @brief Takes in the lines echoed since the last frame
+ * 
+ * @param evt Timer event object
+ */
+void rmEchoLog::onTimer(wxTimerEvent& evt) { update(); }
@@ -0,0 +1,810 @@
+/**
+ * @file echostore.cpp
+ * @brief Persistent and searchable record of the echoed messages
+ * 
+ * The messages are appended to segment files in a directory with the time
+ * they arrived. Each segment is indexed by the trigrams of its lines.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_EXPORT
+#define RM_NO_WX
+
+
+#include "rm/echostore.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#else
+#include <dirent.h>
+#endif
+
+
+#define RM_ECHO_INDEX_VERSION 2
+
+// Number of lines in a block, the unit the lists of the trigrams refer to
+#define RM_ECHO_INDEX_BLOCK 8
+
+// Lists longer than this many times the candidates left are not read
+#define RM_ECHO_LIST_RATIO 16
+
+
+/*
+ * Layout of an index file. The header is followed by the offsets of the
+ * blocks of lines in the segment, the trigrams sorted and then their lists of
+ * block numbers. Each list is stored as the differences between the block
+ * numbers in variable-length integers.
+ */
+struct rmEchoIndexHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t lineCount;
+    uint32_t keyCount;
+    int64_t firstTime;
+    int64_t lastTime;
+};
+
+struct rmEchoIndexKey {
+    uint32_t key;
+    uint32_t start;
+    uint32_t count;
+};
+
+
+static bool readLine(FILE* fp, std::string* line) {
+    line->clear();
+    char buf[256];
+    while(fgets(buf, sizeof(buf), fp) != nullptr) {
+        line->append(buf);
+        if(line->back() == '\n') {
+            line->pop_back();
+            return true;
+        }
+    }
+    return !line->empty();
+}
+
+
+static bool parseLine(const std::string& line, rmEchoRecord* rec) {
+    const char* str = line.c_str();
+    char* end;
+    rec->time = strtoll(str, &end, 10);
+    if(end == str || end[0] != ' ' || end[1] < '0' || end[1] > '2')
+        return false;
+    rec->status = end[1] - '0';
+    rec->text = (end[2] == ' ') ? &end[3] : "";
+    return true;
+}
+
+
+static bool matchRecord(const rmEchoRecord& rec, const char* str,
+                        uint8_t mask, int64_t from, int64_t to)
+{
+    if((mask & (1 << rec.status)) == 0)
+        return false;
+    if(rec.time < from || rec.time > to)
+        return false;
+    return str[0] == '\0' || strstr(rec.text.c_str(), str) != nullptr;
+}
+
+
+static uint32_t trigram(const char* str) {
+    return ((uint32_t) (uint8_t) str[0] << 16) |
+           ((uint32_t) (uint8_t) str[1] << 8) |
+           (uint32_t) (uint8_t) str[2];
+}
+
+
+static void trigrams(const char* str, std::vector<uint32_t>* keys) {
+    size_t len = strlen(str);
+    for(size_t i=0; i+2<len; i++)
+        keys->push_back(trigram(&str[i]));
+    std::sort(keys->begin(), keys->end());
+    keys->erase(std::unique(keys->begin(), keys->end()), keys->end());
+}
+
+
+static void intersect(std::vector<uint32_t>* a, const std::vector<uint32_t>& b)
+{
+    std::vector<uint32_t> c;
+    std::set_intersection(a->begin(), a->end(), b.begin(), b.end(),
+                          std::back_inserter(c));
+    a->swap(c);
+}
+
+
+static void writeVarint(uint32_t x, std::vector<uint8_t>* out) {
+    while(x >= 0x80) {
+        out->push_back((uint8_t) (x | 0x80));
+        x >>= 7;
+    }
+    out->push_back((uint8_t) x);
+}
+
+
+static uint32_t blockCount(uint32_t lines) {
+    return (lines + RM_ECHO_INDEX_BLOCK - 1) / RM_ECHO_INDEX_BLOCK;
+}
+
+
+static uint32_t blockLines(uint32_t lines, uint32_t block) {
+    uint32_t n = lines - block * RM_ECHO_INDEX_BLOCK;
+    return (n < RM_ECHO_INDEX_BLOCK) ? n : RM_ECHO_INDEX_BLOCK;
+}
+
+
+// Decodes a list of block numbers stored as varint differences
+static bool readList(const uint8_t* data, size_t size, uint32_t count,
+                     std::vector<uint32_t>* list)
+{
+    list->resize(count);
+    const uint8_t* end = data + size;
+    uint32_t line = 0;
+    for(uint32_t i=0; i<count; i++) {
+        uint32_t x = 0;
+        for(int shift=0; ; shift+=7) {
+            if(data == end || shift > 28)
+                return false;
+            uint8_t c = *data++;
+            x |= (uint32_t) (c & 0x7F) << shift;
+            if((c & 0x80) == 0)
+                break;
+        }
+        line += x;
+        (*list)[i] = line;
+    }
+    return true;
+}
+
+
+// Reads the blocks of lines at the offsets and keeps the lines matching
+static size_t readBlocks(FILE* log, const std::vector<uint32_t>& offsets,
+                         const std::vector<uint32_t>& counts,
+                         const char* str, uint8_t mask, int64_t from,
+                         int64_t to, size_t limit,
+                         std::vector<rmEchoRecord>* out)
+{
+    std::string line;
+    rmEchoRecord rec;
+    size_t found = 0;
+    long pos = -1;
+    for(size_t i=0; i<offsets.size() && found<limit; i++) {
+        if((long) offsets[i] != pos &&
+           fseek(log, offsets[i], SEEK_SET) != 0)
+            break;
+        pos = offsets[i];
+        for(uint32_t j=0; j<counts[i] && found<limit; j++) {
+            if(!readLine(log, &line))
+                return found;
+            pos += (long) line.size() + 1;
+            if(parseLine(line, &rec) && matchRecord(rec, str, mask, from, to))
+            {
+                out->push_back(rec);
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+
+// Reads the lines from the start up to a size and keeps the ones matching
+static size_t scanLines(FILE* log, long size, const char* str, uint8_t mask,
+                        int64_t from, int64_t to, size_t limit,
+                        std::vector<rmEchoRecord>* out)
+{
+    std::string line;
+    rmEchoRecord rec;
+    size_t found = 0;
+    long pos = 0;
+    while(found < limit && pos < size && readLine(log, &line)) {
+        pos += (long) line.size() + 1;
+        if(parseLine(line, &rec) && matchRecord(rec, str, mask, from, to)) {
+            out->push_back(rec);
+            found++;
+        }
+    }
+    return found;
+}
+
+
+static bool isDirectory(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && (st.st_mode & S_IFDIR) != 0;
+}
+
+
+// Checks if an index file is there in the layout of this version
+static bool isIndex(const std::string& path) {
+    FILE* fp = fopen(path.c_str(), "rb");
+    if(fp == nullptr)
+        return false;
+    rmEchoIndexHeader header;
+    bool ok = fread(&header, sizeof(header), 1, fp) == 1 &&
+              memcmp(header.magic, "RMIX", 4) == 0 &&
+              header.version == RM_ECHO_INDEX_VERSION;
+    fclose(fp);
+    return ok;
+}
+
+
+// Creates the directory with its parents
+static void makeDirectory(const std::string& path) {
+    for(size_t i=1; i<=path.size(); i++) {
+        if(i < path.size() && path[i] != '/' && path[i] != '\\')
+            continue;
+        std::string dir = path.substr(0, i);
+        if(isDirectory(dir))
+            continue;
+        #ifdef _WIN32
+        _mkdir(dir.c_str());
+        #else
+        mkdir(dir.c_str(), 0755);
+        #endif
+    }
+}
+
+
+// Lists the names of the files in a directory
+static void listDirectory(const std::string& path,
+                          std::vector<std::string>* names)
+{
+    #ifdef _WIN32
+    struct _finddata_t data;
+    intptr_t h = _findfirst((path + "/*").c_str(), &data);
+    if(h == -1)
+        return;
+    do {
+        names->push_back(data.name);
+    } while(_findnext(h, &data) == 0);
+    _findclose(h);
+    #else
+    DIR* dir = opendir(path.c_str());
+    if(dir == nullptr)
+        return;
+    struct dirent* entry;
+    while((entry = readdir(dir)) != nullptr)
+        names->push_back(entry->d_name);
+    closedir(dir);
+    #endif
+}
+
+
+static int64_t getTimeNow() {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+}
+
+
+
+
+/**
+ * @brief Destructor
+ * 
+ * Closes the store.
+ */
+rmEchoStore::~rmEchoStore() { close(); }
+
+
+std::string rmEchoStore::segmentPath(uint32_t seg, const char* ext) const {
+    char name[32];
+    snprintf(name, sizeof(name), "/seg-%06u%s", seg, ext);
+    return directory + name;
+}
+
+
+void rmEchoStore::listSegments() {
+    segments.clear();
+    std::vector<std::string> names;
+    listDirectory(directory, &names);
+    for(const std::string& name : names) {
+        if(name.size() != 14 || name.compare(0, 4, "seg-") != 0 ||
+           name.compare(10, 4, ".log") != 0)
+            continue;
+        char* end;
+        unsigned long seg = strtoul(&name[4], &end, 10);
+        if(end == &name[10])
+            segments.push_back((uint32_t) seg);
+    }
+    std::sort(segments.begin(), segments.end());
+}
+
+
+bool rmEchoStore::startSegment() {
+    file = fopen(segmentPath(current, ".log").c_str(), "wb");
+    if(file == nullptr)
+        return false;
+    fileSize = 0;
+    offsets.clear();
+    postings.clear();
+    segments.push_back(current);
+    return true;
+}
+
+
+void rmEchoStore::finishSegment() {
+    if(file == nullptr)
+        return;
+    fclose(file);
+    file = nullptr;
+    if(offsets.empty()) {
+        std::remove(segmentPath(current, ".log").c_str());
+        segments.pop_back();
+    }
+    else {
+        writeIndex(current);
+    }
+    offsets.clear();
+    postings.clear();
+}
+
+
+void rmEchoStore::indexLine(const char* text) {
+    uint32_t block = (uint32_t) (offsets.size() - 1) / RM_ECHO_INDEX_BLOCK;
+    size_t len = strlen(text);
+    for(size_t i=0; i+2<len; i++) {
+        rmEchoPostings& list = postings[trigram(&text[i])];
+        if(list.count > 0 && list.last == block)
+            continue;
+        writeVarint(block - list.last, &list.deltas);
+        list.last = block;
+        list.count++;
+    }
+}
+
+
+bool rmEchoStore::writeIndex(uint32_t seg) const {
+    std::vector<uint32_t> keys;
+    keys.reserve(postings.size());
+    for(auto it=postings.begin(); it!=postings.end(); it++)
+        keys.push_back(it->first);
+    std::sort(keys.begin(), keys.end());
+    
+    std::vector<rmEchoIndexKey> table;
+    std::vector<uint8_t> blob;
+    table.reserve(keys.size());
+    for(uint32_t key : keys) {
+        const rmEchoPostings& list = postings.at(key);
+        rmEchoIndexKey k = { key, (uint32_t) blob.size(), list.count };
+        table.push_back(k);
+        blob.insert(blob.end(), list.deltas.begin(), list.deltas.end());
+    }
+    
+    rmEchoIndexHeader header;
+    memcpy(header.magic, "RMIX", 4);
+    header.version = RM_ECHO_INDEX_VERSION;
+    header.lineCount = (uint32_t) offsets.size();
+    header.keyCount = (uint32_t) table.size();
+    header.firstTime = firstTime;
+    header.lastTime = lastTime;
+    
+    // Written under another name first so a reader never sees half an index
+    std::string path = segmentPath(seg, ".idx");
+    std::string tmp = path + ".tmp";
+    FILE* fp = fopen(tmp.c_str(), "wb");
+    if(fp == nullptr)
+        return false;
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    for(size_t i=0; i<offsets.size(); i+=RM_ECHO_INDEX_BLOCK)
+        ok &= fwrite(&offsets[i], 4, 1, fp) == 1;
+    if(!table.empty())
+        ok &= fwrite(table.data(), sizeof(rmEchoIndexKey), table.size(), fp)
+              == table.size();
+    if(!blob.empty())
+        ok &= fwrite(blob.data(), 1, blob.size(), fp) == blob.size();
+    ok &= fclose(fp) == 0;
+    if(!ok) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    std::remove(path.c_str());
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+
+bool rmEchoStore::buildIndex(uint32_t seg) {
+    FILE* fp = fopen(segmentPath(seg, ".log").c_str(), "rb");
+    if(fp == nullptr)
+        return false;
+    offsets.clear();
+    postings.clear();
+    std::string line;
+    rmEchoRecord rec;
+    uint32_t offset = 0;
+    while(readLine(fp, &line)) {
+        uint32_t next = (uint32_t) ftell(fp);
+        if(parseLine(line, &rec)) {
+            if(offsets.empty())
+                firstTime = rec.time;
+            lastTime = rec.time;
+            offsets.push_back(offset);
+            indexLine(rec.text.c_str());
+        }
+        offset = next;
+    }
+    fclose(fp);
+    bool ok = writeIndex(seg);
+    offsets.clear();
+    postings.clear();
+    return ok;
+}
+
+
+/**
+ * @brief Opens a directory of segments
+ * 
+ * Opening for writing creates the directory if needed, indexes the segments
+ * left without an index or with one of an older layout and starts a new
+ * segment.
+ * 
+ * @param dir Path of the directory
+ * @param write True to append messages and false to search only
+ * 
+ * @return True on success
+ */
+bool rmEchoStore::open(const char* dir, bool write) {
+    close();
+    std::lock_guard<std::mutex> lock(m);
+    if(write)
+        makeDirectory(dir);
+    if(!isDirectory(dir))
+        return false;
+    
+    directory = dir;
+    writable = write;
+    listSegments();
+    if(write) {
+        for(uint32_t seg : segments) {
+            if(!isIndex(segmentPath(seg, ".idx")))
+                buildIndex(seg);
+        }
+        current = segments.empty() ? 1 : segments.back() + 1;
+        if(!startSegment())
+            return false;
+    }
+    opened = true;
+    return true;
+}
+
+/**
+ * @brief Indexes the segment being written and closes the store
+ */
+void rmEchoStore::close() {
+    std::lock_guard<std::mutex> lock(m);
+    if(!opened)
+        return;
+    if(writable)
+        finishSegment();
+    segments.clear();
+    opened = false;
+}
+
+/**
+ * @brief Checks if the store is open
+ * 
+ * @return True if open
+ */
+bool rmEchoStore::isOpen() const { return opened; }
+
+/**
+ * @brief Sets the size at which a new segment is started
+ * 
+ * @param bytes Size of a segment file
+ */
+void rmEchoStore::setSegmentSize(size_t bytes) {
+    // The offsets in a segment are 32-bit
+    if(bytes > 0x7FFFFFFF)
+        bytes = 0x7FFFFFFF;
+    segmentSize = bytes;
+}
+
+/**
+ * @brief Appends a message
+ * 
+ * @param msg The message
+ * @param status The status code. Codes other than 0 and 2 are errors.
+ * @param time Milliseconds since the epoch. Negative for now.
+ */
+void rmEchoStore::append(const char* msg, int status, int64_t time) {
+    std::lock_guard<std::mutex> lock(m);
+    if(!opened || !writable || file == nullptr)
+        return;
+    if(time < 0)
+        time = getTimeNow();
+    if(status != 0 && status != 2)
+        status = 1;
+    
+    std::string text = msg;
+    std::replace(text.begin(), text.end(), '\n', ' ');
+    std::replace(text.begin(), text.end(), '\r', ' ');
+    char head[32];
+    snprintf(head, sizeof(head), "%lld %d ", (long long) time, status);
+    std::string line = head + text + "\n";
+    
+    // A line not written whole would put the offsets after it out of step
+    // with the file, so the segment ends there
+    if(fwrite(line.data(), 1, line.size(), file) != line.size()) {
+        clearerr(file);
+        finishSegment();
+        current++;
+        startSegment();
+        return;
+    }
+    if(offsets.empty())
+        firstTime = time;
+    lastTime = time;
+    offsets.push_back(fileSize);
+    fileSize += (uint32_t) line.size();
+    indexLine(text.c_str());
+    
+    if(fileSize >= segmentSize) {
+        finishSegment();
+        current++;
+        startSegment();
+    }
+}
+
+/**
+ * @brief Writes out the messages buffered
+ */
+void rmEchoStore::flush() {
+    std::lock_guard<std::mutex> lock(m);
+    if(file != nullptr)
+        fflush(file);
+}
+
+
+size_t rmEchoStore::searchSegment(uint32_t seg, const char* str,
+                                  uint8_t mask, int64_t from, int64_t to,
+                                  size_t limit,
+                                  std::vector<rmEchoRecord>* out) const
+{
+    FILE* log = fopen(segmentPath(seg, ".log").c_str(), "rb");
+    if(log == nullptr)
+        return 0;
+    FILE* idx = fopen(segmentPath(seg, ".idx").c_str(), "rb");
+    rmEchoIndexHeader header;
+    std::vector<uint32_t> blockOffsets;
+    std::vector<rmEchoIndexKey> table;
+    long blobStart = 0;
+    long blobEnd = 0;
+    bool indexed = false;
+    if(idx != nullptr) {
+        indexed = fread(&header, sizeof(header), 1, idx) == 1 &&
+                  memcmp(header.magic, "RMIX", 4) == 0 &&
+                  header.version == RM_ECHO_INDEX_VERSION;
+        if(indexed && (header.lastTime < from || header.firstTime > to)) {
+            fclose(idx);
+            fclose(log);
+            return 0;
+        }
+        if(indexed) {
+            blockOffsets.resize(blockCount(header.lineCount));
+            table.resize(header.keyCount);
+            blobStart = (long) (sizeof(header) + 4L * blockOffsets.size() +
+                                sizeof(rmEchoIndexKey) * header.keyCount);
+            indexed = (fread(blockOffsets.data(), 4, blockOffsets.size(), idx)
+                       == blockOffsets.size()) &&
+                      (fread(table.data(), sizeof(rmEchoIndexKey),
+                             table.size(), idx) == table.size()) &&
+                      fseek(idx, 0, SEEK_END) == 0;
+            blobEnd = ftell(idx);
+            indexed &= blobEnd >= blobStart;
+        }
+    }
+    
+    // The segments without an index or with one unreadable are read through,
+    // as are the substrings too short for a trigram
+    if(!indexed || strlen(str) < 3) {
+        if(idx != nullptr)
+            fclose(idx);
+        size_t found = scanLines(log, LONG_MAX, str, mask, from, to, limit,
+                                 out);
+        fclose(log);
+        return found;
+    }
+    
+    // Looks up the trigrams of the substring, the shortest list first
+    std::vector<uint32_t> keys;
+    trigrams(str, &keys);
+    std::vector<size_t> lists;
+    for(uint32_t key : keys) {
+        auto it = std::lower_bound(
+            table.begin(), table.end(), key,
+            [](const rmEchoIndexKey& k, uint32_t v) { return k.key < v; }
+        );
+        if(it == table.end() || it->key != key) {
+            fclose(idx);
+            fclose(log);
+            return 0;
+        }
+        lists.push_back(it - table.begin());
+    }
+    std::sort(
+        lists.begin(), lists.end(),
+        [&table](size_t a, size_t b) { return table[a].count < table[b].count; }
+    );
+    
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> list;
+    std::vector<uint8_t> data;
+    bool ok = true;
+    for(size_t i=0; i<lists.size() && ok; i++) {
+        const rmEchoIndexKey& k = table[lists[i]];
+        if(i > 0 && k.count > RM_ECHO_LIST_RATIO * candidates.size())
+            break;
+        long end = (lists[i] + 1 < table.size()) ?
+                   blobStart + table[lists[i] + 1].start : blobEnd;
+        long size = end - blobStart - k.start;
+        data.resize(size > 0 ? size : 0);
+        ok = size >= 0 && fseek(idx, blobStart + k.start, SEEK_SET) == 0 &&
+             fread(data.data(), 1, data.size(), idx) == data.size() &&
+             readList(data.data(), data.size(), k.count, &list);
+        if(i == 0)
+            candidates.swap(list);
+        else
+            intersect(&candidates, list);
+        if(candidates.empty())
+            break;
+    }
+    fclose(idx);
+    
+    size_t found;
+    if(ok) {
+        // The trigrams only narrow the blocks down
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> counts;
+        for(uint32_t b : candidates) {
+            if(b >= blockOffsets.size())
+                break;
+            offsets.push_back(blockOffsets[b]);
+            counts.push_back(blockLines(header.lineCount, b));
+        }
+        found = readBlocks(log, offsets, counts, str, mask, from, to, limit,
+                           out);
+    }
+    else {
+        found = scanLines(log, LONG_MAX, str, mask, from, to, limit, out);
+    }
+    fclose(log);
+    return found;
+}
+
+
+/*
+ * Searches the segment being written if it is still the one. Only the
+ * candidates are found with the lock held and the file is read after.
+ * Returns false if the segment has been finished in the meantime.
+ */
+bool rmEchoStore::searchCurrent(uint32_t seg, const char* str, uint8_t mask,
+                                int64_t from, int64_t to, size_t limit,
+                                std::vector<rmEchoRecord>* out,
+                                size_t* found) const
+{
+    std::vector<uint32_t> blocks;
+    std::vector<uint32_t> counts;
+    long size;
+    {
+        std::lock_guard<std::mutex> lock(m);
+        if(seg != current || file == nullptr)
+            return false;
+        *found = 0;
+        if(offsets.empty() || lastTime < from || firstTime > to)
+            return true;
+        fflush(file);
+        size = fileSize;
+        
+        if(strlen(str) >= 3) {
+            std::vector<uint32_t> keys;
+            trigrams(str, &keys);
+            std::vector<const rmEchoPostings*> lists;
+            for(uint32_t key : keys) {
+                auto it = postings.find(key);
+                if(it == postings.end())
+                    return true;
+                lists.push_back(&it->second);
+            }
+            std::sort(
+                lists.begin(), lists.end(),
+                [](const rmEchoPostings* a, const rmEchoPostings* b) {
+                    return a->count < b->count;
+                }
+            );
+            std::vector<uint32_t> candidates;
+            std::vector<uint32_t> list;
+            for(size_t i=0; i<lists.size(); i++) {
+                if(i > 0 && lists[i]->count > RM_ECHO_LIST_RATIO *
+                                              candidates.size())
+                    break;
+                readList(lists[i]->deltas.data(), lists[i]->deltas.size(),
+                         lists[i]->count, &list);
+                if(i == 0)
+                    candidates.swap(list);
+                else
+                    intersect(&candidates, list);
+                if(candidates.empty())
+                    return true;
+            }
+            uint32_t n = (uint32_t) offsets.size();
+            for(uint32_t b : candidates) {
+                blocks.push_back(offsets[b * RM_ECHO_INDEX_BLOCK]);
+                counts.push_back(blockLines(n, b));
+            }
+        }
+    }
+    
+    // The lines up to the size taken are complete and do not change
+    FILE* log = fopen(segmentPath(seg, ".log").c_str(), "rb");
+    if(log == nullptr)
+        return true;
+    if(strlen(str) < 3)
+        *found = scanLines(log, size, str, mask, from, to, limit, out);
+    else
+        *found = readBlocks(log, blocks, counts, str, mask, from, to, limit,
+                            out);
+    fclose(log);
+    return true;
+}
+
+/**
+ * @brief Finds the messages containing a substring
+ * 
+ * The messages are returned in the order they arrived.
+ * 
+ * @param str The substring. Null or empty to match every message.
+ * @param mask Combination of RM_ECHO_NORMAL, RM_ECHO_ERROR and RM_ECHO_WARNING
+ * @param out The messages found are appended here
+ * @param limit Maximum number of messages to find
+ * @param from Earliest time in milliseconds since the epoch
+ * @param to Latest time in milliseconds since the epoch
+ * 
+ * @return Number of messages found
+ */
+size_t rmEchoStore::search(const char* str, uint8_t mask,
+                           std::vector<rmEchoRecord>* out, size_t limit,
+                           int64_t from, int64_t to)
+{
+    if(str == nullptr)
+        str = "";
+    
+    // Only the segment being written changes, and the files are read without
+    // the lock held
+    std::vector<uint32_t> segs;
+    bool write;
+    {
+        std::lock_guard<std::mutex> lock(m);
+        if(!opened)
+            return 0;
+        if(!writable)
+            listSegments();
+        segs = segments;
+        write = writable;
+    }
+    
+    size_t found = 0;
+    for(uint32_t seg : segs) {
+        if(found >= limit)
+            break;
+        size_t n;
+        if(write && searchCurrent(seg, str, mask, from, to, limit - found,
+                                  out, &n))
+            found += n;
+        else
+            found += searchSegment(seg, str, mask, from, to, limit - found,
+                                   out);
+    }
+    return found;
+}
@@ -2,134 +2,361 @@
  * @file encryption.cpp
  * @brief The encryption algorithm
  * 
- * The encryption algorithm here does not use a lot of bits and aims for speed
- * so that it can be used on microcontrollers.
+ * The station and the device agree on a shared secret with X25519 and seal
+ * the messages with ChaCha20-Poly1305, which are fast enough in plain C to
+ * run on microcontrollers. The station's key pair is kept in two files, the
+ * private key and the public key with ".pub" added to the name. The public
+ * key is built into the firmware of the devices.
+ * 
+ * The station only starts a session with the devices whose public keys are
+ * in a third file, the known devices with ".known" added to the name, so
+ * no one else can pose as a device on a shared link.
+ * 
+ * The algorithms of RFC 7748 and RFC 8439 are in rm_cipher.c of the client
+ * library, which is built into this library as well.
  * 
  * @license{This project is released under the MIT License.}
  */
 
 
 #define RM_EXPORT
+#define RM_NO_WX
 
 
 #include "rm/encryption.hpp"
 
+#include "../client/src/cipher_private.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
 #include <cstdio>
-#include <cstdlib>
 #include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+typedef std::array<uint8_t, RM_PUBLIC_KEY_SIZE> rmDeviceKey;
+
+static uint8_t privateKey[RM_PRIVATE_KEY_SIZE];
+static uint8_t publicKey[RM_PUBLIC_KEY_SIZE];
+static bool keyOpen = false;
+static std::string knownPath;
+static std::vector<rmDeviceKey> knownDevices;
+static std::mutex m;
+
+
+// A key in hex at the start of a line of the known devices
+static bool parseKey(rmDeviceKey& key, const char* line) {
+    for(size_t i=0; i<RM_PUBLIC_KEY_SIZE; i++) {
+        unsigned int v;
+        if(!isxdigit(line[2*i]) || !isxdigit(line[2*i + 1]) ||
+           sscanf(&line[2*i], "%2x", &v) != 1)
+            return false;
+        key[i] = (uint8_t) v;
+    }
+    char c = line[2*RM_PUBLIC_KEY_SIZE];
+    return c == '\0' || isspace(c);
+}
 
 
-static char privateKey[RM_PRIVATE_KEY_SIZE];
-static char publicKey[RM_PUBLIC_KEY_SIZE];
+// Reads the known devices of a key. The lines which are not a key, like the
+// blank ones and the comments starting with '#', are skipped.
+static std::vector<rmDeviceKey> readKnownDevices(const std::string& path) {
+    std::vector<rmDeviceKey> vec;
+    FILE* fp = fopen(path.c_str(), "r");
+    if(fp == NULL)
+        return vec;
+    char line[256];
+    while(fgets(line, sizeof(line), fp) != NULL) {
+        rmDeviceKey key;
+        if(parseKey(key, line))
+            vec.push_back(key);
+    }
+    fclose(fp);
+    return vec;
+}
+
+
+static void setKey(const uint8_t* priv, const char* key) {
+    static const uint8_t basePoint[32] = {9};
+    uint8_t pub[RM_PUBLIC_KEY_SIZE];
+    _rmX25519(pub, priv, basePoint);
+    std::string path = std::string(key) + ".known";
+    std::vector<rmDeviceKey> known = readKnownDevices(path);
+    m.lock();
+    memcpy(privateKey, priv, RM_PRIVATE_KEY_SIZE);
+    memcpy(publicKey, pub, RM_PUBLIC_KEY_SIZE);
+    keyOpen = true;
+    knownPath = path;
+    knownDevices.swap(known);
+    m.unlock();
+}
 
 
 /**
  * @brief Generates a new key and sets to use it
  * 
+ * The private key is only readable by the user, and a key already in the
+ * file is not replaced.
+ * 
  * @param key The file name where the new key is to be saved
  * 
  * @return True if the key generation is success
  */
 bool rmGenerateKey(const char* key) {
-    FILE* fp1 = fopen(key, "wb");
+#if defined(_WIN32)
+    FILE* fp1 = fopen(key, "wbx");
+#else
+    int fd = open(key, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    FILE* fp1 = (fd >= 0) ? fdopen(fd, "wb") : NULL;
+    if(fd >= 0 && fp1 == NULL) {
+        close(fd);
+        remove(key);
+    }
+#endif
+    if(fp1 == NULL)
+        return false;
     char pub[128];
     snprintf(pub, 127, "%s.pub", key);
     FILE* fp2 = fopen(pub, "wb");
-    if(fp1 == NULL || fp2 == NULL) {
-        if(fp1 != NULL)
-            fclose(fp1);
-        if(fp2 != NULL)
-            fclose(fp2);
+    if(fp2 == NULL) {
+        fclose(fp1);
+        remove(key);
         return false;
     }
     
-    privateKey[0] = 2;
-    publicKey[0] = 2;
+    std::random_device rd;
+    uint8_t priv[RM_PRIVATE_KEY_SIZE];
+    for(size_t i=0; i<RM_PRIVATE_KEY_SIZE; i+=4) {
+        uint32_t r = rd();
+        memcpy(&priv[i], &r, 4);
+    }
+    priv[0] &= 248;
+    priv[31] = (priv[31] & 127) | 64;
+    setKey(priv, key);
     
-    fwrite(privateKey, 1, 1, fp1);
-    fwrite(publicKey, 1, 1, fp2);
-    fclose(fp1);
-    fclose(fp2);
-    return true;
+    bool success = (fwrite(priv, 1, RM_PRIVATE_KEY_SIZE, fp1) ==
+                    RM_PRIVATE_KEY_SIZE);
+    success &= (fwrite(publicKey, 1, RM_PUBLIC_KEY_SIZE, fp2) ==
+                RM_PUBLIC_KEY_SIZE);
+    success &= (fclose(fp1) == 0);
+    success &= (fclose(fp2) == 0);
+    if(!success)
+        remove(key);
+    return success;
 }
 
 /**
  * @brief Opens the generated key to use
  * 
+ * The public key is worked out again from the private key.
+ * 
  * @param key The file name to open
  * 
  * @return True if the key is successfully read
  */
 bool rmOpenKey(const char* key) {
-    FILE* fp1 = fopen(key, "r");
-    char pub[128];
-    snprintf(pub, 127, "%s.pub", key);
-    FILE* fp2 = fopen(pub, "r");
-    if(fp1 == NULL || fp2 == NULL) {
-        if(fp1 != NULL)
-            fclose(fp1);
-        if(fp2 != NULL)
-            fclose(fp2);
+    FILE* fp = fopen(key, "rb");
+    if(fp == NULL)
         return false;
-    }
-    privateKey[0] = 2;
-    publicKey[0] = 2;
-    fclose(fp1);
-    fclose(fp2);
+    uint8_t priv[RM_PRIVATE_KEY_SIZE];
+    size_t n = fread(priv, 1, RM_PRIVATE_KEY_SIZE, fp);
+    fclose(fp);
+    if(n != RM_PRIVATE_KEY_SIZE)
+        return false;
+    setKey(priv, key);
     return true;
 }
 
 /**
  * @brief Gets the private key
  * 
- * @return Private key data
+ * @return Private key data. Null if no key is open.
  */
-const char* rmGetPrivateKey() { return privateKey; }
+const uint8_t* rmGetPrivateKey() {
+    m.lock();
+    const uint8_t* key = keyOpen ? privateKey : nullptr;
+    m.unlock();
+    return key;
+}
 
 /**
  * @brief Gets the public key
  * 
- * @return Public key data
+ * @return Public key data. Null if no key is open.
  */
-const char* rmGetPublicKey() { return publicKey; }
+const uint8_t* rmGetPublicKey() {
+    m.lock();
+    const uint8_t* key = keyOpen ? publicKey : nullptr;
+    m.unlock();
+    return key;
+}
 
 /**
- * @brief Encrypts a message
+ * @brief Trusts the public key of a device
+ * 
+ * Adds the key to the known devices of the key open, and to its file with
+ * ".known" added to the name. The file has a key in hex on each line and
+ * can also be edited by hand.
  * 
- * @param in Message to encrypt
- * @param pub The public key of the client
+ * @param pub The device's public key of RM_PUBLIC_KEY_SIZE bytes
  * 
- * @return Encrypted message. Allocated with malloc() and needs to be freed
- *         manually.
+ * @return False if no key is open or the file cannot be written
  */
-char* rmEncryptMessage(const char* in, const char* pub) {
-    size_t len = strlen(in);
-    char* out = (char*) malloc(len + 1);
-    size_t i = 0;
-    while(i < len) {
-        out[i] = in[i] + publicKey[0];
-        i++;
-    }
-    out[i] = '\0';
-    return out;
+bool rmTrustDevice(const uint8_t* pub) {
+    rmDeviceKey key;
+    memcpy(key.data(), pub, RM_PUBLIC_KEY_SIZE);
+    std::lock_guard<std::mutex> lock(m);
+    if(!keyOpen)
+        return false;
+    if(std::find(knownDevices.begin(), knownDevices.end(), key) !=
+       knownDevices.end())
+        return true;
+    FILE* fp = fopen(knownPath.c_str(), "a");
+    if(fp == NULL)
+        return false;
+    for(size_t i=0; i<RM_PUBLIC_KEY_SIZE; i++)
+        fprintf(fp, "%02x", pub[i]);
+    fprintf(fp, "\n");
+    if(fclose(fp) != 0)
+        return false;
+    knownDevices.push_back(key);
+    return true;
 }
 
 /**
- * @brief Decrypts a message
+ * @brief Checks if the public key of a device is trusted
  * 
- * @param in Encrypted message
+ * @param pub The device's public key of RM_PUBLIC_KEY_SIZE bytes
  * 
- * @return Decrypted message. Allocated with malloc() and needs to be freed
- *         manually.
+ * @return True if the key is one of the known devices of the key open
  */
-char* rmDecryptMessage(const char* in) {
-    size_t len = strlen(in);
-    char* out = (char*) malloc(len + 1);
-    size_t i = 0;
-    while(i < len) {
-        out[i] = in[i] - publicKey[0];
-        i++;
-    }
-    out[i] = '\0';
-    return out;
+bool rmIsTrustedDevice(const uint8_t* pub) {
+    rmDeviceKey key;
+    memcpy(key.data(), pub, RM_PUBLIC_KEY_SIZE);
+    std::lock_guard<std::mutex> lock(m);
+    if(!keyOpen)
+        return false;
+    return std::find(knownDevices.begin(), knownDevices.end(), key) !=
+           knownDevices.end();
+}
+
+/**
+ * @brief Multiplies a point on Curve25519 by a scalar
+ * 
+ * The public key is the private key times the point 9 and the shared secret
+ * is the private key times the other side's public key.
+ * 
+ * @param out The resulting point of 32 bytes
+ * @param scalar The private key
+ * @param point The public key
+ */
+void rmX25519(uint8_t* out, const uint8_t* scalar, const uint8_t* point) {
+    _rmX25519(out, scalar, point);
+}
+
+
+/**
+ * @brief Starts a session
+ * 
+ * The keys of both directions are derived from the shared secret and the
+ * nonces given by the station and the device.
+ * 
+ * @param secret The shared secret from rmX25519()
+ * @param stationNonce The station's nonce of RM_CRYPT_NONCE_SIZE bytes
+ * @param deviceNonce The device's nonce of RM_CRYPT_NONCE_SIZE bytes
+ * @param station True on the station's side
+ */
+void rmCryptChannel::start(const uint8_t* secret, const uint8_t* stationNonce,
+                           const uint8_t* deviceNonce, bool station)
+{
+    uint8_t in[16];
+    uint8_t key[32];
+    uint8_t nonce[12] = {0};
+    uint8_t block[64];
+    memcpy(&in[0], stationNonce, RM_CRYPT_NONCE_SIZE);
+    memcpy(&in[8], deviceNonce, RM_CRYPT_NONCE_SIZE);
+    _rmHChacha(key, secret, in);
+    // The first half is for the station to the device
+    _rmChachaBlock(block, key, 0, nonce);
+    memcpy(txKey, &block[station ? 0 : 32], 32);
+    memcpy(rxKey, &block[station ? 32 : 0], 32);
+    txCounter = 0;
+    rxCounter = 0;
+    active = true;
+}
+
+/**
+ * @brief Ends the session and forgets the keys
+ */
+void rmCryptChannel::stop() {
+    memset(txKey, 0, sizeof(txKey));
+    memset(rxKey, 0, sizeof(rxKey));
+    active = false;
+}
+
+/**
+ * @brief Checks if a session is going on
+ * 
+ * @return True after start() until stop()
+ */
+bool rmCryptChannel::isActive() const { return active; }
+
+/**
+ * @brief Seals a message in place
+ * 
+ * @param buf The buffer with the message from the 4th byte and room for
+ *            RM_CRYPT_OVERHEAD more bytes in total
+ * @param len Length of the message
+ * 
+ * @return Length of the sealed message
+ */
+size_t rmCryptChannel::seal(uint8_t* buf, size_t len) {
+    uint8_t nonce[12] = {0};
+    _rmStore32(buf, txCounter);
+    memcpy(nonce, buf, 4);
+    _rmChachaXor(&buf[4], len, txKey, 1, nonce);
+    _rmAeadTag(&buf[4 + len], NULL, 0, &buf[4], len, txKey, nonce);
+    txCounter++;
+    return len + RM_CRYPT_OVERHEAD;
+}
+
+/**
+ * @brief Checks and opens a sealed message in place
+ * 
+ * @param buf The sealed message
+ * @param len Length of the sealed message
+ * 
+ * @return Length of the message, which is left from the 4th byte. -1 if the
+ *         message is forged, damaged or comes again.
+ */
+long rmCryptChannel::open(uint8_t* buf, size_t len) {
+    if(!active || len < RM_CRYPT_OVERHEAD)
+        return -1;
+    len -= RM_CRYPT_OVERHEAD;
+    uint32_t counter = _rmLoad32(buf);
+    if(counter < rxCounter)
+        return -1;
+    
+    uint8_t nonce[12] = {0};
+    uint8_t tag[RM_CRYPT_TAG_SIZE];
+    uint8_t diff = 0;
+    memcpy(nonce, buf, 4);
+    _rmAeadTag(tag, NULL, 0, &buf[4], len, rxKey, nonce);
+    for(size_t i=0; i<RM_CRYPT_TAG_SIZE; i++)
+        diff |= tag[i] ^ buf[4 + len + i];
+    if(diff != 0)
+        return -1;
+    
+    rxCounter = counter + 1;
+    _rmChachaXor(&buf[4], len, rxKey, 1, nonce);
+    return (long) len;
 }
@@ -0,0 +1,165 @@
+/**
+ * @file frame.cpp
+ * @brief Binary frames sent by the client device
+ * 
+ * Besides the text command lines starting with '$', the client device may
+ * send binary frames. A frame is the start byte, the frame type, the payload
+ * length, the payload and a CRC-8 of everything after the start byte.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_EXPORT
+#define RM_NO_WX
+
+
+#include "rm/frame.hpp"
+
+#include "rm/attribute.hpp"
+
+#include <cstring>
+
+
+/**
+ * @brief Calculates the CRC-8 checksum of a frame
+ * 
+ * @param crc The checksum of the previous part or 0 to start
+ * @param data The data
+ * @param len Length of the data
+ * 
+ * @return The checksum
+ */
+uint8_t rmFrameChecksum(uint8_t crc, const uint8_t* data, size_t len) {
+    while(len--) {
+        crc ^= *data++;
+        for(uint8_t i=0; i<8; i++)
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+    }
+    return crc;
+}
+
+/**
+ * @brief Gets the station data type to hold a client device's data type
+ * 
+ * @param type The wire data type code
+ * 
+ * @return The attribute data type
+ */
+rmAttributeDataType rmFrameAttributeType(uint8_t type) {
+    switch(type) {
+      case RM_WIRE_BOOL:
+        return RM_ATTRIBUTE_BOOL;
+      case RM_WIRE_CHAR:
+        return RM_ATTRIBUTE_CHAR;
+      case RM_WIRE_FLOAT:
+        return RM_ATTRIBUTE_FLOAT;
+      case RM_WIRE_STRING:
+        return RM_ATTRIBUTE_STRING;
+      default:
+        return RM_ATTRIBUTE_INT;
+    }
+}
+
+/**
+ * @brief Decodes a value in the client device's data type
+ * 
+ * The listener of the attribute sees every value and its notifier only a
+ * change.
+ * 
+ * @param attr The attribute to store the value. Can be null to skip the value.
+ * @param type The wire data type code
+ * @param data The encoded value
+ * @param len Length of the data available
+ * 
+ * @return Number of bytes the value takes. 0 if the data is invalid.
+ */
+size_t rmFrameDecodeValue(rmAttribute* attr, uint8_t type, const uint8_t* data,
+                          size_t len)
+{
+    rmAttributeData prev;
+    if(attr != nullptr)
+        prev = attr->getValue();
+    
+    size_t n;
+    uint8_t u8;
+    uint16_t u16;
+    uint32_t u32;
+    float f;
+    char str[256];
+    
+    switch(type) {
+      case RM_WIRE_BOOL:
+      case RM_WIRE_CHAR:
+      case RM_WIRE_UINT8:
+      case RM_WIRE_INT8:
+        if(len < 1)
+            return 0;
+        u8 = data[0];
+        n = 1;
+        if(attr == nullptr)
+            break;
+        if(type == RM_WIRE_BOOL)
+            attr->setValue((bool) u8);
+        else if(type == RM_WIRE_CHAR)
+            attr->setValue((char) u8);
+        else if(type == RM_WIRE_UINT8)
+            attr->setValue((int) u8);
+        else
+            attr->setValue((int) (int8_t) u8);
+        break;
+      
+      case RM_WIRE_UINT16:
+      case RM_WIRE_INT16:
+        if(len < 2)
+            return 0;
+        u16 = data[0] | (data[1] << 8);
+        n = 2;
+        if(attr == nullptr)
+            break;
+        if(type == RM_WIRE_UINT16)
+            attr->setValue((int) u16);
+        else
+            attr->setValue((int) (int16_t) u16);
+        break;
+      
+      case RM_WIRE_UINT32:
+      case RM_WIRE_INT32:
+      case RM_WIRE_FLOAT:
+        if(len < 4)
+            return 0;
+        u32 = data[0] | (data[1] << 8) | (data[2] << 16) |
+              ((uint32_t) data[3] << 24);
+        n = 4;
+        if(attr == nullptr)
+            break;
+        if(type == RM_WIRE_FLOAT) {
+            memcpy(&f, &u32, 4);
+            attr->setValue(f);
+        }
+        else {
+            attr->setValue((int) u32);
+        }
+        break;
+      
+      case RM_WIRE_STRING:
+        if(len < 1 || len < 1 + (size_t) data[0])
+            return 0;
+        n = 1 + data[0];
+        if(attr == nullptr)
+            break;
+        memcpy(str, &data[1], data[0]);
+        str[data[0]] = '\0';
+        attr->setValue((const char*) str);
+        break;
+      
+      default:
+        return 0;
+    }
+    
+    if(attr != nullptr)
+        attr->notifyUpdate(attr->getValue().i != prev.i);
+    return n;
+}
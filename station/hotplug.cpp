@@ -0,0 +1,397 @@
+/**
+ * @file hotplug.cpp
+ * @brief Notifies the serial ports plugged in and out
+ * 
+ * The Linux monitor waits on an inotify watch of /dev and a netlink socket of
+ * the kernel's device events. Either of them wakes the thread only when a
+ * device node changes, and only the port concerned is read from sysfs. A port
+ * added again is compared by its hardware ID, so that a device swapped under
+ * the same node is reported as removed and added.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_EXPORT
+#define RM_NO_WX
+
+
+#include "rm/hotplug.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+
+/**
+ * @brief Triggers when a serial port appears
+ * 
+ * Called from the thread of the monitor.
+ * 
+ * @param info The new port
+ */
+void rmHotplugListener::onPortAdded(const rmSerialPortInfo& info) {}
+
+/**
+ * @brief Triggers when a serial port disappears
+ * 
+ * Called from the thread of the monitor.
+ * 
+ * @param info The port as it was described when it appeared
+ */
+void rmHotplugListener::onPortRemoved(const rmSerialPortInfo& info) {}
+
+
+#if defined(__linux__)
+
+// Held while the listeners are called, so a listener removed is never called
+// again. Recursive for the listeners that list the ports or remove
+// themselves.
+static std::recursive_mutex m;
+static std::vector<rmHotplugListener*> listeners;
+static std::map<std::string, rmSerialPortInfo> ports;
+static std::thread thread;
+static bool running = false;
+
+static int inotifyFd = -1;
+static int netlinkFd = -1;
+static int wakeFds[2] = { -1, -1 };
+
+
+static rmSerialPortInfo toPortInfo(const serial::PortInfo& p) {
+    rmSerialPortInfo info;
+    strncpy(info.port, p.port.c_str(), sizeof(info.port) - 1);
+    strncpy(info.hardware_id, p.hardware_id.c_str(),
+            sizeof(info.hardware_id) - 1);
+    strncpy(info.description, p.description.c_str(),
+            sizeof(info.description) - 1);
+    info.port[sizeof(info.port) - 1] = '\0';
+    info.hardware_id[sizeof(info.hardware_id) - 1] = '\0';
+    info.description[sizeof(info.description) - 1] = '\0';
+    return info;
+}
+
+// The same device nodes serial::list_ports() looks for
+static bool isSerialName(const char* name) {
+    static const char* prefixes[] = {
+        "ttyACM", "ttyS", "ttyUSB", "tty.", "cu."
+    };
+    for(const char* p : prefixes) {
+        if(strncmp(name, p, strlen(p)) == 0)
+            return true;
+    }
+    return false;
+}
+
+static void dispatch(const rmSerialPortInfo& info, bool added) {
+    std::vector<rmHotplugListener*> copy = listeners;
+    for(rmHotplugListener* l : copy) {
+        auto it = std::find(listeners.begin(), listeners.end(), l);
+        if(it == listeners.end())
+            continue;
+        if(added)
+            l->onPortAdded(info);
+        else
+            l->onPortRemoved(info);
+    }
+}
+
+/*
+ * Applies an event of a port. A port added that is known already is probed
+ * again, since the device may have been reset or swapped for another between
+ * the events, and one with another hardware ID is reported as removed and
+ * added. The same event from both the sources is only reported once.
+ */
+static void updatePort(const char* name, bool added) {
+    if(!isSerialName(name))
+        return;
+    std::string path = std::string("/dev/") + name;
+    
+    std::lock_guard<std::recursive_mutex> lock(m);
+    auto it = ports.find(path);
+    if(!added) {
+        if(it == ports.end())
+            return;
+        rmSerialPortInfo info = it->second;
+        ports.erase(it);
+        dispatch(info, false);
+        return;
+    }
+    
+    serial::PortInfo p = serial::get_port_info(path);
+    if(p.hardware_id == "n/a")
+        return;
+    rmSerialPortInfo info = toPortInfo(p);
+    if(it != ports.end()) {
+        if(strcmp(it->second.hardware_id, info.hardware_id) == 0)
+            return;
+        rmSerialPortInfo old = it->second;
+        ports.erase(it);
+        dispatch(old, false);
+    }
+    ports[path] = info;
+    dispatch(info, true);
+}
+
+// Lists all the ports again after the events overflow the queue
+static void rescan() {
+    std::map<std::string, rmSerialPortInfo> found;
+    auto list = serial::list_ports();
+    for(auto it=list.begin(); it!=list.end(); ++it) {
+        if(it->hardware_id != "n/a")
+            found[it->port] = toPortInfo(*it);
+    }
+    
+    std::lock_guard<std::recursive_mutex> lock(m);
+    std::map<std::string, rmSerialPortInfo> old;
+    old.swap(ports);
+    ports = found;
+    // A port with another hardware ID is another device
+    for(auto it=old.begin(); it!=old.end(); ++it) {
+        auto f = found.find(it->first);
+        if(f == found.end() ||
+           strcmp(f->second.hardware_id, it->second.hardware_id) != 0)
+            dispatch(it->second, false);
+    }
+    for(auto it=found.begin(); it!=found.end(); ++it) {
+        auto o = old.find(it->first);
+        if(o == old.end() ||
+           strcmp(o->second.hardware_id, it->second.hardware_id) != 0)
+            dispatch(it->second, true);
+    }
+}
+
+static void readInotify() {
+    alignas(struct inotify_event) char buf[4096];
+    ssize_t len = read(inotifyFd, buf, sizeof(buf));
+    for(ssize_t i=0; i<len; ) {
+        const struct inotify_event* e = (const struct inotify_event*) &buf[i];
+        if(e->mask & IN_Q_OVERFLOW)
+            rescan();
+        else if(e->len > 0)
+            updatePort(e->name, (e->mask & (IN_CREATE | IN_MOVED_TO)) != 0);
+        i += sizeof(struct inotify_event) + e->len;
+    }
+}
+
+// A kernel event is a header like "add@/devices/..." followed by KEY=value
+// strings, each terminated by a null
+static void readNetlink() {
+    char buf[8192];
+    ssize_t len = recv(netlinkFd, buf, sizeof(buf) - 1, 0);
+    if(len <= 0)
+        return;
+    buf[len] = '\0';
+    const char* action = "";
+    const char* subsystem = "";
+    const char* devname = "";
+    for(ssize_t i=0; i<len; i+=strlen(&buf[i]) + 1) {
+        if(strncmp(&buf[i], "ACTION=", 7) == 0)
+            action = &buf[i + 7];
+        else if(strncmp(&buf[i], "SUBSYSTEM=", 10) == 0)
+            subsystem = &buf[i + 10];
+        else if(strncmp(&buf[i], "DEVNAME=", 8) == 0)
+            devname = &buf[i + 8];
+    }
+    if(strcmp(subsystem, "tty") != 0 || devname[0] == '\0')
+        return;
+    
+    // A change is probed again like an addition
+    bool added;
+    if(strcmp(action, "add") == 0 || strcmp(action, "change") == 0)
+        added = true;
+    else if(strcmp(action, "remove") == 0)
+        added = false;
+    else
+        return;
+    const char* slash = strrchr(devname, '/');
+    updatePort((slash != NULL) ? slash + 1 : devname, added);
+}
+
+static void monitorThread() {
+    struct pollfd fds[3] = {
+        { wakeFds[0], POLLIN, 0 },
+        { inotifyFd, POLLIN, 0 },
+        { netlinkFd, POLLIN, 0 }
+    };
+    while(true) {
+        if(poll(fds, 3, -1) < 0)
+            continue;
+        if(fds[0].revents != 0)
+            break;
+        if(fds[1].revents & POLLIN)
+            readInotify();
+        if(fds[2].revents & POLLIN)
+            readNetlink();
+    }
+}
+
+static void closeFds() {
+    int* fds[] = { &inotifyFd, &netlinkFd, &wakeFds[0], &wakeFds[1] };
+    for(int* fd : fds) {
+        if(*fd >= 0)
+            close(*fd);
+        *fd = -1;
+    }
+}
+
+static bool openFds() {
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotifyFd >= 0) {
+        uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+        if(inotify_add_watch(inotifyFd, "/dev", mask) < 0) {
+            close(inotifyFd);
+            inotifyFd = -1;
+        }
+    }
+    
+    // Not every system lets an unprivileged process join the group
+    netlinkFd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                       NETLINK_KOBJECT_UEVENT);
+    if(netlinkFd >= 0) {
+        struct sockaddr_nl addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.nl_family = AF_NETLINK;
+        addr.nl_groups = 1;
+        if(bind(netlinkFd, (struct sockaddr*) &addr, sizeof(addr)) < 0) {
+            close(netlinkFd);
+            netlinkFd = -1;
+        }
+    }
+    
+    if((inotifyFd < 0 && netlinkFd < 0) || pipe(wakeFds) < 0) {
+        closeFds();
+        return false;
+    }
+    return true;
+}
+
+static void endMonitor() {
+    m.lock();
+    bool toJoin = running;
+    running = false;
+    m.unlock();
+    if(!toJoin)
+        return;
+    char c = 0;
+    if(write(wakeFds[1], &c, 1) < 0)
+        return;
+    if(thread.joinable())
+        thread.join();
+    closeFds();
+}
+
+
+/**
+ * @brief Checks if the system can report the ports as they change
+ * 
+ * @return True on Linux with inotify or the kernel's device events
+ *         available. False elsewhere, where the ports have to be polled.
+ */
+bool rmHotplug::isSupported() {
+    std::lock_guard<std::recursive_mutex> lock(m);
+    if(running)
+        return true;
+    static int supported = -1;
+    if(supported < 0) {
+        supported = openFds() ? 1 : 0;
+        closeFds();
+    }
+    return supported == 1;
+}
+
+/**
+ * @brief Adds a listener
+ * 
+ * Starts the monitor with the first listener. It runs until the program
+ * exits.
+ * 
+ * @param l The listener
+ * 
+ * @return False if not supported, in which case the listener is not added
+ */
+bool rmHotplug::addListener(rmHotplugListener* l) {
+    std::lock_guard<std::recursive_mutex> lock(m);
+    if(!running) {
+        if(!openFds())
+            return false;
+        auto list = serial::list_ports();
+        ports.clear();
+        for(auto it=list.begin(); it!=list.end(); ++it) {
+            if(it->hardware_id != "n/a")
+                ports[it->port] = toPortInfo(*it);
+        }
+        running = true;
+        thread = std::thread(&monitorThread);
+        
+        static bool atexitAdded = false;
+        if(!atexitAdded) {
+            atexit(endMonitor);
+            atexitAdded = true;
+        }
+    }
+    if(std::find(listeners.begin(), listeners.end(), l) == listeners.end())
+        listeners.push_back(l);
+    return true;
+}
+
+/**
+ * @brief Removes a listener
+ * 
+ * Once this returns, the listener is not called any more.
+ * 
+ * @param l The listener
+ */
+void rmHotplug::removeListener(rmHotplugListener* l) {
+    std::lock_guard<std::recursive_mutex> lock(m);
+    auto it = std::find(listeners.begin(), listeners.end(), l);
+    if(it != listeners.end())
+        listeners.erase(it);
+}
+
+/**
+ * @brief Lists the ports known to the monitor
+ * 
+ * Lists the ports through rmSerialPort::listPorts() if the monitor is not
+ * running.
+ * 
+ * @return The ports present
+ */
+rmSerialPortList rmHotplug::getPorts() {
+    std::unique_lock<std::recursive_mutex> lock(m);
+    if(!running) {
+        lock.unlock();
+        return rmSerialPort::listPorts();
+    }
+    rmSerialPortList list;
+    for(auto it=ports.begin(); it!=ports.end(); ++it)
+        list.push_back(it->second);
+    return list;
+}
+
+#else
+
+bool rmHotplug::isSupported() { return false; }
+
+bool rmHotplug::addListener(rmHotplugListener* l) { return false; }
+
+void rmHotplug::removeListener(rmHotplugListener* l) {}
+
+rmSerialPortList rmHotplug::getPorts() { return rmSerialPort::listPorts(); }
+
+#endif
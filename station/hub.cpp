@@ -0,0 +1,436 @@
+/**
+ * @file hub.cpp
+ * @brief Many client devices processed by a pool of threads
+ * 
+ * A station with dozens of devices, like a test bench for a swarm of
+ * robots, keeps them in a hub instead of one window each. The hub owns the
+ * clients and takes the place of their timer. The clients are dealt among
+ * the worker threads, and each worker waits on the ports of its own clients
+ * and makes its passes over them without waiting for the others. A client
+ * is processed for a limited time in each pass, and a worker with nothing
+ * to do takes the clients left in the others' passes, so a busy link does
+ * not hold up the rest. The attributes of all the devices are found by the
+ * client name and the attribute name, as in "robot3.voltage".
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_EXPORT
+#define RM_NO_WX
+
+
+#include "rm/hub.hpp"
+
+#include "rm/linkbudget.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if defined(__linux__)
+#include <poll.h>
+#endif
+
+
+/**
+ * @brief Constructs a hub with a number of worker threads
+ * 
+ * @param workers Number of worker threads. 0 for one for each core.
+ */
+rmHub::rmHub(size_t workers) {
+    if(workers == 0)
+        workers = std::thread::hardware_concurrency();
+    if(workers == 0)
+        workers = 1;
+    workerCount = workers;
+    shares.reset(new Share[workerCount]);
+    dealt.resize(workerCount);
+    busy.resize(workerCount, nullptr);
+    rounds = 0;
+    steals = 0;
+}
+
+/**
+ * @brief Destructor
+ * 
+ * Stops the workers and deletes the clients.
+ */
+rmHub::~rmHub() {
+    stop();
+    for(auto it=owned.begin(); it!=owned.end(); ++it)
+        delete *it;
+}
+
+/**
+ * @brief Creates a client which the hub processes and owns
+ * 
+ * The client is processed from when its port is connected.
+ * 
+ * @param name The name before the attribute names, like "robot3"
+ * 
+ * @return The new client. Null if the name is empty, has the separator
+ *         in it or is taken.
+ */
+rmClient* rmHub::createClient(const char* name) {
+    if(name[0] == '\0' || strchr(name, RM_HUB_SEPARATOR) != NULL)
+        return nullptr;
+    m.lock();
+    if(std::find(names.begin(), names.end(), name) != names.end()) {
+        m.unlock();
+        return nullptr;
+    }
+    rmClient* cli = new rmClient();
+    cli->setTimer(this);
+    owned.push_back(cli);
+    names.push_back(name);
+    m.unlock();
+    return cli;
+}
+
+/**
+ * @brief Looks for a client by name
+ * 
+ * @param name The name given to createClient()
+ * 
+ * @return The client. Null if the hub has none by the name.
+ */
+rmClient* rmHub::getClient(const char* name) const {
+    m.lock();
+    rmClient* cli = nullptr;
+    for(size_t i=0; i<names.size(); i++) {
+        if(names[i] == name) {
+            cli = owned[i];
+            break;
+        }
+    }
+    m.unlock();
+    return cli;
+}
+
+/**
+ * @brief Gets the number of clients owned by the hub
+ * 
+ * @return Number of clients
+ */
+size_t rmHub::getClientCount() const {
+    m.lock();
+    size_t n = owned.size();
+    m.unlock();
+    return n;
+}
+
+/**
+ * @brief Gets a client by its position in the order of creation
+ * 
+ * @param i Index of the client
+ * 
+ * @return The client. Null if the index is out of range.
+ */
+rmClient* rmHub::getClientAt(size_t i) const {
+    m.lock();
+    rmClient* cli = (i < owned.size()) ? owned[i] : nullptr;
+    m.unlock();
+    return cli;
+}
+
+/**
+ * @brief Gets the name of a client
+ * 
+ * @param i Index of the client
+ * 
+ * @return The name. Empty if the index is out of range.
+ */
+std::string rmHub::getClientName(size_t i) const {
+    m.lock();
+    std::string str = (i < names.size()) ? names[i] : "";
+    m.unlock();
+    return str;
+}
+
+/**
+ * @brief Looks for an attribute of any of the clients
+ * 
+ * @param key The client name and the attribute name joined by
+ *            RM_HUB_SEPARATOR, like "robot3.voltage"
+ * 
+ * @return The attribute. Null if there is no such client or attribute.
+ */
+rmAttribute* rmHub::getAttribute(const char* key) const {
+    const char* sep = strchr(key, RM_HUB_SEPARATOR);
+    if(sep == NULL)
+        return nullptr;
+    std::string name(key, sep - key);
+    rmClient* cli = getClient(name.c_str());
+    if(cli == nullptr)
+        return nullptr;
+    return cli->getAttribute(sep + 1);
+}
+
+/**
+ * @brief Gets the number of worker threads
+ * 
+ * @return Number of worker threads
+ */
+size_t rmHub::getWorkerCount() const { return workerCount; }
+
+/**
+ * @brief Sets the time to process a client in each pass
+ * 
+ * A client with more data than it can process in the time takes the rest in
+ * the next pass, which its worker starts without waiting.
+ * 
+ * @param us Time in microseconds
+ */
+void rmHub::setBudget(long us) {
+    m.lock();
+    budget = us;
+    m.unlock();
+}
+
+/**
+ * @brief Adds up the traffic and the errors of all the clients
+ * 
+ * @return The totals
+ */
+rmHubStats rmHub::getStats() const {
+    m.lock();
+    auto vec = owned;
+    m.unlock();
+    
+    rmHubStats stats;
+    stats.clients = vec.size();
+    for(auto it=vec.begin(); it!=vec.end(); ++it) {
+        if((*it)->isConnected())
+            stats.connected++;
+        rmLinkBudget* budget = (*it)->getLinkBudget();
+        stats.bytesPerSecond += budget->getOtherBytesPerSecond();
+        for(int i=0; i<RM_LINK_TABLE_COUNT; i++)
+            stats.bytesPerSecond += budget->getStats(i).bytesPerSecond;
+        for(uint8_t k=0; k<RM_LINK_ERROR_COUNT; k++)
+            stats.errors += budget->getErrorStats(k).count;
+    }
+    stats.rounds = rounds;
+    stats.steals = steals;
+    return stats;
+}
+
+/**
+ * @brief Adds a client to the list to process
+ * 
+ * Called by the client when its port is connected. The client is given to
+ * the worker with the fewest. Starts the workers with the first one.
+ * 
+ * @param cli The client device
+ */
+void rmHub::appendClient(rmClient* cli) {
+    m.lock();
+    if(std::find(clients.begin(), clients.end(), cli) == clients.end()) {
+        clients.push_back(cli);
+        size_t w = 0;
+        for(size_t k=1; k<workerCount; k++) {
+            if(dealt[k].size() < dealt[w].size())
+                w = k;
+        }
+        dealt[w].push_back(cli);
+    }
+    bool toStart = !active;
+    m.unlock();
+    clientAdded.notify_all();
+    if(toStart)
+        start(interval);
+}
+
+/**
+ * @brief Removes a client from the list to process
+ * 
+ * Waits if a worker is processing the client, unless it is called from
+ * that worker.
+ * 
+ * @param cli The client device
+ */
+void rmHub::removeClient(rmClient* cli) {
+    std::unique_lock<std::mutex> lock(m);
+    auto it = std::find(clients.begin(), clients.end(), cli);
+    if(it != clients.end())
+        clients.erase(it);
+    for(size_t w=0; w<workerCount; w++) {
+        it = std::find(dealt[w].begin(), dealt[w].end(), cli);
+        if(it != dealt[w].end())
+            dealt[w].erase(it);
+    }
+    // The shares still hold it, but the workers skip the clients removed
+    clientDone.wait(lock, [this, cli]() {
+        for(size_t w=0; w<workerCount; w++) {
+            if(busy[w] == cli &&
+               workers[w].get_id() != std::this_thread::get_id())
+                return false;
+        }
+        return true;
+    });
+}
+
+/**
+ * @brief Starts the workers
+ * 
+ * @param ms Longest time a worker waits for the data between its passes in
+ *           milliseconds
+ */
+void rmHub::start(long ms) {
+    m.lock();
+    if(active) {
+        m.unlock();
+        return;
+    }
+    interval = ms;
+    active = true;
+    for(size_t w=0; w<workerCount; w++)
+        workers.push_back(std::thread(&rmHub::work, this, w));
+    m.unlock();
+}
+
+/**
+ * @brief Stops the workers
+ * 
+ * Waits for the passes going on to finish, so it is not to be called by
+ * the callbacks of the clients.
+ */
+void rmHub::stop() {
+    m.lock();
+    active = false;
+    m.unlock();
+    clientAdded.notify_all();
+    for(auto it=workers.begin(); it!=workers.end(); ++it)
+        it->join();
+    workers.clear();
+    for(size_t w=0; w<workerCount; w++)
+        shares[w].clients.clear();
+}
+
+
+/*
+ * Processes the clients of the worker's pass and then those left in the
+ * others'. Once there are none, starts the next pass of its own clients.
+ */
+void rmHub::work(size_t w) {
+    bool backlog = false;
+    while(startPass(w, backlog)) {
+        backlog = false;
+        rmClient* cli;
+        while((cli = take(w)) != nullptr) {
+            if(process(w, cli))
+                backlog = true;
+        }
+    }
+}
+
+
+// Own share from the front, the others' from the back
+rmClient* rmHub::take(size_t w) {
+    for(size_t k=0; k<workerCount; k++) {
+        Share& share = shares[(w + k) % workerCount];
+        std::lock_guard<std::mutex> lock(share.m);
+        if(share.clients.empty())
+            continue;
+        rmClient* cli;
+        if(k == 0) {
+            cli = share.clients.front();
+            share.clients.pop_front();
+        }
+        else {
+            cli = share.clients.back();
+            share.clients.pop_back();
+            steals++;
+        }
+        return cli;
+    }
+    return nullptr;
+}
+
+
+/*
+ * Skips a client removed or being processed by another worker, which took
+ * it from this worker's last pass. Returns true if the client had more data
+ * than the budget allowed.
+ */
+bool rmHub::process(size_t w, rmClient* cli) {
+    m.lock();
+    bool skip = std::find(clients.begin(), clients.end(), cli) ==
+                clients.end();
+    for(size_t k=0; k<workerCount && !skip; k++)
+        skip = (busy[k] == cli);
+    if(skip) {
+        m.unlock();
+        return false;
+    }
+    busy[w] = cli;
+    long us = budget;
+    m.unlock();
+    
+    bool full = false;
+    if(cli->isConnected() == false) {
+        if(!cli->reconnect()) {
+            cli->echo("Port disconnected", 1);
+            removeClient(cli);
+            cli->onDisconnected();
+        }
+    }
+    else {
+        auto start = std::chrono::steady_clock::now();
+        cli->onIdle(us);
+        full = (std::chrono::steady_clock::now() - start >=
+                std::chrono::microseconds(us));
+    }
+    
+    m.lock();
+    busy[w] = nullptr;
+    m.unlock();
+    clientDone.notify_all();
+    return full;
+}
+
+
+// Wakes on the bytes received by any of the clients, or after the interval
+// for the timeouts and the clients reconnecting
+void rmHub::waitForClients(const std::vector<rmClient*>& vec, long ms) {
+#if defined(__linux__)
+    std::vector<struct pollfd> fds;
+    for(auto it=vec.begin(); it!=vec.end(); it++) {
+        int fd = (*it)->getSerialFd();
+        if(fd >= 0)
+            fds.push_back({ fd, POLLIN, 0 });
+    }
+    if(fds.size() > 0) {
+        poll(fds.data(), fds.size(), ms);
+        return;
+    }
+#endif
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+
+/*
+ * Waits for the data on the worker's own clients, unless one of them was
+ * left with more, and queues them in its share. Waits while the worker has
+ * no clients. Returns false once the hub is stopped.
+ */
+bool rmHub::startPass(size_t w, bool backlog) {
+    std::unique_lock<std::mutex> lock(m);
+    while(active && dealt[w].empty())
+        clientAdded.wait_for(lock, std::chrono::milliseconds(interval));
+    if(!active)
+        return false;
+    auto vec = dealt[w];
+    long ms = interval;
+    lock.unlock();
+    
+    if(!backlog)
+        waitForClients(vec, ms);
+    std::lock_guard<std::mutex> shareLock(shares[w].m);
+    for(auto it=vec.begin(); it!=vec.end(); ++it)
+        shares[w].clients.push_back(*it);
+    rounds++;
+    return true;
+}
@@ -0,0 +1,336 @@
+/**
+ * @file linkbudget.cpp
+ * @brief Keeps the sync traffic within the capacity of the link
+ * 
+ * Measures the bytes received for each sync table, computes the utilisation
+ * against the link capacity derived from the baud rate and commands the client
+ * device to change the table rates so that the utilisation stays under a
+ * ceiling.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_EXPORT
+#define RM_NO_WX
+
+
+#include "rm/linkbudget.hpp"
+
+#include "rm/client.hpp"
+
+#include <chrono>
+#include <cmath>
+
+
+static int64_t getTime() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+}
+
+
+/**
+ * @brief Sets the link capacity from the baud rate
+ * 
+ * Each byte takes 10 bits on the line with a start and a stop bit.
+ * 
+ * @param baud Baud rate
+ */
+void rmLinkBudget::setBaudrate(uint32_t baud) {
+    m.lock();
+    capacity = baud / 10;
+    m.unlock();
+}
+
+/**
+ * @brief Gets the link capacity
+ * 
+ * @return Capacity in bytes per second
+ */
+uint32_t rmLinkBudget::getCapacity() const { return capacity; }
+
+/**
+ * @brief Sets the maximum utilisation allowed
+ * 
+ * @param c Fraction of the capacity between 0 and 1
+ */
+void rmLinkBudget::setCeiling(float c) {
+    if(c > 1.0f)
+        c = 1.0f;
+    m.lock();
+    ceiling = c;
+    m.unlock();
+}
+
+/**
+ * @brief Gets the maximum utilisation allowed
+ * 
+ * @return Fraction of the capacity
+ */
+float rmLinkBudget::getCeiling() const { return ceiling; }
+
+/**
+ * @brief Enables or disables changing the rates of the client device
+ * 
+ * The traffic is measured either way.
+ * 
+ * @param en True for enable and false for otherwise
+ */
+void rmLinkBudget::setEnabled(bool en) { enabled = en; }
+
+/**
+ * @brief Checks if the rates are managed
+ * 
+ * @return True if the rates of the client device are changed
+ */
+bool rmLinkBudget::isEnabled() const { return enabled; }
+
+/**
+ * @brief Sets the interval between two measurements
+ * 
+ * @param ms Interval in milliseconds
+ */
+void rmLinkBudget::setInterval(long ms) { interval = ms; }
+
+/**
+ * @brief Sets the rate a sync table should be kept at
+ * 
+ * @param i Sync table ID
+ * @param hz Number of updates per second
+ */
+void rmLinkBudget::setTargetRate(uint8_t i, uint16_t hz) {
+    m.lock();
+    stats[i].rate = hz;
+    stats[i].targetRate = hz;
+    m.unlock();
+}
+
+/**
+ * @brief Counts the bytes of a message received
+ * 
+ * @param i Sync table ID. RM_LINK_OTHER for the other messages.
+ * @param n Number of bytes
+ */
+void rmLinkBudget::onReceived(int i, size_t n) {
+    m.lock();
+    if(i >= 0 && i < RM_LINK_TABLE_COUNT) {
+        bytes[i] += n;
+        updates[i]++;
+    }
+    else {
+        otherBytes += n;
+    }
+    m.unlock();
+}
+
+
+uint16_t rmLinkBudget::adjustRate(uint8_t i, float scale) {
+    rmLinkStats* s = &stats[i];
+    if(s->rate == 0 && s->updatesPerSecond < 0.5f)
+        return 0;
+    
+    // The rate is learned from the traffic if the station has never set it
+    uint16_t base = s->rate;
+    if(base == 0)
+        base = (uint16_t) std::lround(s->updatesPerSecond);
+    if(s->targetRate == 0)
+        s->targetRate = base;
+    
+    long hz = std::lround(base * scale);
+    if(hz < 1)
+        hz = 1;
+    if(hz > s->targetRate)
+        hz = s->targetRate;
+    if(hz == base) {
+        s->rate = base;
+        return 0;
+    }
+    s->rate = (uint16_t) hz;
+    return s->rate;
+}
+
+/**
+ * @brief Counts errors on the link
+ * 
+ * @param kind One of the RM_LINK_* error codes
+ * @param n Number of errors
+ */
+void rmLinkBudget::onError(uint8_t kind, size_t n) {
+    if(kind >= RM_LINK_ERROR_COUNT)
+        return;
+    m.lock();
+    errors[kind].count += n;
+    windowErrors[kind] += n;
+    m.unlock();
+}
+
+
+void rmLinkBudget::countDriverErrors(rmClient* cli) {
+    serial::ErrorCounts c;
+    if(!cli->getSerialErrorCounts(&c))
+        return;
+    const uint32_t counts[3] = {
+        c.frame, c.parity, c.overrun + c.buf_overrun
+    };
+    const uint8_t kinds[3] = {
+        RM_LINK_FRAMING, RM_LINK_PARITY, RM_LINK_OVERRUN
+    };
+    
+    // The driver counts from when the port was set up, so the first reading
+    // is only the base. The counts start over on a device plugged in again.
+    m.lock();
+    for(int i=0; i<3; i++) {
+        if(driverCounted) {
+            uint32_t n = counts[i];
+            if(n >= driverCounts[i])
+                n -= driverCounts[i];
+            errors[kinds[i]].count += n;
+            windowErrors[kinds[i]] += n;
+        }
+        driverCounts[i] = counts[i];
+    }
+    driverCounted = true;
+    m.unlock();
+}
+
+/**
+ * @brief Updates the measurements and the rates of the client device
+ * 
+ * Does nothing until the measurement interval has passed.
+ * 
+ * @param cli The client device
+ */
+void rmLinkBudget::update(rmClient* cli) {
+    int64_t now = getTime();
+    m.lock();
+    if(windowStart == 0)
+        windowStart = now;
+    float elapsed = (now - windowStart) / 1000.0f;
+    if(now - windowStart < interval) {
+        m.unlock();
+        return;
+    }
+    m.unlock();
+    countDriverErrors(cli);
+    m.lock();
+    
+    float syncBytesPerSecond = 0;
+    for(int i=0; i<RM_LINK_TABLE_COUNT; i++) {
+        stats[i].bytesPerSecond = bytes[i] / elapsed;
+        stats[i].updatesPerSecond = updates[i] / elapsed;
+        syncBytesPerSecond += stats[i].bytesPerSecond;
+        bytes[i] = 0;
+        updates[i] = 0;
+    }
+    otherBytesPerSecond = otherBytes / elapsed;
+    otherBytes = 0;
+    for(uint8_t i=0; i<RM_LINK_ERROR_COUNT; i++) {
+        errors[i].perSecond = windowErrors[i] / elapsed;
+        windowErrors[i] = 0;
+    }
+    windowStart = now;
+    
+    float total = syncBytesPerSecond + otherBytesPerSecond;
+    utilisation = (capacity > 0) ? total / capacity : 0;
+    if(!enabled || capacity == 0 || syncBytesPerSecond == 0) {
+        m.unlock();
+        return;
+    }
+    
+    // Scales the sync traffic to fit in what the other messages leave. The
+    // rates are raised back only well below the ceiling to avoid oscillating.
+    float budget = ceiling * capacity - otherBytesPerSecond;
+    float scale = 1.0f;
+    if(utilisation > ceiling)
+        scale = budget / syncBytesPerSecond;
+    else if(utilisation < 0.75f * ceiling)
+        scale = std::fmin(0.9f * budget / syncBytesPerSecond, 2.0f);
+    
+    uint16_t rates[RM_LINK_TABLE_COUNT] = {0};
+    if(scale != 1.0f) {
+        for(int i=0; i<RM_LINK_TABLE_COUNT; i++)
+            rates[i] = adjustRate(i, scale);
+    }
+    m.unlock();
+    
+    for(int i=0; i<RM_LINK_TABLE_COUNT; i++) {
+        if(rates[i] != 0)
+            cli->sendCommand("rate %d %d", i, rates[i]);
+    }
+}
+
+/**
+ * @brief Clears the measurements, the rates and the error counts
+ */
+void rmLinkBudget::reset() {
+    m.lock();
+    windowStart = 0;
+    for(uint8_t i=0; i<RM_LINK_ERROR_COUNT; i++) {
+        errors[i] = rmLinkErrorStats();
+        windowErrors[i] = 0;
+    }
+    driverCounted = false;
+    for(int i=0; i<RM_LINK_TABLE_COUNT; i++) {
+        bytes[i] = 0;
+        updates[i] = 0;
+        stats[i] = rmLinkStats();
+    }
+    otherBytes = 0;
+    otherBytesPerSecond = 0;
+    utilisation = 0;
+    m.unlock();
+}
+
+/**
+ * @brief Gets the traffic of a sync table
+ * 
+ * @param i Sync table ID
+ * 
+ * @return The measurements of the last interval
+ */
+rmLinkStats rmLinkBudget::getStats(uint8_t i) const {
+    rmLinkStats s;
+    m.lock();
+    s = stats[i];
+    m.unlock();
+    return s;
+}
+
+/**
+ * @brief Gets the traffic other than the sync tables
+ * 
+ * @return Bytes received per second
+ */
+float rmLinkBudget::getOtherBytesPerSecond() const {
+    return otherBytesPerSecond;
+}
+
+/**
+ * @brief Gets the link utilisation
+ * 
+ * @return Fraction of the capacity used in the last interval. 0 if the
+ *         capacity is unknown.
+ */
+float rmLinkBudget::getUtilisation() const { return utilisation; }
+
+/**
+ * @brief Gets the errors of a kind on the link
+ * 
+ * The errors of the driver are read from the serial port at every interval,
+ * where the driver counts them.
+ * 
+ * @param kind One of the RM_LINK_* error codes
+ * 
+ * @return The count and the rate of the last interval
+ */
+rmLinkErrorStats rmLinkBudget::getErrorStats(uint8_t kind) const {
+    rmLinkErrorStats e;
+    if(kind >= RM_LINK_ERROR_COUNT)
+        return e;
+    m.lock();
+    e = errors[kind];
+    m.unlock();
+    return e;
+}
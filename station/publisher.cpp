@@ -0,0 +1,423 @@
+/**
+ * @file publisher.cpp
+ * @brief Shares the decoded traffic of a client with local processes
+ * 
+ * The attribute changes and the echoed messages of the client device are
+ * served to the local subscribers over a Unix domain socket.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_EXPORT
+#define RM_NO_WX
+
+
+#include "rm/publisher.hpp"
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+
+// A line break in a message would end the line early
+static void appendEscaped(std::string& line, const char* str) {
+    for(; *str != '\0'; str++) {
+        if(*str == '\\')
+            line += "\\\\";
+        else if(*str == '\n')
+            line += "\\n";
+        else if(*str == '\r')
+            line += "\\r";
+        else
+            line += *str;
+    }
+}
+
+
+struct rmSubscriber {
+    int fd = -1;
+    std::string out;
+    size_t outPos = 0;
+    std::string in;
+    uint64_t valueSent = 0;
+    uint64_t messageSent = 0;
+};
+
+
+/**
+ * @brief Constructs a publisher
+ * 
+ * @param cli The client whose traffic is published
+ */
+rmPublisher::rmPublisher(rmClient* cli) { client = cli; }
+
+/**
+ * @brief Destructor
+ * 
+ * Closes the socket.
+ */
+rmPublisher::~rmPublisher() { close(); }
+
+
+#ifndef _WIN32
+
+static void setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+
+/**
+ * @brief Listens for the subscribers
+ * 
+ * An existing file at the path is replaced. Only the user running the
+ * station may connect to the socket.
+ * 
+ * @param socketPath Path of the Unix domain socket
+ * 
+ * @return True on success. Always false on Windows.
+ */
+bool rmPublisher::open(const char* socketPath) {
+    close();
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(strlen(socketPath) >= sizeof(addr.sun_path))
+        return false;
+    strcpy(addr.sun_path, socketPath);
+    
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0)
+        return false;
+    unlink(socketPath);
+    if(bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 ||
+       chmod(socketPath, 0600) != 0 || listen(fd, 16) != 0 ||
+       pipe(wakeFds) != 0)
+    {
+        ::close(fd);
+        unlink(socketPath);
+        return false;
+    }
+    setNonBlocking(fd);
+    setNonBlocking(wakeFds[0]);
+    setNonBlocking(wakeFds[1]);
+    
+    path = socketPath;
+    listenFd = fd;
+    running = true;
+    thread = std::thread(&rmPublisher::run, this);
+    return true;
+}
+
+/**
+ * @brief Disconnects the subscribers and removes the socket
+ */
+void rmPublisher::close() {
+    if(!running)
+        return;
+    m.lock();
+    running = false;
+    m.unlock();
+    wake();
+    if(thread.joinable())
+        thread.join();
+    
+    m.lock();
+    for(rmSubscriber* sub : subscribers) {
+        ::close(sub->fd);
+        delete sub;
+    }
+    subscribers.clear();
+    m.unlock();
+    ::close(listenFd);
+    ::close(wakeFds[0]);
+    ::close(wakeFds[1]);
+    listenFd = -1;
+    wakeFds[0] = -1;
+    wakeFds[1] = -1;
+    unlink(path.c_str());
+}
+
+
+void rmPublisher::wake() {
+    if(wakeFds[1] >= 0) {
+        char c = 0;
+        ssize_t n = write(wakeFds[1], &c, 1);
+        (void) n;
+    }
+}
+
+
+void rmPublisher::acceptSubscriber() {
+    int fd = accept(listenFd, nullptr, nullptr);
+    if(fd < 0)
+        return;
+    setNonBlocking(fd);
+    rmSubscriber* sub = new rmSubscriber();
+    sub->fd = fd;
+    sub->out = "$hello 1\n";
+    
+    // A new subscriber gets every value and the messages still kept
+    m.lock();
+    sub->messageSent = messageCount - messages.size();
+    subscribers.push_back(sub);
+    m.unlock();
+}
+
+
+/*
+ * Queues what the subscriber has not seen yet. Nothing is queued while the
+ * subscriber is still behind by RM_PUBLISH_BACKLOG bytes, and each attribute
+ * is sent once with its latest value however many times it has changed.
+ */
+void rmPublisher::fill(rmSubscriber* sub) {
+    if(sub->outPos == sub->out.size()) {
+        sub->out.clear();
+        sub->outPos = 0;
+    }
+    else if(sub->outPos > RM_PUBLISH_BACKLOG) {
+        sub->out.erase(0, sub->outPos);
+        sub->outPos = 0;
+    }
+    if(sub->out.size() - sub->outPos >= RM_PUBLISH_BACKLOG)
+        return;
+    
+    std::lock_guard<std::mutex> lock(m);
+    uint64_t oldest = messageCount - messages.size();
+    if(sub->messageSent < oldest) {
+        sub->out += "$dropped ";
+        sub->out += std::to_string(oldest - sub->messageSent);
+        sub->out += '\n';
+        sub->messageSent = oldest;
+    }
+    while(sub->messageSent < messageCount &&
+          sub->out.size() - sub->outPos < RM_PUBLISH_BACKLOG)
+    {
+        sub->out += messages[sub->messageSent - oldest];
+        sub->messageSent++;
+    }
+    
+    if(sub->valueSent < sequence) {
+        for(const rmPublishedValue& v : values) {
+            if(v.sequence <= sub->valueSent)
+                continue;
+            sub->out += "$set ";
+            sub->out += v.name;
+            sub->out += ' ';
+            sub->out += v.value;
+            sub->out += '\n';
+        }
+        sub->valueSent = sequence;
+    }
+}
+
+
+bool rmPublisher::transmit(rmSubscriber* sub) {
+    while(sub->outPos < sub->out.size()) {
+        ssize_t n = send(sub->fd, &sub->out[sub->outPos],
+                         sub->out.size() - sub->outPos, MSG_NOSIGNAL);
+        if(n > 0)
+            sub->outPos += n;
+        else if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return true;
+        else if(n < 0 && errno == EINTR)
+            continue;
+        else
+            return false;
+    }
+    return true;
+}
+
+
+bool rmPublisher::receive(rmSubscriber* sub) {
+    char buf[256];
+    ssize_t n = recv(sub->fd, buf, sizeof(buf), 0);
+    if(n == 0)
+        return false;
+    if(n < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    
+    sub->in.append(buf, n);
+    size_t start = 0;
+    size_t end;
+    while((end = sub->in.find('\n', start)) != std::string::npos) {
+        std::string line = sub->in.substr(start, end - start);
+        start = end + 1;
+        if(!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if(!line.empty() && line[0] == '$')
+            line.erase(0, 1);
+        if(!line.empty() && line.size() < 250)
+            client->sendCommand("%s", line.c_str());
+    }
+    sub->in.erase(0, start);
+    if(sub->in.size() > 1024)
+        sub->in.clear();
+    return true;
+}
+
+
+void rmPublisher::run() {
+    std::vector<struct pollfd> fds;
+    while(true) {
+        m.lock();
+        bool r = running;
+        m.unlock();
+        if(!r)
+            break;
+        
+        fds.resize(2 + subscribers.size());
+        fds[0] = { wakeFds[0], POLLIN, 0 };
+        fds[1] = { listenFd, POLLIN, 0 };
+        for(size_t i=0; i<subscribers.size(); i++) {
+            rmSubscriber* sub = subscribers[i];
+            short events = POLLIN;
+            if(sub->outPos < sub->out.size())
+                events |= POLLOUT;
+            fds[2 + i] = { sub->fd, events, 0 };
+        }
+        if(poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR)
+            break;
+        
+        if(fds[0].revents & POLLIN) {
+            char buf[64];
+            while(read(wakeFds[0], buf, sizeof(buf)) > 0);
+            m.lock();
+            wakePending = false;
+            m.unlock();
+        }
+        
+        // The subscribers accepted now are not in the poll list yet
+        size_t count = subscribers.size();
+        if(fds[1].revents & POLLIN)
+            acceptSubscriber();
+        
+        for(size_t i=count; i-->0;) {
+            rmSubscriber* sub = subscribers[i];
+            bool ok = true;
+            if(fds[2 + i].revents & (POLLIN | POLLHUP | POLLERR))
+                ok = receive(sub);
+            // Filled again once the backlog has drained
+            for(int j=0; j<2 && ok; j++) {
+                fill(sub);
+                ok = transmit(sub);
+                if(sub->outPos < sub->out.size())
+                    break;
+            }
+            if(!ok) {
+                ::close(sub->fd);
+                m.lock();
+                subscribers.erase(subscribers.begin() + i);
+                m.unlock();
+                delete sub;
+            }
+        }
+        for(size_t i=count; i<subscribers.size(); i++) {
+            fill(subscribers[i]);
+            transmit(subscribers[i]);
+        }
+    }
+}
+
+#else
+
+bool rmPublisher::open(const char* socketPath) { return false; }
+
+void rmPublisher::close() {}
+
+void rmPublisher::wake() {}
+
+void rmPublisher::acceptSubscriber() {}
+
+void rmPublisher::fill(rmSubscriber* sub) {}
+
+bool rmPublisher::transmit(rmSubscriber* sub) { return false; }
+
+bool rmPublisher::receive(rmSubscriber* sub) { return false; }
+
+void rmPublisher::run() {}
+
+#endif
+
+/**
+ * @brief Gets the number of subscribers connected
+ * 
+ * @return Number of subscribers
+ */
+size_t rmPublisher::getSubscriberCount() const {
+    std::lock_guard<std::mutex> lock(m);
+    return subscribers.size();
+}
+
+/**
+ * @brief Publishes the new value of an attribute
+ * 
+ * A value the same as the one published before is not sent again.
+ * 
+ * @param attr The attribute updated
+ */
+void rmPublisher::onAttributeUpdate(rmAttribute* attr) {
+    std::string value;
+    appendEscaped(value, attr->getValueString().c_str());
+    m.lock();
+    size_t id;
+    auto it = ids.find(attr);
+    if(it == ids.end()) {
+        id = values.size();
+        ids[attr] = id;
+        values.emplace_back();
+        values[id].name = attr->getName();
+    }
+    else {
+        id = it->second;
+        if(values[id].sequence > 0 && values[id].value == value) {
+            m.unlock();
+            return;
+        }
+    }
+    values[id].value = value;
+    values[id].sequence = ++sequence;
+    bool w = !wakePending;
+    wakePending = true;
+    m.unlock();
+    if(w)
+        wake();
+}
+
+/**
+ * @brief Publishes a message echoed by the client device
+ * 
+ * @param msg The message
+ * @param status The status code
+ */
+void rmPublisher::echo(const char* msg, int status) {
+    std::string line = (status == 0) ? "$echo " :
+                       (status == 2) ? "$warn " : "$err ";
+    appendEscaped(line, msg);
+    line += '\n';
+    m.lock();
+    messages.push_back(line);
+    if(messages.size() > RM_PUBLISH_ECHO_COUNT)
+        messages.pop_front();
+    messageCount++;
+    bool w = !wakePending;
+    wakePending = true;
+    m.unlock();
+    if(w)
+        wake();
+}
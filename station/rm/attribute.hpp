@@ -60,6 +60,7 @@ union rmAttributeData {
 };
 
 
+class rmAttributeListener;
 class rmAttributeNotifier;
 
 
@@ -74,6 +75,7 @@ class rmAttributeNotifier;
 class RM_API rmAttribute {
   private:
     rmAttributeNotifier* notifier = nullptr;
+    rmAttributeListener* listener = nullptr;
     char name[12] = {0};
     rmAttributeData data;
     uint8_t cap = 0;
@@ -218,6 +220,16 @@ class RM_API rmAttribute {
      */
     rmAttributeDataType getType() const;
     
+    /**
+     * @brief Changes the data type of the value
+     * 
+     * The current value is converted to the new type and the boundary is
+     * removed.
+     * 
+     * @param t The new data type
+     */
+    void setType(rmAttributeDataType t);
+    
     /**
      * @brief Sets the boundary
      * 
@@ -255,6 +267,35 @@ class RM_API rmAttribute {
      * @return The associated widget. Returns null if it doesn't have.
      */
     rmAttributeNotifier* getNotifier() const;
+    
+    /**
+     * @brief Sets the listener that sees the changes of every attribute
+     * 
+     * @param l The listener
+     */
+    void setListener(rmAttributeListener* l);
+    
+    /**
+     * @brief Gets the listener of this attribute
+     * 
+     * @return The listener. Returns null if it doesn't have.
+     */
+    rmAttributeListener* getListener() const;
+    
+    /**
+     * @brief Tells the notifier and the listener that the value has changed
+     */
+    void notifyChange();
+    
+    /**
+     * @brief Tells the listener of a value received from the client device
+     * 
+     * The listener sees every value received, so the repeated values are
+     * recorded as well. The notifier is only told of a change.
+     * 
+     * @param changed True if the value differs from the one before
+     */
+    void notifyUpdate(bool changed);
 };
 
 
@@ -265,7 +306,7 @@ class RM_API rmAttribute {
 class RM_API rmAttributeNotifier {
   protected:
     rmAttribute* attribute = nullptr; ///< The attribute to track
-    
+  
   public:
     /**
      * @brief Default constructor
@@ -281,4 +322,29 @@ class RM_API rmAttributeNotifier {
     virtual void onAttributeChange();
 };
 
+
+/**
+ * @brief Class that sees the changes of all the attributes of a client
+ * 
+ * Unlike the notifier, which belongs to the single widget of an attribute,
+ * the listener is shared by all the attributes of the client. It is called
+ * once for each attribute as the attribute is listed and then on every value
+ * received, even one the same as before, from the thread that processes the
+ * connection.
+ */
+class RM_API rmAttributeListener {
+  public:
+    /**
+     * @brief Default constructor
+     */
+    rmAttributeListener() = default;
+    
+    /**
+     * @brief Triggers on attribute value update
+     * 
+     * @param attr The attribute updated
+     */
+    virtual void onAttributeUpdate(rmAttribute* attr);
+};
+
 #endif
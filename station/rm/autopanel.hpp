@@ -0,0 +1,139 @@
+/**
+ * @file autopanel.hpp
+ * @brief A panel generated from the attributes and calls of the client
+ * 
+ * Lists every attribute and call the client device has described with a
+ * widget suited to it. Only the rows in view are painted and their widgets
+ * are constructed the first time they are scrolled into view, so a device
+ * with hundreds of attributes gets its panel right away.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_AUTOPANEL_H__
+#define __RM_AUTOPANEL_H__ ///< Header guard
+
+#ifndef RM_WX_API
+#ifdef _WIN32
+#ifdef RM_WX_EXPORT
+#define RM_WX_API __declspec(dllexport) ///< API
+#else
+#define RM_WX_API __declspec(dllimport) ///< API
+#endif
+#else
+#define RM_WX_API ///< API
+#endif
+#endif
+
+
+#include "widget.hpp"
+
+#include <vector>
+
+#include <wx/timer.h>
+#include <wx/vscroll.h>
+
+
+/**
+ * @brief The kind of widget shown on a row of the automatic panel
+ */
+enum rmAutoPanelRowKind {
+    RM_AUTO_TEXT, ///< Name and value painted by the panel
+    RM_AUTO_SLIDER, ///< A slider for a bounded number
+    RM_AUTO_CHECKBOX, ///< A check box for a boolean
+    RM_AUTO_TEXTCTRL, ///< A text box for any other input
+    RM_AUTO_BUTTON ///< A button for a call
+};
+
+
+/**
+ * @brief A row of the automatic panel
+ */
+struct rmAutoPanelRow {
+    char name[12] = {0}; ///< Name of the attribute or the call
+    rmAttribute* attribute = nullptr; ///< The attribute, null for the calls
+    rmAutoPanelRowKind kind = RM_AUTO_TEXT; ///< The widget shown on the row
+    rmWidget* widget = nullptr; ///< The widget once constructed
+    wxWindow* window = nullptr; ///< The same widget as a window
+};
+
+
+/**
+ * @brief A panel generated from the attributes and calls of the client
+ * 
+ * Lists every attribute and call the client device has described with a
+ * widget suited to it. Only the rows in view are painted and their widgets are
+ * constructed the first time they are scrolled into view, so a device with
+ * hundreds of attributes gets its panel right away.
+ */
+class RM_WX_API rmAutoPanel: public wxVScrolledWindow {
+  private:
+    rmClient* client = nullptr;
+    std::vector<rmAutoPanelRow> rows;
+    size_t attrCount = 0;
+    size_t callCount = 0;
+    size_t layoutBegin = 0;
+    size_t layoutEnd = 0;
+    int rowHeight = 0;
+    int labelWidth = 0;
+    wxTimer refreshTimer;
+    long wx_id = 0;
+    
+    long getWxID();
+    void createWidget(rmAutoPanelRow* row);
+    void layoutWidgets();
+  
+  public:
+    /**
+     * @brief Constructs an automatic panel
+     * 
+     * @param parent The parent window
+     * @param cli The client
+     */
+    rmAutoPanel(wxWindow* parent, rmClient* cli);
+    
+    /**
+     * @brief Lists the attributes and calls of the client again
+     * 
+     * This is called by itself when the client device describes new
+     * attributes or calls. The widgets already constructed are kept and the
+     * ones of the rows gone are destroyed.
+     */
+    void rebuild();
+    
+    /**
+     * @brief Gets the height of a row
+     * 
+     * @param row Index of the row
+     * 
+     * @return The row height in pixels
+     */
+    wxCoord OnGetRowHeight(size_t row) const override;
+    
+    /**
+     * @brief Paints the rows in view
+     * 
+     * @param evt The event object
+     */
+    virtual void onPaint(wxPaintEvent& evt);
+    
+    /**
+     * @brief Fits the widgets to the new width
+     * 
+     * @param evt The event object
+     */
+    virtual void onSize(wxSizeEvent& evt);
+    
+    /**
+     * @brief Repaints the values in view and picks up new attributes
+     * 
+     * @param evt Timer event object
+     */
+    virtual void onTimer(wxTimerEvent& evt);
+};
+
+#endif
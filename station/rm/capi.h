@@ -0,0 +1,204 @@
+/**
+ * @file capi.h
+ * @brief C interface of the client for scripts and other languages
+ * 
+ * A stable C ABI over rmClient. Scripts connect to a client device, watch
+ * the attributes they want to capture and read the recorded samples in
+ * batches straight into their own arrays, so no object is created per
+ * sample. The Python bindings in python/rmonitor.py are built on it.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_CAPI_H__
+#define __RM_CAPI_H__ ///< Header guard
+
+#ifndef RM_API
+#ifdef _WIN32
+#ifdef RM_EXPORT
+#define RM_API __declspec(dllexport) ///< API
+#else
+#define RM_API __declspec(dllimport) ///< API
+#endif
+#else
+#define RM_API ///< API
+#endif
+#endif
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define RM_CAPI_VERSION 1 ///< Version of the C interface
+
+#ifndef RM_CAPI_ECHO_COUNT
+#define RM_CAPI_ECHO_COUNT 1024 ///< Echoed messages kept until read
+#endif
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Handle of a client created through the C interface
+ */
+typedef struct _rmClientHandle rmClientHandle;
+
+
+/**
+ * @brief Gets the version of the C interface
+ * 
+ * @return RM_CAPI_VERSION of the library
+ */
+RM_API int rmGetVersion(void);
+
+/**
+ * @brief Creates a client
+ * 
+ * @return The handle. Null on failure.
+ */
+RM_API rmClientHandle* rmClientCreate(void);
+
+/**
+ * @brief Disconnects and destroys a client
+ * 
+ * @param h The handle
+ */
+RM_API void rmClientDestroy(rmClientHandle* h);
+
+/**
+ * @brief Connects to a client device on a serial port
+ * 
+ * @param h The handle
+ * @param port Name of the port such as "/dev/ttyACM0" or "COM3"
+ * @param baud Baudrate
+ * 
+ * @return 1 if the port is opened. 0 otherwise.
+ */
+RM_API int rmClientConnect(rmClientHandle* h, const char* port, uint32_t baud);
+
+/**
+ * @brief Disconnects from the client device
+ * 
+ * @param h The handle
+ */
+RM_API void rmClientDisconnect(rmClientHandle* h);
+
+/**
+ * @brief Checks if the client device is connected
+ * 
+ * @param h The handle
+ * 
+ * @return 1 if connected. 0 otherwise.
+ */
+RM_API int rmClientIsConnected(rmClientHandle* h);
+
+/**
+ * @brief Sends a command to the client device
+ * 
+ * @param h The handle
+ * @param cmd The command without the leading '$' and the line end
+ * 
+ * @return 1 if sent. 0 if not connected or too long.
+ */
+RM_API int rmClientSendCommand(rmClientHandle* h, const char* cmd);
+
+/**
+ * @brief Starts recording the values of an attribute
+ * 
+ * The attribute does not need to exist yet. Its values are recorded as soon
+ * as the device lists it. Once the buffer is full, the oldest samples are
+ * dropped and counted.
+ * 
+ * @param h The handle
+ * @param key Name of the attribute
+ * @param capacity Number of samples buffered until read
+ * 
+ * @return ID of the watch for rmClientRead. -1 on failure.
+ */
+RM_API int rmClientWatch(rmClientHandle* h, const char* key, size_t capacity);
+
+/**
+ * @brief Gets the number of samples waiting to be read
+ * 
+ * @param h The handle
+ * @param id ID of the watch
+ * 
+ * @return Number of samples
+ */
+RM_API size_t rmClientAvailable(rmClientHandle* h, int id);
+
+/**
+ * @brief Takes the oldest recorded samples
+ * 
+ * A string value is recorded as NaN.
+ * 
+ * @param h The handle
+ * @param id ID of the watch
+ * @param times Receives the times in seconds since the epoch. May be null.
+ * @param values Receives the values
+ * @param max Size of the arrays
+ * 
+ * @return Number of samples written
+ */
+RM_API size_t rmClientRead(rmClientHandle* h, int id, double* times,
+                           double* values, size_t max);
+
+/**
+ * @brief Gets the number of samples dropped because the buffer was full
+ * 
+ * @param h The handle
+ * @param id ID of the watch
+ * 
+ * @return Total number of samples dropped
+ */
+RM_API uint64_t rmClientDropped(rmClientHandle* h, int id);
+
+/**
+ * @brief Gets the current value of an attribute as a number
+ * 
+ * @param h The handle
+ * @param key Name of the attribute
+ * @param value Receives the value
+ * 
+ * @return 1 on success. 0 if there is no such attribute or it is a string.
+ */
+RM_API int rmClientGetValue(rmClientHandle* h, const char* key, double* value);
+
+/**
+ * @brief Gets the current value of an attribute as text
+ * 
+ * @param h The handle
+ * @param key Name of the attribute
+ * @param buf Receives the text with the null
+ * @param len Size of the buffer
+ * 
+ * @return Length of the whole text. -1 if there is no such attribute.
+ */
+RM_API int rmClientGetString(rmClientHandle* h, const char* key, char* buf,
+                             size_t len);
+
+/**
+ * @brief Takes the oldest message echoed by the client device
+ * 
+ * @param h The handle
+ * @param buf Receives the message with the null
+ * @param len Size of the buffer
+ * @param status Receives the status code. May be null.
+ * 
+ * @return 1 if a message is taken. 0 if there is none.
+ */
+RM_API int rmClientReadEcho(rmClientHandle* h, char* buf, size_t len,
+                            int* status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
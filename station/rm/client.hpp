@@ -33,18 +33,124 @@ class rmClient;
 
 #include "attribute.hpp"
 #include "call.hpp"
+#include "compress.hpp"
 #include "echo.hpp"
+#include "echostore.hpp"
 #include "encryption.hpp"
+#include "hotplug.hpp"
+#include "linkbudget.hpp"
 #include "request.hpp"
 #include "serial.hpp"
+#include "session.hpp"
+#include "sharedmemory.hpp"
 #include "sync.hpp"
 #include "timerbase.hpp"
 #include "widget.hpp"
 
 #include <cstdint>
 #include <cstdio>
+#include <string>
 #include <thread>
 #include <mutex>
+#include <vector>
+
+
+#define RM_DEVICE_BINARY 0x01 ///< The device can send binary frames
+#define RM_DEVICE_DELTA  0x02 ///< The device can send only the changed values
+#define RM_DEVICE_RATE   0x04 ///< The device publishes sync tables at rates
+#define RM_DEVICE_SPLIT  0x08 ///< The device splits large sync tables
+#define RM_DEVICE_COMPRESS 0x10 ///< The device can compress its lines
+
+#ifndef RM_HANDSHAKE_TIMEOUT
+#define RM_HANDSHAKE_TIMEOUT 500 ///< Time for the device to answer connect
+#endif
+
+#ifndef RM_SYNC_LIST_TIMEOUT
+#define RM_SYNC_LIST_TIMEOUT 3000 ///< Time before a sync list is asked again
+#endif
+
+#define RM_CRYPT_LINE_SIZE 168 ///< Longest message sealed in one command-line
+
+#ifndef RM_RECONNECT_MIN_DELAY
+#define RM_RECONNECT_MIN_DELAY 10 ///< First wait before reconnecting in ms
+#endif
+
+#ifndef RM_RECONNECT_MAX_DELAY
+#define RM_RECONNECT_MAX_DELAY 1000 ///< Longest wait between the attempts
+#endif
+
+#ifndef RM_PENDING_WRITE_COUNT
+#define RM_PENDING_WRITE_COUNT 64 ///< Messages kept while the link is not up
+#endif
+
+
+/**
+ * @brief What the client device reports about itself on connection
+ */
+struct rmDeviceInfo {
+    uint8_t version = 0; ///< Protocol version, 0 without the handshake
+    uint8_t capabilities = 0; ///< Combination of the RM_DEVICE_* flags
+    uint16_t rxBufferSize = 0; ///< Size of the device's receive buffer
+    uint16_t txBufferSize = 0; ///< Size of the device's transmit buffer
+    uint16_t maxRate = 0; ///< Highest sync rate in updates per second
+    bool ready = false; ///< Whether the whole description has arrived
+};
+
+
+/**
+ * @brief Passes the attribute changes of a client on
+ * 
+ * Set as the listener of every attribute of the client. Writes the new value
+ * into the shared memory of the client and calls the listener set by the
+ * user.
+ */
+class RM_API rmClientListener: public rmAttributeListener {
+  private:
+    rmClient* client;
+  
+  public:
+    /**
+     * @brief Constructs the listener of a client
+     * 
+     * @param cli The client
+     */
+    rmClientListener(rmClient* cli);
+    
+    /**
+     * @brief Passes the change on
+     * 
+     * @param attr The attribute changed
+     */
+    void onAttributeUpdate(rmAttribute* attr) override;
+};
+
+
+/**
+ * @brief Watches for the device of a client to come back
+ * 
+ * Added to rmHotplug while the client reconnects, so the client tries again
+ * as soon as a port with the same hardware ID appears instead of waiting out
+ * the delay.
+ */
+class RM_API rmClientReconnector: public rmHotplugListener {
+  private:
+    rmClient* client;
+  
+  public:
+    /**
+     * @brief Constructs the reconnector of a client
+     * 
+     * @param cli The client
+     */
+    rmClientReconnector(rmClient* cli);
+    
+    /**
+     * @brief Lets the client try at once if the port is its device
+     * 
+     * @param info The new port
+     */
+    void onPortAdded(const rmSerialPortInfo& info) override;
+};
 
 
 /**
@@ -58,7 +164,10 @@ class RM_API rmClient {
     char name[32] = "Unknown Device";
     uint8_t key[RM_PUBLIC_KEY_SIZE];
     bool useEncryption = false;
-    rmSync syncs[10];
+    rmCryptChannel cryptChannel;
+    uint8_t cryptNonce[RM_CRYPT_NONCE_SIZE];
+    bool cryptWarned = false;
+    rmSync* syncs[256] = {};
     rmAttribute** attributes = nullptr;
     size_t attrCount = 0;
     rmCall** calls = nullptr;
@@ -67,20 +176,66 @@ class RM_API rmClient {
     size_t widgetCount = 0;
     rmSerialPort mySerial;
     rmEcho *myEcho = nullptr;
+    rmEchoStore* echoStore = nullptr;
+    rmAttributeListener* attributeListener = nullptr;
+    rmSharedMemory* sharedMemory = nullptr;
+    rmSessionRecorder* sessionRecorder = nullptr;
+    rmClientListener clientListener = rmClientListener(this);
+    rmClientReconnector reconnector = rmClientReconnector(this);
+    bool autoReconnect = false;
+    bool reconnecting = false;
+    rmSerialPortInfo identity;
+    uint32_t baudrate = 0;
+    int64_t reconnectTime = 0;
+    int64_t reconnectDelay = 0;
+    std::vector<std::string> pendingWrites;
     char rx_cmd[256];
     char* rx_tokens[8];
     uint8_t rx_i = 0;
     uint8_t rx_tokenCount = 0;
     uint8_t rx_flag = 0b00;
+    uint8_t rx_frame[260];
+    uint16_t rx_frameLen = 0;
+    size_t rx_count = 0;
+    size_t rx_discarded = 0;
+    uint8_t rx_cryptFrame[260];
+    uint16_t rx_cryptLen = 0;
+    bool rx_cryptStarted = false;
+    bool rx_trusted = false;
+    rmDecompressor decompressor;
+    bool rx_compressed = false;
+    rmLinkBudget linkBudget;
+    rmDeviceInfo deviceInfo;
+    int64_t handshakeStart = 0;
+    int64_t syncListRequested[256] = {};
+    std::vector<std::string> deviceCalls;
     rmTimerBase* timer = nullptr;
     rmRequest request;
+    mutable std::mutex m; // Guards the connection
+    mutable std::mutex syncMutex; // Guards the attribute lists of the syncs
+    std::mutex attrMutex; // Guards the attributes, calls and widgets
+    std::mutex sinkMutex; // Guards the listener, memory and recorder
     
     int binarySearch1(int low, int high, const char* key) const;
     int binarySearch2(int low, int high, const char* key) const;
     bool appendAttribute(rmAttribute* attr);
+    rmAttribute* adoptAttribute(const char* key, rmAttributeDataType t);
     void startConnection();
+    void startHandshake();
+    void writeSealed(const char* msg);
     char read();
-    
+    size_t read(uint8_t* buf, size_t len);
+    void processByte(char c);
+    void processText(char c);
+    void processFrame();
+    void processCryptByte(char c);
+    rmSync* createSync(uint8_t i);
+    rmSync* getSync(uint8_t i);
+    void recordSync(const rmSync* sync);
+    
+    friend class rmClientListener;
+    friend class rmClientReconnector;
+  
   public:
     /**
      * @brief Default constructor
@@ -127,14 +282,73 @@ class RM_API rmClient {
      */
     const char* getDeviceName() const;
     
+    /**
+     * @brief Sets the name of the client device
+     * 
+     * @param str The device name
+     */
+    void setDeviceName(const char* str);
+    
+    /**
+     * @brief Gets what the client device reported on connection
+     * 
+     * @return The device information. The version is 0 if the device has not
+     *         answered the handshake.
+     */
+    const rmDeviceInfo* getDeviceInfo() const;
+    
+    /**
+     * @brief Sets what the client device reported on connection
+     * 
+     * @param info The device information
+     */
+    void setDeviceInfo(const rmDeviceInfo& info);
+    
+    /**
+     * @brief Adds a call to the list of calls the client device provides
+     * 
+     * @param key Name of the call
+     */
+    void appendDeviceCall(const char* key);
+    
+    /**
+     * @brief Checks if the client device provides a call
+     * 
+     * @param key Name of the call
+     * 
+     * @return True if the device listed the call on connection
+     */
+    bool hasDeviceCall(const char* key) const;
+    
+    /**
+     * @brief Gets the number of calls the client device provides
+     * 
+     * @return The call count. 0 if the device has not answered the
+     *         handshake.
+     */
+    size_t getDeviceCallCount() const;
+    
+    /**
+     * @brief Gets the name of a call the client device provides
+     * 
+     * The calls are sorted by name.
+     * 
+     * @param i Index of the call
+     * 
+     * @return The call name. Empty if the index is out of range.
+     */
+    std::string getDeviceCall(size_t i) const;
+    
     /**
      * @brief Creates an attribute in the map structure
      * 
      * @param key Unique name of the attribute with maximum 11 characters
      * @param t Data type of the value stored
      * 
-     * @return The newly created attribute. Null if the attribute with the same
-     *         name already exists or the creation is invalid.
+     * @return The newly created attribute. An attribute created by a sync
+     *         table and not used by any widget yet is returned with the new
+     *         type. Null if the attribute with the same name already exists
+     *         or the creation is invalid.
      */
     rmAttribute* createAttribute(const char* key, rmAttributeDataType t);
     
@@ -147,8 +361,10 @@ class RM_API rmClient {
      *              be of the same type as t.
      * @param upper Upper bound value
      * 
-     * @return The newly created attribute. Null if the attribute with the same
-     *         name already exists or the creation is invalid.
+     * @return The newly created attribute. An attribute created by a sync
+     *         table and not used by any widget yet is returned with the new
+     *         type. Null if the attribute with the same name already exists
+     *         or the creation is invalid.
      */
     rmAttribute* createAttribute(const char* key, rmAttributeDataType t,
                                  float lower, float upper);
@@ -162,6 +378,24 @@ class RM_API rmClient {
      */
     rmAttribute* getAttribute(const char* key);
     
+    /**
+     * @brief Gets the number of attributes in the map
+     * 
+     * @return The attribute count
+     */
+    size_t getAttributeCount() const;
+    
+    /**
+     * @brief Gets an attribute by its position in the map
+     * 
+     * The attributes are sorted by name.
+     * 
+     * @param i Index of the attribute
+     * 
+     * @return The attribute. Null if the index is out of range.
+     */
+    rmAttribute* getAttributeAt(size_t i);
+    
     /**
      * @brief Removes an attribute from the map by name
      * 
@@ -226,13 +460,27 @@ class RM_API rmClient {
      */
     void onIdle();
     
+    /**
+     * @brief Checks the connection and processes the incoming messages for a
+     *        limited time
+     * 
+     * The bytes are read and processed in chunks of 256 until there are no
+     * more or the time is up, so a burst is taken over several calls.
+     * 
+     * @param budget Time to process the messages in microseconds. Negative
+     *               for no limit.
+     * 
+     * @return Number of bytes processed
+     */
+    size_t onIdle(long budget);
+    
     /**
      * @brief Connects to a device via RS-232 serial
      * 
      * @param port The address of the serial port, which would be something
      *             like 'COM1' on Windows and '/dev/ttyACM0' on Linux.
      * @param baud Baudrate
-     * @param crypt Enable encryption
+     * @param crypt Encrypt the connection with the key opened by rmOpenKey()
      */
     void connectSerial(const char* port, uint32_t baud, bool crypt=false);
     
@@ -241,11 +489,59 @@ class RM_API rmClient {
      * 
      * @param portInfo The serial port information for the device
      * @param baud Baud rate
-     * @param crypt Enable encryption
+     * @param crypt Encrypt the connection with the key opened by rmOpenKey()
      */
     void connectSerial(rmSerialPortInfo portInfo, uint32_t baud,
                        bool crypt=false);
     
+    /**
+     * @brief Starts the session with the keys the device answered with
+     * 
+     * Called by the reply to "$crypt". The messages held back during the key
+     * exchange are sealed and sent along with "connect". A device whose key is
+     * not trusted with rmTrustDevice() is refused.
+     * 
+     * @param pub The device's public key of RM_PUBLIC_KEY_SIZE bytes
+     * @param nonce The device's nonce of RM_CRYPT_NONCE_SIZE bytes
+     * 
+     * @return False if the client is not waiting for the keys or the device
+     *         is not trusted
+     */
+    bool startEncryption(const uint8_t* pub, const uint8_t* nonce);
+    
+    /**
+     * @brief Checks if the connection is encrypted
+     * 
+     * @return True once the device has answered the key exchange
+     */
+    bool isEncrypted();
+    
+    /**
+     * @brief Decompresses the lines from now on
+     * 
+     * Called by the device's answer to "$compress 1".
+     * 
+     * @param window Window size the device compresses with
+     * 
+     * @return False if the window size is not supported, in which case the
+     *         device is asked to stop
+     */
+    bool startCompression(uint16_t window);
+    
+    /**
+     * @brief Takes the lines as they come from now on
+     * 
+     * Called by the device's answer to "$compress 0".
+     */
+    void stopCompression();
+    
+    /**
+     * @brief Checks if the device compresses its lines
+     * 
+     * @return True once the device has answered "$compress 1"
+     */
+    bool isCompressed();
+    
     /**
      * @brief Gets the connected serial port info
      * 
@@ -263,6 +559,39 @@ class RM_API rmClient {
      */
     void onDisconnected();
     
+    /**
+     * @brief Reconnects the client device when the port is lost
+     * 
+     * Once enabled, a client whose port closes without disconnect() being
+     * called keeps its sync tables and looks for the port with the same
+     * hardware ID, which may come back under another address. The attempts
+     * start after RM_RECONNECT_MIN_DELAY and back off up to
+     * RM_RECONNECT_MAX_DELAY, or are made at once when rmHotplug reports the
+     * device. The messages sent in the meantime are kept and sent after the
+     * handshake along with the sync rates last commanded.
+     * 
+     * @param en True for enable and false for otherwise
+     */
+    void setAutoReconnect(bool en);
+    
+    /**
+     * @brief Checks if the client is waiting for its device to come back
+     * 
+     * @return True while reconnecting
+     */
+    bool isReconnecting();
+    
+    /**
+     * @brief Tries to get back the connection lost
+     * 
+     * Called in place of onDisconnected() by the thread or the timer that
+     * processes the client when it finds the port closed.
+     * 
+     * @return True while the client reconnects, false if auto reconnection
+     *         is disabled and the client should be dropped
+     */
+    bool reconnect();
+    
     /**
      * @brief Checks if the client is connected
      * 
@@ -297,8 +626,102 @@ class RM_API rmClient {
      * 
      * @param i Sync table ID
      * @param value The string representing the array of attribute values
+     * @param start Index of the first value for the tables split into
+     *              several lines
      */
-    void syncUpdate(uint8_t i, const char* value);
+    void syncUpdate(uint8_t i, const char* value, size_t start=0);
+    
+    /**
+     * @brief Updates the attributes changed since the last sync update
+     * 
+     * @param i Sync table ID
+     * @param value The string of index and value pairs
+     */
+    void syncDeltaUpdate(uint8_t i, const char* value);
+    
+    /**
+     * @brief Changes the rate the client device publishes a sync table at
+     * 
+     * @param i Sync table ID
+     * @param hz Number of updates per second. 0 stops the automatic updates.
+     */
+    void setSyncRate(uint8_t i, uint16_t hz);
+    
+    /**
+     * @brief Updates the attribute list of a sync table
+     * 
+     * @param i Sync table ID
+     * @param list The response to the list request
+     * @param request True if the list was requested, false if the device sent
+     *                it on connection along with the rest of the list
+     */
+    void syncListUpdate(uint8_t i, const char* list, bool request=true);
+    
+    /**
+     * @brief Requests the attribute list of a sync table
+     * 
+     * @param i Sync table ID
+     * @param start Index of the first attribute to list
+     */
+    void requestSyncList(uint8_t i, size_t start=0);
+    
+    /**
+     * @brief Gets a sync table to read its values directly
+     * 
+     * The table is kept as long as the client, so the pointer stays valid,
+     * and so are the arrays read from it. Its list is emptied when the client
+     * disconnects.
+     * 
+     * @param i Sync table ID
+     * 
+     * @return The sync table. Null if the client device has not sent the
+     *         table yet.
+     */
+    const rmSync* getSyncTable(uint8_t i) const;
+    
+    /**
+     * @brief Gets the attributes of all the sync tables
+     * 
+     * The lists are read under the lock the client updates them with, so it
+     * can be called from another thread than the one processing the client.
+     * 
+     * @return The output attributes of the client device in the order of the
+     *         tables
+     */
+    std::vector<rmAttribute*> getSyncAttributes() const;
+    
+    /**
+     * @brief Gets the manager of the link capacity
+     * 
+     * Can be used to display the traffic and error statistics or to let the
+     * station reduce the sync rates when the link saturates.
+     * 
+     * @return The link budget of the connection
+     */
+    rmLinkBudget* getLinkBudget();
+    
+    /**
+     * @brief Reads the line errors the driver counted on the port
+     * 
+     * The link budget reads them at every interval into its error
+     * statistics.
+     * 
+     * @param counts Output counters
+     * 
+     * @return False if the port is closed or the driver does not count the
+     *         errors
+     */
+    bool getSerialErrorCounts(serial::ErrorCounts* counts);
+    
+    /**
+     * @brief Gets the file descriptor of the serial port to wait on
+     * 
+     * The thread that processes the clients waits on it for the bytes
+     * received instead of sleeping.
+     * 
+     * @return The descriptor. -1 if there is none to wait on.
+     */
+    int getSerialFd();
     
     /**
      * @brief Sends a request to the station
@@ -323,6 +746,53 @@ class RM_API rmClient {
      */
     void setEcho(rmEcho* printer);
     
+    /**
+     * @brief Sets the store to record the echoed messages in
+     * 
+     * The messages are recorded with the time they arrived and can be searched
+     * later through the store.
+     * 
+     * @param store The store opened for writing. Null to stop recording.
+     */
+    void setEchoStore(rmEchoStore* store);
+    
+    /**
+     * @brief Sets the recorder of the sync table updates
+     * 
+     * Every update of a sync table is written into the session log with the
+     * time it arrived. Remove the recorder here before destroying it. A
+     * record being written is waited for, so the recorder is not used once
+     * this returns.
+     * 
+     * @param rec The recorder with its log open. Null to stop recording.
+     */
+    void setSessionRecorder(rmSessionRecorder* rec);
+    
+    /**
+     * @brief Sets the listener that sees the changes of every attribute
+     * 
+     * The listener is also given to the attributes created later. It is
+     * called once for each attribute as it is listed and then on every value
+     * received, even one the same as before, from the thread that processes
+     * the connection. A call going on is waited for, so the listener removed
+     * is not called once this returns.
+     * 
+     * @param l The listener. Null to remove.
+     */
+    void setAttributeListener(rmAttributeListener* l);
+    
+    /**
+     * @brief Sets the shared memory to mirror the attribute values in
+     * 
+     * Every attribute is written into the memory now and again on each
+     * change, so other processes can read the latest values without asking
+     * the client. Remove the memory here before closing it. A write going on
+     * is waited for, so the memory is not written once this returns.
+     * 
+     * @param shm The memory created for writing. Null to stop mirroring.
+     */
+    void setSharedMemory(rmSharedMemory* shm);
+    
     /**
      * @brief Echos the messages
      * 
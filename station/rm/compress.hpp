@@ -0,0 +1,100 @@
+/**
+ * @file compress.hpp
+ * @brief Decompresses the command-lines sent by the client device
+ * 
+ * The devices on slow links may send their lines through an LZ77 coder over
+ * the last 64, 128 or 256 characters sent. The characters below 128 come as
+ * they are and the bytes from 0x80 start a 2-byte reference back into the
+ * window. Each line starts with either a reset of the window to a primer
+ * both sides know or a CRC-8 of the window, so the lines lost to a dropped
+ * byte are found and skipped until the next reset.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_COMPRESS_H__
+#define __RM_COMPRESS_H__ ///< Header guard
+
+#ifndef RM_API
+#ifdef _WIN32
+#ifdef RM_EXPORT
+#define RM_API __declspec(dllexport) ///< API
+#else
+#define RM_API __declspec(dllimport) ///< API
+#endif
+#else
+#define RM_API ///< API
+#endif
+#endif
+
+
+#include <cstddef>
+#include <cstdint>
+
+
+#define RM_COMPRESS_MAX_WINDOW 256 ///< Largest window a device may use
+#define RM_COMPRESS_MAX_MATCH 126 ///< Most characters a reference gives
+
+
+/**
+ * @brief Decodes the compressed lines one byte at a time
+ * 
+ * Keeps the same window as the device's coder. Nothing is allocated and
+ * each byte takes at most RM_COMPRESS_MAX_MATCH copies, so it runs in the
+ * idle loop along with the rest of the parsing.
+ */
+class RM_API rmDecompressor {
+  private:
+    uint8_t window[RM_COMPRESS_MAX_WINDOW];
+    uint16_t size = 0;
+    uint8_t position = 0;
+    uint8_t code = 0;
+    bool broken = false;
+    
+    void restart();
+    void insert(uint8_t c);
+  
+  public:
+    /**
+     * @brief Starts again with a window size
+     * 
+     * @param window Window size of the device, 64, 128 or 256
+     * 
+     * @return False if the window size is not supported
+     */
+    bool reset(uint16_t window);
+    
+    /**
+     * @brief Checks if the decoder is between the codes
+     * 
+     * The start byte of a binary frame is only a frame when it comes here,
+     * since the second byte of a code may have any value.
+     * 
+     * @return True if no code is half received
+     */
+    bool isIdle() const;
+    
+    /**
+     * @brief Checks if the window is out of step with the device
+     * 
+     * @return True from a failed check until the next reset
+     */
+    bool isBroken() const;
+    
+    /**
+     * @brief Decodes a byte
+     * 
+     * @param c The byte received
+     * @param out Buffer of RM_COMPRESS_MAX_MATCH characters for the output
+     * 
+     * @return Number of characters decoded. -1 if the window is found out of
+     *         step, after which the output stops until the next reset.
+     */
+    int push(uint8_t c, char* out);
+};
+
+#endif
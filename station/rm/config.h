@@ -4,6 +4,6 @@
 /**
  * @brief Constant string representing Robot Monitor version
  */
-#define RM_VERSION_STRING "1.0.0"
+#define RM_VERSION_STRING "2.0.0"
 
 #endif
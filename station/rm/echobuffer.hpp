@@ -0,0 +1,173 @@
+/**
+ * @file echobuffer.hpp
+ * @brief Ring buffer of the messages echoed by the client device
+ * 
+ * Keeps the latest lines of the console output with their status codes. Each
+ * line is stored in a slot of fixed size so that appending never allocates,
+ * and lines are addressed by a sequence number that keeps counting after the
+ * oldest ones have been overwritten.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_ECHOBUFFER_H__
+#define __RM_ECHOBUFFER_H__ ///< Header guard
+
+#ifndef RM_API
+#ifdef _WIN32
+#ifdef RM_EXPORT
+#define RM_API __declspec(dllexport) ///< API
+#else
+#define RM_API __declspec(dllimport) ///< API
+#endif
+#else
+#define RM_API ///< API
+#endif
+#endif
+
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+
+#ifndef RM_ECHO_BUFFER_SIZE
+#define RM_ECHO_BUFFER_SIZE 131072 ///< Default number of lines kept
+#endif
+
+#define RM_ECHO_LINE_SIZE 127 ///< Maximum length of a line with the null
+
+#define RM_ECHO_NORMAL  0x01 ///< Mask of the normal messages
+#define RM_ECHO_ERROR   0x02 ///< Mask of the error messages
+#define RM_ECHO_WARNING 0x04 ///< Mask of the warning messages
+#define RM_ECHO_ALL     0x07 ///< Mask of all the messages
+
+
+/**
+ * @brief A line of the console output
+ */
+struct RM_API rmEchoLine {
+    char text[RM_ECHO_LINE_SIZE]; ///< The message
+    uint8_t status; ///< 0 for normal, 1 for error and 2 for warning
+};
+
+
+/**
+ * @brief Ring buffer of the messages echoed by the client device
+ * 
+ * Keeps the latest lines of the console output with their status codes. Each
+ * line is stored in a slot of fixed size so that appending never allocates,
+ * and lines are addressed by a sequence number that keeps counting after the
+ * oldest ones have been overwritten. The lines can be appended from the
+ * connection thread while the user interface reads them.
+ */
+class RM_API rmEchoBuffer {
+  private:
+    rmEchoLine* lines = nullptr;
+    size_t capacity = 0;
+    uint64_t total = 0;
+    uint64_t first = 0;
+    mutable std::mutex m;
+    
+    uint64_t oldest() const;
+  
+  public:
+    /**
+     * @brief Constructs a buffer
+     * 
+     * @param n Number of lines kept
+     */
+    rmEchoBuffer(size_t n=RM_ECHO_BUFFER_SIZE);
+    
+    /**
+     * @brief Destructor
+     */
+    ~rmEchoBuffer();
+    
+    /**
+     * @brief Copy constructor (deleted)
+     * 
+     * @param buf Source
+     */
+    rmEchoBuffer(const rmEchoBuffer& buf) = delete;
+    
+    /**
+     * @brief Copy assignment (deleted)
+     * 
+     * @param buf Source
+     */
+    rmEchoBuffer& operator=(const rmEchoBuffer& buf) = delete;
+    
+    /**
+     * @brief Appends a line
+     * 
+     * The oldest line is overwritten once the buffer is full. Messages longer
+     * than the slot are cut.
+     * 
+     * @param msg The message
+     * @param status The status code. Codes other than 0 and 2 are errors.
+     */
+    void append(const char* msg, int status=0);
+    
+    /**
+     * @brief Removes all the lines
+     * 
+     * The sequence numbers keep counting.
+     */
+    void clear();
+    
+    /**
+     * @brief Gets the number of lines kept at most
+     * 
+     * @return The capacity
+     */
+    size_t getCapacity() const;
+    
+    /**
+     * @brief Gets the number of lines appended ever
+     * 
+     * @return The sequence number of the next line
+     */
+    uint64_t getTotal() const;
+    
+    /**
+     * @brief Gets the oldest line still kept
+     * 
+     * @return Sequence number of the oldest line
+     */
+    uint64_t getOldest() const;
+    
+    /**
+     * @brief Copies a line
+     * 
+     * @param seq Sequence number of the line
+     * @param line Output line
+     * 
+     * @return False if the line has been overwritten or does not exist yet
+     */
+    bool get(uint64_t seq, rmEchoLine* line) const;
+    
+    /**
+     * @brief Finds the lines matching a status mask and a substring
+     * 
+     * Scans only the lines from a sequence number on, so that a filtered view
+     * is kept up to date by passing the returned value on the next call.
+     * 
+     * @param from Sequence number to start at
+     * @param mask Combination of RM_ECHO_NORMAL, RM_ECHO_ERROR and
+     *             RM_ECHO_WARNING
+     * @param str The substring. Null or empty to match every line.
+     * @param out The sequence numbers matched are appended here
+     * 
+     * @return Sequence number to start at the next time
+     */
+    uint64_t filter(uint64_t from, uint8_t mask, const char* str,
+                    std::vector<uint64_t>* out) const;
+};
+
+#endif
@@ -0,0 +1,139 @@
+/**
+ * @file echolog.hpp
+ * @brief A log widget that shows the console output messages
+ * 
+ * Unlike the echo box, the messages are kept in a large ring buffer and only
+ * the rows in view are painted. The messages are taken in at most once per
+ * frame, so a client device printing thousands of lines per second does not
+ * stall the user interface.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_ECHOLOG_H__
+#define __RM_ECHOLOG_H__ ///< Header guard
+
+#ifndef RM_WX_API
+#ifdef _WIN32
+#ifdef RM_WX_EXPORT
+#define RM_WX_API __declspec(dllexport) ///< API
+#else
+#define RM_WX_API __declspec(dllimport) ///< API
+#endif
+#else
+#define RM_WX_API ///< API
+#endif
+#endif
+
+
+#include "client.hpp"
+#include "echobuffer.hpp"
+
+#include <deque>
+#include <string>
+
+#include <wx/timer.h>
+#include <wx/vscroll.h>
+
+
+/**
+ * @brief A log widget that shows the console output messages
+ * 
+ * Unlike the echo box, the messages are kept in a large ring buffer and only
+ * the rows in view are painted. The messages are taken in at most once per
+ * frame, so a client device printing thousands of lines per second does not
+ * stall the user interface. The rows can be filtered by the status and by a
+ * substring.
+ */
+class RM_WX_API rmEchoLog: public rmEcho, public wxVScrolledWindow {
+  private:
+    rmEchoBuffer buffer;
+    std::deque<uint64_t> rows;
+    uint64_t scanned = 0;
+    uint8_t statusMask = RM_ECHO_ALL;
+    std::string pattern;
+    int rowHeight = 0;
+    wxTimer refreshTimer;
+    long wx_id = 0;
+    
+    long getWxID();
+    void update();
+  
+  public:
+    /**
+     * @brief Constructs a echo log widget
+     * 
+     * @param parent The parent window
+     * @param cli The client
+     * @param n Number of lines kept
+     */
+    rmEchoLog(wxWindow* parent, rmClient* cli, size_t n=RM_ECHO_BUFFER_SIZE);
+    
+    /**
+     * @brief Echos the messages
+     * 
+     * Only stores the message. The rows are updated on the next frame.
+     * 
+     * @param msg The message
+     * @param status The status code. Status code other than 0 may print red
+     *         messages.
+     */
+    void echo(const char* msg, int status=0) override;
+    
+    /**
+     * @brief Enables or disables the user input
+     * 
+     * @param en True for enable and false for otherwise
+     */
+    void setEnabled(bool en) override;
+    
+    /**
+     * @brief Shows only the lines matching a status mask and a substring
+     * 
+     * @param mask Combination of RM_ECHO_NORMAL, RM_ECHO_ERROR and
+     *             RM_ECHO_WARNING
+     * @param str The substring. Null or empty to show every line.
+     */
+    void setFilter(uint8_t mask, const char* str=nullptr);
+    
+    /**
+     * @brief Removes all the lines
+     */
+    void clear();
+    
+    /**
+     * @brief Gets the lines stored
+     * 
+     * @return The ring buffer of the lines
+     */
+    const rmEchoBuffer* getBuffer() const;
+    
+    /**
+     * @brief Gets the height of a row
+     * 
+     * @param row Index of the row
+     * 
+     * @return The row height in pixels
+     */
+    wxCoord OnGetRowHeight(size_t row) const override;
+    
+    /**
+     * @brief Paints the rows in view
+     * 
+     * @param evt The event object
+     */
+    virtual void onPaint(wxPaintEvent& evt);
+    
+    /**
+     * @brief Takes in the lines echoed since the last frame
+     * 
+     * @param evt Timer event object
+     */
+    virtual void onTimer(wxTimerEvent& evt);
+};
+
+#endif
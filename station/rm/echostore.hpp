@@ -0,0 +1,211 @@
+/**
+ * @file echostore.hpp
+ * @brief Persistent and searchable record of the echoed messages
+ * 
+ * The messages are appended to segment files in a directory with the time
+ * they arrived. Each segment is indexed by the trigrams of its lines once it
+ * is full, so a substring is found in hours of messages by reading only the
+ * lines that contain all its trigrams.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_ECHOSTORE_H__
+#define __RM_ECHOSTORE_H__ ///< Header guard
+
+#ifndef RM_API
+#ifdef _WIN32
+#ifdef RM_EXPORT
+#define RM_API __declspec(dllexport) ///< API
+#else
+#define RM_API __declspec(dllimport) ///< API
+#endif
+#else
+#define RM_API ///< API
+#endif
+#endif
+
+
+#include "echobuffer.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+#ifndef RM_ECHO_SEGMENT_SIZE
+#define RM_ECHO_SEGMENT_SIZE 8388608 ///< Default size of a segment file
+#endif
+
+
+/**
+ * @brief A message read back from the store
+ */
+struct RM_API rmEchoRecord {
+    int64_t time = 0; ///< Milliseconds since the epoch
+    uint8_t status = 0; ///< 0 for normal, 1 for error and 2 for warning
+    std::string text; ///< The message
+};
+
+
+/**
+ * @brief Blocks of lines with a trigram in the segment being written
+ * 
+ * The lines are indexed in blocks of a few, and the block numbers are kept as
+ * the differences from the one before in variable-length integers, the same
+ * as in the index file, which takes about a byte each.
+ */
+struct RM_API rmEchoPostings {
+    uint32_t count = 0; ///< Number of blocks
+    uint32_t last = 0; ///< The last block number added
+    std::vector<uint8_t> deltas; ///< The differences as varints
+};
+
+
+/**
+ * @brief Persistent and searchable record of the echoed messages
+ * 
+ * The messages are appended to segment files in a directory with the time
+ * they arrived. Each segment is indexed by the trigrams of its lines once it
+ * is full, so a substring is found in hours of messages by reading only the
+ * lines that contain all its trigrams. The segment being written is indexed
+ * in memory and searched as well. Another process searching the directory
+ * has no index of that segment and reads it through, so the segments are
+ * kept small.
+ * 
+ * A segment is a text file with a line per message in the form of
+ * "<time> <status> <message>". Its index is a file of the same name with the
+ * extension ".idx".
+ */
+class RM_API rmEchoStore {
+  private:
+    std::string directory;
+    bool writable = false;
+    bool opened = false;
+    size_t segmentSize = RM_ECHO_SEGMENT_SIZE;
+    std::vector<uint32_t> segments;
+    FILE* file = nullptr;
+    uint32_t current = 0;
+    uint32_t fileSize = 0;
+    std::vector<uint32_t> offsets;
+    std::unordered_map<uint32_t, rmEchoPostings> postings;
+    int64_t firstTime = 0;
+    int64_t lastTime = 0;
+    mutable std::mutex m;
+    
+    std::string segmentPath(uint32_t seg, const char* ext) const;
+    void listSegments();
+    bool startSegment();
+    void finishSegment();
+    void indexLine(const char* text);
+    bool writeIndex(uint32_t seg) const;
+    bool buildIndex(uint32_t seg);
+    size_t searchSegment(uint32_t seg, const char* str, uint8_t mask,
+                         int64_t from, int64_t to, size_t limit,
+                         std::vector<rmEchoRecord>* out) const;
+    bool searchCurrent(uint32_t seg, const char* str, uint8_t mask,
+                       int64_t from, int64_t to, size_t limit,
+                       std::vector<rmEchoRecord>* out, size_t* found) const;
+  
+  public:
+    /**
+     * @brief Default constructor
+     */
+    rmEchoStore() = default;
+    
+    /**
+     * @brief Destructor
+     * 
+     * Closes the store.
+     */
+    ~rmEchoStore();
+    
+    /**
+     * @brief Copy constructor (deleted)
+     * 
+     * @param store Source
+     */
+    rmEchoStore(const rmEchoStore& store) = delete;
+    
+    /**
+     * @brief Copy assignment (deleted)
+     * 
+     * @param store Source
+     */
+    rmEchoStore& operator=(const rmEchoStore& store) = delete;
+    
+    /**
+     * @brief Opens a directory of segments
+     * 
+     * Opening for writing creates the directory if needed, indexes the
+     * segments left without an index or with one of an older layout and
+     * starts a new segment.
+     * 
+     * @param dir Path of the directory
+     * @param write True to append messages and false to search only
+     * 
+     * @return True on success
+     */
+    bool open(const char* dir, bool write=true);
+    
+    /**
+     * @brief Indexes the segment being written and closes the store
+     */
+    void close();
+    
+    /**
+     * @brief Checks if the store is open
+     * 
+     * @return True if open
+     */
+    bool isOpen() const;
+    
+    /**
+     * @brief Sets the size at which a new segment is started
+     * 
+     * @param bytes Size of a segment file
+     */
+    void setSegmentSize(size_t bytes);
+    
+    /**
+     * @brief Appends a message
+     * 
+     * @param msg The message
+     * @param status The status code. Codes other than 0 and 2 are errors.
+     * @param time Milliseconds since the epoch. Negative for now.
+     */
+    void append(const char* msg, int status=0, int64_t time=-1);
+    
+    /**
+     * @brief Writes out the messages buffered
+     */
+    void flush();
+    
+    /**
+     * @brief Finds the messages containing a substring
+     * 
+     * The messages are returned in the order they arrived.
+     * 
+     * @param str The substring. Null or empty to match every message.
+     * @param mask Combination of RM_ECHO_NORMAL, RM_ECHO_ERROR and
+     *             RM_ECHO_WARNING
+     * @param out The messages found are appended here
+     * @param limit Maximum number of messages to find
+     * @param from Earliest time in milliseconds since the epoch
+     * @param to Latest time in milliseconds since the epoch
+     * 
+     * @return Number of messages found
+     */
+    size_t search(const char* str, uint8_t mask,
+                  std::vector<rmEchoRecord>* out, size_t limit=SIZE_MAX,
+                  int64_t from=INT64_MIN, int64_t to=INT64_MAX);
+};
+
+#endif
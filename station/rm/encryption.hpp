@@ -2,8 +2,13 @@
  * @file encryption.hpp
  * @brief The encryption algorithm
  * 
- * The encryption algorithm here does not use a lot of bits and aims for speed
- * so that it can be used on microcontrollers.
+ * The station and the device agree on a shared secret with X25519 and seal
+ * the messages with ChaCha20-Poly1305, which are fast enough in plain C to
+ * run on microcontrollers. The station's key pair is kept in two files, the
+ * private key and the public key with ".pub" added to the name. The public
+ * key is built into the firmware of the devices. The station only starts a
+ * session with the devices whose public keys are in a third file, the known
+ * devices with ".known" added to the name.
  * 
  * @license{This project is released under the MIT License.}
  */
@@ -26,13 +31,23 @@
 #endif
 
 
+#include <cstddef>
+#include <cstdint>
+
+
 #define RM_PRIVATE_KEY_SIZE 32 ///< Private key size
-#define RM_PUBLIC_KEY_SIZE 8 ///< Public key size
+#define RM_PUBLIC_KEY_SIZE 32 ///< Public key size
+#define RM_CRYPT_NONCE_SIZE 8 ///< Nonce each side gives for a session
+#define RM_CRYPT_TAG_SIZE 16 ///< Authentication tag size
+#define RM_CRYPT_OVERHEAD 20 ///< Counter and tag added to a message
 
 
 /**
  * @brief Generates a new key and sets to use it
  * 
+ * The private key is only readable by the user, and a key already in the
+ * file is not replaced.
+ * 
  * @param key The file name where the new key is to be saved
  * 
  * @return True if the key generation is success
@@ -42,6 +57,8 @@ RM_API bool rmGenerateKey(const char* key);
 /**
  * @brief Opens the generated key to use
  * 
+ * The public key is worked out again from the private key.
+ * 
  * @param key The file name to open
  * 
  * @return True if the key is successfully read
@@ -51,36 +68,117 @@ RM_API bool rmOpenKey(const char* key);
 /**
  * @brief Gets the private key
  * 
- * @return Private key data
+ * @return Private key data. Null if no key is open.
  */
-RM_API const char* rmGetPrivateKey();
+RM_API const uint8_t* rmGetPrivateKey();
 
 /**
  * @brief Gets the public key
  * 
- * @return Public key data
+ * @return Public key data. Null if no key is open.
  */
-RM_API const char* rmGetPublicKey();
+RM_API const uint8_t* rmGetPublicKey();
 
 /**
- * @brief Encrypts a message
+ * @brief Trusts the public key of a device
  * 
- * @param in Message to encrypt
- * @param pub The public key of the client
+ * Adds the key to the known devices of the key open, and to its file with
+ * ".known" added to the name. The file has a key in hex on each line and
+ * can also be edited by hand.
  * 
- * @return Encrypted message. Allocated with malloc() and needs to be freed
- *         manually.
+ * @param pub The device's public key of RM_PUBLIC_KEY_SIZE bytes
+ * 
+ * @return False if no key is open or the file cannot be written
  */
-RM_API char* rmEncryptMessage(const char* in, const char* pub);
+RM_API bool rmTrustDevice(const uint8_t* pub);
 
 /**
- * @brief Decrypts a message
+ * @brief Checks if the public key of a device is trusted
+ * 
+ * @param pub The device's public key of RM_PUBLIC_KEY_SIZE bytes
  * 
- * @param in Encrypted message
+ * @return True if the key is one of the known devices of the key open
+ */
+RM_API bool rmIsTrustedDevice(const uint8_t* pub);
+
+/**
+ * @brief Multiplies a point on Curve25519 by a scalar
+ * 
+ * The public key is the private key times the point 9 and the shared secret
+ * is the private key times the other side's public key.
+ * 
+ * @param out The resulting point of 32 bytes
+ * @param scalar The private key
+ * @param point The public key
+ */
+RM_API void rmX25519(uint8_t* out, const uint8_t* scalar,
+                     const uint8_t* point);
+
+
+/**
+ * @brief The two directions of an encrypted connection
  * 
- * @return Decrypted message. Allocated with malloc() and needs to be freed
- *         manually.
+ * Each direction has its own key and a 32-bit counter used as the nonce.
+ * A sealed message is the counter, the ciphertext and the tag, and a
+ * message is only opened if its counter comes after the last one opened.
+ * Nothing is allocated, the messages are sealed and opened in place.
  */
-RM_API char* rmDecryptMessage(const char* in);
+class RM_API rmCryptChannel {
+  private:
+    uint8_t txKey[32];
+    uint8_t rxKey[32];
+    uint32_t txCounter = 0;
+    uint32_t rxCounter = 0;
+    bool active = false;
+  
+  public:
+    /**
+     * @brief Starts a session
+     * 
+     * The keys of both directions are derived from the shared secret and
+     * the nonces given by the station and the device.
+     * 
+     * @param secret The shared secret from rmX25519()
+     * @param stationNonce The station's nonce of RM_CRYPT_NONCE_SIZE bytes
+     * @param deviceNonce The device's nonce of RM_CRYPT_NONCE_SIZE bytes
+     * @param station True on the station's side
+     */
+    void start(const uint8_t* secret, const uint8_t* stationNonce,
+               const uint8_t* deviceNonce, bool station=true);
+    
+    /**
+     * @brief Ends the session and forgets the keys
+     */
+    void stop();
+    
+    /**
+     * @brief Checks if a session is going on
+     * 
+     * @return True after start() until stop()
+     */
+    bool isActive() const;
+    
+    /**
+     * @brief Seals a message in place
+     * 
+     * @param buf The buffer with the message from the 4th byte and room for
+     *            RM_CRYPT_OVERHEAD more bytes in total
+     * @param len Length of the message
+     * 
+     * @return Length of the sealed message
+     */
+    size_t seal(uint8_t* buf, size_t len);
+    
+    /**
+     * @brief Checks and opens a sealed message in place
+     * 
+     * @param buf The sealed message
+     * @param len Length of the sealed message
+     * 
+     * @return Length of the message, which is left from the 4th byte. -1 if
+     *         the message is forged, damaged or comes again.
+     */
+    long open(uint8_t* buf, size_t len);
+};
 
 #endif
@@ -0,0 +1,104 @@
+/**
+ * @file frame.hpp
+ * @brief Binary frames sent by the client device
+ * 
+ * Besides the text command lines starting with '$', the client device may
+ * send binary frames. A frame is the start byte, the frame type, the payload
+ * length, the payload and a CRC-8 of everything after the start byte.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_FRAME_H__
+#define __RM_FRAME_H__ ///< Header guard
+
+#ifndef RM_API
+#ifdef _WIN32
+#ifdef RM_EXPORT
+#define RM_API __declspec(dllexport) ///< API
+#else
+#define RM_API __declspec(dllimport) ///< API
+#endif
+#else
+#define RM_API ///< API
+#endif
+#endif
+
+
+#include "attribute.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+
+#define RM_FRAME_START      0x01 ///< The byte which starts a binary frame
+#define RM_FRAME_SYNC       0x10 ///< All values of a sync table
+#define RM_FRAME_SYNC_DELTA 0x11 ///< Index and value pairs of a sync table
+#define RM_FRAME_SET        0x12 ///< Name, type and value of an attribute
+#define RM_FRAME_SYNC_PART  0x13 ///< Sync table values from a start index
+#define RM_FRAME_CRYPT      0x20 ///< Sealed messages of an encrypted link
+
+
+/**
+ * @brief Data types of the client device's attributes
+ * 
+ * The client device has more data types than the station. These codes are
+ * used in the attribute lists and to decode the binary values.
+ */
+enum rmWireDataType {
+    RM_WIRE_BOOL   = 0x00, ///< Boolean, 1 byte
+    RM_WIRE_CHAR   = 0x01, ///< A single character, 1 byte
+    RM_WIRE_STRING = 0x02, ///< Length byte followed by the characters
+    RM_WIRE_UINT8  = 0x10, ///< 8-bit unsigned integer
+    RM_WIRE_UINT16 = 0x11, ///< 16-bit unsigned integer, little endian
+    RM_WIRE_UINT32 = 0x12, ///< 32-bit unsigned integer, little endian
+    RM_WIRE_INT8   = 0x18, ///< 8-bit signed integer
+    RM_WIRE_INT16  = 0x19, ///< 16-bit signed integer, little endian
+    RM_WIRE_INT32  = 0x1A, ///< 32-bit signed integer, little endian
+    RM_WIRE_FLOAT  = 0x1C  ///< IEEE 754 single precision, little endian
+};
+
+
+/**
+ * @brief Calculates the CRC-8 checksum of a frame
+ * 
+ * @param crc The checksum of the previous part or 0 to start
+ * @param data The data
+ * @param len Length of the data
+ * 
+ * @return The checksum
+ */
+RM_API uint8_t rmFrameChecksum(uint8_t crc, const uint8_t* data, size_t len);
+
+
+/**
+ * @brief Gets the station data type to hold a client device's data type
+ * 
+ * @param type The wire data type code
+ * 
+ * @return The attribute data type
+ */
+RM_API rmAttributeDataType rmFrameAttributeType(uint8_t type);
+
+
+/**
+ * @brief Decodes a value in the client device's data type
+ * 
+ * The listener of the attribute sees every value and its notifier only a
+ * change.
+ * 
+ * @param attr The attribute to store the value. Can be null to skip the value.
+ * @param type The wire data type code
+ * @param data The encoded value
+ * @param len Length of the data available
+ * 
+ * @return Number of bytes the value takes. 0 if the data is invalid.
+ */
+RM_API size_t rmFrameDecodeValue(rmAttribute* attr, uint8_t type,
+                                 const uint8_t* data, size_t len);
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ * @file hotplug.hpp
+ * @brief Notifies the serial ports plugged in and out
+ * 
+ * On Linux the ports are watched through the kernel's device events and the
+ * changes in /dev, so a device is reported as soon as it appears without
+ * listing the ports over and over. The description of each port is kept
+ * from when it appeared, so a removed port is reported with its hardware ID
+ * even though its sysfs entries are already gone.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_HOTPLUG_H__
+#define __RM_HOTPLUG_H__ ///< Header guard
+
+#ifndef RM_API
+#ifdef _WIN32
+#ifdef RM_EXPORT
+#define RM_API __declspec(dllexport) ///< API
+#else
+#define RM_API __declspec(dllimport) ///< API
+#endif
+#else
+#define RM_API ///< API
+#endif
+#endif
+
+
+#include "serial.hpp"
+
+
+/**
+ * @brief Receives the serial ports plugged in and out
+ */
+class RM_API rmHotplugListener {
+  public:
+    /**
+     * @brief Default constructor
+     */
+    rmHotplugListener() = default;
+    
+    /**
+     * @brief Triggers when a serial port appears
+     * 
+     * Called from the thread of the monitor.
+     * 
+     * @param info The new port
+     */
+    virtual void onPortAdded(const rmSerialPortInfo& info);
+    
+    /**
+     * @brief Triggers when a serial port disappears
+     * 
+     * Called from the thread of the monitor.
+     * 
+     * @param info The port as it was described when it appeared
+     */
+    virtual void onPortRemoved(const rmSerialPortInfo& info);
+};
+
+
+/**
+ * @brief Notifies the serial ports plugged in and out
+ * 
+ * The monitor runs in a thread of its own while there is a listener. The
+ * ports already present are not reported, getPorts() lists them.
+ */
+class RM_API rmHotplug {
+  public:
+    /**
+     * @brief Checks if the system can report the ports as they change
+     * 
+     * @return True on Linux with inotify or the kernel's device events
+     *         available. False elsewhere, where the ports have to be polled.
+     */
+    static bool isSupported();
+    
+    /**
+     * @brief Adds a listener
+     * 
+     * Starts the monitor with the first listener. It runs until the program
+     * exits.
+     * 
+     * @param l The listener
+     * 
+     * @return False if not supported, in which case the listener is not added
+     */
+    static bool addListener(rmHotplugListener* l);
+    
+    /**
+     * @brief Removes a listener
+     * 
+     * Once this returns, the listener is not called any more.
+     * 
+     * @param l The listener
+     */
+    static void removeListener(rmHotplugListener* l);
+    
+    /**
+     * @brief Lists the ports known to the monitor
+     * 
+     * Lists the ports through rmSerialPort::listPorts() if the monitor is
+     * not running.
+     * 
+     * @return The ports present
+     */
+    static rmSerialPortList getPorts();
+};
+
+#endif
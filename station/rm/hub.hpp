@@ -0,0 +1,258 @@
+/**
+ * @file hub.hpp
+ * @brief Many client devices processed by a pool of threads
+ * 
+ * A station with dozens of devices, like a test bench for a swarm of
+ * robots, keeps them in a hub instead of one window each. The hub owns the
+ * clients and takes the place of their timer. The clients are dealt among
+ * the worker threads, and each worker waits on the ports of its own clients
+ * and makes its passes over them without waiting for the others. A client
+ * is processed for a limited time in each pass, and a worker with nothing
+ * to do takes the clients left in the others' passes, so a busy link does
+ * not hold up the rest. The attributes of all the devices are found by the
+ * client name and the attribute name, as in "robot3.voltage".
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_HUB_H__
+#define __RM_HUB_H__ ///< Header guard
+
+#ifndef RM_API
+#ifdef _WIN32
+#ifdef RM_EXPORT
+#define RM_API __declspec(dllexport) ///< API
+#else
+#define RM_API __declspec(dllimport) ///< API
+#endif
+#else
+#define RM_API ///< API
+#endif
+#endif
+
+
+#include "attribute.hpp"
+#include "client.hpp"
+#include "timerbase.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+#define RM_HUB_SEPARATOR '.' ///< Between the client name and the attribute
+
+#ifndef RM_HUB_BUDGET
+#define RM_HUB_BUDGET 2000 ///< Time to process a client per pass in us
+#endif
+
+
+/**
+ * @brief Totals over the clients of a hub
+ */
+struct RM_API rmHubStats {
+    size_t clients = 0; ///< Clients owned by the hub
+    size_t connected = 0; ///< Clients with the port open
+    float bytesPerSecond = 0; ///< Bytes received in the last interval
+    uint64_t errors = 0; ///< Link errors of all kinds so far
+    uint64_t rounds = 0; ///< Passes made by the workers over their clients
+    uint64_t steals = 0; ///< Clients taken from another worker's share
+};
+
+
+/**
+ * @brief Many client devices processed by a pool of threads
+ * 
+ * The decoding of each link is independent of the others, so the clients
+ * run their onIdle() in parallel, each for the time set by setBudget() in a
+ * pass. A client is only processed by one worker at a time and
+ * removeClient() waits for it to finish.
+ */
+class RM_API rmHub: public rmTimerBase {
+  private:
+    struct Share {
+        std::mutex m;
+        std::deque<rmClient*> clients;
+    };
+    
+    std::vector<rmClient*> owned;
+    std::vector<std::string> names;
+    std::vector<std::thread> workers;
+    std::unique_ptr<Share[]> shares;
+    std::vector<std::vector<rmClient*>> dealt;
+    std::vector<rmClient*> busy;
+    size_t workerCount;
+    long budget = RM_HUB_BUDGET;
+    mutable std::mutex m;
+    std::condition_variable clientAdded;
+    std::condition_variable clientDone;
+    bool active = false;
+    std::atomic<uint64_t> rounds;
+    std::atomic<uint64_t> steals;
+    
+    void work(size_t w);
+    rmClient* take(size_t w);
+    bool process(size_t w, rmClient* cli);
+    void waitForClients(const std::vector<rmClient*>& vec, long ms);
+    bool startPass(size_t w, bool backlog);
+  
+  public:
+    /**
+     * @brief Constructs a hub with a number of worker threads
+     * 
+     * @param workers Number of worker threads. 0 for one for each core.
+     */
+    rmHub(size_t workers=0);
+    
+    /**
+     * @brief Destructor
+     * 
+     * Stops the workers and deletes the clients.
+     */
+    ~rmHub();
+    
+    /**
+     * @brief Copy constructor (deleted)
+     * 
+     * @param hub Source
+     */
+    rmHub(const rmHub& hub) = delete;
+    
+    /**
+     * @brief Copy assignment (deleted)
+     * 
+     * @param hub Source
+     * 
+     * @return Reference to this object
+     */
+    rmHub& operator=(const rmHub& hub) = delete;
+    
+    /**
+     * @brief Creates a client which the hub processes and owns
+     * 
+     * The client is processed from when its port is connected.
+     * 
+     * @param name The name before the attribute names, like "robot3"
+     * 
+     * @return The new client. Null if the name is empty, has the separator
+     *         in it or is taken.
+     */
+    rmClient* createClient(const char* name);
+    
+    /**
+     * @brief Looks for a client by name
+     * 
+     * @param name The name given to createClient()
+     * 
+     * @return The client. Null if the hub has none by the name.
+     */
+    rmClient* getClient(const char* name) const;
+    
+    /**
+     * @brief Gets the number of clients owned by the hub
+     * 
+     * @return Number of clients
+     */
+    size_t getClientCount() const;
+    
+    /**
+     * @brief Gets a client by its position in the order of creation
+     * 
+     * @param i Index of the client
+     * 
+     * @return The client. Null if the index is out of range.
+     */
+    rmClient* getClientAt(size_t i) const;
+    
+    /**
+     * @brief Gets the name of a client
+     * 
+     * @param i Index of the client
+     * 
+     * @return The name. Empty if the index is out of range.
+     */
+    std::string getClientName(size_t i) const;
+    
+    /**
+     * @brief Looks for an attribute of any of the clients
+     * 
+     * @param key The client name and the attribute name joined by
+     *            RM_HUB_SEPARATOR, like "robot3.voltage"
+     * 
+     * @return The attribute. Null if there is no such client or attribute.
+     */
+    rmAttribute* getAttribute(const char* key) const;
+    
+    /**
+     * @brief Gets the number of worker threads
+     * 
+     * @return Number of worker threads
+     */
+    size_t getWorkerCount() const;
+    
+    /**
+     * @brief Sets the time to process a client in each pass
+     * 
+     * A client with more data than it can process in the time takes the
+     * rest in the next pass, which its worker starts without waiting.
+     * 
+     * @param us Time in microseconds
+     */
+    void setBudget(long us);
+    
+    /**
+     * @brief Adds up the traffic and the errors of all the clients
+     * 
+     * @return The totals
+     */
+    rmHubStats getStats() const;
+    
+    /**
+     * @brief Adds a client to the list to process
+     * 
+     * Called by the client when its port is connected. The client is given
+     * to the worker with the fewest. Starts the workers with the first one.
+     * 
+     * @param cli The client device
+     */
+    void appendClient(rmClient* cli) override;
+    
+    /**
+     * @brief Removes a client from the list to process
+     * 
+     * Waits if a worker is processing the client, unless it is called from
+     * that worker.
+     * 
+     * @param cli The client device
+     */
+    void removeClient(rmClient* cli) override;
+    
+    /**
+     * @brief Starts the workers
+     * 
+     * @param ms Longest time a worker waits for the data between its passes
+     *           in milliseconds
+     */
+    void start(long ms) override;
+    
+    /**
+     * @brief Stops the workers
+     * 
+     * Waits for the passes going on to finish, so it is not to be called by
+     * the callbacks of the clients.
+     */
+    void stop() override;
+};
+
+#endif
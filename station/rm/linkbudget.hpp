@@ -0,0 +1,241 @@
+/**
+ * @file linkbudget.hpp
+ * @brief Keeps the sync traffic within the capacity of the link
+ * 
+ * Measures the bytes received for each sync table, computes the utilisation
+ * against the link capacity derived from the baud rate and commands the client
+ * device to change the table rates so that the utilisation stays under a
+ * ceiling.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_LINKBUDGET_H__
+#define __RM_LINKBUDGET_H__ ///< Header guard
+
+#ifndef RM_API
+#ifdef _WIN32
+#ifdef RM_EXPORT
+#define RM_API __declspec(dllexport) ///< API
+#else
+#define RM_API __declspec(dllimport) ///< API
+#endif
+#else
+#define RM_API ///< API
+#endif
+#endif
+
+
+class rmClient;
+
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+
+#define RM_LINK_TABLE_COUNT 256 ///< Number of sync tables tracked
+#define RM_LINK_OTHER -1 ///< Table ID for the traffic other than syncs
+
+#define RM_LINK_DISCARDED 0 ///< Bytes received outside any message
+#define RM_LINK_TRUNCATED 1 ///< Lines cut at the 255 character limit
+#define RM_LINK_UNKNOWN   2 ///< Commands with no call by the name
+#define RM_LINK_CHECKSUM  3 ///< Binary frames failing the checksum
+#define RM_LINK_FRAMING   4 ///< Framing errors counted by the driver
+#define RM_LINK_PARITY    5 ///< Parity errors counted by the driver
+#define RM_LINK_OVERRUN   6 ///< Characters the driver lost to overruns
+#define RM_LINK_RECONNECT 7 ///< Times the port was reopened
+#define RM_LINK_ERROR_COUNT 8 ///< Number of the kinds of errors
+
+
+/**
+ * @brief Measured traffic of a sync table
+ */
+struct RM_API rmLinkStats {
+    float bytesPerSecond = 0; ///< Bytes received per second
+    float updatesPerSecond = 0; ///< Updates received per second
+    uint16_t rate = 0; ///< Rate last commanded. 0 if never changed.
+    uint16_t targetRate = 0; ///< Rate to restore once the link has room
+};
+
+
+/**
+ * @brief Measured errors of a kind on the link
+ */
+struct RM_API rmLinkErrorStats {
+    uint64_t count = 0; ///< Errors since the connection was opened
+    float perSecond = 0; ///< Errors per second in the last interval
+};
+
+
+/**
+ * @brief Keeps the sync traffic within the capacity of the link
+ * 
+ * Measures the bytes received for each sync table, computes the utilisation
+ * against the link capacity derived from the baud rate and commands the client
+ * device to change the table rates so that the utilisation stays under a
+ * ceiling. Also counts the errors on the link, so a degrading cable shows up
+ * in the rates before the link fails.
+ */
+class RM_API rmLinkBudget {
+  private:
+    uint32_t capacity = 0;
+    float ceiling = 0.8f;
+    bool enabled = false;
+    long interval = 1000;
+    int64_t windowStart = 0;
+    size_t bytes[RM_LINK_TABLE_COUNT] = {0};
+    size_t updates[RM_LINK_TABLE_COUNT] = {0};
+    size_t otherBytes = 0;
+    rmLinkStats stats[RM_LINK_TABLE_COUNT];
+    float otherBytesPerSecond = 0;
+    float utilisation = 0;
+    rmLinkErrorStats errors[RM_LINK_ERROR_COUNT];
+    uint64_t windowErrors[RM_LINK_ERROR_COUNT] = {0};
+    uint32_t driverCounts[3] = {0};
+    bool driverCounted = false;
+    mutable std::mutex m;
+    
+    void countDriverErrors(rmClient* cli);
+    
+    uint16_t adjustRate(uint8_t i, float scale);
+  
+  public:
+    /**
+     * @brief Default constructor
+     */
+    rmLinkBudget() = default;
+    
+    /**
+     * @brief Sets the link capacity from the baud rate
+     * 
+     * Each byte takes 10 bits on the line with a start and a stop bit.
+     * 
+     * @param baud Baud rate
+     */
+    void setBaudrate(uint32_t baud);
+    
+    /**
+     * @brief Gets the link capacity
+     * 
+     * @return Capacity in bytes per second
+     */
+    uint32_t getCapacity() const;
+    
+    /**
+     * @brief Sets the maximum utilisation allowed
+     * 
+     * @param c Fraction of the capacity between 0 and 1
+     */
+    void setCeiling(float c);
+    
+    /**
+     * @brief Gets the maximum utilisation allowed
+     * 
+     * @return Fraction of the capacity
+     */
+    float getCeiling() const;
+    
+    /**
+     * @brief Enables or disables changing the rates of the client device
+     * 
+     * The traffic is measured either way.
+     * 
+     * @param en True for enable and false for otherwise
+     */
+    void setEnabled(bool en);
+    
+    /**
+     * @brief Checks if the rates are managed
+     * 
+     * @return True if the rates of the client device are changed
+     */
+    bool isEnabled() const;
+    
+    /**
+     * @brief Sets the interval between two measurements
+     * 
+     * @param ms Interval in milliseconds
+     */
+    void setInterval(long ms);
+    
+    /**
+     * @brief Sets the rate a sync table should be kept at
+     * 
+     * @param i Sync table ID
+     * @param hz Number of updates per second
+     */
+    void setTargetRate(uint8_t i, uint16_t hz);
+    
+    /**
+     * @brief Counts the bytes of a message received
+     * 
+     * @param i Sync table ID. RM_LINK_OTHER for the other messages.
+     * @param n Number of bytes
+     */
+    void onReceived(int i, size_t n);
+    
+    /**
+     * @brief Counts errors on the link
+     * 
+     * @param kind One of the RM_LINK_* error codes
+     * @param n Number of errors
+     */
+    void onError(uint8_t kind, size_t n=1);
+    
+    /**
+     * @brief Updates the measurements and the rates of the client device
+     * 
+     * Does nothing until the measurement interval has passed.
+     * 
+     * @param cli The client device
+     */
+    void update(rmClient* cli);
+    
+    /**
+     * @brief Clears the measurements, the rates and the error counts
+     */
+    void reset();
+    
+    /**
+     * @brief Gets the traffic of a sync table
+     * 
+     * @param i Sync table ID
+     * 
+     * @return The measurements of the last interval
+     */
+    rmLinkStats getStats(uint8_t i) const;
+    
+    /**
+     * @brief Gets the traffic other than the sync tables
+     * 
+     * @return Bytes received per second
+     */
+    float getOtherBytesPerSecond() const;
+    
+    /**
+     * @brief Gets the link utilisation
+     * 
+     * @return Fraction of the capacity used in the last interval. 0 if the
+     *         capacity is unknown.
+     */
+    float getUtilisation() const;
+    
+    /**
+     * @brief Gets the errors of a kind on the link
+     * 
+     * The errors of the driver are read from the serial port at every
+     * interval, where the driver counts them.
+     * 
+     * @param kind One of the RM_LINK_* error codes
+     * 
+     * @return The count and the rate of the last interval
+     */
+    rmLinkErrorStats getErrorStats(uint8_t kind) const;
+};
+
+#endif
@@ -0,0 +1,182 @@
+/**
+ * @file publisher.hpp
+ * @brief Shares the decoded traffic of a client with local processes
+ * 
+ * Only one process can open a serial port. The publisher lets the process
+ * owning the port serve the attribute changes and the echoed messages of the
+ * client device to any number of local subscribers over a Unix domain socket.
+ * The subscribers can also send commands to the device.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_PUBLISHER_H__
+#define __RM_PUBLISHER_H__ ///< Header guard
+
+#ifndef RM_API
+#ifdef _WIN32
+#ifdef RM_EXPORT
+#define RM_API __declspec(dllexport) ///< API
+#else
+#define RM_API __declspec(dllimport) ///< API
+#endif
+#else
+#define RM_API ///< API
+#endif
+#endif
+
+
+#include "client.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+#ifndef RM_PUBLISH_ECHO_COUNT
+#define RM_PUBLISH_ECHO_COUNT 1024 ///< Echoed messages kept for subscribers
+#endif
+
+#ifndef RM_PUBLISH_BACKLOG
+#define RM_PUBLISH_BACKLOG 65536 ///< Bytes queued for a subscriber at most
+#endif
+
+
+struct rmSubscriber;
+
+
+/**
+ * @brief The latest value of an attribute as published
+ */
+struct RM_API rmPublishedValue {
+    std::string name; ///< Name of the attribute
+    std::string value; ///< The value formatted as text
+    uint64_t sequence = 0; ///< Sequence number of the last change
+};
+
+
+/**
+ * @brief Shares the decoded traffic of a client with local processes
+ * 
+ * Only one process can open a serial port. The publisher lets the process
+ * owning the port serve the attribute changes and the echoed messages of the
+ * client device to any number of local subscribers over a Unix domain socket.
+ * 
+ * The messages follow the text protocol of the client device. A subscriber
+ * receives "$hello 1" first, then "$set <name> <value>" for each attribute
+ * and "$echo", "$warn" or "$err" for each message echoed. A backslash, a line
+ * feed or a carriage return in a value or a message is sent as "\\\\", "\\n"
+ * or "\\r". The lines a subscriber sends are passed to the device as
+ * commands.
+ * 
+ * The connection thread only formats the changed value and marks it. The
+ * socket thread writes to a subscriber whenever it can take more, sending the
+ * latest value of each attribute changed since the last write, so a slow
+ * subscriber only misses the intermediate values and never holds the others
+ * back. Echoed messages a subscriber falls too far behind on are reported
+ * with "$dropped <count>".
+ */
+class RM_API rmPublisher: public rmAttributeListener, public rmEcho {
+  private:
+    rmClient* client = nullptr;
+    std::string path;
+    int listenFd = -1;
+    int wakeFds[2] = {-1, -1};
+    bool wakePending = false;
+    bool running = false;
+    std::thread thread;
+    std::vector<rmPublishedValue> values;
+    std::unordered_map<rmAttribute*, size_t> ids;
+    uint64_t sequence = 0;
+    std::deque<std::string> messages;
+    uint64_t messageCount = 0;
+    std::vector<rmSubscriber*> subscribers;
+    mutable std::mutex m;
+    
+    void run();
+    void wake();
+    void acceptSubscriber();
+    void fill(rmSubscriber* sub);
+    bool transmit(rmSubscriber* sub);
+    bool receive(rmSubscriber* sub);
+  
+  public:
+    /**
+     * @brief Constructs a publisher
+     * 
+     * @param cli The client whose traffic is published
+     */
+    rmPublisher(rmClient* cli);
+    
+    /**
+     * @brief Destructor
+     * 
+     * Closes the socket.
+     */
+    virtual ~rmPublisher();
+    
+    /**
+     * @brief Copy constructor (deleted)
+     * 
+     * @param pub Source
+     */
+    rmPublisher(const rmPublisher& pub) = delete;
+    
+    /**
+     * @brief Copy assignment (deleted)
+     * 
+     * @param pub Source
+     */
+    rmPublisher& operator=(const rmPublisher& pub) = delete;
+    
+    /**
+     * @brief Listens for the subscribers
+     * 
+     * An existing file at the path is replaced. Only the user running the
+     * station may connect to the socket.
+     * 
+     * @param socketPath Path of the Unix domain socket
+     * 
+     * @return True on success. Always false on Windows.
+     */
+    bool open(const char* socketPath);
+    
+    /**
+     * @brief Disconnects the subscribers and removes the socket
+     */
+    void close();
+    
+    /**
+     * @brief Gets the number of subscribers connected
+     * 
+     * @return Number of subscribers
+     */
+    size_t getSubscriberCount() const;
+    
+    /**
+     * @brief Publishes the new value of an attribute
+     * 
+     * A value the same as the one published before is not sent again.
+     * 
+     * @param attr The attribute updated
+     */
+    void onAttributeUpdate(rmAttribute* attr) override;
+    
+    /**
+     * @brief Publishes a message echoed by the client device
+     * 
+     * @param msg The message
+     * @param status The status code
+     */
+    void echo(const char* msg, int status=0) override;
+};
+
+#endif
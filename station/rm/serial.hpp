@@ -27,15 +27,20 @@
 #endif
 
 
+#include "serialfd.hpp"
+
 #include "serial/serial.h"
 
 
+#define RM_SERIAL_WRITE_TIMEOUT 5000 ///< Milliseconds a write waits at most
+
+
 /**
  * @brief Structure that describes a serial device
  */
 struct RM_API rmSerialPortInfo {
     char port[16]; ///< Address to the serial port
-    char hardware_id[23]; ///< Hardware ID
+    char hardware_id[64]; ///< Hardware ID, the VID, PID and serial of USB
     char description[63]; ///< Human readable description of serial device
 };
 
@@ -52,7 +57,7 @@ class RM_API rmSerialPortList {
     size_t portCount = 0;
     
     void swap(rmSerialPortList &list) noexcept;
-    
+  
   public:
     /**
      * @brief Default constructor
@@ -98,7 +103,7 @@ class RM_API rmSerialPortList {
     class RM_API iterator {
       private:
         rmSerialPortInfo* pData;
-        
+      
       public:
         /**
          * @brief Constructs from pointer
@@ -227,12 +232,20 @@ RM_WX_API void rmSetOnPortDetectedWx(void (wxEvtHandler::*func)(wxEvent&),
 
 /**
  * @brief Class that provides a portable serial port interface.
+ * 
+ * Uses rmSerialFd on Linux and serial::Serial elsewhere. It is not locked,
+ * the owner serializes the calls.
  */
 class RM_API rmSerialPort {
   private:
+    rmSerialFd myFd;
     serial::Serial mySerial;
     rmSerialPortInfo portInfo;
+    int lastError;
     
+    bool open(const char* port, uint32_t baud);
+    void onError(int err);
+  
   public:
     /**
      * @brief Default constructor
@@ -285,13 +298,34 @@ class RM_API rmSerialPort {
      */
     char read();
     
+    /**
+     * @brief Reads the available bytes from the serial port
+     * 
+     * @param buf Destination buffer
+     * @param len Size of the buffer
+     * 
+     * @return Number of bytes read. 0 if there is nothing to read.
+     */
+    size_t read(uint8_t* buf, size_t len);
+    
     /**
      * @brief Writes a string to the serial port
      * 
+     * Waits up to RM_SERIAL_WRITE_TIMEOUT for the driver to take the whole
+     * string. The rest is dropped after that.
+     * 
      * @param msg A null-terminating string
      */
     void write(const char* msg);
     
+    /**
+     * @brief Gets the error which closed the port or kept it from opening
+     * 
+     * @return RM_SERIAL_OK, or one of the error codes of rmSerialFd.
+     *         Described by rmSerialFd::getErrorString().
+     */
+    int getError() const;
+    
     /**
      * @brief Gets the port info
      * 
@@ -299,6 +333,34 @@ class RM_API rmSerialPort {
      */
     rmSerialPortInfo getInfo();
     
+    /**
+     * @brief Reads the line errors the driver counted on the port
+     * 
+     * @param counts Output counters
+     * 
+     * @return False if the port is closed or the driver does not count the
+     *         errors
+     */
+    bool getErrorCounts(serial::ErrorCounts* counts);
+    
+    /**
+     * @brief Sets the low latency mode of the port
+     * 
+     * The driver pushes the received bytes at once instead of buffering them
+     * for a few milliseconds. Kept for the next connections.
+     * 
+     * @param lowLatency True to favour latency over CPU time
+     */
+    void setLowLatency(bool lowLatency);
+    
+    /**
+     * @brief Gets the file descriptor to wait on for the bytes received
+     * 
+     * @return The descriptor. -1 if the port is closed or is not a
+     *         descriptor of rmSerialFd.
+     */
+    int getFd() const;
+    
     /**
      * @brief Gets a list of devices available on the serial ports
      * 
@@ -309,9 +371,10 @@ class RM_API rmSerialPort {
     /**
      * @brief Sets a callback function on serial port detected
      * 
-     * The callback is triggered whenever the number of elements from
-     * listPorts() is changed. This is when a new port is detected or when an
-     * existing port is missing.
+     * The callback is triggered whenever the list from listPorts() is
+     * changed. This is when a new port is detected or when an existing port
+     * is missing. Where rmHotplug is supported, the ports are not listed
+     * again until a device is plugged in or out.
      * 
      * @param func The callback function
      */
@@ -322,7 +385,7 @@ class RM_API rmSerialPort {
      * @brief Sets a callback function on serial port detected
      * 
      * Connects function to an event that that triggers on the change of
-     * number of ports detected. Use this function if it is associated with
+     * the ports detected. Use this function if it is associated with
      * wxWidgets.
      * 
      * @param func The event function
@@ -141,6 +141,26 @@ struct Timeout {
   {}
 };
 
+/*!
+ * Line errors the driver counted on a port since it was set up.
+ */
+struct ErrorCounts {
+  /*! Characters received without a valid stop bit. */
+  uint32_t frame;
+
+  /*! Characters received with a wrong parity bit. */
+  uint32_t parity;
+
+  /*! Characters lost because the UART was not read in time. */
+  uint32_t overrun;
+
+  /*! Characters lost because the buffer of the driver was full. */
+  uint32_t buf_overrun;
+
+  /*! Break conditions received. */
+  uint32_t brk;
+};
+
 /*!
  * Class that provides a portable serial port interface.
  */
@@ -489,6 +509,8 @@ public:
    * 57600, 115200
    * Some other baudrates that are supported by some comports:
    * 128000, 153600, 230400, 256000, 460800, 500000, 921600
+   * On Linux, any other baudrate the driver can generate, like 250000 or
+   * 1843200, is set with termios2 and BOTHER.
    *
    * \param baudrate An integer that sets the baud rate for the serial port.
    *
@@ -586,6 +608,27 @@ public:
   flowcontrol_t
   getFlowcontrol () const;
 
+  /*! Sets the low latency mode of the serial port.
+   *
+   * Asks the driver to push the received bytes to the reader at once, with
+   * ASYNC_LOW_LATENCY via ioctl on Linux, and makes the fixed-length reads
+   * return the bytes as they arrive instead of waiting for the time the rest
+   * of them take on the line. The drivers that do not support the flag,
+   * like PTYs, keep their latency.
+   *
+   * \param low_latency True to favour latency over CPU time. The mode is off
+   * until set.
+   */
+  void
+  setLowLatency (bool low_latency = true);
+
+  /*! Gets the low latency mode of the serial port.
+   *
+   * \see Serial::setLowLatency
+   */
+  bool
+  getLowLatency () const;
+
   /*! Flush the input and output buffers */
   void
   flush ();
@@ -647,6 +690,21 @@ public:
   bool
   getCD ();
 
+  /*!
+   * Reads the line errors the driver counted on the port.
+   *
+   * Uses TIOCGICOUNT via ioctl, which only Linux provides and not every
+   * driver supports.
+   *
+   * \param counts The counters.
+   *
+   * \return Returns false if the driver does not count the errors.
+   *
+   * \throw serial::PortNotOpenedException
+   */
+  bool
+  getErrorCounts (ErrorCounts *counts);
+
 private:
   // Disable copy constructors
   Serial(const Serial&);
@@ -770,6 +828,38 @@ struct PortInfo {
 std::vector<PortInfo>
 list_ports();
 
+#if defined(__linux__)
+/* Describes a single serial port from sysfs
+ *
+ * Reads the same information list_ports() gives for the port, for the hotplug
+ * monitor to describe a new device without listing all of them.
+ *
+ * \param port Path of the device such as "/dev/ttyACM0".
+ *
+ * \return serial::PortInfo of the port.
+ */
+PortInfo
+get_port_info(const std::string& port);
+
+/* Lists the serial ports under the given device and sysfs directories
+ *
+ * list_ports() is list_ports_in("/dev", "/sys"). The description of each
+ * port is cached with the inode and the modification time of its device
+ * node, so sysfs is read again only for the nodes that are new or changed
+ * since the last call with the same directories. The ttyS ports without a
+ * hardware ID, mostly the placeholders of the legacy serial driver, are
+ * left out.
+ *
+ * \param dev_dir Directory of the device nodes.
+ *
+ * \param sys_dir Mount point of sysfs.
+ *
+ * \return vector of serial::PortInfo sorted by the port.
+ */
+std::vector<PortInfo>
+list_ports_in(const std::string& dev_dir, const std::string& sys_dir);
+#endif
+
 } // namespace serial
 
 #endif
@@ -0,0 +1,49 @@
+/**
+ * @file serial_internal.hpp
+ * @brief Helpers shared by the serial port sources of the station
+ * 
+ * Only included by the library's own sources and not installed with the
+ * public headers.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_SERIAL_INTERNAL_H__
+#define __RM_SERIAL_INTERNAL_H__ ///< Header guard
+
+
+#include "serial.hpp"
+
+#include <cstring>
+
+
+/**
+ * @brief Compares two lists of the serial ports
+ * 
+ * The port detection reports a change only when this is false, so a port
+ * whose description changes is not taken for a new one.
+ * 
+ * @param a A list
+ * @param b The other list
+ * 
+ * @return True if the lists have the same ports with the same hardware IDs
+ *         in the same order
+ */
+inline bool rmIsSamePortList(const rmSerialPortList& a,
+                             const rmSerialPortList& b)
+{
+    if(a.size() != b.size())
+        return false;
+    for(size_t i=0; i<a.size(); i++) {
+        if(strcmp(a[i].port, b[i].port) != 0 ||
+           strcmp(a[i].hardware_id, b[i].hardware_id) != 0)
+            return false;
+    }
+    return true;
+}
+
+#endif
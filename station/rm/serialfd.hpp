@@ -0,0 +1,200 @@
+/**
+ * @file serialfd.hpp
+ * @brief Non-blocking file descriptor of a serial port on Linux
+ * 
+ * A thin layer over the tty device for the station's own use. Every call
+ * returns at once with a count or an error code instead of waiting on a
+ * timeout or throwing, and nothing is locked, as the owner already
+ * serializes the calls. The descriptor can be waited on with poll() along
+ * with the ports of other clients. Elsewhere, open() fails with
+ * RM_SERIAL_UNSUPPORTED and serial::Serial is used instead.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_SERIALFD_H__
+#define __RM_SERIALFD_H__ ///< Header guard
+
+#ifndef RM_API
+#ifdef _WIN32
+#ifdef RM_EXPORT
+#define RM_API __declspec(dllexport) ///< API
+#else
+#define RM_API __declspec(dllimport) ///< API
+#endif
+#else
+#define RM_API ///< API
+#endif
+#endif
+
+
+#include "serial/serial.h"
+
+#include <cstddef>
+#include <cstdint>
+
+
+#define RM_SERIAL_OK            0 ///< Success
+#define RM_SERIAL_AGAIN        -1 ///< Timed out waiting
+#define RM_SERIAL_CLOSED       -2 ///< The port is not open
+#define RM_SERIAL_DISCONNECTED -3 ///< The device is gone
+#define RM_SERIAL_BUSY         -4 ///< The port is used by another process
+#define RM_SERIAL_BAUDRATE     -5 ///< The driver rejects the baudrate
+#define RM_SERIAL_IO           -6 ///< Other system error, see getErrno()
+#define RM_SERIAL_UNSUPPORTED  -7 ///< Not available on this system
+
+
+/**
+ * @brief Non-blocking file descriptor of a serial port
+ * 
+ * The port is set up raw with 8 data bits, no parity, one stop bit and no
+ * flow control, which is what the client devices use.
+ */
+class RM_API rmSerialFd {
+  private:
+    int fd = -1;
+    int lastErrno = 0;
+    uint32_t baudrate = 0;
+    bool lowLatency = false;
+    
+    int fail(int err);
+    int configure();
+  
+  public:
+    /**
+     * @brief Default constructor
+     */
+    rmSerialFd() = default;
+    
+    /**
+     * @brief Destructor
+     * 
+     * Closes the port.
+     */
+    ~rmSerialFd();
+    
+    rmSerialFd(const rmSerialFd&) = delete;
+    rmSerialFd& operator = (const rmSerialFd&) = delete;
+    
+    /**
+     * @brief Opens and sets up a serial port
+     * 
+     * Closes the port opened before. The other processes are kept from
+     * opening the port until it is closed.
+     * 
+     * @param port Path of the device such as "/dev/ttyACM0"
+     * @param baud Baudrate. The ones with no B constant are set with termios2.
+     * 
+     * @return RM_SERIAL_OK or the error code
+     */
+    int open(const char* port, uint32_t baud);
+    
+    /**
+     * @brief Closes the port
+     */
+    void close();
+    
+    /**
+     * @brief Checks if the port is open
+     * 
+     * @return True if open
+     */
+    bool isOpen() const;
+    
+    /**
+     * @brief Gets the file descriptor to wait on
+     * 
+     * @return The descriptor. -1 if the port is closed.
+     */
+    int getFd() const;
+    
+    /**
+     * @brief Changes the baudrate of the port opened
+     * 
+     * @param baud Baudrate
+     * 
+     * @return RM_SERIAL_OK or the error code
+     */
+    int setBaudrate(uint32_t baud);
+    
+    /**
+     * @brief Sets the low latency mode of the driver
+     * 
+     * Sets ASYNC_LOW_LATENCY, so the driver pushes the received bytes at once
+     * instead of buffering them for a few milliseconds. Kept for the next
+     * ports opened.
+     * 
+     * @param en True for enable and false for otherwise
+     * 
+     * @return RM_SERIAL_OK, or RM_SERIAL_UNSUPPORTED if the driver does not
+     *         have the flag, like PTYs
+     */
+    int setLowLatency(bool en);
+    
+    /**
+     * @brief Reads the bytes received
+     * 
+     * @param buf Destination buffer
+     * @param len Size of the buffer
+     * 
+     * @return Number of bytes read, 0 if there is nothing to read, or the
+     *         error code
+     */
+    long read(uint8_t* buf, size_t len);
+    
+    /**
+     * @brief Writes as many bytes as the driver takes now
+     * 
+     * @param buf Source buffer
+     * @param len Number of bytes
+     * 
+     * @return Number of bytes written, 0 if the driver's buffer is full, or
+     *         the error code
+     */
+    long write(const uint8_t* buf, size_t len);
+    
+    /**
+     * @brief Waits for the port to be readable or writable
+     * 
+     * @param writable False to wait for the bytes to read, true to wait for
+     *                 the room to write
+     * @param timeout Milliseconds to wait at most. -1 to wait forever.
+     * 
+     * @return RM_SERIAL_OK if ready, RM_SERIAL_AGAIN on timeout or the error
+     *         code
+     */
+    int wait(bool writable, int timeout);
+    
+    /**
+     * @brief Reads the line errors the driver counted on the port
+     * 
+     * @param counts Output counters
+     * 
+     * @return RM_SERIAL_OK, or RM_SERIAL_UNSUPPORTED if the driver does not
+     *         count the errors
+     */
+    int getErrorCounts(serial::ErrorCounts* counts);
+    
+    /**
+     * @brief Gets the errno of the last system error
+     * 
+     * @return The errno behind the last RM_SERIAL_IO and the other codes
+     *         that come from a system call
+     */
+    int getErrno() const;
+    
+    /**
+     * @brief Describes an error code
+     * 
+     * @param err The error code
+     * 
+     * @return A message in English
+     */
+    static const char* getErrorString(int err);
+};
+
+#endif
@@ -0,0 +1,257 @@
+/**
+ * @file session.hpp
+ * @brief Binary log of the sync table updates of a session
+ * 
+ * Records every update of the sync tables with the time it arrived, so a run
+ * can be converted for the analysis tools afterwards with rmexport. The
+ * numbers are written as received, without any formatting.
+ * 
+ * The file starts with the header below. Then follow the records, each a
+ * kind byte, the sync table ID and the 32-bit length of the body. A schema
+ * record lists the columns of a table as a 16-bit count followed by the wire
+ * data type, the length and the characters of each name. It is written
+ * before the first row of a table and again whenever its list changes. A row
+ * record holds the 64-bit time in microseconds since the epoch followed by
+ * each value of the table, 4 bytes for a number and a length byte followed
+ * by the characters for a string. All the numbers are little endian.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_SESSION_H__
+#define __RM_SESSION_H__ ///< Header guard
+
+#ifndef RM_API
+#ifdef _WIN32
+#ifdef RM_EXPORT
+#define RM_API __declspec(dllexport) ///< API
+#else
+#define RM_API __declspec(dllimport) ///< API
+#endif
+#else
+#define RM_API ///< API
+#endif
+#endif
+
+
+#include "sync.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+#define RM_SESSION_VERSION 1 ///< Version of the file format
+
+#define RM_SESSION_SCHEMA 0x01 ///< Record listing the columns of a table
+#define RM_SESSION_ROW    0x02 ///< Record holding the values of a table
+
+#define RM_SESSION_RECORD_MAX (1 << 25) ///< Largest body of a record read
+
+
+/**
+ * @brief Header at the start of a session log
+ */
+struct rmSessionHeader {
+    char magic[8]; ///< "RMSESS" followed by nulls
+    uint32_t version; ///< RM_SESSION_VERSION
+    uint32_t reserved; ///< Zero
+    int64_t startTime; ///< Microseconds since the epoch at the start
+};
+
+
+/**
+ * @brief A column of a sync table
+ */
+struct RM_API rmSessionColumn {
+    std::string name; ///< Name of the attribute
+    uint8_t type; ///< Wire data type code
+};
+
+
+/**
+ * @brief A record read from a session log
+ */
+struct RM_API rmSessionRecord {
+    uint8_t kind = 0; ///< RM_SESSION_SCHEMA or RM_SESSION_ROW
+    uint8_t table = 0; ///< ID of the sync table
+    std::vector<uint8_t> body; ///< The body as written
+};
+
+
+/**
+ * @brief Records the sync table updates of a session
+ * 
+ * Given to the client with rmClient::setSessionRecorder. The rows are
+ * written from the connection thread through a large file buffer. A table
+ * split into several lines by the device gets a row for each part.
+ */
+class RM_API rmSessionRecorder {
+  private:
+    FILE* file = nullptr;
+    std::vector<std::vector<rmAttribute*>> attributes;
+    std::vector<std::string> types;
+    std::vector<uint8_t> buffer;
+    std::mutex m;
+    
+    void writeSchema(const rmSync* sync);
+  
+  public:
+    /**
+     * @brief Default constructor
+     */
+    rmSessionRecorder() = default;
+    
+    /**
+     * @brief Destructor
+     * 
+     * Closes the file.
+     */
+    ~rmSessionRecorder();
+    
+    /**
+     * @brief Copy constructor (deleted)
+     * 
+     * @param rec Source
+     */
+    rmSessionRecorder(const rmSessionRecorder& rec) = delete;
+    
+    /**
+     * @brief Copy assignment (deleted)
+     * 
+     * @param rec Source
+     */
+    rmSessionRecorder& operator=(const rmSessionRecorder& rec) = delete;
+    
+    /**
+     * @brief Creates a session log
+     * 
+     * An existing file is replaced.
+     * 
+     * @param path Path of the file
+     * 
+     * @return True on success
+     */
+    bool open(const char* path);
+    
+    /**
+     * @brief Writes the rest of the buffer and closes the file
+     */
+    void close();
+    
+    /**
+     * @brief Checks if a file is open
+     * 
+     * @return True if open
+     */
+    bool isOpen() const;
+    
+    /**
+     * @brief Writes the buffered records to the file
+     */
+    void flush();
+    
+    /**
+     * @brief Records the current values of a sync table
+     * 
+     * @param sync The sync table just updated
+     */
+    void record(const rmSync* sync);
+};
+
+
+/**
+ * @brief Reads the records of a session log in order
+ */
+class RM_API rmSessionReader {
+  private:
+    FILE* file = nullptr;
+    rmSessionHeader header;
+    bool corrupt = false;
+  
+  public:
+    /**
+     * @brief Default constructor
+     */
+    rmSessionReader() = default;
+    
+    /**
+     * @brief Destructor
+     * 
+     * Closes the file.
+     */
+    ~rmSessionReader();
+    
+    /**
+     * @brief Copy constructor (deleted)
+     * 
+     * @param reader Source
+     */
+    rmSessionReader(const rmSessionReader& reader) = delete;
+    
+    /**
+     * @brief Copy assignment (deleted)
+     * 
+     * @param reader Source
+     */
+    rmSessionReader& operator=(const rmSessionReader& reader) = delete;
+    
+    /**
+     * @brief Opens a session log
+     * 
+     * @param path Path of the file
+     * 
+     * @return False if the file cannot be opened or is not a session log
+     */
+    bool open(const char* path);
+    
+    /**
+     * @brief Closes the file
+     */
+    void close();
+    
+    /**
+     * @brief Gets the time the session started
+     * 
+     * @return Microseconds since the epoch
+     */
+    int64_t getStartTime() const;
+    
+    /**
+     * @brief Reads the next record
+     * 
+     * A record cut short or with a size beyond RM_SESSION_RECORD_MAX ends
+     * the reading and is reported by isCorrupt().
+     * 
+     * @param rec Output record. Its buffer is reused.
+     * 
+     * @return False at the end of the file or on a corrupt record
+     */
+    bool next(rmSessionRecord* rec);
+    
+    /**
+     * @brief Checks if the reading stopped at a corrupt record
+     * 
+     * @return True if next() found a record cut short or too large
+     */
+    bool isCorrupt() const;
+    
+    /**
+     * @brief Decodes the columns of a schema record
+     * 
+     * @param rec The schema record
+     * @param columns Output columns
+     * 
+     * @return False if the record is malformed
+     */
+    static bool parseSchema(const rmSessionRecord& rec,
+                            std::vector<rmSessionColumn>* columns);
+};
+
+#endif
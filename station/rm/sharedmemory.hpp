@@ -0,0 +1,239 @@
+/**
+ * @file sharedmemory.hpp
+ * @brief Mirror of the attribute values in shared memory
+ * 
+ * The values of the attributes are copied into a POSIX shared memory object
+ * as they change. Other processes on the same machine read the latest value
+ * of an attribute straight from the memory without a system call and without
+ * ever blocking the client.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_SHAREDMEMORY_H__
+#define __RM_SHAREDMEMORY_H__ ///< Header guard
+
+#ifndef RM_API
+#ifdef _WIN32
+#ifdef RM_EXPORT
+#define RM_API __declspec(dllexport) ///< API
+#else
+#define RM_API __declspec(dllimport) ///< API
+#endif
+#else
+#define RM_API ///< API
+#endif
+#endif
+
+
+#include "attribute.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+
+#ifndef RM_SHARED_SLOT_COUNT
+#define RM_SHARED_SLOT_COUNT 1024 ///< Number of attributes mirrored at most
+#endif
+
+#define RM_SHARED_VERSION 1 ///< Version of the memory layout
+#define RM_SHARED_STRING_SIZE 128 ///< Size of a string value with the null
+#define RM_SHARED_READ_TRIES 10000 ///< Reads of a slot being written at most
+
+
+/**
+ * @brief Header at the start of the shared memory
+ */
+struct rmSharedHeader {
+    char magic[8]; ///< "RMSHM" followed by nulls
+    uint32_t version; ///< RM_SHARED_VERSION
+    uint32_t capacity; ///< Number of slots
+    uint32_t slotSize; ///< Size of a slot in bytes
+    std::atomic<uint32_t> count; ///< Number of slots in use
+    int64_t pid; ///< Process that writes the memory
+};
+
+
+/**
+ * @brief A slot holding the value of an attribute
+ * 
+ * The slot is written with a sequence lock. The sequence is odd while the
+ * value is being written and increases by two with each write, so a reader
+ * copies the value and retries if the sequence has changed meanwhile. The
+ * fields a number needs are in the first cache line.
+ */
+struct alignas(64) rmSharedSlot {
+    std::atomic<uint32_t> sequence; ///< Sequence lock
+    uint8_t type; ///< rmAttributeDataType of the value
+    uint8_t reserved[3]; ///< Padding
+    char name[12]; ///< Name of the attribute
+    rmAttributeData data; ///< The value other than a string
+    int64_t time; ///< Milliseconds since the epoch of the last write
+    char str[RM_SHARED_STRING_SIZE]; ///< The value of a string
+};
+
+
+/**
+ * @brief The value of an attribute as read from the shared memory
+ */
+struct RM_API rmSharedValue {
+    rmAttributeDataType type = RM_ATTRIBUTE_INT; ///< Data type of the value
+    rmAttributeData data; ///< The value other than a string
+    char str[RM_SHARED_STRING_SIZE] = {0}; ///< The value of a string
+    int64_t time = 0; ///< Milliseconds since the epoch of the last write
+    uint32_t sequence = 0; ///< Increases with each write
+};
+
+
+/**
+ * @brief Mirror of the attribute values in shared memory
+ * 
+ * Used by the client to write the values into the memory as they change. A
+ * slot is given to each attribute on its first write, so the slot index
+ * stays the same for as long as the memory exists. The names of the slots are
+ * stored with them for the readers to look up.
+ */
+class RM_API rmSharedMemory {
+  private:
+    std::string name;
+    uint8_t* memory = nullptr;
+    size_t size = 0;
+    rmSharedHeader* header = nullptr;
+    rmSharedSlot* slots = nullptr;
+    bool owner = false;
+    std::unordered_map<rmAttribute*, uint32_t> ids;
+    std::mutex m;
+    
+    bool map(const char* shmName, bool create);
+  
+  public:
+    /**
+     * @brief Default constructor
+     */
+    rmSharedMemory() = default;
+    
+    /**
+     * @brief Destructor
+     * 
+     * Unmaps the memory and removes it if this object created it.
+     */
+    ~rmSharedMemory();
+    
+    /**
+     * @brief Copy constructor (deleted)
+     * 
+     * @param shm Source
+     */
+    rmSharedMemory(const rmSharedMemory& shm) = delete;
+    
+    /**
+     * @brief Copy assignment (deleted)
+     * 
+     * @param shm Source
+     */
+    rmSharedMemory& operator=(const rmSharedMemory& shm) = delete;
+    
+    /**
+     * @brief Creates the shared memory to write to
+     * 
+     * An existing object of the same name is replaced.
+     * 
+     * @param shmName Name of the object starting with a slash, such as
+     *                "/rmonitor"
+     * 
+     * @return True on success. Always false on Windows.
+     */
+    bool create(const char* shmName);
+    
+    /**
+     * @brief Opens the shared memory of another process to read from
+     * 
+     * @param shmName Name of the object
+     * 
+     * @return True on success
+     */
+    bool open(const char* shmName);
+    
+    /**
+     * @brief Unmaps the memory and removes it if this object created it
+     */
+    void close();
+    
+    /**
+     * @brief Checks if the memory is mapped
+     * 
+     * @return True if mapped
+     */
+    bool isOpen() const;
+    
+    /**
+     * @brief Writes the value of an attribute
+     * 
+     * The writes are serialised, so any thread may call it. Attributes beyond
+     * the capacity are not mirrored. Does nothing on the memory opened to
+     * read.
+     * 
+     * @param attr The attribute
+     */
+    void update(rmAttribute* attr);
+    
+    /**
+     * @brief Gets the number of slots in use
+     * 
+     * @return Number of attributes mirrored
+     */
+    size_t getCount() const;
+    
+    /**
+     * @brief Finds the slot of an attribute
+     * 
+     * @param key Name of the attribute
+     * 
+     * @return Index of the slot. -1 if not found.
+     */
+    int find(const char* key) const;
+    
+    /**
+     * @brief Gets the name of the attribute in a slot
+     * 
+     * @param i Index of the slot
+     * 
+     * @return The name. Null if the slot is not in use.
+     */
+    const char* getName(size_t i) const;
+    
+    /**
+     * @brief Reads the latest value of a slot
+     * 
+     * Never blocks the writer. Retries while the value is being written, up
+     * to RM_SHARED_READ_TRIES times.
+     * 
+     * @param i Index of the slot
+     * @param value Output value
+     * 
+     * @return False if the slot is not in use or if the writer never
+     *         finished writing it, as when its process died in the middle of
+     *         a write
+     */
+    bool read(size_t i, rmSharedValue* value) const;
+    
+    /**
+     * @brief Reads the latest value of a slot as a number
+     * 
+     * @param i Index of the slot
+     * 
+     * @return The value. NAN for a string, if the slot is not in use or if
+     *         the writer never finished writing it.
+     */
+    float readFloat(size_t i) const;
+};
+
+#endif
@@ -31,6 +31,7 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <vector>
 
 
 class rmAttribute;
@@ -46,15 +47,35 @@ class rmClient;
  */
 class RM_API rmSync {
   private:
+    uint8_t* block = nullptr;
     rmAttribute** attributes = nullptr;
+    float* values = nullptr;
+    uint32_t* raws = nullptr;
+    uint8_t* types = nullptr;
+    bool* received = nullptr;
+    std::vector<uint8_t*> retired;
+    size_t capacity = 0;
     size_t count = 0;
+    uint32_t revision = 0;
+    bool complete = false;
+    uint8_t id = 0;
     
+    void reserve(size_t n);
+    void store(size_t i, uint32_t raw);
+  
   public:
     /**
      * @brief Default constructor
      */
     rmSync() = default;
     
+    /**
+     * @brief Constructs an empty sync table with an ID
+     * 
+     * @param i The sync table ID used by the client device
+     */
+    rmSync(uint8_t i);
+    
     /**
      * @brief Destructor
      */
@@ -72,7 +93,7 @@ class RM_API rmSync {
      * 
      * @param sync Source
      */
-    rmSync(rmSync&& sync) noexcept = default;
+    rmSync(rmSync&& sync) noexcept;
     
     /**
      * @brief Copy assignment (deleted)
@@ -86,7 +107,7 @@ class RM_API rmSync {
      * 
      * @param sync Source
      */
-    rmSync& operator=(rmSync&& sync) noexcept = default;
+    rmSync& operator=(rmSync&& sync) noexcept;
     
     /**
      * @brief Gets the attribute count in the table
@@ -95,20 +116,133 @@ class RM_API rmSync {
      */
     size_t getCount() const;
     
+    /**
+     * @brief Empties the attribute list
+     * 
+     * The arrays are kept, so the pointers read from the table stay valid.
+     */
+    void clear();
+    
+    /**
+     * @brief Gets the sync table ID
+     * 
+     * @return The ID used by the client device
+     */
+    uint8_t getID() const;
+    
+    /**
+     * @brief Checks if the whole attribute list has been received
+     * 
+     * @return True if the list is complete
+     */
+    bool isComplete() const;
+    
+    /**
+     * @brief Gets the decoded values of the table
+     * 
+     * The values are kept in a plain array in the order of the client
+     * device's list so that the widgets and plots can read them without
+     * going through the attributes. The arrays only move when the table
+     * grows, and the old ones are kept along with the table, so a pointer
+     * read before stays valid but is to be read again for the new values.
+     * 
+     * @return The numeric value of each attribute. NAN for the strings and the
+     *         values not received yet.
+     */
+    const float* getValues() const;
+    
+    /**
+     * @brief Gets the raw values of the table
+     * 
+     * The numbers as received, the 32-bit integers with the signed types
+     * extended or the bits of the floats. Integers too large for a float
+     * keep their precision here.
+     * 
+     * @return The raw value of each attribute. 0 for the strings and the
+     *         values not received yet.
+     */
+    const uint32_t* getRaws() const;
+    
+    /**
+     * @brief Gets the data types of the table
+     * 
+     * @return The wire data type code of each attribute
+     */
+    const uint8_t* getTypes() const;
+    
+    /**
+     * @brief Gets an attribute of the table
+     * 
+     * @param i Index of the attribute in the table
+     * 
+     * @return The attribute. Null if the index is out of range.
+     */
+    rmAttribute* getAttribute(size_t i) const;
+    
+    /**
+     * @brief Looks for an attribute in the table by name
+     * 
+     * @param key Name of the attribute
+     * 
+     * @return Index of the attribute. The attribute count if the table does
+     *         not have the attribute.
+     */
+    size_t getIndex(const char* key) const;
+    
+    /**
+     * @brief Gets the update counter of the table
+     * 
+     * The counter increases whenever a value of the table changes so that the
+     * readers can poll for new data cheaply.
+     * 
+     * @return The number of value changes since the table was created
+     */
+    uint32_t getRevision() const;
+    
     /**
      * @breif Updates the attribute values
      * 
      * @param str The string representing the values of the list
+     * @param start Index of the first value in the string
+     */
+    void onSync(const char* str, size_t start=0);
+    
+    /**
+     * @brief Updates the attributes changed since the last update
+     * 
+     * @param str Comma-separated pairs of the attribute index and the value
+     *            such as "0:1.25,3:7"
      */
-    void onSync(const char* str);
+    void onSyncDelta(const char* str);
+    
+    /**
+     * @brief Updates the attribute values from a binary frame
+     * 
+     * @param data The values encoded in the client device's data types
+     * @param len Length of the data
+     * @param delta True if each value is preceded by its index, false if the
+     *              data contains the values of the list in order
+     * @param start Index of the first value if not delta
+     */
+    void onSyncBinary(const uint8_t* data, size_t len, bool delta,
+                      size_t start=0);
     
     /**
      * @breif Retrive the list of attributes to work in a sync
      * 
+     * A list ending with '+' and an index is continued by requesting the rest
+     * from that index, and the reply starts with '@' and the same index.
+     * 
+     * The attributes not created by the widgets yet are created with the
+     * types in the list.
+     * 
      * @param str The string containing the name of every attribute
      * @param cli The client instance
+     * @param request False if the device sends the whole list by itself, in
+     *                which case neither the rest of the list nor a keyframe
+     *                is requested
      */
-    void updateList(const char* str, rmClient* cli);
+    void updateList(const char* str, rmClient* cli, bool request=true);
 };
 
 #endif
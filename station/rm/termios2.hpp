@@ -0,0 +1,51 @@
+/**
+ * @file termios2.hpp
+ * @brief The kernel's termios2 to set any baudrate on Linux
+ * 
+ * Shared by rmSerialFd and the serial library under serial/impl. Only
+ * included by the library's own sources and not installed with the public
+ * headers.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_TERMIOS2_H__
+#define __RM_TERMIOS2_H__ ///< Header guard
+
+
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <termios.h>
+#endif
+
+
+#if defined(__linux__) && defined(TCGETS2) && defined(CBAUD) && \
+    defined(CIBAUD) && (defined(__i386__) || defined(__x86_64__) || \
+    defined(__arm__) || defined(__aarch64__) || defined(__riscv))
+/**
+ * @brief The termios2 of <asm/termbits.h>
+ * 
+ * Declared here as <asm/termbits.h> conflicts with <termios.h>. Its layout
+ * differs on a few other architectures, which do without it.
+ */
+struct termios2 {
+    tcflag_t c_iflag; ///< Input modes
+    tcflag_t c_oflag; ///< Output modes
+    tcflag_t c_cflag; ///< Control modes
+    tcflag_t c_lflag; ///< Local modes
+    cc_t c_line; ///< Line discipline
+    cc_t c_cc[19]; ///< Control characters
+    speed_t c_ispeed; ///< Input speed
+    speed_t c_ospeed; ///< Output speed
+};
+#ifndef BOTHER
+#define BOTHER 0010000 ///< Speed given in c_ispeed and c_ospeed
+#endif
+#define RM_HAVE_TERMIOS2 ///< termios2 and BOTHER are available
+#endif
+
+#endif
@@ -7,6 +7,11 @@
  * function. If the default multithreading is used, there will be data races
  * and conflict with data and event systems of wxWidgets.
  * 
+ * Each tick processes the clients for a limited time, so a burst of data
+ * is spread over several ticks instead of holding up the window. The
+ * interval follows the rate of the data coming in, short while it is busy
+ * and longer while it is quiet.
+ * 
  * @copyright Copyright (c) 2021 Khant Kyaw Khaung
  * 
  * @license{This project is released under the MIT License.}
@@ -32,9 +37,27 @@
 
 #include "timerbase.hpp"
 
+#include <cstddef>
+#include <cstdint>
+
 #include <wx/timer.h>
 
 
+#ifndef RM_TIMER_BUDGET
+#define RM_TIMER_BUDGET 4000 ///< Time to process the clients per tick in us
+#endif
+
+#ifndef RM_TIMER_MIN_INTERVAL
+#define RM_TIMER_MIN_INTERVAL 1 ///< Shortest interval in ms, while busy
+#endif
+
+#ifndef RM_TIMER_MAX_INTERVAL
+#define RM_TIMER_MAX_INTERVAL 50 ///< Longest interval in ms, while quiet
+#endif
+
+#define RM_TIMER_TICK_BYTES 256 ///< Bytes the interval is set to gather
+
+
 /**
  * @brief the wxTimer to handle the idle function of the client
  * 
@@ -46,9 +69,16 @@
 class RM_WX_API rmTimer: public rmTimerBase, public wxTimer {
   private:
     long wx_id = 0;
+    long budget = RM_TIMER_BUDGET;
+    long minInterval = RM_TIMER_MIN_INTERVAL;
+    long maxInterval = RM_TIMER_MAX_INTERVAL;
+    size_t first = 0;
+    float rate = 0;
+    int64_t lastTick = 0;
     
     long getWxID();
-    
+    void adaptInterval(size_t bytes, bool busy, int64_t elapsed);
+  
   public:
     /**
      * @brief Default constructor
@@ -67,6 +97,30 @@ class RM_WX_API rmTimer: public rmTimerBase, public wxTimer {
      */
     void stop() override;
     
+    /**
+     * @brief Sets the time to process the clients in each tick
+     * 
+     * @param us Time in microseconds
+     */
+    void setBudget(long us);
+    
+    /**
+     * @brief Sets the range the interval adapts in
+     * 
+     * @param min Shortest interval in milliseconds, used while the clients
+     *            have more data than the budget allows
+     * @param max Longest interval in milliseconds, reached when no data
+     *            comes in
+     */
+    void setIntervalRange(long min, long max);
+    
+    /**
+     * @brief Gets the interval the timer runs at now
+     * 
+     * @return Time interval in milliseconds
+     */
+    long getInterval() const;
+    
     /**
      * @brief Timer function to be executed in each interval
      * 
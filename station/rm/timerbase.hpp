@@ -62,19 +62,24 @@ class RM_API rmTimerBase {
      */
     rmTimerBase(long ms);
     
+    /**
+     * @brief Destructor
+     */
+    virtual ~rmTimerBase() = default;
+    
     /**
      * @brief Adds a client to the list to process
      * 
      * @param cli The client device
      */
-    void appendClient(rmClient* cli);
+    virtual void appendClient(rmClient* cli);
     
     /**
      * @brief Removes a client from the list to process
      * 
      * @param cli The client device
      */
-    void removeClient(rmClient* cli);
+    virtual void removeClient(rmClient* cli);
     
     /**
      * @brief Starts the timer
@@ -23,12 +23,24 @@
 
 #include "rm/attribute.hpp"
 #include "rm/call.hpp"
+#include "rm/capi.h"
 #include "rm/client.hpp"
+#include "rm/compress.hpp"
+#include "rm/echobuffer.hpp"
+#include "rm/echostore.hpp"
+#include "rm/hotplug.hpp"
+#include "rm/hub.hpp"
+#include "rm/publisher.hpp"
+#include "rm/serialfd.hpp"
+#include "rm/session.hpp"
+#include "rm/sharedmemory.hpp"
 
 #ifndef RM_NO_WX
+#include "rm/autopanel.hpp"
 #include "rm/button.hpp"
 #include "rm/checkbox.hpp"
 #include "rm/echobox.hpp"
+#include "rm/echolog.hpp"
 #include "rm/gauge.hpp"
 #include "rm/icon.hpp"
 #include "rm/radiobox.hpp"
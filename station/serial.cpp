@@ -16,22 +16,29 @@
 
 #include "rm/serial.hpp"
 
+#include "rm/hotplug.hpp"
+#include "rm/serial_internal.hpp"
+
 #include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
-#include <thread>
+#include <cstring>
 #include <mutex>
+#include <thread>
 
 
 /**
  * @brief Default constructor
  */
 rmSerialPort::rmSerialPort()
-             :mySerial("", 9600, serial::Timeout::simpleTimeout(5000))
+             :mySerial("", 9600, serial::Timeout::simpleTimeout(
+                 RM_SERIAL_WRITE_TIMEOUT))
 {
     strcpy(portInfo.port, "");
     strcpy(portInfo.hardware_id, "n/a");
     strcpy(portInfo.description, "");
+    lastError = RM_SERIAL_OK;
 }
 
 /**
@@ -42,8 +49,36 @@ rmSerialPort::rmSerialPort()
  * @param baud Baudrate
  */
 rmSerialPort::rmSerialPort(const char* port, uint32_t baud)
-             :mySerial(port, baud, serial::Timeout::simpleTimeout(5000))
-{}
+             :rmSerialPort()
+{
+    open(port, baud);
+}
+
+// Opens the port with rmSerialFd, or with serial::Serial where it is not
+// supported. The owner reports the error kept in lastError.
+bool rmSerialPort::open(const char* port, uint32_t baud) {
+    disconnect();
+    lastError = myFd.open(port, baud);
+    if(lastError != RM_SERIAL_UNSUPPORTED)
+        return lastError == RM_SERIAL_OK;
+    
+    try {
+        mySerial.setPort(port);
+        mySerial.setBaudrate(baud);
+        mySerial.open();
+        lastError = RM_SERIAL_OK;
+    }
+    catch(std::exception& e) {
+        lastError = RM_SERIAL_IO;
+    }
+    return mySerial.isOpen();
+}
+
+// Closes the port once the device is gone or the port fails
+void rmSerialPort::onError(int err) {
+    lastError = err;
+    disconnect();
+}
 
 /**
  * @param port The address of the serial port, which would be something like
@@ -60,19 +95,12 @@ void rmSerialPort::connect(const char* port, uint32_t baud) {
             break;
         }
     }
-    if(notInList)
+    if(notInList) {
+        lastError = RM_SERIAL_DISCONNECTED;
         return;
-    
-    try {
-        if(mySerial.isOpen())
-            mySerial.close();
-        mySerial.setPort(port);
-        mySerial.setBaudrate(baud);
-        mySerial.open();
-    }
-    catch(std::exception& e) {
-        printf(e.what());
     }
+    
+    open(port, baud);
 }
 
 /**
@@ -82,25 +110,18 @@ void rmSerialPort::connect(const char* port, uint32_t baud) {
  * @param baud Baudrate
  */
 void rmSerialPort::connect(rmSerialPortInfo portInfo, uint32_t baud) {
-    try {
-        if(mySerial.isOpen())
-            mySerial.close();
-        mySerial.setPort(portInfo.port);
-        mySerial.setBaudrate(baud);
-        mySerial.open();
+    if(open(portInfo.port, baud))
         this->portInfo = portInfo;
-    }
-    catch(std::exception& e) {
-        printf(e.what());
-    }
 }
 
 /**
  * @brief Closes the serial port
  */
 void rmSerialPort::disconnect() {
+    myFd.close();
     try {
-        mySerial.close();
+        if(mySerial.isOpen())
+            mySerial.close();
     }
     catch(std::exception& e) {
         printf(e.what());
@@ -112,7 +133,9 @@ void rmSerialPort::disconnect() {
  * 
  * @return True if the serial port is opened and false otherwise
  */
-bool rmSerialPort::isConnected() { return mySerial.isOpen(); }
+bool rmSerialPort::isConnected() {
+    return myFd.isOpen() || mySerial.isOpen();
+}
 
 /**
  * @brief Reads a character from the serial port
@@ -122,23 +145,68 @@ bool rmSerialPort::isConnected() { return mySerial.isOpen(); }
  */
 char rmSerialPort::read() {
     uint8_t c = 0;
+    read(&c, 1);
+    return (char) c;
+}
+
+/**
+ * @brief Reads the available bytes from the serial port
+ * 
+ * @param buf Destination buffer
+ * @param len Size of the buffer
+ * 
+ * @return Number of bytes read. 0 if there is nothing to read.
+ */
+size_t rmSerialPort::read(uint8_t* buf, size_t len) {
+    if(myFd.isOpen()) {
+        long n = myFd.read(buf, len);
+        if(n >= 0)
+            return (size_t) n;
+        onError((int) n);
+        return 0;
+    }
+    
+    size_t n = 0;
     try {
-        if(mySerial.available())
-            mySerial.read(&c, 1);
+        size_t available = mySerial.available();
+        if(available > 0)
+            n = mySerial.read(buf, (available < len) ? available : len);
     }
     catch(std::exception& e) {
         printf(e.what());
         disconnect();
     }
-    return (char) c;
+    return n;
 }
 
 /**
  * @brief Writes a string to the serial port
  * 
+ * Waits up to RM_SERIAL_WRITE_TIMEOUT for the driver to take the whole
+ * string. The rest is dropped after that.
+ * 
  * @param msg A null-terminating string
  */
 void rmSerialPort::write(const char* msg) {
+    if(myFd.isOpen()) {
+        const uint8_t* p = (const uint8_t*) msg;
+        size_t len = strlen(msg);
+        while(len > 0) {
+            long n = myFd.write(p, len);
+            if(n == 0)
+                n = myFd.wait(true, RM_SERIAL_WRITE_TIMEOUT);
+            if(n == RM_SERIAL_AGAIN)
+                return;
+            if(n < 0) {
+                onError((int) n);
+                return;
+            }
+            p += n;
+            len -= n;
+        }
+        return;
+    }
+    
     try {
         mySerial.write(msg);
     }
@@ -148,6 +216,14 @@ void rmSerialPort::write(const char* msg) {
     }
 }
 
+/**
+ * @brief Gets the error which closed the port or kept it from opening
+ * 
+ * @return RM_SERIAL_OK, or one of the error codes of rmSerialFd. Described
+ *         by rmSerialFd::getErrorString().
+ */
+int rmSerialPort::getError() const { return lastError; }
+
 /**
  * @brief Gets the port info
  * 
@@ -155,6 +231,46 @@ void rmSerialPort::write(const char* msg) {
  */
 rmSerialPortInfo rmSerialPort::getInfo() { return portInfo; }
 
+/**
+ * @brief Reads the line errors the driver counted on the port
+ * 
+ * @param counts Output counters
+ * 
+ * @return False if the port is closed or the driver does not count the
+ *         errors
+ */
+bool rmSerialPort::getErrorCounts(serial::ErrorCounts* counts) {
+    if(myFd.isOpen())
+        return myFd.getErrorCounts(counts) == RM_SERIAL_OK;
+    try {
+        return mySerial.isOpen() && mySerial.getErrorCounts(counts);
+    }
+    catch(std::exception& e) {
+        return false;
+    }
+}
+
+/**
+ * @brief Sets the low latency mode of the port
+ * 
+ * The driver pushes the received bytes at once instead of buffering them
+ * for a few milliseconds. Kept for the next connections.
+ * 
+ * @param lowLatency True to favour latency over CPU time
+ */
+void rmSerialPort::setLowLatency(bool lowLatency) {
+    myFd.setLowLatency(lowLatency);
+    mySerial.setLowLatency(lowLatency);
+}
+
+/**
+ * @brief Gets the file descriptor to wait on for the bytes received
+ * 
+ * @return The descriptor. -1 if the port is closed or is not a descriptor
+ *         of rmSerialFd.
+ */
+int rmSerialPort::getFd() const { return myFd.getFd(); }
+
 /**
  * @brief Gets a list of devices available on the serial ports
  * 
@@ -167,12 +283,14 @@ rmSerialPortList rmSerialPort::listPorts() {
         rmSerialPortInfo portInfo;
         if(it->hardware_id == "n/a")
             continue;
-        strncpy(portInfo.port, it->port.c_str(), 15);
-        strncpy(portInfo.hardware_id, it->hardware_id.c_str(), 23);
-        strncpy(portInfo.description, it->description.c_str(), 63);
-        portInfo.port[15] = '\0';
-        portInfo.hardware_id[23] = '\0';
-        portInfo.description[63] = '\0';
+        strncpy(portInfo.port, it->port.c_str(), sizeof(portInfo.port) - 1);
+        strncpy(portInfo.hardware_id, it->hardware_id.c_str(),
+                sizeof(portInfo.hardware_id) - 1);
+        strncpy(portInfo.description, it->description.c_str(),
+                sizeof(portInfo.description) - 1);
+        portInfo.port[sizeof(portInfo.port) - 1] = '\0';
+        portInfo.hardware_id[sizeof(portInfo.hardware_id) - 1] = '\0';
+        portInfo.description[sizeof(portInfo.description) - 1] = '\0';
         myPortList.push_back(portInfo);
     }
     return myPortList;
@@ -184,48 +302,88 @@ rmSerialPortList rmSerialPort::listPorts() {
 static void (*callback)() = nullptr;
 static std::thread thread;
 static std::mutex m;
+static std::condition_variable cv;
+static bool changed = false;
+
+
+// Wakes the detection thread instead of listing the ports every 200 ms
+class rmPortThreadListener: public rmHotplugListener {
+  public:
+    void onPortAdded(const rmSerialPortInfo& info) override { wake(); }
+    
+    void onPortRemoved(const rmSerialPortInfo& info) override { wake(); }
+    
+    void wake() {
+        m.lock();
+        changed = true;
+        m.unlock();
+        cv.notify_one();
+    }
+};
+
+static rmPortThreadListener listener;
+
 
 static void endPortDetection() {
+    rmHotplug::removeListener(&listener);
     m.lock();
     callback = nullptr;
     m.unlock();
+    cv.notify_one();
     if(thread.joinable())
         thread.join();
 }
 
-static void portDetectionThread() {
-    size_t count = 0;
-    do {
-        m.lock();
-        auto ports = serial::list_ports();
-        if(ports.size() != count) {
+static void portDetectionThread(bool hotplug) {
+    rmSerialPortList prev;
+    std::unique_lock<std::mutex> lock(m);
+    while(callback != nullptr) {
+        changed = false;
+        lock.unlock();
+        rmSerialPortList ports = rmHotplug::getPorts();
+        lock.lock();
+        if(callback != nullptr && !rmIsSamePortList(ports, prev)) {
             callback();
-            count = ports.size();
+            prev = ports;
         }
-        m.unlock();
-        std::this_thread::sleep_for(std::chrono::milliseconds(200));
-    } while(true);
+        auto woken = [] { return changed || callback == nullptr; };
+        if(hotplug)
+            cv.wait(lock, woken);
+        else
+            cv.wait_for(lock, std::chrono::milliseconds(200), woken);
+    }
 }
 
 /**
  * @brief Sets a callback function on serial port detected
  * 
- * The callback is triggered whenever the number of elements from
- * listPorts() is changed. This is when a new port is detected or when an
- * existing port is missing.
+ * The callback is triggered whenever the list from listPorts() is changed.
+ * This is when a new port is detected or when an existing port is missing.
+ * Where rmHotplug is supported, the ports are not listed again until a
+ * device is plugged in or out.
  * 
  * @param func The callback function
  */
 void rmSerialPort::setOnPortDetected(void (*func)()) {
+    if(func == nullptr) {
+        endPortDetection();
+        return;
+    }
+    
     m.lock();
-    if(callback == nullptr)
-        thread = std::thread(&portDetectionThread);
+    bool toStart = (callback == nullptr);
     callback = func;
+    m.unlock();
+    if(toStart) {
+        if(thread.joinable())
+            thread.join();
+        bool hotplug = rmHotplug::addListener(&listener);
+        thread = std::thread(&portDetectionThread, hotplug);
+    }
     
     static bool atexitAdded = false;
     if(!atexitAdded) {
         atexit(endPortDetection);
         atexitAdded = true;
     }
-    m.unlock();
 }
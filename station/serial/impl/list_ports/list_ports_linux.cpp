@@ -16,8 +16,14 @@
 #include <cstdio>
 #include <cstdarg>
 #include <cstdlib>
-
-#include <glob.h>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include <dirent.h>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -30,47 +36,73 @@ using std::ifstream;
 using std::getline;
 using std::vector;
 using std::string;
+using std::map;
 using std::cout;
 using std::endl;
 
-static vector<string> glob(const vector<string>& patterns);
+struct candidate
+{
+    string name;
+    ino_t inode;
+};
+
+static vector<candidate> list_candidates(const string& dev_dir);
 static string basename(const string& path);
 static string dirname(const string& path);
 static bool path_exists(const string& path);
 static string realpath(const string& path);
 static string usb_sysfs_friendly_name(const string& sys_usb_path);
-static vector<string> get_sysfs_info(const string& device_path);
+static vector<string> get_sysfs_info(const string& device_path,
+                                     const string& sys_dir);
 static string read_line(const string& file);
 static string usb_sysfs_hw_string(const string& sysfs_path);
 static string format(const char* format, ...);
 
-vector<string>
-glob(const vector<string>& patterns)
+// The names serial ports take under the device directory
+static const char* candidate_prefixes[] = {
+    "ttyACM", "ttyS", "ttyUSB", "tty.", "cu."
+};
+
+static bool
+operator<(const candidate& a, const candidate& b)
 {
-    vector<string> paths_found;
+    return a.name < b.name;
+}
 
-	if(patterns.size() == 0)
-	    return paths_found;
+vector<candidate>
+list_candidates(const string& dev_dir)
+{
+    vector<candidate> names;
 
-    glob_t glob_results;
+    DIR* dir = opendir(dev_dir.c_str());
 
-    glob(patterns[0].c_str(), 0, NULL, &glob_results);
+    if(dir == NULL)
+        return names;
 
-    vector<string>::const_iterator iter = patterns.begin();
+    struct dirent* entry;
 
-    while(++iter != patterns.end())
+    while((entry = readdir(dir)) != NULL)
     {
-        glob(iter->c_str(), GLOB_APPEND, NULL, &glob_results);
-    }
+        for(size_t i = 0; i < sizeof(candidate_prefixes) / sizeof(char*); i++)
+        {
+            const char* prefix = candidate_prefixes[i];
 
-    for(int path_index = 0; path_index < (int) glob_results.gl_pathc; path_index++)
-    {
-        paths_found.push_back(glob_results.gl_pathv[path_index]);
+            if(strncmp(entry->d_name, prefix, strlen(prefix)) == 0)
+            {
+                candidate c;
+                c.name = entry->d_name;
+                c.inode = entry->d_ino;
+                names.push_back(c);
+                break;
+            }
+        }
     }
 
-    globfree(&glob_results);
+    closedir(dir);
 
-    return paths_found;
+    std::sort(names.begin(), names.end());
+
+    return names;
 }
 
 string
@@ -145,7 +177,7 @@ usb_sysfs_friendly_name(const string& sys_usb_path)
 }
 
 vector<string>
-get_sysfs_info(const string& device_path)
+get_sysfs_info(const string& device_path, const string& sys_dir)
 {
     string device_name = basename( device_path );
 
@@ -153,7 +185,7 @@ get_sysfs_info(const string& device_path)
 
     string hardware_id;
 
-    string sys_device_path = format( "/sys/class/tty/%s/device", device_name.c_str() );
+    string sys_device_path = format( "%s/class/tty/%s/device", sys_dir.c_str(), device_name.c_str() );
 
     if( device_name.compare(0,6,"ttyUSB") == 0 )
     {
@@ -294,42 +326,169 @@ usb_sysfs_hw_string(const string& sysfs_path)
     return format("USB VID:PID=%s:%s %s", vid.c_str(), pid.c_str(), serial_number.c_str() );
 }
 
+PortInfo
+serial::get_port_info(const string& port)
+{
+    vector<string> sysfs_info = get_sysfs_info( port, "/sys" );
+
+    PortInfo device_entry;
+    device_entry.port = port;
+    device_entry.description = sysfs_info[0];
+    device_entry.hardware_id = sysfs_info[1];
+
+    return device_entry;
+}
+
+// A port described before, valid while its device node is the same
+struct cached_port
+{
+    ino_t inode;
+    struct timespec mtime;
+    bool listed;
+    PortInfo info;
+};
+
+// The cached ports of each pair of the device and sysfs directories
+static map<string, map<string, cached_port> > port_cache;
+static std::mutex port_cache_mutex;
+
+// Below this many ports to probe, starting the threads costs more than the
+// reads it spreads
+#define PARALLEL_PROBE_MIN 16
+
+static void
+probe_port(const string& sys_dir, cached_port* entry)
+{
+    string device_name = basename( entry->info.port );
+
+    // The placeholders of the legacy serial driver have no hardware ID, which
+    // the ID file of the PNP devices alone gives
+    if( device_name.compare(0,4,"ttyS") == 0 )
+    {
+        string sys_id_path = format( "%s/class/tty/%s/device/id", sys_dir.c_str(), device_name.c_str() );
+
+        if( !path_exists( sys_id_path ) )
+        {
+            entry->listed = false;
+            return;
+        }
+    }
+
+    vector<string> sysfs_info = get_sysfs_info( entry->info.port, sys_dir );
+
+    entry->info.description = sysfs_info[0];
+    entry->info.hardware_id = sysfs_info[1];
+    entry->listed = true;
+}
+
+static void
+probe_ports(const string& sys_dir, const vector<cached_port*>& entries)
+{
+    size_t count = entries.size();
+
+    size_t threads = std::thread::hardware_concurrency();
+
+    if( threads > count / PARALLEL_PROBE_MIN )
+        threads = count / PARALLEL_PROBE_MIN;
+
+    if( threads < 2 )
+    {
+        for(size_t i = 0; i < count; i++)
+            probe_port( sys_dir, entries[i] );
+
+        return;
+    }
+
+    vector<std::thread> workers;
+
+    for(size_t t = 0; t < threads; t++)
+    {
+        workers.push_back(std::thread([&sys_dir, &entries, count, threads, t]()
+        {
+            for(size_t i = t; i < count; i += threads)
+                probe_port( sys_dir, entries[i] );
+        }));
+    }
+
+    for(size_t t = 0; t < threads; t++)
+        workers[t].join();
+}
+
 vector<PortInfo>
-serial::list_ports()
+serial::list_ports_in(const string& dev_dir, const string& sys_dir)
 {
-    vector<PortInfo> results;
+    vector<candidate> names = list_candidates( dev_dir );
+
+    int dir_fd = open(dev_dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
 
-    vector<string> search_globs;
-    search_globs.push_back("/dev/ttyACM*");
-    search_globs.push_back("/dev/ttyS*");
-    search_globs.push_back("/dev/ttyUSB*");
-    search_globs.push_back("/dev/tty.*");
-    search_globs.push_back("/dev/cu.*");
+    std::lock_guard<std::mutex> lock(port_cache_mutex);
 
-    vector<string> devices_found = glob( search_globs );
+    map<string, cached_port>& cache = port_cache[dev_dir + '\n' + sys_dir];
 
-    vector<string>::iterator iter = devices_found.begin();
+    map<string, cached_port> found;
 
-    while( iter != devices_found.end() )
+    vector<cached_port*> to_probe;
+
+    for(size_t i = 0; i < names.size(); i++)
     {
-        string device = *iter++;
+        string device = dev_dir + "/" + names[i].name;
+
+        map<string, cached_port>::iterator old = cache.find(device);
 
-        vector<string> sysfs_info = get_sysfs_info( device );
+        // A port left out is only checked again once its node is replaced,
+        // which the inode from the directory tells without a stat
+        if( old != cache.end() && !old->second.listed &&
+            old->second.inode == names[i].inode )
+        {
+            found[device] = old->second;
+            continue;
+        }
 
-        string friendly_name = sysfs_info[0];
+        struct stat sb;
 
-        string hardware_id = sysfs_info[1];
+        if( dir_fd < 0 || fstatat(dir_fd, names[i].name.c_str(), &sb, 0) != 0 )
+            continue;
 
-        PortInfo device_entry;
-        device_entry.port = device;
-        device_entry.description = friendly_name;
-        device_entry.hardware_id = hardware_id;
+        cached_port& entry = found[device];
 
-        results.push_back( device_entry );
+        if( old != cache.end() &&
+            old->second.inode == sb.st_ino &&
+            old->second.mtime.tv_sec == sb.st_mtim.tv_sec &&
+            old->second.mtime.tv_nsec == sb.st_mtim.tv_nsec )
+        {
+            entry = old->second;
+            continue;
+        }
 
+        entry.inode = sb.st_ino;
+        entry.mtime = sb.st_mtim;
+        entry.info.port = device;
+        to_probe.push_back(&entry);
+    }
+
+    if( dir_fd >= 0 )
+        close(dir_fd);
+
+    probe_ports( sys_dir, to_probe );
+
+    // The nodes gone are dropped with the swap
+    cache.swap(found);
+
+    vector<PortInfo> results;
+
+    for(map<string, cached_port>::iterator it = cache.begin(); it != cache.end(); ++it)
+    {
+        if( it->second.listed )
+            results.push_back( it->second.info );
     }
 
     return results;
 }
 
+vector<PortInfo>
+serial::list_ports()
+{
+    return list_ports_in( "/dev", "/sys" );
+}
+
 #endif // defined(__linux__)
@@ -23,6 +23,9 @@
 # include <linux/serial.h>
 #endif
 
+// The kernel's termios2 and BOTHER, shared with rmSerialFd
+#include "../../rm/termios2.hpp"
+
 #include <sys/select.h>
 #include <sys/time.h>
 #include <time.h>
@@ -56,6 +59,30 @@ using serial::PortNotOpenedException;
 using serial::IOException;
 
 
+// Sets or clears ASYNC_LOW_LATENCY, which makes the driver push the received
+// bytes to the reader at once. Returns false if the driver does not support
+// it, like PTYs.
+static bool
+set_driver_low_latency (int fd, bool low_latency)
+{
+#if defined(__linux__) && defined(TIOCSSERIAL) && defined(ASYNC_LOW_LATENCY)
+  struct serial_struct ser;
+
+  if (-1 == ioctl (fd, TIOCGSERIAL, &ser)) {
+    return false;
+  }
+  if (low_latency)
+    ser.flags |= ASYNC_LOW_LATENCY;
+  else
+    ser.flags &= ~ASYNC_LOW_LATENCY;
+  return -1 != ioctl (fd, TIOCSSERIAL, &ser);
+#else
+  (void) fd;
+  (void) low_latency;
+  return false;
+#endif
+}
+
 MillisecondTimer::MillisecondTimer (const uint32_t millis)
   : expiry(timespec_now())
 {
@@ -111,7 +138,8 @@ Serial::SerialImpl::SerialImpl (const string &port, unsigned long baudrate,
                                 flowcontrol_t flowcontrol)
   : port_ (port), fd_ (-1), is_open_ (false), xonxoff_ (false), rtscts_ (false),
     baudrate_ (baudrate), parity_ (parity),
-    bytesize_ (bytesize), stopbits_ (stopbits), flowcontrol_ (flowcontrol)
+    bytesize_ (bytesize), stopbits_ (stopbits), flowcontrol_ (flowcontrol),
+    low_latency_ (false)
 {
   pthread_mutex_init(&this->read_mutex, NULL);
   pthread_mutex_init(&this->write_mutex, NULL);
@@ -315,6 +343,10 @@ Serial::SerialImpl::reconfigurePort ()
       THROW (IOException, errno);
     }
     // Linux Support
+#elif defined(RM_HAVE_TERMIOS2)
+    // Set with BOTHER once the other settings are applied, as tcsetattr
+    // would restore the old rate. Unlike the custom divisor, the USB-serial
+    // drivers take it as well.
 #elif defined(__linux__) && defined (TIOCSSERIAL)
     struct serial_struct ser;
 
@@ -443,6 +475,31 @@ Serial::SerialImpl::reconfigurePort ()
   // activate settings
   ::tcsetattr (fd_, TCSANOW, &options);
 
+#if defined(RM_HAVE_TERMIOS2)
+  if (custom_baud) {
+    struct termios2 options2;
+
+    if (-1 == ioctl (fd_, TCGETS2, &options2)) {
+      THROW (IOException, errno);
+    }
+
+    // The input speed follows the output speed with CIBAUD cleared
+    options2.c_cflag &= (tcflag_t) ~(CBAUD | CIBAUD);
+    options2.c_cflag |= BOTHER;
+    options2.c_ispeed = static_cast<speed_t> (baudrate_);
+    options2.c_ospeed = static_cast<speed_t> (baudrate_);
+
+    if (-1 == ioctl (fd_, TCSETS2, &options2)) {
+      THROW (IOException, errno);
+    }
+  }
+#endif
+
+  // Only set here, so the flag another program or udev gave the driver is
+  // left alone
+  if (low_latency_)
+    set_driver_low_latency (fd_, true);
+
   // Update byte_time_ based on the new settings.
   uint32_t bit_time_ns = 1e9 / baudrate_;
   byte_time_ns_ = bit_time_ns * (1 + bytesize_ + parity_ + stopbits_);
@@ -565,8 +622,10 @@ Serial::SerialImpl::read (uint8_t *buf, size_t size)
     if (waitReadable(timeout)) {
       // If it's a fixed-length multi-byte read, insert a wait here so that
       // we can attempt to grab the whole thing in a single IO call. Skip
-      // this wait if a non-max inter_byte_timeout is specified.
-      if (size > 1 && timeout_.inter_byte_timeout == Timeout::max()) {
+      // this wait if a non-max inter_byte_timeout is specified or in low
+      // latency mode.
+      if (size > 1 && timeout_.inter_byte_timeout == Timeout::max() &&
+          !low_latency_) {
         size_t bytes_available = available();
         if (bytes_available + bytes_read < size) {
           waitByteTimes(size - (bytes_available + bytes_read));
@@ -788,6 +847,20 @@ Serial::SerialImpl::getFlowcontrol () const
   return flowcontrol_;
 }
 
+void
+Serial::SerialImpl::setLowLatency (bool low_latency)
+{
+  low_latency_ = low_latency;
+  if (is_open_)
+    set_driver_low_latency (fd_, low_latency);
+}
+
+bool
+Serial::SerialImpl::getLowLatency () const
+{
+  return low_latency_;
+}
+
 void
 Serial::SerialImpl::flush ()
 {
@@ -1027,6 +1100,33 @@ Serial::SerialImpl::getCD ()
   }
 }
 
+bool
+Serial::SerialImpl::getErrorCounts (ErrorCounts *counts)
+{
+  if (is_open_ == false) {
+    throw PortNotOpenedException ("Serial::getErrorCounts");
+  }
+
+#if defined(TIOCGICOUNT)
+  struct serial_icounter_struct icount;
+
+  // PTYs and some USB adapters do not keep the counters
+  if (-1 == ioctl (fd_, TIOCGICOUNT, &icount)) {
+    return false;
+  }
+
+  counts->frame = icount.frame;
+  counts->parity = icount.parity;
+  counts->overrun = icount.overrun;
+  counts->buf_overrun = icount.buf_overrun;
+  counts->brk = icount.brk;
+  return true;
+#else
+  (void) counts;
+  return false;
+#endif
+}
+
 void
 Serial::SerialImpl::readLock ()
 {
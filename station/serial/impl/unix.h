@@ -134,6 +134,9 @@ public:
   bool
   getCD ();
 
+  bool
+  getErrorCounts (ErrorCounts *counts);
+
   void
   setPort (const string &port);
 
@@ -176,6 +179,12 @@ public:
   flowcontrol_t
   getFlowcontrol () const;
 
+  void
+  setLowLatency (bool low_latency);
+
+  bool
+  getLowLatency () const;
+
   void
   readLock ();
 
@@ -207,6 +216,7 @@ private:
   bytesize_t bytesize_;       // Size of the bytes
   stopbits_t stopbits_;       // Stop Bits
   flowcontrol_t flowcontrol_; // Flow Control
+  bool low_latency_;          // Low latency mode
 
   // Mutex used to lock the read functions
   pthread_mutex_t read_mutex;
@@ -37,7 +37,8 @@ Serial::SerialImpl::SerialImpl (const string &port, unsigned long baudrate,
                                 flowcontrol_t flowcontrol)
   : port_ (port.begin(), port.end()), fd_ (INVALID_HANDLE_VALUE), is_open_ (false),
     baudrate_ (baudrate), parity_ (parity),
-    bytesize_ (bytesize), stopbits_ (stopbits), flowcontrol_ (flowcontrol)
+    bytesize_ (bytesize), stopbits_ (stopbits), flowcontrol_ (flowcontrol),
+    low_latency_ (false)
 {
   if (port_.empty () == false)
     open ();
@@ -459,6 +460,19 @@ Serial::SerialImpl::getFlowcontrol () const
   return flowcontrol_;
 }
 
+void
+Serial::SerialImpl::setLowLatency (bool low_latency)
+{
+  // The latency of USB adapters is a setting of their drivers on Windows
+  low_latency_ = low_latency;
+}
+
+bool
+Serial::SerialImpl::getLowLatency () const
+{
+  return low_latency_;
+}
+
 void
 Serial::SerialImpl::flush ()
 {
@@ -610,6 +624,17 @@ Serial::SerialImpl::getCD()
   return (MS_RLSD_ON & dwModemStatus) != 0;
 }
 
+bool
+Serial::SerialImpl::getErrorCounts(ErrorCounts *counts)
+{
+  if (is_open_ == false) {
+    throw PortNotOpenedException ("Serial::getErrorCounts");
+  }
+  // ClearCommError only flags the errors since the last call
+  (void) counts;
+  return false;
+}
+
 void
 Serial::SerialImpl::readLock()
 {
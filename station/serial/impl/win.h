@@ -123,6 +123,9 @@ public:
   bool
   getCD ();
 
+  bool
+  getErrorCounts (ErrorCounts *counts);
+
   void
   setPort (const string &port);
 
@@ -165,6 +168,12 @@ public:
   flowcontrol_t
   getFlowcontrol () const;
 
+  void
+  setLowLatency (bool low_latency);
+
+  bool
+  getLowLatency () const;
+
   void
   readLock ();
 
@@ -193,6 +202,7 @@ private:
   bytesize_t bytesize_;       // Size of the bytes
   stopbits_t stopbits_;       // Stop Bits
   flowcontrol_t flowcontrol_; // Flow Control
+  bool low_latency_;          // Low latency mode
 
   // Mutex used to lock the read functions
   HANDLE read_mutex;
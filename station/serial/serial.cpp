@@ -365,6 +365,18 @@ Serial::getFlowcontrol () const
   return pimpl_->getFlowcontrol ();
 }
 
+void
+Serial::setLowLatency (bool low_latency)
+{
+  pimpl_->setLowLatency (low_latency);
+}
+
+bool
+Serial::getLowLatency () const
+{
+  return pimpl_->getLowLatency ();
+}
+
 void Serial::flush ()
 {
   ScopedReadLock rlock(this->pimpl_);
@@ -428,3 +440,8 @@ bool Serial::getCD ()
 {
   return pimpl_->getCD ();
 }
+
+bool Serial::getErrorCounts (ErrorCounts *counts)
+{
+  return pimpl_->getErrorCounts (counts);
+}
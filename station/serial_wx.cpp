@@ -2,7 +2,8 @@
  * @file serial_wx.cpp
  * @brief Serial ports to communicate with client devices
  * 
- * Port detection thread made specifically for wxWidgets.
+ * Port detection timer made specifically for wxWidgets. With rmHotplug the
+ * ports are listed again only after a device is plugged in or out.
  * 
  * @copyright Copyright (c) 2021 Khant Kyaw Khaung
  * 
@@ -15,6 +16,11 @@
 
 #include "rm/serial.hpp"
 
+#include "rm/hotplug.hpp"
+#include "rm/serial_internal.hpp"
+
+#include <atomic>
+
 #include <wx/timer.h>
 
 
@@ -25,13 +31,33 @@ static wxEvtHandler* handler;
 static void (wxEvtHandler::*callback)(wxEvent&) = nullptr;
 
 
+// Flags the timer to list the ports again after a device is plugged in or
+// out, so the ticks in between cost nothing
+class rmPortTimerListener: public rmHotplugListener {
+  public:
+    std::atomic<bool> changed{true};
+    
+    void onPortAdded(const rmSerialPortInfo& info) override {
+        changed = true;
+    }
+    
+    void onPortRemoved(const rmSerialPortInfo& info) override {
+        changed = true;
+    }
+};
+
+static rmPortTimerListener listener;
+
+
 class rmPortDetectionTimer: public wxTimer {
   private:
-    size_t prevCount = 0;
+    bool hotplug;
+    rmSerialPortList prev;
     rmSerialPortList ports;
-    
+  
   public:
     rmPortDetectionTimer() {
+        hotplug = rmHotplug::addListener(&listener);
         Connect(
             wxEVT_TIMER,
             wxTimerEventHandler(rmPortDetectionTimer::onTimer),
@@ -41,10 +67,12 @@ class rmPortDetectionTimer: public wxTimer {
     }
     
     void onTimer(wxTimerEvent& evt) {
-        ports = rmSerialPort::listPorts();
-        if(ports.size() != prevCount) {
+        if(hotplug && !listener.changed.exchange(false))
+            return;
+        ports = rmHotplug::getPorts();
+        if(!rmIsSamePortList(ports, prev)) {
             (handler->*callback)(evt);
-            prevCount = ports.size();
+            prev = ports;
         }
     }
 };
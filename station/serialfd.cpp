@@ -0,0 +1,420 @@
+/**
+ * @file serialfd.cpp
+ * @brief Non-blocking file descriptor of a serial port on Linux
+ * 
+ * A thin layer over the tty device for the station's own use. Every call
+ * returns at once with a count or an error code instead of waiting on a
+ * timeout or throwing, and nothing is locked, as the owner already
+ * serializes the calls.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_EXPORT
+#define RM_NO_WX
+
+
+#include "rm/serialfd.hpp"
+
+#include "rm/termios2.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <linux/serial.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+
+/**
+ * @brief Destructor
+ * 
+ * Closes the port.
+ */
+rmSerialFd::~rmSerialFd() { close(); }
+
+/**
+ * @brief Checks if the port is open
+ * 
+ * @return True if open
+ */
+bool rmSerialFd::isOpen() const { return fd >= 0; }
+
+/**
+ * @brief Gets the file descriptor to wait on
+ * 
+ * @return The descriptor. -1 if the port is closed.
+ */
+int rmSerialFd::getFd() const { return fd; }
+
+/**
+ * @brief Gets the errno of the last system error
+ * 
+ * @return The errno behind the last RM_SERIAL_IO and the other codes that
+ *         come from a system call
+ */
+int rmSerialFd::getErrno() const { return lastErrno; }
+
+/**
+ * @brief Describes an error code
+ * 
+ * @param err The error code
+ * 
+ * @return A message in English
+ */
+const char* rmSerialFd::getErrorString(int err) {
+    switch(err) {
+      case RM_SERIAL_OK:
+        return "Success";
+      case RM_SERIAL_AGAIN:
+        return "Timed out";
+      case RM_SERIAL_CLOSED:
+        return "Port not open";
+      case RM_SERIAL_DISCONNECTED:
+        return "Device disconnected";
+      case RM_SERIAL_BUSY:
+        return "Port busy";
+      case RM_SERIAL_BAUDRATE:
+        return "Baudrate not supported";
+      case RM_SERIAL_IO:
+        return "I/O error";
+      case RM_SERIAL_UNSUPPORTED:
+        return "Not supported";
+      default:
+        return "Unknown error";
+    }
+}
+
+
+#if defined(__linux__)
+
+static speed_t toSpeed(uint32_t baud) {
+    switch(baud) {
+      case 1200: return B1200;
+      case 2400: return B2400;
+      case 4800: return B4800;
+      case 9600: return B9600;
+      case 19200: return B19200;
+      case 38400: return B38400;
+      case 57600: return B57600;
+      case 115200: return B115200;
+      case 230400: return B230400;
+      case 460800: return B460800;
+      case 500000: return B500000;
+      case 921600: return B921600;
+      case 1000000: return B1000000;
+      case 1500000: return B1500000;
+      case 2000000: return B2000000;
+      case 3000000: return B3000000;
+      case 4000000: return B4000000;
+      default: return B0;
+    }
+}
+
+
+// Maps the errno of a failed call to an error code. A device unplugged
+// fails with EIO or ENODEV, or its node is gone, and a hung up port reads as
+// end of file.
+int rmSerialFd::fail(int err) {
+    lastErrno = err;
+    switch(err) {
+      case EAGAIN:
+        return RM_SERIAL_AGAIN;
+      case EIO:
+      case ENODEV:
+      case ENOENT:
+      case ENXIO:
+        return RM_SERIAL_DISCONNECTED;
+      case EBUSY:
+        return RM_SERIAL_BUSY;
+      default:
+        return RM_SERIAL_IO;
+    }
+}
+
+int rmSerialFd::configure() {
+    struct termios options;
+    if(tcgetattr(fd, &options) < 0)
+        return fail(errno);
+    cfmakeraw(&options);
+    options.c_cflag |= CLOCAL | CREAD;
+    options.c_cflag &= ~(CSTOPB | CRTSCTS);
+    options.c_iflag &= ~(IXON | IXOFF | IXANY);
+    // With VMIN at 0, a read with nothing to read returns 0 as the end of
+    // file does. At 1, it fails with EAGAIN, so 0 is only read once the port
+    // hangs up.
+    options.c_cc[VMIN] = 1;
+    options.c_cc[VTIME] = 0;
+    
+    speed_t speed = toSpeed(baudrate);
+    if(speed != B0) {
+        cfsetispeed(&options, speed);
+        cfsetospeed(&options, speed);
+    }
+    if(tcsetattr(fd, TCSANOW, &options) < 0)
+        return fail(errno);
+    
+    if(speed == B0) {
+#if defined(RM_HAVE_TERMIOS2)
+        // Set after tcsetattr, which would restore the old rate
+        struct termios2 options2;
+        if(ioctl(fd, TCGETS2, &options2) < 0)
+            return fail(errno);
+        options2.c_cflag &= ~(CBAUD | CIBAUD);
+        options2.c_cflag |= BOTHER;
+        options2.c_ispeed = baudrate;
+        options2.c_ospeed = baudrate;
+        if(ioctl(fd, TCSETS2, &options2) < 0) {
+            lastErrno = errno;
+            return RM_SERIAL_BAUDRATE;
+        }
+#else
+        return RM_SERIAL_BAUDRATE;
+#endif
+    }
+    
+    // The flag another program or udev gave the driver is left alone
+    if(lowLatency)
+        setLowLatency(true);
+    return RM_SERIAL_OK;
+}
+
+/**
+ * @brief Opens and sets up a serial port
+ * 
+ * Closes the port opened before. The other processes are kept from opening
+ * the port until it is closed.
+ * 
+ * @param port Path of the device such as "/dev/ttyACM0"
+ * @param baud Baudrate. The ones with no B constant are set with termios2.
+ * 
+ * @return RM_SERIAL_OK or the error code
+ */
+int rmSerialFd::open(const char* port, uint32_t baud) {
+    close();
+    do {
+        fd = ::open(port, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    } while(fd < 0 && errno == EINTR);
+    if(fd < 0)
+        return fail(errno);
+    
+    if(ioctl(fd, TIOCEXCL) < 0 && errno != ENOTTY) {
+        int err = fail(errno);
+        close();
+        return err;
+    }
+    baudrate = baud;
+    int err = configure();
+    if(err != RM_SERIAL_OK) {
+        close();
+        return err;
+    }
+    return RM_SERIAL_OK;
+}
+
+/**
+ * @brief Closes the port
+ */
+void rmSerialFd::close() {
+    if(fd < 0)
+        return;
+    ioctl(fd, TIOCNXCL);
+    ::close(fd);
+    fd = -1;
+}
+
+/**
+ * @brief Changes the baudrate of the port opened
+ * 
+ * @param baud Baudrate
+ * 
+ * @return RM_SERIAL_OK or the error code
+ */
+int rmSerialFd::setBaudrate(uint32_t baud) {
+    if(fd < 0)
+        return RM_SERIAL_CLOSED;
+    baudrate = baud;
+    return configure();
+}
+
+/**
+ * @brief Sets the low latency mode of the driver
+ * 
+ * Sets ASYNC_LOW_LATENCY, so the driver pushes the received bytes at once
+ * instead of buffering them for a few milliseconds. Kept for the next ports
+ * opened.
+ * 
+ * @param en True for enable and false for otherwise
+ * 
+ * @return RM_SERIAL_OK, or RM_SERIAL_UNSUPPORTED if the driver does not have
+ *         the flag, like PTYs
+ */
+int rmSerialFd::setLowLatency(bool en) {
+    lowLatency = en;
+    if(fd < 0)
+        return RM_SERIAL_OK;
+#if defined(TIOCSSERIAL) && defined(ASYNC_LOW_LATENCY)
+    struct serial_struct ser;
+    if(ioctl(fd, TIOCGSERIAL, &ser) < 0) {
+        lastErrno = errno;
+        return RM_SERIAL_UNSUPPORTED;
+    }
+    if(en)
+        ser.flags |= ASYNC_LOW_LATENCY;
+    else
+        ser.flags &= ~ASYNC_LOW_LATENCY;
+    if(ioctl(fd, TIOCSSERIAL, &ser) < 0)
+        return fail(errno);
+    return RM_SERIAL_OK;
+#else
+    return RM_SERIAL_UNSUPPORTED;
+#endif
+}
+
+/**
+ * @brief Reads the bytes received
+ * 
+ * @param buf Destination buffer
+ * @param len Size of the buffer
+ * 
+ * @return Number of bytes read, 0 if there is nothing to read, or the error
+ *         code
+ */
+long rmSerialFd::read(uint8_t* buf, size_t len) {
+    if(fd < 0)
+        return RM_SERIAL_CLOSED;
+    ssize_t n;
+    do {
+        n = ::read(fd, buf, len);
+    } while(n < 0 && errno == EINTR);
+    if(n > 0)
+        return (long) n;
+    if(n == 0) {
+        lastErrno = 0;
+        return (len > 0) ? RM_SERIAL_DISCONNECTED : 0;
+    }
+    if(errno == EAGAIN || errno == EWOULDBLOCK)
+        return 0;
+    return fail(errno);
+}
+
+/**
+ * @brief Writes as many bytes as the driver takes now
+ * 
+ * @param buf Source buffer
+ * @param len Number of bytes
+ * 
+ * @return Number of bytes written, 0 if the driver's buffer is full, or the
+ *         error code
+ */
+long rmSerialFd::write(const uint8_t* buf, size_t len) {
+    if(fd < 0)
+        return RM_SERIAL_CLOSED;
+    ssize_t n;
+    do {
+        n = ::write(fd, buf, len);
+    } while(n < 0 && errno == EINTR);
+    if(n >= 0)
+        return (long) n;
+    if(errno == EAGAIN || errno == EWOULDBLOCK)
+        return 0;
+    return fail(errno);
+}
+
+/**
+ * @brief Waits for the port to be readable or writable
+ * 
+ * @param writable False to wait for the bytes to read, true to wait for the
+ *                 room to write
+ * @param timeout Milliseconds to wait at most. -1 to wait forever.
+ * 
+ * @return RM_SERIAL_OK if ready, RM_SERIAL_AGAIN on timeout or the error
+ *         code
+ */
+int rmSerialFd::wait(bool writable, int timeout) {
+    if(fd < 0)
+        return RM_SERIAL_CLOSED;
+    struct pollfd p = { fd, (short) (writable ? POLLOUT : POLLIN), 0 };
+    int r = poll(&p, 1, timeout);
+    if(r < 0)
+        return (errno == EINTR) ? RM_SERIAL_AGAIN : fail(errno);
+    if(r == 0)
+        return RM_SERIAL_AGAIN;
+    if((p.revents & p.events) == 0) {
+        lastErrno = 0;
+        return RM_SERIAL_DISCONNECTED;
+    }
+    return RM_SERIAL_OK;
+}
+
+/**
+ * @brief Reads the line errors the driver counted on the port
+ * 
+ * @param counts Output counters
+ * 
+ * @return RM_SERIAL_OK, or RM_SERIAL_UNSUPPORTED if the driver does not count
+ *         the errors
+ */
+int rmSerialFd::getErrorCounts(serial::ErrorCounts* counts) {
+    if(fd < 0)
+        return RM_SERIAL_CLOSED;
+#if defined(TIOCGICOUNT)
+    struct serial_icounter_struct icount;
+    if(ioctl(fd, TIOCGICOUNT, &icount) < 0) {
+        lastErrno = errno;
+        return RM_SERIAL_UNSUPPORTED;
+    }
+    counts->frame = icount.frame;
+    counts->parity = icount.parity;
+    counts->overrun = icount.overrun;
+    counts->buf_overrun = icount.buf_overrun;
+    counts->brk = icount.brk;
+    return RM_SERIAL_OK;
+#else
+    return RM_SERIAL_UNSUPPORTED;
+#endif
+}
+
+#else
+
+int rmSerialFd::fail(int err) {
+    lastErrno = err;
+    return RM_SERIAL_IO;
+}
+
+int rmSerialFd::configure() { return RM_SERIAL_UNSUPPORTED; }
+
+int rmSerialFd::open(const char* port, uint32_t baud) {
+    return RM_SERIAL_UNSUPPORTED;
+}
+
+void rmSerialFd::close() {}
+
+int rmSerialFd::setBaudrate(uint32_t baud) { return RM_SERIAL_CLOSED; }
+
+int rmSerialFd::setLowLatency(bool en) {
+    lowLatency = en;
+    return RM_SERIAL_UNSUPPORTED;
+}
+
+long rmSerialFd::read(uint8_t* buf, size_t len) { return RM_SERIAL_CLOSED; }
+
+long rmSerialFd::write(const uint8_t* buf, size_t len) {
+    return RM_SERIAL_CLOSED;
+}
+
+int rmSerialFd::wait(bool writable, int timeout) { return RM_SERIAL_CLOSED; }
+
+int rmSerialFd::getErrorCounts(serial::ErrorCounts* counts) {
+    return RM_SERIAL_CLOSED;
+}
+
+#endif
@@ -0,0 +1,311 @@
+/**
+ * @file session.cpp
+ * @brief Binary log of the sync table updates of a session
+ * 
+ * The rows are appended as received and read back record by record, so a
+ * log of any size is converted in bounded memory.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_EXPORT
+#define RM_NO_WX
+
+
+#include "rm/session.hpp"
+
+#include "rm/attribute.hpp"
+#include "rm/frame.hpp"
+
+#include <chrono>
+#include <cstring>
+
+
+static const char magic[8] = "RMSESS";
+
+#define RM_SESSION_FILE_BUFFER (1 << 20)
+
+
+static int64_t getTime() {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
+
+static void put(std::vector<uint8_t>& buf, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*) data;
+    buf.insert(buf.end(), p, p + len);
+}
+
+
+/**
+ * @brief Destructor
+ * 
+ * Closes the file.
+ */
+rmSessionRecorder::~rmSessionRecorder() { close(); }
+
+/**
+ * @brief Creates a session log
+ * 
+ * An existing file is replaced.
+ * 
+ * @param path Path of the file
+ * 
+ * @return True on success
+ */
+bool rmSessionRecorder::open(const char* path) {
+    close();
+    FILE* f = fopen(path, "wb");
+    if(f == NULL)
+        return false;
+    setvbuf(f, NULL, _IOFBF, RM_SESSION_FILE_BUFFER);
+    
+    rmSessionHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, magic, sizeof(magic));
+    h.version = RM_SESSION_VERSION;
+    h.startTime = getTime();
+    if(fwrite(&h, sizeof(h), 1, f) != 1) {
+        fclose(f);
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m);
+    file = f;
+    attributes.clear();
+    types.clear();
+    return true;
+}
+
+/**
+ * @brief Writes the rest of the buffer and closes the file
+ */
+void rmSessionRecorder::close() {
+    std::lock_guard<std::mutex> lock(m);
+    if(file == NULL)
+        return;
+    fclose(file);
+    file = NULL;
+}
+
+/**
+ * @brief Checks if a file is open
+ * 
+ * @return True if open
+ */
+bool rmSessionRecorder::isOpen() const { return file != NULL; }
+
+/**
+ * @brief Writes the buffered records to the file
+ */
+void rmSessionRecorder::flush() {
+    std::lock_guard<std::mutex> lock(m);
+    if(file != NULL)
+        fflush(file);
+}
+
+
+void rmSessionRecorder::writeSchema(const rmSync* sync) {
+    uint8_t id = sync->getID();
+    size_t count = sync->getCount();
+    const uint8_t* t = sync->getTypes();
+    attributes[id].resize(count);
+    for(size_t i=0; i<count; i++)
+        attributes[id][i] = sync->getAttribute(i);
+    types[id].assign((const char*) t, count);
+    
+    buffer.clear();
+    uint16_t n = (uint16_t) count;
+    put(buffer, &n, 2);
+    for(size_t i=0; i<count; i++) {
+        rmAttribute* attr = attributes[id][i];
+        const char* name = (attr != nullptr) ? attr->getName() : "";
+        uint8_t len = (uint8_t) strlen(name);
+        buffer.push_back(t[i]);
+        buffer.push_back(len);
+        put(buffer, name, len);
+    }
+    uint8_t head[6] = { RM_SESSION_SCHEMA, id };
+    uint32_t size = (uint32_t) buffer.size();
+    memcpy(&head[2], &size, 4);
+    fwrite(head, 6, 1, file);
+    fwrite(buffer.data(), buffer.size(), 1, file);
+}
+
+/**
+ * @brief Records the current values of a sync table
+ * 
+ * @param sync The sync table just updated
+ */
+void rmSessionRecorder::record(const rmSync* sync) {
+    int64_t time = getTime();
+    std::lock_guard<std::mutex> lock(m);
+    if(file == NULL)
+        return;
+    
+    // The schema is written again once the list of the table changes
+    uint8_t id = sync->getID();
+    size_t count = sync->getCount();
+    const uint8_t* t = sync->getTypes();
+    if(attributes.size() <= id) {
+        attributes.resize(id + 1);
+        types.resize(id + 1);
+    }
+    bool changed = (types[id].size() != count ||
+                    memcmp(types[id].data(), t, count) != 0);
+    for(size_t i=0; i<count && !changed; i++) {
+        if(attributes[id][i] != sync->getAttribute(i))
+            changed = true;
+    }
+    if(changed)
+        writeSchema(sync);
+    
+    buffer.clear();
+    put(buffer, &time, 8);
+    const uint32_t* raws = sync->getRaws();
+    for(size_t i=0; i<count; i++) {
+        if(t[i] != RM_WIRE_STRING) {
+            put(buffer, &raws[i], 4);
+            continue;
+        }
+        rmAttribute* attr = attributes[id][i];
+        const char* str = (attr != nullptr) ? attr->getValue().s : nullptr;
+        size_t len = (str != nullptr) ? strlen(str) : 0;
+        if(len > 255)
+            len = 255;
+        buffer.push_back((uint8_t) len);
+        put(buffer, str, len);
+    }
+    uint8_t head[6] = { RM_SESSION_ROW, id };
+    uint32_t size = (uint32_t) buffer.size();
+    memcpy(&head[2], &size, 4);
+    fwrite(head, 6, 1, file);
+    fwrite(buffer.data(), buffer.size(), 1, file);
+}
+
+
+/**
+ * @brief Destructor
+ * 
+ * Closes the file.
+ */
+rmSessionReader::~rmSessionReader() { close(); }
+
+/**
+ * @brief Opens a session log
+ * 
+ * @param path Path of the file
+ * 
+ * @return False if the file cannot be opened or is not a session log
+ */
+bool rmSessionReader::open(const char* path) {
+    close();
+    FILE* f = fopen(path, "rb");
+    if(f == NULL)
+        return false;
+    setvbuf(f, NULL, _IOFBF, RM_SESSION_FILE_BUFFER);
+    if(fread(&header, sizeof(header), 1, f) != 1 ||
+       memcmp(header.magic, magic, sizeof(magic)) != 0 ||
+       header.version != RM_SESSION_VERSION)
+    {
+        fclose(f);
+        return false;
+    }
+    file = f;
+    corrupt = false;
+    return true;
+}
+
+/**
+ * @brief Closes the file
+ */
+void rmSessionReader::close() {
+    if(file == NULL)
+        return;
+    fclose(file);
+    file = NULL;
+}
+
+/**
+ * @brief Gets the time the session started
+ * 
+ * @return Microseconds since the epoch
+ */
+int64_t rmSessionReader::getStartTime() const { return header.startTime; }
+
+/**
+ * @brief Reads the next record
+ * 
+ * A record cut short or with a size beyond RM_SESSION_RECORD_MAX ends the
+ * reading and is reported by isCorrupt().
+ * 
+ * @param rec Output record. Its buffer is reused.
+ * 
+ * @return False at the end of the file or on a corrupt record
+ */
+bool rmSessionReader::next(rmSessionRecord* rec) {
+    if(file == NULL || corrupt)
+        return false;
+    uint8_t head[6];
+    size_t n = fread(head, 1, 6, file);
+    if(n != 6) {
+        corrupt = (n > 0);
+        return false;
+    }
+    uint32_t size;
+    memcpy(&size, &head[2], 4);
+    
+    // The size is checked before the buffer grows to it
+    if(size > RM_SESSION_RECORD_MAX) {
+        corrupt = true;
+        return false;
+    }
+    rec->kind = head[0];
+    rec->table = head[1];
+    rec->body.resize(size);
+    if(size > 0 && fread(rec->body.data(), size, 1, file) != 1) {
+        corrupt = true;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Checks if the reading stopped at a corrupt record
+ * 
+ * @return True if next() found a record cut short or too large
+ */
+bool rmSessionReader::isCorrupt() const { return corrupt; }
+
+/**
+ * @brief Decodes the columns of a schema record
+ * 
+ * @param rec The schema record
+ * @param columns Output columns
+ * 
+ * @return False if the record is malformed
+ */
+bool rmSessionReader::parseSchema(const rmSessionRecord& rec,
+                                  std::vector<rmSessionColumn>* columns)
+{
+    const std::vector<uint8_t>& b = rec.body;
+    columns->clear();
+    if(rec.kind != RM_SESSION_SCHEMA || b.size() < 2)
+        return false;
+    uint16_t n;
+    memcpy(&n, b.data(), 2);
+    size_t pos = 2;
+    for(uint16_t i=0; i<n; i++) {
+        if(pos + 2 > b.size() || pos + 2 + b[pos + 1] > b.size())
+            return false;
+        rmSessionColumn col;
+        col.type = b[pos];
+        col.name.assign((const char*) &b[pos + 2], b[pos + 1]);
+        pos += 2 + b[pos + 1];
+        columns->push_back(col);
+    }
+    return true;
+}
@@ -0,0 +1,365 @@
+/**
+ * @file sharedmemory.cpp
+ * @brief Mirror of the attribute values in shared memory
+ * 
+ * The values are written into a fixed table of slots guarded by sequence
+ * locks so the readers in the other processes never block the writer.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_EXPORT
+#define RM_NO_WX
+
+
+#include "rm/sharedmemory.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+static const char magic[8] = "RMSHM";
+
+// The slots start at the second cache line
+static const size_t slotOffset = 64;
+
+static_assert(sizeof(rmSharedHeader) <= slotOffset, "Header too large");
+static_assert(sizeof(rmSharedSlot) % 64 == 0, "Slot not aligned");
+
+
+/**
+ * @brief Destructor
+ * 
+ * Unmaps the memory and removes it if this object created it.
+ */
+rmSharedMemory::~rmSharedMemory() { close(); }
+
+
+#ifndef _WIN32
+
+bool rmSharedMemory::map(const char* shmName, bool create) {
+    close();
+    size_t len = slotOffset + sizeof(rmSharedSlot) * RM_SHARED_SLOT_COUNT;
+    int fd;
+    if(create) {
+        shm_unlink(shmName);
+        fd = shm_open(shmName, O_RDWR | O_CREAT | O_EXCL, 0644);
+        if(fd < 0)
+            return false;
+        if(ftruncate(fd, len) != 0) {
+            ::close(fd);
+            shm_unlink(shmName);
+            return false;
+        }
+    }
+    else {
+        fd = shm_open(shmName, O_RDONLY, 0);
+        if(fd < 0)
+            return false;
+        struct stat st;
+        if(fstat(fd, &st) != 0 || (size_t) st.st_size < slotOffset) {
+            ::close(fd);
+            return false;
+        }
+        len = st.st_size;
+    }
+    
+    int prot = create ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void* ptr = mmap(nullptr, len, prot, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(ptr == MAP_FAILED) {
+        if(create)
+            shm_unlink(shmName);
+        return false;
+    }
+    
+    rmSharedHeader* h = (rmSharedHeader*) ptr;
+    if(create) {
+        memcpy(h->magic, magic, sizeof(magic));
+        h->version = RM_SHARED_VERSION;
+        h->capacity = RM_SHARED_SLOT_COUNT;
+        h->slotSize = sizeof(rmSharedSlot);
+        h->pid = getpid();
+        h->count.store(0, std::memory_order_release);
+    }
+    else if(memcmp(h->magic, magic, sizeof(magic)) != 0 ||
+            h->version != RM_SHARED_VERSION ||
+            h->slotSize != sizeof(rmSharedSlot) ||
+            slotOffset + (size_t) h->slotSize * h->capacity > len)
+    {
+        munmap(ptr, len);
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(m);
+    name = shmName;
+    memory = (uint8_t*) ptr;
+    size = len;
+    header = h;
+    slots = (rmSharedSlot*) (memory + slotOffset);
+    owner = create;
+    return true;
+}
+
+/**
+ * @brief Unmaps the memory and removes it if this object created it
+ */
+void rmSharedMemory::close() {
+    // Waits for a write going on
+    std::lock_guard<std::mutex> lock(m);
+    if(memory == nullptr)
+        return;
+    munmap(memory, size);
+    if(owner)
+        shm_unlink(name.c_str());
+    memory = nullptr;
+    size = 0;
+    header = nullptr;
+    slots = nullptr;
+    owner = false;
+    ids.clear();
+}
+
+#else
+
+bool rmSharedMemory::map(const char* shmName, bool create) { return false; }
+
+void rmSharedMemory::close() {}
+
+#endif
+
+/**
+ * @brief Creates the shared memory to write to
+ * 
+ * An existing object of the same name is replaced.
+ * 
+ * @param shmName Name of the object starting with a slash, such as
+ *                "/rmonitor"
+ * 
+ * @return True on success. Always false on Windows.
+ */
+bool rmSharedMemory::create(const char* shmName) {
+    return map(shmName, true);
+}
+
+/**
+ * @brief Opens the shared memory of another process to read from
+ * 
+ * @param shmName Name of the object
+ * 
+ * @return True on success
+ */
+bool rmSharedMemory::open(const char* shmName) {
+    return map(shmName, false);
+}
+
+/**
+ * @brief Checks if the memory is mapped
+ * 
+ * @return True if mapped
+ */
+bool rmSharedMemory::isOpen() const { return memory != nullptr; }
+
+
+static int64_t getTime() {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+}
+
+/**
+ * @brief Writes the value of an attribute
+ * 
+ * The writes are serialised, so any thread may call it. Attributes beyond
+ * the capacity are not mirrored. Does nothing on the memory opened to
+ * read.
+ * 
+ * @param attr The attribute
+ */
+void rmSharedMemory::update(rmAttribute* attr) {
+    std::lock_guard<std::mutex> lock(m);
+    if(!owner)
+        return;
+    uint32_t id;
+    bool added = false;
+    auto it = ids.find(attr);
+    if(it != ids.end()) {
+        id = it->second;
+    }
+    else {
+        id = header->count.load(std::memory_order_relaxed);
+        if(id >= header->capacity)
+            return;
+        ids[attr] = id;
+        added = true;
+    }
+    
+    // Odd while the value is being written
+    rmSharedSlot* slot = &slots[id];
+    uint32_t seq = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    if(added)
+        strncpy(slot->name, attr->getName(), sizeof(slot->name) - 1);
+    rmAttributeDataType type = attr->getType();
+    slot->type = (uint8_t) type;
+    slot->time = getTime();
+    if(type == RM_ATTRIBUTE_STRING) {
+        const char* s = attr->getValue().s;
+        if(s == nullptr)
+            s = "";
+        strncpy(slot->str, s, RM_SHARED_STRING_SIZE - 1);
+        slot->str[RM_SHARED_STRING_SIZE - 1] = '\0';
+        slot->data.s = nullptr;
+    }
+    else {
+        slot->data = attr->getValue();
+    }
+    slot->sequence.store(seq + 2, std::memory_order_release);
+    
+    // The slot is visible to the readers once its name is written
+    if(added)
+        header->count.store(id + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Gets the number of slots in use
+ * 
+ * @return Number of attributes mirrored
+ */
+size_t rmSharedMemory::getCount() const {
+    if(header == nullptr)
+        return 0;
+    size_t n = header->count.load(std::memory_order_acquire);
+    return (n < header->capacity) ? n : header->capacity;
+}
+
+/**
+ * @brief Finds the slot of an attribute
+ * 
+ * @param key Name of the attribute
+ * 
+ * @return Index of the slot. -1 if not found.
+ */
+int rmSharedMemory::find(const char* key) const {
+    size_t n = getCount();
+    for(size_t i=0; i<n; i++) {
+        if(strncmp(slots[i].name, key, sizeof(slots[i].name)) == 0)
+            return (int) i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Gets the name of the attribute in a slot
+ * 
+ * @param i Index of the slot
+ * 
+ * @return The name. Null if the slot is not in use.
+ */
+const char* rmSharedMemory::getName(size_t i) const {
+    if(i >= getCount())
+        return nullptr;
+    return slots[i].name;
+}
+
+/*
+ * Copies a slot until the sequence is even and the same before and after the
+ * copy. A writer which died in the middle of a write leaves the sequence odd
+ * for good, so the tries are bounded and the thread yields after the first
+ * few to let a writer preempted in the middle finish.
+ */
+template <typename F>
+static bool readSlot(const rmSharedSlot* slot, uint32_t* seq, F copy) {
+    for(int k=0; k<RM_SHARED_READ_TRIES; k++) {
+        uint32_t s = slot->sequence.load(std::memory_order_acquire);
+        if((s & 1) == 0) {
+            copy();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(slot->sequence.load(std::memory_order_relaxed) == s) {
+                *seq = s;
+                return true;
+            }
+        }
+        if(k >= 16)
+            std::this_thread::yield();
+    }
+    return false;
+}
+
+/**
+ * @brief Reads the latest value of a slot
+ * 
+ * Never blocks the writer. Retries while the value is being written, up to
+ * RM_SHARED_READ_TRIES times.
+ * 
+ * @param i Index of the slot
+ * @param value Output value
+ * 
+ * @return False if the slot is not in use or if the writer never finished
+ *         writing it, as when its process died in the middle of a write
+ */
+bool rmSharedMemory::read(size_t i, rmSharedValue* value) const {
+    if(i >= getCount())
+        return false;
+    const rmSharedSlot* slot = &slots[i];
+    uint32_t seq;
+    bool ok = readSlot(slot, &seq, [slot, value]() {
+        value->type = (rmAttributeDataType) slot->type;
+        value->data = slot->data;
+        value->time = slot->time;
+        if(value->type == RM_ATTRIBUTE_STRING)
+            memcpy(value->str, slot->str, RM_SHARED_STRING_SIZE);
+    });
+    if(!ok)
+        return false;
+    value->str[RM_SHARED_STRING_SIZE - 1] = '\0';
+    value->sequence = seq / 2;
+    return true;
+}
+
+/**
+ * @brief Reads the latest value of a slot as a number
+ * 
+ * @param i Index of the slot
+ * 
+ * @return The value. NAN for a string, if the slot is not in use or if the
+ *         writer never finished writing it.
+ */
+float rmSharedMemory::readFloat(size_t i) const {
+    if(i >= getCount())
+        return NAN;
+    const rmSharedSlot* slot = &slots[i];
+    uint8_t type;
+    rmAttributeData data;
+    uint32_t seq;
+    bool ok = readSlot(slot, &seq, [slot, &type, &data]() {
+        type = slot->type;
+        data = slot->data;
+    });
+    if(!ok)
+        return NAN;
+    switch(type) {
+    case RM_ATTRIBUTE_BOOL:
+        return data.b ? 1.0f : 0.0f;
+    case RM_ATTRIBUTE_CHAR:
+        return (float) data.c;
+    case RM_ATTRIBUTE_INT:
+        return (float) data.i;
+    case RM_ATTRIBUTE_FLOAT:
+        return data.f;
+    default:
+        return NAN;
+    }
+}
@@ -20,21 +20,73 @@
 
 #include "rm/attribute.hpp"
 #include "rm/client.hpp"
+#include "rm/frame.hpp"
 #include "rm/request.hpp"
 
+#include <cmath>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <string>
+#include <utility>
 
 
-static void responseCallback(rmResponse resp);
+/**
+ * @brief Constructs an empty sync table with an ID
+ * 
+ * @param i The sync table ID used by the client device
+ */
+rmSync::rmSync(uint8_t i) { id = i; }
 
-    
 /**
  * @brief Destructor
  */
 rmSync::~rmSync() {
-    if(attributes != nullptr)
-        delete attributes;
+    if(block != nullptr)
+        delete[] block;
+    for(auto it=retired.begin(); it!=retired.end(); ++it)
+        delete[] *it;
+}
+
+/**
+ * @brief Move constructor
+ * 
+ * @param sync Source
+ */
+rmSync::rmSync(rmSync&& sync) noexcept {
+    block = std::exchange(sync.block, nullptr);
+    attributes = std::exchange(sync.attributes, nullptr);
+    values = std::exchange(sync.values, nullptr);
+    raws = std::exchange(sync.raws, nullptr);
+    types = std::exchange(sync.types, nullptr);
+    received = std::exchange(sync.received, nullptr);
+    retired = std::move(sync.retired);
+    capacity = std::exchange(sync.capacity, 0);
+    count = std::exchange(sync.count, 0);
+    revision = std::exchange(sync.revision, 0);
+    complete = std::exchange(sync.complete, false);
+    id = sync.id;
+}
+
+/**
+ * @brief Move assignment
+ * 
+ * @param sync Source
+ */
+rmSync& rmSync::operator=(rmSync&& sync) noexcept {
+    std::swap(block, sync.block);
+    std::swap(attributes, sync.attributes);
+    std::swap(values, sync.values);
+    std::swap(raws, sync.raws);
+    std::swap(types, sync.types);
+    std::swap(received, sync.received);
+    std::swap(retired, sync.retired);
+    std::swap(capacity, sync.capacity);
+    std::swap(count, sync.count);
+    std::swap(revision, sync.revision);
+    std::swap(complete, sync.complete);
+    std::swap(id, sync.id);
+    return *this;
 }
 
 /**
@@ -44,60 +96,450 @@ rmSync::~rmSync() {
  */
 size_t rmSync::getCount() const { return count; }
 
+/**
+ * @brief Empties the attribute list
+ * 
+ * The arrays are kept, so the pointers read from the table stay valid.
+ */
+void rmSync::clear() {
+    count = 0;
+    complete = false;
+}
+
+/**
+ * @brief Gets the sync table ID
+ * 
+ * @return The ID used by the client device
+ */
+uint8_t rmSync::getID() const { return id; }
+
+/**
+ * @brief Checks if the whole attribute list has been received
+ * 
+ * @return True if the list is complete
+ */
+bool rmSync::isComplete() const { return complete; }
+
+/**
+ * @brief Gets the decoded values of the table
+ * 
+ * The values are kept in a plain array in the order of the client device's
+ * list so that the widgets and plots can read them without going through the
+ * attributes. The arrays only move when the table grows, and the old ones are
+ * kept along with the table, so a pointer read before stays valid but is to be
+ * read again for the new values.
+ * 
+ * @return The numeric value of each attribute. NAN for the strings and the
+ *         values not received yet.
+ */
+const float* rmSync::getValues() const { return values; }
+
+/**
+ * @brief Gets the raw values of the table
+ * 
+ * The numbers as received, the 32-bit integers with the signed types extended
+ * or the bits of the floats. Integers too large for a float keep their
+ * precision here.
+ * 
+ * @return The raw value of each attribute. 0 for the strings and the values
+ *         not received yet.
+ */
+const uint32_t* rmSync::getRaws() const { return raws; }
+
+/**
+ * @brief Gets the data types of the table
+ * 
+ * @return The wire data type code of each attribute
+ */
+const uint8_t* rmSync::getTypes() const { return types; }
+
+/**
+ * @brief Gets an attribute of the table
+ * 
+ * @param i Index of the attribute in the table
+ * 
+ * @return The attribute. Null if the index is out of range.
+ */
+rmAttribute* rmSync::getAttribute(size_t i) const {
+    if(i >= count)
+        return nullptr;
+    return attributes[i];
+}
+
+/**
+ * @brief Looks for an attribute in the table by name
+ * 
+ * @param key Name of the attribute
+ * 
+ * @return Index of the attribute. The attribute count if the table does not
+ *         have the attribute.
+ */
+size_t rmSync::getIndex(const char* key) const {
+    for(size_t i=0; i<count; i++) {
+        if(attributes[i] != nullptr &&
+           strcmp(attributes[i]->getName(), key) == 0)
+        {
+            return i;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Gets the update counter of the table
+ * 
+ * The counter increases whenever a value of the table changes so that the
+ * readers can poll for new data cheaply.
+ * 
+ * @return The number of value changes since the table was created
+ */
+uint32_t rmSync::getRevision() const { return revision; }
+
+
+/*
+ * All the arrays of a table share one allocation. The pointers come first
+ * and the single bytes last so that every array stays aligned. The arrays
+ * only grow, and the old allocation is kept until the table is destroyed
+ * since the readers on other threads take no lock.
+ */
+void rmSync::reserve(size_t n) {
+    if(n <= capacity)
+        return;
+    if(n < 2 * capacity)
+        n = 2 * capacity;
+    size_t size = n * (sizeof(rmAttribute*) + sizeof(float) +
+                       sizeof(uint32_t) + sizeof(uint8_t) + sizeof(bool));
+    uint8_t* arr = new uint8_t[size];
+    rmAttribute** newAttributes = (rmAttribute**) arr;
+    float* newValues = (float*) &newAttributes[n];
+    uint32_t* newRaws = (uint32_t*) &newValues[n];
+    uint8_t* newTypes = (uint8_t*) &newRaws[n];
+    bool* newReceived = (bool*) &newTypes[n];
+    
+    if(count > 0) {
+        memcpy(newAttributes, attributes, count * sizeof(rmAttribute*));
+        memcpy(newValues, values, count * sizeof(float));
+        memcpy(newRaws, raws, count * sizeof(uint32_t));
+        memcpy(newTypes, types, count * sizeof(uint8_t));
+        memcpy(newReceived, received, count * sizeof(bool));
+    }
+    for(size_t i=count; i<n; i++) {
+        newAttributes[i] = nullptr;
+        newValues[i] = NAN;
+        newRaws[i] = 0;
+        newTypes[i] = RM_WIRE_STRING;
+        newReceived[i] = false;
+    }
+    
+    if(block != nullptr)
+        retired.push_back(block);
+    block = arr;
+    attributes = newAttributes;
+    values = newValues;
+    raws = newRaws;
+    types = newTypes;
+    received = newReceived;
+    capacity = n;
+}
+
+
+static void notify(rmAttribute* attr, rmAttributeData prev) {
+    attr->notifyUpdate(attr->getValue().i != prev.i);
+}
+
+static void setValue(rmAttribute* attr, const char* str) {
+    rmAttributeData prev = attr->getValue();
+    attr->setValue(str);
+    notify(attr, prev);
+}
+
+/*
+ * Stores a numeric value of the table. The raw value is the 32-bit integer
+ * with the signed types extended or the bits of the float. The attribute is
+ * only set if the value has changed, but its listener sees every value.
+ */
+void rmSync::store(size_t i, uint32_t raw) {
+    if(received[i] && raws[i] == raw) {
+        if(attributes[i] != nullptr)
+            attributes[i]->notifyUpdate(false);
+        return;
+    }
+    raws[i] = raw;
+    received[i] = true;
+    revision++;
+    
+    uint8_t type = types[i];
+    float f;
+    if(type == RM_WIRE_FLOAT)
+        memcpy(&f, &raw, 4);
+    else if(type == RM_WIRE_INT8 || type == RM_WIRE_INT16 ||
+            type == RM_WIRE_INT32)
+        f = (float) (int32_t) raw;
+    else
+        f = (float) raw;
+    values[i] = f;
+    
+    rmAttribute* attr = attributes[i];
+    if(attr == nullptr)
+        return;
+    rmAttributeData prev = attr->getValue();
+    if(type == RM_WIRE_FLOAT)
+        attr->setValue(f);
+    else if(type == RM_WIRE_BOOL)
+        attr->setValue((bool) raw);
+    else if(type == RM_WIRE_CHAR)
+        attr->setValue((char) raw);
+    else
+        attr->setValue((int) raw);
+    notify(attr, prev);
+}
+
+/*
+ * Parses a value of the text lines into the raw value for store().
+ */
+static uint32_t parseValue(uint8_t type, const char* str) {
+    uint32_t raw;
+    float f;
+    switch(type) {
+      case RM_WIRE_FLOAT:
+        f = strtof(str, NULL);
+        memcpy(&raw, &f, 4);
+        return raw;
+      
+      case RM_WIRE_CHAR:
+        return (uint8_t) str[0];
+      
+      case RM_WIRE_UINT8:
+      case RM_WIRE_UINT16:
+      case RM_WIRE_UINT32:
+        return (uint32_t) strtoul(str, NULL, 10);
+      
+      default:
+        return (uint32_t) strtol(str, NULL, 10);
+    }
+}
+
 /**
  * @breif Updates the attribute values
  * 
  * @param str The string representing the values of the list
+ * @param start Index of the first value in the string
  */
-void rmSync::onSync(const char* str) {
-    size_t i = 0;
-    char buffer[256];
-    strncpy(buffer, str, 255);
-    buffer[255] = '\0';
-    char *token = strtok(buffer, ",");
+void rmSync::onSync(const char* str, size_t start) {
+    std::string buffer = str;
+    char* token = &buffer[0];
+    size_t i = start;
     
-    while(token != NULL && i < count) {
-        rmAttribute* attr = attributes[i++];
-        if(attr != nullptr) {
-            rmAttributeData prev = attr->getValue();
-            attr->setValue(token);
-            if(attr->getValue().i != prev.i) {
-                rmAttributeNotifier* noti = attr->getNotifier();
-                if(noti != nullptr)
-                    noti->onAttributeChange();
-            }
+    while(i < count) {
+        char* sep = strchr(token, ',');
+        if(sep != NULL)
+            *sep = '\0';
+        if(types[i] != RM_WIRE_STRING)
+            store(i, parseValue(types[i], token));
+        else if(attributes[i] != nullptr) {
+            setValue(attributes[i], token);
+            revision++;
         }
-        token = strtok(NULL, ",");
+        i++;
+        if(sep == NULL)
+            break;
+        token = sep + 1;
     }
 }
 
+/**
+ * @brief Updates the attributes changed since the last update
+ * 
+ * @param str Comma-separated pairs of the attribute index and the value such
+ *            as "0:1.25,3:7"
+ */
+void rmSync::onSyncDelta(const char* str) {
+    std::string buffer = str;
+    char* token = &buffer[0];
+    
+    while(true) {
+        char* sep = strchr(token, ',');
+        if(sep != NULL)
+            *sep = '\0';
+        char* value;
+        size_t i = strtoul(token, &value, 10);
+        if(*value == ':' && i < count) {
+            if(types[i] != RM_WIRE_STRING)
+                store(i, parseValue(types[i], value + 1));
+            else if(attributes[i] != nullptr) {
+                setValue(attributes[i], value + 1);
+                revision++;
+            }
+        }
+        if(sep == NULL)
+            break;
+        token = sep + 1;
+    }
+}
 
-#define MAX_ATTRIBUTES_PER_SYNC 32
+/**
+ * @brief Updates the attribute values from a binary frame
+ * 
+ * The numbers are decoded straight into the value arrays of the table. Values
+ * equal to the last ones received are skipped without touching the
+ * attributes.
+ * 
+ * @param data The values encoded in the client device's data types
+ * @param len Length of the data
+ * @param delta True if each value is preceded by its index, false if the data
+ *              contains the values of the list in order
+ * @param start Index of the first value if not delta
+ */
+void rmSync::onSyncBinary(const uint8_t* data, size_t len, bool delta,
+                          size_t start)
+{
+    size_t i = start;
+    while(len > 0) {
+        if(delta) {
+            i = data[0];
+            data++;
+            len--;
+        }
+        if(i >= count)
+            break;
+        
+        uint8_t type = types[i];
+        uint32_t raw;
+        size_t n;
+        switch(type) {
+          case RM_WIRE_BOOL:
+          case RM_WIRE_CHAR:
+          case RM_WIRE_UINT8:
+            if(len < 1)
+                return;
+            raw = data[0];
+            n = 1;
+            break;
+          
+          case RM_WIRE_INT8:
+            if(len < 1)
+                return;
+            raw = (uint32_t) (int32_t) (int8_t) data[0];
+            n = 1;
+            break;
+          
+          case RM_WIRE_UINT16:
+            if(len < 2)
+                return;
+            raw = data[0] | (data[1] << 8);
+            n = 2;
+            break;
+          
+          case RM_WIRE_INT16:
+            if(len < 2)
+                return;
+            raw = (uint32_t) (int32_t) (int16_t) (data[0] | (data[1] << 8));
+            n = 2;
+            break;
+          
+          case RM_WIRE_UINT32:
+          case RM_WIRE_INT32:
+          case RM_WIRE_FLOAT:
+            if(len < 4)
+                return;
+            raw = data[0] | (data[1] << 8) | (data[2] << 16) |
+                  ((uint32_t) data[3] << 24);
+            n = 4;
+            break;
+          
+          default:
+            // Strings still go through the attribute
+            n = rmFrameDecodeValue(attributes[i], type, data, len);
+            if(n == 0)
+                return;
+            data += n;
+            len -= n;
+            i++;
+            revision++;
+            continue;
+        }
+        
+        store(i, raw);
+        data += n;
+        len -= n;
+        i++;
+    }
+}
 
 
 /**
  * @breif Retrive the list of attributes to work in a sync
  * 
+ * Each item of the list is the attribute name followed by a colon and the
+ * data type code in hexadecimal. The attributes not created by the widgets
+ * yet are created with these types so that no value of the table is dropped.
+ * A list ending with '+' and an index is continued by requesting the rest
+ * from that index, and the reply starts with '@' and the same index. A
+ * keyframe is requested once the list is complete so that the values do not
+ * have to wait for the next one.
+ * 
  * @param str The string containing the name of every attribute
  * @param cli The client instance
+ * @param request False if the device sends the whole list by itself, in which
+ *                case neither the rest of the list nor a keyframe is requested
  */
-void rmSync::updateList(const char* str, rmClient* cli) {
-    char buffer[256];
-    strncpy(buffer, str, 255);
-    buffer[255] = '\0';
-    char *tokens[MAX_ATTRIBUTES_PER_SYNC];
-    char *tok = strtok(buffer, ",");
-    count = 0;
+void rmSync::updateList(const char* str, rmClient* cli, bool request) {
+    std::string buffer = str;
+    char* token = &buffer[0];
+    size_t start = 0;
+    size_t next = 0;
+    
+    // The continued lists start with '@' and the index of the first item
+    if(token[0] == '@') {
+        start = strtoul(token + 1, &token, 10);
+        if(*token == ',')
+            token++;
+    }
+    if(start > count)
+        return;
+    count = start;
     
-    while(tok != NULL && count < MAX_ATTRIBUTES_PER_SYNC) {
-        tokens[count++] = tok;
-        tok = strtok(NULL, ",");
+    // Counts the items to grow the arrays only once
+    size_t n = 1;
+    for(const char* c=token; *c!='\0'; c++) {
+        if(*c == ',')
+            n++;
     }
+    reserve(count + n);
     
-    if(attributes != nullptr)
-        delete attributes;
-    attributes = new rmAttribute*[count];
+    while(*token != '\0') {
+        char* sep = strchr(token, ',');
+        if(sep != NULL)
+            *sep = '\0';
+        if(token[0] == '+') {
+            next = strtoul(token + 1, NULL, 10);
+            break;
+        }
+        
+        char* colon = strchr(token, ':');
+        uint8_t type = RM_WIRE_STRING;
+        if(colon != NULL) {
+            *colon = '\0';
+            type = (uint8_t) strtoul(colon + 1, NULL, 16);
+        }
+        rmAttribute* attr = cli->getAttribute(token);
+        if(attr == nullptr)
+            attr = cli->createAttribute(token, rmFrameAttributeType(type));
+        attributes[count] = attr;
+        types[count] = type;
+        received[count] = false;
+        values[count] = NAN;
+        count++;
+        if(sep == NULL)
+            break;
+        token = sep + 1;
+    }
     
-    for(uint8_t i=0; i<count; i++)
-        attributes[i] = cli->getAttribute(tokens[i]);
+    complete = (next == 0);
+    if(!request)
+        return;
+    if(!complete)
+        cli->requestSyncList(id, next);
+    else
+        cli->sendCommand("syncf %d", id);
 }
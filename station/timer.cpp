@@ -7,6 +7,11 @@
  * function. If the default multithreading is used, there will be data races
  * and conflict with data and event systems of wxWidgets.
  * 
+ * Each tick processes the clients for a limited time, so a burst of data
+ * is spread over several ticks instead of holding up the window. The
+ * interval follows the rate of the data coming in, short while it is busy
+ * and longer while it is quiet.
+ * 
  * @copyright Copyright (c) 2021 Khant Kyaw Khaung
  * 
  * @license{This project is released under the MIT License.}
@@ -18,6 +23,14 @@
 
 #include "rm/timer.hpp"
 
+#include <chrono>
+
+
+static int64_t getTime() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
 
 long rmTimer::getWxID() { 
     if(wx_id == 0)
@@ -44,13 +57,44 @@ rmTimer::rmTimer()
  * 
  * @param ms Time interval in milliseconds
  */
-void rmTimer::start(long ms) { Start(ms); }
+void rmTimer::start(long ms) {
+    interval = ms;
+    rate = 0;
+    lastTick = getTime();
+    Start(ms);
+}
 
 /**
  * @brief Stops the timer
  */
 void rmTimer::stop() { Stop(); }
 
+/**
+ * @brief Sets the time to process the clients in each tick
+ * 
+ * @param us Time in microseconds
+ */
+void rmTimer::setBudget(long us) { budget = us; }
+
+/**
+ * @brief Sets the range the interval adapts in
+ * 
+ * @param min Shortest interval in milliseconds, used while the clients have
+ *            more data than the budget allows
+ * @param max Longest interval in milliseconds, reached when no data comes in
+ */
+void rmTimer::setIntervalRange(long min, long max) {
+    minInterval = min;
+    maxInterval = max;
+}
+
+/**
+ * @brief Gets the interval the timer runs at now
+ * 
+ * @return Time interval in milliseconds
+ */
+long rmTimer::getInterval() const { return interval; }
+
 /**
  * @brief Timer function to be executed in each interval
  * 
@@ -62,13 +106,58 @@ void rmTimer::onTimer(wxTimerEvent& evt) {
         return;
     }
     auto vec = clients;
+    int64_t start = getTime();
+    int64_t elapsed = start - lastTick;
+    lastTick = start;
     
-    for(auto it=vec.begin(); it!=vec.end(); it++) {
-        if((*it)->isConnected() == false) {
-            (*it)->echo("Port disconnected", 1);
-            removeClient(*it);
-            (*it)->onDisconnected();
+    // Takes up from the client where the last tick ran out of time
+    size_t n = vec.size();
+    size_t done = 0;
+    size_t bytes = 0;
+    bool busy = false;
+    for(; done<n; done++) {
+        rmClient* cli = vec[(first + done) % n];
+        long left = budget - (long) (getTime() - start);
+        if(left <= 0) {
+            busy = true;
+            break;
         }
-        (*it)->onIdle();
+        if(cli->isConnected() == false) {
+            if(cli->reconnect())
+                continue;
+            cli->echo("Port disconnected", 1);
+            removeClient(cli);
+            cli->onDisconnected();
+        }
+        bytes += cli->onIdle(left);
+    }
+    if(getTime() - start >= budget)
+        busy = true;
+    first = (first + (busy ? done : 1)) % n;
+    if(clients.size() > 0)
+        adaptInterval(bytes, busy, elapsed);
+}
+
+
+/*
+ * Shortest interval while the budget runs out. Otherwise, the interval in
+ * which RM_TIMER_TICK_BYTES come in at the smoothed rate, which grows to the
+ * longest as the rate falls away.
+ */
+void rmTimer::adaptInterval(size_t bytes, bool busy, int64_t elapsed) {
+    if(elapsed > 0)
+        rate += (bytes * 1000.0f / elapsed - rate) * 0.25f;
+    long next = maxInterval;
+    if(busy)
+        next = minInterval;
+    else if(rate * maxInterval > RM_TIMER_TICK_BYTES)
+        next = (long) (RM_TIMER_TICK_BYTES / rate);
+    if(next < minInterval)
+        next = minInterval;
+    if(next > maxInterval)
+        next = maxInterval;
+    if(next != interval) {
+        interval = next;
+        Start(interval);
     }
 }
@@ -0,0 +1,223 @@
+/**
+ * @file bench_hub_pty.cpp
+ * @brief Measures how the hub scales with the worker threads
+ * 
+ * Plays the devices on the master sides of pseudo-terminals in a child
+ * process. Each device answers "connect" with a sync table of a sequence
+ * number and eight floats and then sends a fixed number of its lines as
+ * fast as the station takes them. For each number of workers, times the
+ * hub from connecting until every device's last line is decoded.
+ * 
+ * The child process takes a core of its own to make the lines, so the
+ * counts up to one less than the cores show the scaling best.
+ * 
+ * Usage: rmonitor_bench_hub_pty [devices] [lines per device]
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_NO_WX
+
+
+#include <robotmonitor.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+#define CHUNK_SIZE 4096
+#define TIMEOUT 120
+
+static const char handshake[] =
+    "$hello 1 0 256 256 0\n"
+    "$lst 0 seq:1a,a:1c,b:1c,c:1c,d:1c,e:1c,f:1c,g:1c,h:1c\n"
+    "$ready\n";
+
+
+static double now() {
+    auto t = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration<double>(t).count();
+}
+
+
+// The lines from one sequence number on, up to about a chunk
+static void appendLines(std::string& buf, long& seq, long last) {
+    char line[128];
+    while(seq < last && buf.size() < CHUNK_SIZE) {
+        seq++;
+        float x = (seq % 1000) * 0.01f;
+        snprintf(line, sizeof(line),
+                 "$sync 0 %ld,%.2f,%.2f,%.2f,%.2f,%.3f,%.3f,%.1f,%.1f\n",
+                 seq, x, -x, x + 1, x * 2, x / 3, -x / 7, x * 10, -x * 10);
+        buf += line;
+    }
+}
+
+
+// Runs in the child process until killed
+static void playDevices(const std::vector<int>& masters, long lines) {
+    size_t n = masters.size();
+    std::vector<struct pollfd> fds(n);
+    std::vector<std::string> out(n);
+    std::vector<std::string> in(n);
+    std::vector<long> seq(n, 0);
+    std::vector<bool> started(n, false);
+    char buf[CHUNK_SIZE];
+    
+    while(true) {
+        for(size_t i=0; i<n; i++) {
+            fds[i].fd = masters[i];
+            fds[i].events = POLLIN;
+            if(!out[i].empty() || (started[i] && seq[i] < lines))
+                fds[i].events |= POLLOUT;
+            fds[i].revents = 0;
+        }
+        poll(fds.data(), n, 100);
+        
+        for(size_t i=0; i<n; i++) {
+            if(fds[i].revents & POLLIN) {
+                ssize_t r = read(masters[i], buf, sizeof(buf));
+                if(r > 0 && !started[i]) {
+                    in[i].append(buf, r);
+                    if(in[i].find("$connect") != std::string::npos) {
+                        out[i] = handshake;
+                        started[i] = true;
+                    }
+                }
+            }
+            if(fds[i].revents & POLLOUT) {
+                if(out[i].empty())
+                    appendLines(out[i], seq[i], lines);
+                ssize_t w = write(masters[i], out[i].data(), out[i].size());
+                if(w > 0)
+                    out[i].erase(0, w);
+            }
+        }
+    }
+}
+
+
+// Seconds from connecting until every device's last line is decoded
+static double run(size_t workers, size_t devices, long lines,
+                  rmHubStats& stats)
+{
+    std::vector<int> masters, slaves;
+    std::vector<std::string> names;
+    for(size_t i=0; i<devices; i++) {
+        int master, slave;
+        char name[64];
+        if(openpty(&master, &slave, name, NULL, NULL) < 0) {
+            perror("openpty");
+            exit(1);
+        }
+        struct termios t;
+        tcgetattr(slave, &t);
+        cfmakeraw(&t);
+        tcsetattr(slave, TCSANOW, &t);
+        fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+        masters.push_back(master);
+        slaves.push_back(slave);
+        names.push_back(name);
+    }
+    
+    pid_t pid = fork();
+    if(pid == 0) {
+        playDevices(masters, lines);
+        _exit(0);
+    }
+    
+    double t;
+    {
+        rmHub hub(workers);
+        std::vector<std::string> keys;
+        t = now();
+        for(size_t i=0; i<devices; i++) {
+            // A PTY is not in the port list, so it is given in full
+            rmSerialPortInfo info;
+            memset(&info, 0, sizeof(info));
+            strncpy(info.port, names[i].c_str(), sizeof(info.port) - 1);
+            strcpy(info.hardware_id, "n/a");
+            std::string name = "robot" + std::to_string(i);
+            hub.createClient(name.c_str())->connectSerial(info, 115200);
+            keys.push_back(name + ".seq");
+        }
+        
+        size_t done = 0;
+        while(done < devices && now() - t < TIMEOUT) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            done = 0;
+            for(size_t i=0; i<devices; i++) {
+                rmAttribute* attr = hub.getAttribute(keys[i].c_str());
+                if(attr != nullptr && attr->getValue().i == lines)
+                    done++;
+            }
+        }
+        t = now() - t;
+        if(done < devices)
+            printf("only %zu of the devices finished\n", done);
+        stats = hub.getStats();
+    }
+    
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    for(size_t i=0; i<devices; i++) {
+        close(slaves[i]);
+        close(masters[i]);
+    }
+    return t;
+}
+
+
+int main(int argc, char** argv) {
+    size_t devices = (argc > 1) ? atol(argv[1]) : 32;
+    long lines = (argc > 2) ? atol(argv[2]) : 20000;
+    size_t cores = std::thread::hardware_concurrency();
+    if(cores == 0)
+        cores = 1;
+    
+    // Bytes each device sends after the handshake
+    size_t bytes = 0;
+    long seq = 0;
+    while(seq < lines) {
+        std::string buf;
+        appendLines(buf, seq, lines);
+        bytes += buf.size();
+    }
+    
+    printf("%zu devices, %ld lines each, %zu cores\n", devices, lines, cores);
+    printf("%8s  %10s  %14s  %10s  %10s  %8s  %7s\n", "workers", "seconds",
+           "lines/s", "MB/s", "rounds", "steals", "speedup");
+    // Doubling up to the number of cores
+    std::vector<size_t> counts;
+    for(size_t workers=1; workers<cores; workers*=2)
+        counts.push_back(workers);
+    counts.push_back(cores);
+    
+    double base = 0;
+    for(size_t workers : counts) {
+        rmHubStats stats;
+        double t = run(workers, devices, lines, stats);
+        if(base == 0)
+            base = t;
+        printf("%8zu  %10.3f  %14.0f  %10.2f  %10llu  %8llu  %7.2f\n",
+               workers, t, devices * lines / t, devices * bytes / t / 1e6,
+               (unsigned long long) stats.rounds,
+               (unsigned long long) stats.steals, base / t);
+    }
+    return 0;
+}
@@ -0,0 +1,152 @@
+/**
+ * @file bench_list_ports.cpp
+ * @brief Measures listing the serial ports against a synthetic sysfs tree
+ * 
+ * Builds a device directory and a sysfs tree in a temporary directory with
+ * many ttyS placeholders, a few PNP UARTs and USB adapters, then times the
+ * first listing, which probes every port, and the listings after it, which
+ * only check the device nodes against the cache.
+ * 
+ * Usage: rmonitor_bench_list_ports [placeholders] [usb]
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#include <rm/serial/serial.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+
+#define ITERATIONS 1000
+
+
+namespace fs = std::filesystem;
+
+
+static void writeLine(const fs::path& path, const std::string& line) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << line << "\n";
+}
+
+
+static void makeNode(const fs::path& dev, const std::string& name) {
+    std::ofstream(dev / name);
+}
+
+
+// The device of ttyUSB is two levels below the USB device and the device of
+// ttyACM one level, as the kernel lays them out
+static void makeUsb(const fs::path& root, const std::string& name, int n,
+                    bool acm)
+{
+    std::string usb = "devices/usb1/1-" + std::to_string(n);
+    fs::path dev = root / "sys" / usb;
+    writeLine(dev / "idVendor", acm ? "2341" : "0403");
+    writeLine(dev / "idProduct", acm ? "0043" : "6001");
+    writeLine(dev / "manufacturer", acm ? "Arduino" : "FTDI");
+    writeLine(dev / "product", acm ? "Uno" : "FT232R USB UART");
+    writeLine(dev / "serial", "A" + std::to_string(1000 + n));
+    writeLine(dev / "devnum", std::to_string(n));
+    
+    fs::path target = dev / ("1-" + std::to_string(n) + ":1.0");
+    if(!acm)
+        target /= name;
+    fs::create_directories(target);
+    fs::path link = root / "sys/class/tty" / name;
+    fs::create_directories(link);
+    fs::create_symlink(target, link / "device");
+    makeNode(root / "dev", name);
+}
+
+
+static void makeFixture(const fs::path& root, int placeholders, int usb) {
+    fs::create_directories(root / "dev");
+    fs::create_directories(root / "sys/devices/platform/serial8250");
+    for(int i=0; i<placeholders; i++) {
+        std::string name = "ttyS" + std::to_string(i);
+        fs::path link = root / "sys/class/tty" / name;
+        fs::create_directories(link);
+        fs::create_symlink(root / "sys/devices/platform/serial8250",
+                           link / "device");
+        makeNode(root / "dev", name);
+    }
+    
+    // Two PNP UARTs on board after the placeholders
+    for(int i=0; i<2; i++) {
+        std::string name = "ttyS" + std::to_string(placeholders + i);
+        fs::path pnp = root / "sys/devices/pnp0" / ("00:0" + std::to_string(i));
+        writeLine(pnp / "id", "PNP0501");
+        fs::path link = root / "sys/class/tty" / name;
+        fs::create_directories(link);
+        fs::create_symlink(pnp, link / "device");
+        makeNode(root / "dev", name);
+    }
+    
+    for(int i=0; i<usb; i++) {
+        makeUsb(root, "ttyUSB" + std::to_string(i), 2 * i + 1, false);
+        makeUsb(root, "ttyACM" + std::to_string(i), 2 * i + 2, true);
+    }
+    
+    // Other nodes of a busy /dev that are not serial ports
+    for(int i=0; i<256; i++)
+        makeNode(root / "dev", "tty" + std::to_string(i));
+}
+
+
+static double now() {
+    auto t = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration<double>(t).count();
+}
+
+
+int main(int argc, char** argv) {
+    int placeholders = (argc > 1) ? atoi(argv[1]) : 256;
+    int usb = (argc > 2) ? atoi(argv[2]) : 4;
+    
+    fs::path root = fs::temp_directory_path() /
+                    ("rm-bench-" + std::to_string(getpid()));
+    makeFixture(root, placeholders, usb);
+    std::string dev = (root / "dev").string();
+    std::string sys = (root / "sys").string();
+    
+    double t = now();
+    auto ports = serial::list_ports_in(dev, sys);
+    double cold = now() - t;
+    
+    t = now();
+    for(int i=0; i<ITERATIONS; i++)
+        ports = serial::list_ports_in(dev, sys);
+    double warm = (now() - t) / ITERATIONS;
+    
+    // A replugged adapter gets a new device node
+    t = now();
+    for(int i=0; i<ITERATIONS; i++) {
+        fs::remove(root / "dev/ttyACM0");
+        makeNode(root / "dev", "ttyACM0");
+        ports = serial::list_ports_in(dev, sys);
+    }
+    double replug = (now() - t) / ITERATIONS;
+    
+    printf("%d placeholders, 2 PNP UARTs, %d USB adapters: %zu ports\n",
+           placeholders, 2 * usb, ports.size());
+    for(auto it=ports.begin(); it!=ports.end(); ++it) {
+        printf("  %-28s %-36s %s\n", it->port.substr(root.string().size())
+               .c_str(), it->hardware_id.c_str(), it->description.c_str());
+    }
+    printf("first listing  %10.1f us\n", cold * 1e6);
+    printf("cached         %10.1f us\n", warm * 1e6);
+    printf("one replugged  %10.1f us\n", replug * 1e6);
+    
+    fs::remove_all(root);
+    return 0;
+}
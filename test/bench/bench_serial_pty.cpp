@@ -0,0 +1,189 @@
+/**
+ * @file bench_serial_pty.cpp
+ * @brief Measures the serial port over a pseudo-terminal at each baudrate
+ * 
+ * Opens the slave side of a PTY with serial::Serial and plays the device on
+ * the master side. For each baudrate, with and without the low latency mode,
+ * times a bulk transfer from the device and the round trip of short messages
+ * echoed back by the station.
+ * 
+ * A PTY moves the bytes as fast as the processes do, whatever the baudrate,
+ * so this measures the software path. The rates that have no B constant go
+ * through termios2 and BOTHER all the same, which the first column checks.
+ * 
+ * Usage: rmonitor_bench_serial_pty [bulk bytes] [messages]
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#include <rm/serial/serial.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <unistd.h>
+
+
+#define MESSAGE_SIZE 32
+#define CHUNK_SIZE 4096
+
+// The speed <termios.h> reports for the rates set through termios2
+#ifndef BOTHER
+#define BOTHER 0010000
+#endif
+
+
+static const uint32_t rates[] = {
+    115200, 250000, 921600, 1500000, 1843200, 2000000, 3000000
+};
+
+
+static double now() {
+    auto t = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration<double>(t).count();
+}
+
+
+static bool readAll(int fd, uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while(n < len) {
+        struct pollfd p = { fd, POLLIN, 0 };
+        if(poll(&p, 1, 1000) <= 0)
+            return false;
+        ssize_t r = read(fd, buf + n, len - n);
+        if(r <= 0)
+            return false;
+        n += r;
+    }
+    return true;
+}
+
+
+static bool writeAll(int fd, const uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while(n < len) {
+        ssize_t w = write(fd, buf + n, len - n);
+        if(w < 0) {
+            struct pollfd p = { fd, POLLOUT, 0 };
+            poll(&p, 1, 1000);
+            continue;
+        }
+        n += w;
+    }
+    return true;
+}
+
+
+// Bytes per second from the device to the station
+static double bulk(int master, serial::Serial& port, size_t total) {
+    std::thread device([master, total]() {
+        std::vector<uint8_t> chunk(CHUNK_SIZE, 'x');
+        for(size_t n=0; n<total; n+=CHUNK_SIZE)
+            writeAll(master, chunk.data(), CHUNK_SIZE);
+    });
+    
+    std::vector<uint8_t> buf(CHUNK_SIZE);
+    size_t received = 0;
+    double t = now();
+    while(received < total) {
+        size_t n = port.read(buf.data(), buf.size());
+        if(n == 0)
+            break;
+        received += n;
+    }
+    t = now() - t;
+    device.join();
+    return received / t;
+}
+
+
+// Seconds from the device sending a message to it receiving the echo
+static double roundTrip(int master, serial::Serial& port, int messages) {
+    uint8_t msg[MESSAGE_SIZE];
+    uint8_t buf[MESSAGE_SIZE];
+    memset(msg, 'm', sizeof(msg));
+    
+    std::thread station([&port, messages]() {
+        uint8_t echo[MESSAGE_SIZE];
+        for(int i=0; i<messages; i++) {
+            if(port.read(echo, sizeof(echo)) != sizeof(echo))
+                break;
+            port.write(echo, sizeof(echo));
+        }
+    });
+    
+    double total = 0;
+    int done = 0;
+    for(int i=0; i<messages; i++) {
+        double t = now();
+        writeAll(master, msg, sizeof(msg));
+        if(!readAll(master, buf, sizeof(buf)))
+            break;
+        total += now() - t;
+        done++;
+    }
+    station.join();
+    return (done > 0) ? total / done : 0;
+}
+
+
+int main(int argc, char** argv) {
+    size_t total = (argc > 1) ? atol(argv[1]) : 4 << 20;
+    int messages = (argc > 2) ? atoi(argv[2]) : 2000;
+    total -= total % CHUNK_SIZE;
+    
+    printf("%zu bulk bytes, %d messages of %d bytes\n", total, messages,
+           MESSAGE_SIZE);
+    printf("%10s  %-11s  %12s  %14s\n", "baudrate", "mode", "bulk MB/s",
+           "round trip us");
+    for(uint32_t rate : rates) {
+        for(int lowLatency=0; lowLatency<2; lowLatency++) {
+            int master, slave;
+            char name[64];
+            if(openpty(&master, &slave, name, NULL, NULL) < 0) {
+                perror("openpty");
+                return 1;
+            }
+            fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+            
+            double bytesPerSec, latency;
+            bool bother;
+            try {
+                serial::Serial port(name, rate,
+                                    serial::Timeout::simpleTimeout(1000));
+                port.setLowLatency(lowLatency != 0);
+                struct termios t;
+                tcgetattr(slave, &t);
+                bother = (cfgetospeed(&t) == BOTHER);
+                bytesPerSec = bulk(master, port, total);
+                latency = roundTrip(master, port, messages);
+            }
+            catch(std::exception& e) {
+                printf("%10u  %s\n", rate, e.what());
+                close(slave);
+                close(master);
+                continue;
+            }
+            
+            printf("%10u%s %-11s  %12.1f  %14.1f\n", rate,
+                   bother ? "*" : " ",
+                   lowLatency ? "low latency" : "default",
+                   bytesPerSec / 1e6, latency * 1e6);
+            close(slave);
+            close(master);
+        }
+    }
+    printf("* set through termios2 and BOTHER\n");
+    return 0;
+}
@@ -39,7 +39,7 @@ MyFrame::MyFrame(wxWindow* parent, wxWindowID id, const wxString& title, const w
     /*
     txtEcho = new wxTextCtrl(this, wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxTE_MULTILINE|wxTE_RICH);
     */
-    txtEcho = new rmEchoBox(this, &client);
+    txtEcho = new rmEchoLog(this, &client);
 
     set_properties();
     do_layout();
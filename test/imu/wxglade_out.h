@@ -64,7 +64,7 @@ protected:
     wxButton* btnConnect;
     wxPanel* pnlToolBar;
     wxBoxSizer* sizerFocus;
-    wxTextCtrl* txtEcho;
+    rmEchoLog* txtEcho;
     wxStaticBoxSizer* sizerEcho;
     wxBoxSizer* sizerWidgets;
     // end wxGlade
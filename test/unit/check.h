@@ -0,0 +1,41 @@
+/**
+ * @file check.h
+ * @brief The checks of the unit tests
+ * 
+ * A failed check prints where it is and makes the test exit with 1 at the
+ * end, so the rest of the checks still run.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#pragma once
+#ifndef __RM_TEST_CHECK_H__
+#define __RM_TEST_CHECK_H__ ///< Header guard
+
+#include <stdio.h>
+
+
+static int checkFailures = 0; ///< Number of the checks failed
+
+
+/**
+ * @brief Checks a condition and counts it as failed if false
+ */
+#define CHECK(cond) \
+    do { \
+        if(!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            checkFailures++; \
+        } \
+    } while(0)
+
+
+/**
+ * @brief The exit code of the test
+ */
+#define CHECK_RESULT() (checkFailures == 0 ? 0 : 1)
+
+#endif
@@ -0,0 +1,163 @@
+/**
+ * @file test_capi.cpp
+ * @brief Checks that the C interface records every value received
+ * 
+ * Plays a device on the master side of a pseudo-terminal that sends the
+ * same values again and again, through the text sync lines and "$set". Each
+ * line is to give a sample of its own, as a script plotting the values needs
+ * the times of all of them, not only the changes.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_NO_WX
+
+
+#include <rm/capi.h>
+
+#include "check.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <pty.h>
+#include <unistd.h>
+
+
+#define REPEAT_COUNT 20
+#define TIMEOUT 5
+
+
+static int master = -1;
+
+
+static void sendLines(const std::string& str) {
+    size_t pos = 0;
+    while(pos < str.size()) {
+        ssize_t n = write(master, &str[pos], str.size() - pos);
+        if(n > 0)
+            pos += n;
+        else
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+
+// Answers "$connect" with the description of a sync table
+static bool handshake() {
+    std::string in;
+    char buf[256];
+    auto start = std::chrono::steady_clock::now();
+    while(in.find("$connect") == std::string::npos) {
+        if(std::chrono::steady_clock::now() - start >
+           std::chrono::seconds(TIMEOUT))
+            return false;
+        ssize_t n = read(master, buf, sizeof(buf));
+        if(n > 0)
+            in.append(buf, n);
+        else
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    sendLines("$hello 1 0 256 256 0\n"
+              "$lst 0 seq:1a,x:1c\n"
+              "$ready\n");
+    return true;
+}
+
+
+// Waits for a number of samples of a watch
+static size_t waitFor(rmClientHandle* h, int id, size_t count) {
+    auto start = std::chrono::steady_clock::now();
+    while(rmClientAvailable(h, id) < count &&
+          std::chrono::steady_clock::now() - start <
+          std::chrono::seconds(TIMEOUT))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return rmClientAvailable(h, id);
+}
+
+
+int main() {
+    int slave;
+    char name[64];
+    if(openpty(&master, &slave, name, NULL, NULL) < 0) {
+        perror("openpty");
+        return 1;
+    }
+    struct termios t;
+    tcgetattr(slave, &t);
+    cfmakeraw(&t);
+    tcsetattr(slave, TCSANOW, &t);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    
+    rmClientHandle* h = rmClientCreate();
+    int seq = rmClientWatch(h, "seq", 256);
+    int x = rmClientWatch(h, "x", 256);
+    CHECK(seq >= 0 && x >= 0);
+    std::thread device([]() { CHECK(handshake()); });
+    CHECK(rmClientConnect(h, name, 115200) == 1);
+    device.join();
+    
+    // The first values, after which the samples are counted
+    sendLines("$sync 0 1,2.50\n");
+    waitFor(h, x, 2);
+    double times[256];
+    double values[256];
+    rmClientRead(h, seq, times, values, 256);
+    rmClientRead(h, x, times, values, 256);
+    
+    // The same line over and over
+    std::string lines;
+    for(int i=0; i<REPEAT_COUNT; i++)
+        lines += "$sync 0 1,2.50\n";
+    sendLines(lines);
+    CHECK(waitFor(h, x, REPEAT_COUNT) == REPEAT_COUNT);
+    CHECK(waitFor(h, seq, REPEAT_COUNT) == REPEAT_COUNT);
+    size_t n = rmClientRead(h, x, times, values, 256);
+    CHECK(n == REPEAT_COUNT);
+    for(size_t i=0; i<n; i++) {
+        CHECK(values[i] == 2.5);
+        if(i > 0)
+            CHECK(times[i] >= times[i - 1]);
+    }
+    n = rmClientRead(h, seq, times, values, 256);
+    CHECK(n == REPEAT_COUNT);
+    for(size_t i=0; i<n; i++)
+        CHECK(values[i] == 1);
+    
+    // Only one of the values repeated
+    lines.clear();
+    for(int i=0; i<REPEAT_COUNT; i++)
+        lines += "$sync 0 " + std::to_string(i + 2) + ",2.50\n";
+    sendLines(lines);
+    CHECK(waitFor(h, seq, REPEAT_COUNT) == REPEAT_COUNT);
+    CHECK(waitFor(h, x, REPEAT_COUNT) == REPEAT_COUNT);
+    n = rmClientRead(h, seq, times, values, 256);
+    CHECK(n == REPEAT_COUNT && values[n - 1] == REPEAT_COUNT + 1);
+    rmClientRead(h, x, times, values, 256);
+    
+    // The same value set again
+    lines.clear();
+    for(int i=0; i<REPEAT_COUNT; i++)
+        lines += "$set x 2.50\n";
+    sendLines(lines);
+    CHECK(waitFor(h, x, REPEAT_COUNT) == REPEAT_COUNT);
+    CHECK(rmClientAvailable(h, seq) == 0);
+    
+    CHECK(rmClientDropped(h, x) == 0);
+    rmClientDestroy(h);
+    close(slave);
+    close(master);
+    if(checkFailures == 0)
+        printf("all checks passed\n");
+    return CHECK_RESULT();
+}
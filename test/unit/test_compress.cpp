@@ -0,0 +1,146 @@
+/**
+ * @file test_compress.cpp
+ * @brief Checks the compression of the lines against their decoding
+ * 
+ * The lines are compressed by the coder of the client firmware, built into
+ * the test, and decoded by rmDecompressor. The output is to be the lines
+ * sent, over the resets of the window, the matches longer than a code gives
+ * and the characters to be escaped. Then a byte is dropped from the stream,
+ * which is to be found by the check of the next line, and the lines from
+ * the next reset are to be decoded again.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_NO_WX
+
+
+#include <rm/compress.hpp>
+
+#include "../../client/src/connection_private.h"
+#include "check.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+#define LINE_COUNT 200
+
+
+extern "C" void rmSetCompression(bool en);
+
+
+static std::string reply;
+static std::string stream;
+
+
+static void sinkMessage(const char* msg) {
+    reply += msg;
+}
+
+
+static void sinkData(const void* data, uint16_t len) {
+    stream.append((const char*) data, len);
+}
+
+
+static std::string makeLine(int i) {
+    char buf[300];
+    if(i % 50 == 7) {
+        // Longer than a match and than the window
+        std::string str = "$echo ";
+        for(int k=0; k<40; k++)
+            str += "motor ok ";
+        return str + "\n";
+    }
+    if(i % 10 == 3)
+        snprintf(buf, sizeof(buf), "$echo temp %d\xC2\xB0" "C\n", 20 + i % 7);
+    else
+        snprintf(buf, sizeof(buf), "$sync 0 %d,%.3f,%.3f,-%.3f\n", i,
+                 i * 0.25, 1.5 + (i % 9) * 0.125, (i % 4) * 0.5);
+    return buf;
+}
+
+
+// Decodes a stream, leaving out what comes between a failed check and a reset
+static std::string decode(rmDecompressor& dec, const std::string& data,
+                          int* failures)
+{
+    std::string out;
+    char buf[RM_COMPRESS_MAX_MATCH];
+    *failures = 0;
+    for(size_t i=0; i<data.size(); i++) {
+        int n = dec.push((uint8_t) data[i], buf);
+        if(n < 0)
+            (*failures)++;
+        else
+            out.append(buf, n);
+    }
+    return out;
+}
+
+
+int main() {
+    _rmSendMessage = sinkMessage;
+    _rmSendData = sinkData;
+    rmSetCompression(true);
+    CHECK(_rmCompressSet != nullptr);
+    if(_rmCompressSet == nullptr)
+        return CHECK_RESULT();
+    _rmCompressSet(true, true);
+    int window = 0;
+    CHECK(sscanf(reply.c_str(), "$compress 1 %d", &window) == 1);
+    
+    std::string text;
+    std::vector<size_t> starts;
+    for(int i=0; i<LINE_COUNT; i++) {
+        std::string line = makeLine(i);
+        starts.push_back(stream.size());
+        _rmSendMessage(line.c_str());
+        text += line;
+    }
+    printf("%zu bytes compressed to %zu\n", text.size(), stream.size());
+    CHECK(stream.size() * 3 < text.size() * 2);
+    
+    rmDecompressor dec;
+    CHECK(dec.reset(window));
+    int failures;
+    CHECK(decode(dec, stream, &failures) == text);
+    CHECK(failures == 0);
+    CHECK(dec.isIdle() && !dec.isBroken());
+    
+    // A byte lost in the 40th line, with a reset at the start of the 64th
+    std::string lost = stream;
+    lost.erase(starts[39] + 5, 1);
+    CHECK(dec.reset(window));
+    std::string out = decode(dec, lost, &failures);
+    CHECK(failures > 0);
+    CHECK(!dec.isBroken());
+    std::string tail;
+    for(int i=63; i<LINE_COUNT; i++)
+        tail += makeLine(i);
+    CHECK(out.size() >= tail.size() &&
+          out.compare(out.size() - tail.size(), tail.size(), tail) == 0);
+    std::string head;
+    for(int i=0; i<39; i++)
+        head += makeLine(i);
+    CHECK(out.compare(0, head.size(), head) == 0);
+    
+    // Stopped, the lines are sent as they are
+    reply.clear();
+    _rmCompressSet(false, true);
+    CHECK(reply == "$compress 0\n");
+    size_t size = stream.size();
+    _rmSendMessage("$sync 0 1,2\n");
+    CHECK(reply == "$compress 0\n$sync 0 1,2\n");
+    CHECK(stream.size() == size);
+    
+    if(checkFailures == 0)
+        printf("all checks passed\n");
+    return CHECK_RESULT();
+}
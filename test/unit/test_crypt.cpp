@@ -0,0 +1,375 @@
+/**
+ * @file test_crypt.cpp
+ * @brief Checks the encryption of the station
+ * 
+ * The ciphers built into the library are checked against the test vectors
+ * of RFC 8439 for ChaCha20 and Poly1305, of the XChaCha draft for HChaCha20
+ * and of RFC 7748 for X25519. Then the two ends of a channel, the files of
+ * a new key, and the refusal of a device whose key is not known, which is
+ * played on the master side of a pseudo-terminal.
+ * 
+ * Usage: rmonitor_test_crypt [directory]
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_NO_WX
+
+
+#include <rm/client.hpp>
+#include <rm/encryption.hpp>
+
+#include "../../client/src/cipher_private.h"
+#include "check.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <pty.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+#define TIMEOUT 5
+
+
+static const char sunscreen[] =
+    "Ladies and Gentlemen of the class of '99: If I could offer you only "
+    "one tip for the future, sunscreen would be it.";
+
+
+static std::vector<uint8_t> hex(const char* str) {
+    std::vector<uint8_t> vec;
+    for(size_t i=0; str[i] != '\0' && str[i + 1] != '\0'; i+=2) {
+        unsigned int v;
+        sscanf(&str[i], "%2x", &v);
+        vec.push_back((uint8_t) v);
+    }
+    return vec;
+}
+
+
+static bool same(const uint8_t* data, const char* expected) {
+    std::vector<uint8_t> vec = hex(expected);
+    return memcmp(data, vec.data(), vec.size()) == 0;
+}
+
+
+// RFC 8439 2.3.2, 2.4.2 and 2.6.2
+static void checkChacha() {
+    uint8_t key[32];
+    uint8_t block[64];
+    for(int i=0; i<32; i++)
+        key[i] = (uint8_t) i;
+    _rmChachaBlock(block, key, 1, hex("000000090000004a00000000").data());
+    CHECK(same(block, "10f1e7e4d13b5915500fdd1fa32071c4c7d1f4c733c06803"
+                      "0422aa9ac3d46c4ed2826446079faa0914c2d705d98b02a2"
+                      "b5129cd1de164eb9cbd083e8a2503c4e"));
+    
+    std::vector<uint8_t> text(sunscreen, sunscreen + strlen(sunscreen));
+    _rmChachaXor(text.data(), text.size(), key, 1,
+                 hex("000000000000004a00000000").data());
+    CHECK(same(text.data(), "6e2e359a2568f98041ba0728dd0d6981e97e7aec1d43"
+                            "60c20a27afccfd9fae0bf91b65c5524733ab8f593dab"
+                            "cd62b3571639d624e65152ab8f530c359f0861d807ca"
+                            "0dbf500d6a6156a38e088a22b65e52bc514d16ccf806"
+                            "818ce91ab77937365af90bbf74a35be6b40b8eedf278"
+                            "5e42874d"));
+    
+    for(int i=0; i<32; i++)
+        key[i] = (uint8_t) (0x80 + i);
+    _rmChachaBlock(block, key, 0, hex("000000000001020304050607").data());
+    CHECK(same(block, "8ad5a08b905f81cc815040274ab29471a833b637e3fd0da5"
+                      "08dbb8e2fdd1a646"));
+}
+
+
+// RFC 8439 2.5.2 and 2.8.2
+static void checkPoly1305() {
+    const char* msg = "Cryptographic Forum Research Group";
+    uint8_t tag[16];
+    _rmPoly1305(tag, (const uint8_t*) msg, strlen(msg),
+                hex("85d6be7857556d337f4452fe42d506a80103808afb0db2fd"
+                    "4abff6af4149f51b").data());
+    CHECK(same(tag, "a8061dc1305136c6c22b8baf0c0127a9"));
+    
+    uint8_t key[32];
+    for(int i=0; i<32; i++)
+        key[i] = (uint8_t) (0x80 + i);
+    std::vector<uint8_t> nonce = hex("070000004041424344454647");
+    std::vector<uint8_t> aad = hex("50515253c0c1c2c3c4c5c6c7");
+    std::vector<uint8_t> text(sunscreen, sunscreen + strlen(sunscreen));
+    _rmChachaXor(text.data(), text.size(), key, 1, nonce.data());
+    CHECK(same(text.data(), "d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e"
+                            "08fea9e2b5a736ee62d63dbea45e8ca9671282fafb69"
+                            "da92728b1a71de0a9e060b2905d6a5b67ecd3b3692dd"
+                            "bd7f2d778b8c9803aee328091b58fab324e4fad67594"
+                            "5585808b4831d7bc3ff4def08e4b7a9de576d26586ce"
+                            "c64b6116"));
+    _rmAeadTag(tag, aad.data(), aad.size(), text.data(), text.size(), key,
+               nonce.data());
+    CHECK(same(tag, "1ae10b594f09e26a7e902ecbd0600691"));
+}
+
+
+// draft-irtf-cfrg-xchacha-03 2.2.1
+static void checkHChacha() {
+    uint8_t key[32];
+    uint8_t out[32];
+    for(int i=0; i<32; i++)
+        key[i] = (uint8_t) i;
+    _rmHChacha(out, key, hex("000000090000004a0000000031415927").data());
+    CHECK(same(out, "82413b4227b27bfed30e42508a877d73a0f9e4d58a74a853"
+                    "c12ec41326d3ecdc"));
+}
+
+
+// RFC 7748 5.2 and 6.1
+static void checkX25519() {
+    uint8_t out[32];
+    rmX25519(out, hex("a546e36bf0527c9d3b16154b82465edd62144c0ac1fc5a18"
+                      "506a2244ba449ac4").data(),
+             hex("e6db6867583030db3594c1a424b15f7c726624ec26b3353b10a9"
+                 "03a6d0ab1c4c").data());
+    CHECK(same(out, "c3da55379de9c6908e94ea4df28d084f32eccf03491c71f754b4"
+                    "075577a28552"));
+    rmX25519(out, hex("4b66e9d4d1b4673c5ad22691957d6af5c11b6421e0ea01d4"
+                      "2ca4169e7918ba0d").data(),
+             hex("e5210f12786811d3f4b7959d0538ae2c31dbe7106fc03c3efc4c"
+                 "d549c715a493").data());
+    CHECK(same(out, "95cbde9476e8907d7aade45cb4b873f88b595a68799fa152e6f8"
+                    "f7647aac7957"));
+    
+    // The result fed back as the scalar, and the scalar as the point
+    uint8_t k[32] = {9};
+    uint8_t u[32] = {9};
+    for(int i=1; i<=1000; i++) {
+        rmX25519(out, k, u);
+        memcpy(u, k, 32);
+        memcpy(k, out, 32);
+        if(i == 1)
+            CHECK(same(k, "422c8e7a6227d7bca1350b3e2bb7279f7897b87bb6854b78"
+                          "3c60e80311ae3079"));
+    }
+    CHECK(same(k, "684cf59ba83309552800ef566f2f4d3c1c3887c49360e3875f2e"
+                  "b94d99532c51"));
+    
+    std::vector<uint8_t> alice = hex("77076d0a7318a57d3c16c17251b26645df4c"
+                                     "2f87ebc0992ab177fba51db92c2a");
+    std::vector<uint8_t> bob = hex("5dab087e624a8a4b79e17f8b83800ee66f3bb1"
+                                   "292618b6fd1c2f8b27ff88e0eb");
+    uint8_t base[32] = {9};
+    uint8_t alicePub[32], bobPub[32], secret1[32], secret2[32];
+    rmX25519(alicePub, alice.data(), base);
+    rmX25519(bobPub, bob.data(), base);
+    rmX25519(secret1, alice.data(), bobPub);
+    rmX25519(secret2, bob.data(), alicePub);
+    CHECK(same(alicePub, "8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4"
+                         "eba4a98eaa9b4e6a"));
+    CHECK(same(bobPub, "de9edb7d7b7dc1b4d35b61c2ece435373f8343c85b78674d"
+                       "adfc7e146f882b4f"));
+    CHECK(same(secret1, "4a5d9d5ba4ce2de1728e3bf480350f25e07e21c947d19e33"
+                        "76f09b3c1e161742"));
+    CHECK(memcmp(secret1, secret2, 32) == 0);
+}
+
+
+// Sealed by one end and opened by the other, only once and only intact
+static void checkChannel() {
+    uint8_t secret[32];
+    uint8_t stationNonce[RM_CRYPT_NONCE_SIZE] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint8_t deviceNonce[RM_CRYPT_NONCE_SIZE] = {8, 7, 6, 5, 4, 3, 2, 1};
+    for(int i=0; i<32; i++)
+        secret[i] = (uint8_t) (i * 3);
+    rmCryptChannel station, device;
+    station.start(secret, stationNonce, deviceNonce, true);
+    device.start(secret, stationNonce, deviceNonce, false);
+    
+    const char* msg = "$set speed 2.5\n";
+    size_t len = strlen(msg);
+    uint8_t buf[64];
+    for(int k=0; k<3; k++) {
+        memcpy(&buf[4], msg, len);
+        size_t n = station.seal(buf, len);
+        CHECK(n == len + RM_CRYPT_OVERHEAD);
+        CHECK(memcmp(&buf[4], msg, len) != 0);
+        uint8_t copy[64];
+        memcpy(copy, buf, n);
+        CHECK(device.open(buf, n) == (long) len);
+        CHECK(memcmp(&buf[4], msg, len) == 0);
+        CHECK(device.open(copy, n) == -1);
+    }
+    
+    memcpy(&buf[4], msg, len);
+    size_t n = device.seal(buf, len);
+    buf[6] ^= 1;
+    CHECK(station.open(buf, n) == -1);
+    buf[6] ^= 1;
+    CHECK(station.open(buf, n) == (long) len);
+    // The station's own direction is not opened with the other key
+    memcpy(&buf[4], msg, len);
+    n = station.seal(buf, len);
+    CHECK(station.open(buf, n) == -1);
+}
+
+
+// A new private key only for the user, the known devices next to it
+static void checkKeys(const std::string& dir) {
+    std::string key = dir + "/station";
+    unlink(key.c_str());
+    unlink((key + ".pub").c_str());
+    unlink((key + ".known").c_str());
+    
+    CHECK(rmGenerateKey(key.c_str()));
+    struct stat st;
+    CHECK(stat(key.c_str(), &st) == 0 && (st.st_mode & 0777) == 0600);
+    CHECK(stat((key + ".pub").c_str(), &st) == 0 && st.st_size == 32);
+    uint8_t pub[RM_PUBLIC_KEY_SIZE];
+    memcpy(pub, rmGetPublicKey(), sizeof(pub));
+    // A key already there is kept
+    CHECK(!rmGenerateKey(key.c_str()));
+    CHECK(rmOpenKey(key.c_str()));
+    CHECK(memcmp(pub, rmGetPublicKey(), sizeof(pub)) == 0);
+    
+    uint8_t device[RM_PUBLIC_KEY_SIZE];
+    for(int i=0; i<RM_PUBLIC_KEY_SIZE; i++)
+        device[i] = (uint8_t) (0xA0 + i);
+    CHECK(!rmIsTrustedDevice(device));
+    CHECK(rmTrustDevice(device));
+    CHECK(rmTrustDevice(device));
+    CHECK(rmIsTrustedDevice(device));
+    
+    // Read again with a comment and a key added by hand
+    FILE* fp = fopen((key + ".known").c_str(), "a");
+    CHECK(fp != nullptr);
+    if(fp != nullptr) {
+        fprintf(fp, "# bench\n\n");
+        for(int i=0; i<RM_PUBLIC_KEY_SIZE; i++)
+            fprintf(fp, "%02X", 0x10 + i);
+        fprintf(fp, " robot2\n");
+        fclose(fp);
+    }
+    CHECK(rmOpenKey(key.c_str()));
+    CHECK(rmIsTrustedDevice(device));
+    device[0] ^= 1;
+    CHECK(!rmIsTrustedDevice(device));
+    for(int i=0; i<RM_PUBLIC_KEY_SIZE; i++)
+        device[i] = (uint8_t) (0x10 + i);
+    CHECK(rmIsTrustedDevice(device));
+}
+
+
+static std::string readLine(int master) {
+    std::string line;
+    char c;
+    auto start = std::chrono::steady_clock::now();
+    while(std::chrono::steady_clock::now() - start <
+          std::chrono::seconds(TIMEOUT))
+    {
+        if(read(master, &c, 1) != 1) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if(c == '\n')
+            return line;
+        line += c;
+    }
+    return line;
+}
+
+
+// Answers the station's "$crypt" as a device with a key of its own
+static void answer(int master, const uint8_t* priv) {
+    uint8_t base[32] = {9};
+    uint8_t pub[32];
+    rmX25519(pub, priv, base);
+    std::string reply = "$crypt ";
+    char buf[3];
+    for(int i=0; i<32; i++) {
+        snprintf(buf, sizeof(buf), "%02x", pub[i]);
+        reply += buf;
+    }
+    reply += " 0102030405060708\n";
+    CHECK(write(master, reply.data(), reply.size()) ==
+          (ssize_t) reply.size());
+}
+
+
+static bool waitEncrypted(rmClient& cli, int ms) {
+    auto start = std::chrono::steady_clock::now();
+    while(!cli.isEncrypted() && std::chrono::steady_clock::now() - start <
+          std::chrono::milliseconds(ms))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return cli.isEncrypted();
+}
+
+
+// The station does not start a session with a device it does not know
+static void checkUnknownDevice() {
+    int master, slave;
+    char name[64];
+    CHECK(openpty(&master, &slave, name, NULL, NULL) == 0);
+    struct termios t;
+    tcgetattr(slave, &t);
+    cfmakeraw(&t);
+    tcsetattr(slave, TCSANOW, &t);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    
+    uint8_t stranger[32], known[32];
+    uint8_t base[32] = {9};
+    uint8_t pub[32];
+    for(int i=0; i<32; i++) {
+        stranger[i] = (uint8_t) (i * 5 + 1);
+        known[i] = (uint8_t) (i * 11 + 2);
+    }
+    rmX25519(pub, known, base);
+    CHECK(rmTrustDevice(pub));
+    
+    rmClient cli;
+    rmSerialPortInfo info;
+    memset(&info, 0, sizeof(info));
+    strncpy(info.port, name, sizeof(info.port) - 1);
+    std::thread device([&]() {
+        CHECK(readLine(master).compare(0, 7, "$crypt ") == 0);
+        answer(master, stranger);
+    });
+    cli.connectSerial(info, 115200, true);
+    device.join();
+    CHECK(!waitEncrypted(cli, 300));
+    
+    // Still waiting for the keys, now from a known device
+    answer(master, known);
+    CHECK(waitEncrypted(cli, TIMEOUT * 1000));
+    CHECK(readLine(master).compare(0, 2, "$~") == 0);
+    cli.disconnect();
+    close(slave);
+    close(master);
+}
+
+
+int main(int argc, char** argv) {
+    std::string dir = (argc > 1) ? argv[1] : "/tmp/rmonitor_test_crypt";
+    mkdir(dir.c_str(), 0755);
+    
+    checkChacha();
+    checkPoly1305();
+    checkHChacha();
+    checkX25519();
+    checkChannel();
+    checkKeys(dir);
+    checkUnknownDevice();
+    
+    if(checkFailures == 0)
+        printf("all checks passed\n");
+    return CHECK_RESULT();
+}
@@ -0,0 +1,205 @@
+/**
+ * @file test_crypt_device.c
+ * @brief Checks the key exchange of the client firmware
+ * 
+ * Plays the station with the ciphers of the firmware. The same station nonce
+ * is to get a new device nonce each time, and a "$crypt" during a session is
+ * not to change its keys until a message sealed with the new ones comes.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#include <robotmonitor.h>
+#include <cipher_private.h>
+#include <connection_private.h>
+
+#include "check.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+#define STATION_NONCE "0102030405060708"
+
+
+static char reply[256];
+static uint8_t frame[512];
+static uint16_t frameLen = 0;
+static const char* input = "";
+
+static uint8_t stationPrivate[32];
+static uint8_t devicePublic[32];
+
+
+static void sinkMessage(const char* msg) {
+    strncpy(reply, msg, sizeof(reply) - 1);
+}
+
+
+static void sinkData(const void* data, uint16_t len) {
+    if(frameLen + len <= sizeof(frame)) {
+        memcpy(&frame[frameLen], data, len);
+        frameLen += len;
+    }
+}
+
+
+static char readInput() {
+    if(*input == '\0')
+        return '\0';
+    return *input++;
+}
+
+
+static void process(const char* str) {
+    input = str;
+    rmProcessMessage();
+}
+
+
+static void decodeHex(uint8_t* out, const char* str, size_t len) {
+    for(size_t i=0; i<len; i++) {
+        unsigned int v = 0;
+        sscanf(&str[2 * i], "%2x", &v);
+        out[i] = (uint8_t) v;
+    }
+}
+
+
+static void encodeBase64(char* out, const uint8_t* data, size_t len) {
+    static const char digits[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    uint32_t acc = 0;
+    int bits = 0;
+    for(size_t i=0; i<len; i++) {
+        acc = (acc << 8) | data[i];
+        bits += 8;
+        while(bits >= 6) {
+            bits -= 6;
+            *out++ = digits[(acc >> bits) & 0x3F];
+        }
+    }
+    if(bits > 0)
+        *out++ = digits[(acc << (6 - bits)) & 0x3F];
+    *out = '\0';
+}
+
+
+/*
+ * Sends "$crypt" and works out the keys as the station does, toDevice and
+ * fromDevice. The device nonce of the reply is left in nonce.
+ */
+static void exchange(uint8_t* toDevice, uint8_t* fromDevice, uint8_t* nonce) {
+    reply[0] = '\0';
+    process("$crypt " STATION_NONCE "\n");
+    CHECK(strncmp(reply, "$crypt ", 7) == 0 && strlen(reply) == 89);
+    decodeHex(devicePublic, &reply[7], 32);
+    decodeHex(nonce, &reply[72], 8);
+    
+    uint8_t shared[32];
+    uint8_t in[16];
+    uint8_t key[32];
+    uint8_t block[64];
+    uint8_t zero[12] = {0};
+    _rmX25519(shared, stationPrivate, devicePublic);
+    decodeHex(in, STATION_NONCE, 8);
+    memcpy(&in[8], nonce, 8);
+    _rmHChacha(key, shared, in);
+    _rmChachaBlock(block, key, 0, zero);
+    memcpy(toDevice, &block[0], 32);
+    memcpy(fromDevice, &block[32], 32);
+}
+
+
+// Sends a message sealed as the station does
+static void sendSealed(const char* msg, const uint8_t* key, uint32_t counter) {
+    uint8_t buf[64];
+    uint8_t nonce[12] = {0};
+    size_t len = strlen(msg);
+    _rmStore32(buf, counter);
+    memcpy(nonce, buf, 4);
+    memcpy(&buf[4], msg, len);
+    _rmChachaXor(&buf[4], len, key, 1, nonce);
+    _rmAeadTag(&buf[4 + len], NULL, 0, &buf[4], len, key, nonce);
+    
+    char line[128] = "$~";
+    encodeBase64(&line[2], buf, len + 20);
+    strcat(line, "\n");
+    process(line);
+}
+
+
+/*
+ * Has the device send a few bytes and opens the frame with a key. Returns
+ * the counter of the frame, or -1 if it does not open.
+ */
+static long sendFromDevice(const uint8_t* key) {
+    frameLen = 0;
+    _rmSendData("ping", 4);
+    _rmCryptFlush();
+    if(frameLen != 4 + 4 + 4 + 16 || frame[1] != RM_FRAME_CRYPT)
+        return -1;
+    
+    uint8_t nonce[12] = {0};
+    uint8_t tag[16];
+    memcpy(nonce, &frame[3], 4);
+    _rmAeadTag(tag, NULL, 0, &frame[7], 4, key, nonce);
+    if(memcmp(tag, &frame[11], 16) != 0)
+        return -1;
+    _rmChachaXor(&frame[7], 4, key, 1, nonce);
+    if(memcmp(&frame[7], "ping", 4) != 0)
+        return -1;
+    return (long) _rmLoad32(&frame[3]);
+}
+
+
+int main() {
+    uint8_t devicePrivate[RM_KEY_SIZE];
+    uint8_t stationPublic[RM_KEY_SIZE];
+    uint8_t seed[RM_CRYPT_SEED_SIZE] = {1};
+    uint8_t basePoint[32] = {9};
+    for(uint8_t i=0; i<RM_KEY_SIZE; i++) {
+        devicePrivate[i] = i * 7 + 1;
+        stationPrivate[i] = i * 13 + 5;
+    }
+    _rmX25519(stationPublic, stationPrivate, basePoint);
+    _rmSendMessage = sinkMessage;
+    _rmSendData = sinkData;
+    _rmRead = readInput;
+    rmSetEncryptionKey(devicePrivate, stationPublic, seed);
+    
+    uint8_t toDevice[32], fromDevice[32], nonce[8];
+    uint8_t toDevice2[32], fromDevice2[32], nonce2[8];
+    exchange(toDevice, fromDevice, nonce);
+    CHECK(sendFromDevice(fromDevice) == 0);
+    sendSealed("$x\n", toDevice, 0);
+    CHECK(sendFromDevice(fromDevice) == 1);
+    
+    // The same station nonce again, which does not end the session
+    exchange(toDevice2, fromDevice2, nonce2);
+    CHECK(memcmp(nonce, nonce2, 8) != 0);
+    CHECK(memcmp(fromDevice, fromDevice2, 32) != 0);
+    CHECK(sendFromDevice(fromDevice) == 2);
+    CHECK(sendFromDevice(fromDevice2) == -1);
+    sendSealed("$x\n", toDevice, 1);
+    CHECK(sendFromDevice(fromDevice) == 4);
+    
+    // A message sealed with the new keys starts their session
+    sendSealed("$x\n", toDevice2, 0);
+    CHECK(sendFromDevice(fromDevice2) == 0);
+    CHECK(sendFromDevice(fromDevice) == -1);
+    
+    // Keys set again, with no session to wait for
+    seed[0] = 2;
+    rmSetEncryptionKey(devicePrivate, stationPublic, seed);
+    exchange(toDevice, fromDevice, nonce);
+    CHECK(memcmp(nonce, nonce2, 8) != 0);
+    CHECK(sendFromDevice(fromDevice) == 0);
+    
+    if(checkFailures == 0)
+        printf("all checks passed\n");
+    return CHECK_RESULT();
+}
@@ -0,0 +1,174 @@
+/**
+ * @file test_echostore.cpp
+ * @brief Checks the search of the echo store against reading every message
+ * 
+ * Writes messages over many small segments, then checks the substrings
+ * found through the trigram index against a plain search of the messages
+ * kept in memory. The segment being written, the store opened only for
+ * searching, the indexes cut short and the substrings too short for a
+ * trigram are all checked.
+ * 
+ * Usage: rmonitor_test_echostore [directory]
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_NO_WX
+
+
+#include <rm/echostore.hpp>
+
+#include "check.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+#define MESSAGE_COUNT 20000
+#define SEGMENT_SIZE 65536
+
+
+static std::vector<rmEchoRecord> messages;
+
+static const char* queries[] = {
+    "speed 4999", "motor 12 ", "az=98", "rror", "t 1", "m", "", "nothing",
+    "speed 1999 az", "=1"
+};
+
+
+static void clearDirectory(const char* dir) {
+    DIR* d = opendir(dir);
+    if(d == nullptr)
+        return;
+    struct dirent* ent;
+    while((ent = readdir(d)) != nullptr) {
+        if(ent->d_name[0] != '.')
+            unlink((std::string(dir) + "/" + ent->d_name).c_str());
+    }
+    closedir(d);
+}
+
+
+// The messages the search is to find, by reading every one
+static std::vector<rmEchoRecord> expect(const char* str, uint8_t mask,
+                                        size_t limit, int64_t from,
+                                        int64_t to)
+{
+    std::vector<rmEchoRecord> vec;
+    for(auto it=messages.begin(); it!=messages.end(); it++) {
+        if(vec.size() >= limit)
+            break;
+        if((mask & (1 << it->status)) == 0 || it->time < from ||
+           it->time > to)
+            continue;
+        if(strstr(it->text.c_str(), str) != nullptr)
+            vec.push_back(*it);
+    }
+    return vec;
+}
+
+
+static bool same(const std::vector<rmEchoRecord>& a,
+                 const std::vector<rmEchoRecord>& b)
+{
+    if(a.size() != b.size())
+        return false;
+    for(size_t i=0; i<a.size(); i++) {
+        if(a[i].time != b[i].time || a[i].status != b[i].status ||
+           a[i].text != b[i].text)
+            return false;
+    }
+    return true;
+}
+
+
+static void checkQueries(rmEchoStore& store) {
+    for(const char* str : queries) {
+        std::vector<rmEchoRecord> found;
+        size_t n = store.search(str, RM_ECHO_ALL, &found);
+        CHECK(n == found.size());
+        CHECK(same(found, expect(str, RM_ECHO_ALL, SIZE_MAX, INT64_MIN,
+                                 INT64_MAX)));
+        
+        found.clear();
+        store.search(str, RM_ECHO_ERROR | RM_ECHO_WARNING, &found, 50,
+                     5000, 15000);
+        CHECK(same(found, expect(str, RM_ECHO_ERROR | RM_ECHO_WARNING, 50,
+                                 5000, 15000)));
+    }
+}
+
+
+int main(int argc, char** argv) {
+    std::string dir = (argc > 1) ? argv[1] : "/tmp/rmonitor_test_echostore";
+    mkdir(dir.c_str(), 0755);
+    clearDirectory(dir.c_str());
+    
+    rmEchoStore store;
+    store.setSegmentSize(SEGMENT_SIZE);
+    CHECK(store.open(dir.c_str(), true));
+    for(int i=0; i<MESSAGE_COUNT; i++) {
+        rmEchoRecord rec;
+        char text[64];
+        snprintf(text, sizeof(text), "motor %d speed %d az=%d%s", i % 50,
+                 i % 5000, (i * 7) % 1000, (i % 3 == 1) ? " error" : "");
+        rec.time = 1000 + i;
+        rec.status = i % 3;
+        rec.text = text;
+        store.append(text, rec.status, rec.time);
+        messages.push_back(rec);
+    }
+    
+    // Finished segments through their index and the current one in memory
+    checkQueries(store);
+    
+    // Lines appended after a search are found by the next
+    store.append("speed 4999 late", 0, 1000 + MESSAGE_COUNT);
+    rmEchoRecord late;
+    late.time = 1000 + MESSAGE_COUNT;
+    late.text = "speed 4999 late";
+    messages.push_back(late);
+    checkQueries(store);
+    store.close();
+    
+    // Every segment through its index
+    rmEchoStore reader;
+    CHECK(reader.open(dir.c_str(), false));
+    checkQueries(reader);
+    reader.close();
+    
+    // The indexes cut short are read through instead
+    DIR* d = opendir(dir.c_str());
+    CHECK(d != nullptr);
+    struct dirent* ent;
+    size_t cut = 0;
+    while(d != nullptr && (ent = readdir(d)) != nullptr) {
+        size_t len = strlen(ent->d_name);
+        if(len > 4 && strcmp(&ent->d_name[len - 4], ".idx") == 0) {
+            std::string path = dir + "/" + ent->d_name;
+            CHECK(truncate(path.c_str(), 40 + 8 * (cut % 4)) == 0);
+            cut++;
+        }
+    }
+    if(d != nullptr)
+        closedir(d);
+    CHECK(cut > 2);
+    CHECK(reader.open(dir.c_str(), false));
+    checkQueries(reader);
+    reader.close();
+    
+    clearDirectory(dir.c_str());
+    rmdir(dir.c_str());
+    if(checkFailures == 0)
+        printf("all checks passed\n");
+    return CHECK_RESULT();
+}
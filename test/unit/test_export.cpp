@@ -0,0 +1,260 @@
+/**
+ * @file test_export.cpp
+ * @brief Checks the session log and its export by rmexport
+ * 
+ * Records a sync table through rmSessionRecorder, including a change of its
+ * list, and reads the log back. Then runs rmexport on it and checks the rows
+ * of the CSV and of the column chunked files against the values recorded.
+ * Last, logs with a record cut short and with an impossible record size are
+ * to be reported as corrupt, with the rows before them still exported.
+ * 
+ * Usage: rmonitor_test_export <rmexport> <directory>
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_NO_WX
+
+
+#include <rm/client.hpp>
+#include <rm/frame.hpp>
+#include <rm/session.hpp>
+#include <rm/sync.hpp>
+
+#include "check.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+#define ROW_COUNT 70000 // More than a chunk handed to the writers
+#define EXTRA_COUNT 10 // Rows after the list changes
+
+
+static std::string exporter;
+static std::string dir;
+
+
+static std::string readFile(const std::string& path) {
+    std::string str;
+    FILE* f = fopen(path.c_str(), "rb");
+    if(f == nullptr)
+        return str;
+    char buf[65536];
+    size_t n;
+    while((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        str.append(buf, n);
+    fclose(f);
+    return str;
+}
+
+
+static void writeFile(const std::string& path, const std::string& str) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if(f == nullptr)
+        return;
+    fwrite(str.data(), str.size(), 1, f);
+    fclose(f);
+}
+
+
+// Exit code of rmexport on a log
+static int runExport(const std::string& log, const std::string& out,
+                     const char* format)
+{
+    mkdir(out.c_str(), 0755);
+    std::string cmd = "\"" + exporter + "\" -f " + format + " -l 0 -j 2 -o \"" +
+                      out + "\" \"" + log + "\" > /dev/null 2>&1";
+    int status = system(cmd.c_str());
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+
+static std::string expectedRow(int i) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%d,%g,name%d", i, i * 0.5, i % 7);
+    return buf;
+}
+
+
+static void recordSession(const std::string& log) {
+    rmClient cli;
+    rmSync sync(0);
+    sync.updateList("seq:1a,x:1c,name:2", &cli, false);
+    rmSessionRecorder rec;
+    CHECK(rec.open(log.c_str()));
+    for(int i=0; i<ROW_COUNT; i++) {
+        sync.onSync(expectedRow(i).c_str());
+        rec.record(&sync);
+    }
+    sync.updateList("seq:1a,y:11", &cli, false);
+    for(int i=0; i<EXTRA_COUNT; i++) {
+        sync.onSync((std::to_string(i) + ",7").c_str());
+        rec.record(&sync);
+    }
+    rec.close();
+}
+
+
+static void checkReader(const std::string& log) {
+    rmSessionReader reader;
+    CHECK(reader.open(log.c_str()));
+    rmSessionRecord rec;
+    std::vector<rmSessionColumn> columns;
+    size_t schemas = 0;
+    size_t rows = 0;
+    while(reader.next(&rec)) {
+        if(rec.kind == RM_SESSION_SCHEMA) {
+            CHECK(rmSessionReader::parseSchema(rec, &columns));
+            schemas++;
+        }
+        else if(rec.kind == RM_SESSION_ROW) {
+            rows++;
+        }
+    }
+    CHECK(!reader.isCorrupt());
+    CHECK(schemas == 2);
+    CHECK(rows == ROW_COUNT + EXTRA_COUNT);
+    CHECK(columns.size() == 2 && columns[1].name == "y" &&
+          columns[1].type == RM_WIRE_UINT16);
+}
+
+
+static void checkCsv(const std::string& out, size_t count) {
+    std::string csv = readFile(out + "/sync0.csv");
+    size_t pos = csv.find('\n');
+    CHECK(csv.compare(0, pos, "time,seq,x,name") == 0);
+    size_t rows = 0;
+    while(pos != std::string::npos && pos + 1 < csv.size()) {
+        size_t end = csv.find('\n', pos + 1);
+        std::string line = csv.substr(pos + 1, end - pos - 1);
+        size_t comma = line.find(',');
+        if(line.substr(comma + 1) != expectedRow((int) rows)) {
+            CHECK(line.substr(comma + 1) == expectedRow((int) rows));
+            break;
+        }
+        rows++;
+        pos = end;
+    }
+    CHECK(rows == count);
+}
+
+
+// Reads the seq column of the column chunked file, stored without deflate
+static void checkColumns(const std::string& out) {
+    std::string col = readFile(out + "/sync0.rmcol");
+    CHECK(col.size() > 16 && memcmp(col.data(), "RMCOL", 6) == 0);
+    if(col.size() <= 16)
+        return;
+    uint32_t head[2];
+    memcpy(head, &col[8], 8);
+    CHECK(head[0] == 1 && head[1] == 4);
+    size_t pos = 16;
+    for(uint32_t i=0; i<head[1] && pos + 2 <= col.size(); i++)
+        pos += 2 + (uint8_t) col[pos + 1];
+    
+    std::vector<int32_t> seq;
+    while(pos + 4 <= col.size()) {
+        uint32_t rows;
+        memcpy(&rows, &col[pos], 4);
+        pos += 4;
+        if(rows == 0)
+            break;
+        for(uint32_t c=0; c<head[1] && pos + 9 <= col.size(); c++) {
+            uint32_t size[2];
+            memcpy(size, &col[pos + 1], 8);
+            CHECK(col[pos] == 0 && size[0] == size[1]);
+            if(c == 1 && pos + 9 + size[0] <= col.size()) {
+                CHECK(size[0] == rows * 4);
+                for(uint32_t r=0; r<rows; r++) {
+                    int32_t v;
+                    memcpy(&v, &col[pos + 9 + r * 4], 4);
+                    seq.push_back(v);
+                }
+            }
+            pos += 9 + size[0];
+        }
+    }
+    CHECK(pos == col.size());
+    CHECK(seq.size() == ROW_COUNT);
+    for(size_t i=0; i<seq.size(); i++) {
+        if(seq[i] != (int32_t) i) {
+            CHECK(seq[i] == (int32_t) i);
+            break;
+        }
+    }
+}
+
+
+int main(int argc, char** argv) {
+    if(argc < 3) {
+        printf("Usage: rmonitor_test_export <rmexport> <directory>\n");
+        return 1;
+    }
+    exporter = argv[1];
+    dir = argv[2];
+    mkdir(dir.c_str(), 0755);
+    std::string log = dir + "/session.rmlog";
+    
+    recordSession(log);
+    checkReader(log);
+    
+    CHECK(runExport(log, dir + "/csv", "csv") == 0);
+    checkCsv(dir + "/csv", ROW_COUNT);
+    std::string part = readFile(dir + "/csv/sync0-1.csv");
+    CHECK(part.compare(0, 11, "time,seq,y\n") == 0);
+    CHECK(runExport(log, dir + "/col", "col") == 0);
+    checkColumns(dir + "/col");
+    
+    // A record cut short ends the log
+    std::string data = readFile(log);
+    std::string cut = dir + "/cut.rmlog";
+    writeFile(cut, data.substr(0, data.size() - 3));
+    rmSessionReader reader;
+    rmSessionRecord rec;
+    size_t rows = 0;
+    CHECK(reader.open(cut.c_str()));
+    while(reader.next(&rec))
+        rows += (rec.kind == RM_SESSION_ROW);
+    CHECK(reader.isCorrupt());
+    CHECK(rows == ROW_COUNT + EXTRA_COUNT - 1);
+    reader.close();
+    CHECK(runExport(cut, dir + "/cut", "csv") == 1);
+    checkCsv(dir + "/cut", ROW_COUNT);
+    
+    // A size beyond any record, given to the one after the schema and 99
+    // rows, is not allocated
+    std::string bad = dir + "/bad.rmlog";
+    size_t pos = sizeof(rmSessionHeader);
+    for(int r=0; r<100; r++) {
+        uint32_t size;
+        memcpy(&size, &data[pos + 2], 4);
+        pos += 6 + size;
+    }
+    uint32_t huge = 0xFFFFFFF0;
+    memcpy(&data[pos + 2], &huge, 4);
+    writeFile(bad, data);
+    rows = 0;
+    CHECK(reader.open(bad.c_str()));
+    while(reader.next(&rec))
+        rows += (rec.kind == RM_SESSION_ROW);
+    CHECK(reader.isCorrupt());
+    CHECK(rows == 99);
+    reader.close();
+    CHECK(runExport(bad, dir + "/bad", "csv") == 1);
+    checkCsv(dir + "/bad", 99);
+    
+    if(checkFailures == 0)
+        printf("all checks passed\n");
+    return CHECK_RESULT();
+}
@@ -0,0 +1,92 @@
+/**
+ * @file test_output.c
+ * @brief Checks the binary frames of the output attributes
+ * 
+ * A string attribute is sent in a frame with its name, its type and its
+ * length. A string longer than the frame holds is to be cut, with the length
+ * of the frame and of the string still matching what is sent and the
+ * checksum still right.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#include <robotmonitor.h>
+#include <connection_private.h>
+
+#include "check.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+static uint8_t frame[512];
+static uint16_t frameLen = 0;
+
+
+static void sinkData(const void* data, uint16_t len) {
+    if(frameLen + len <= sizeof(frame)) {
+        memcpy(&frame[frameLen], data, len);
+        frameLen += len;
+    }
+}
+
+
+/*
+ * Sends a string attribute of a length and checks its frame. Returns the
+ * length of the string in the frame, or -1 if the frame is not right.
+ */
+static int sendString(const char* name, uint8_t len) {
+    char data[256];
+    for(int i=0; i<len; i++)
+        data[i] = 'a' + i % 26;
+    data[len] = '\0';
+    
+    rmOutputAttribute attr;
+    strcpy(attr.name, name);
+    rmString str = {data, len};
+    attr.data = &str;
+    attr.cap = len;
+    attr.type = RM_ATTRIBUTE_STRING;
+    frameLen = 0;
+    rmOutputAttributeUpdateBinary(&attr);
+    
+    uint8_t n = strlen(name);
+    if(frameLen < 4 || frame[0] != RM_FRAME_START || frame[1] != RM_FRAME_SET)
+        return -1;
+    if(frame[2] + 4 != frameLen)
+        return -1;
+    uint8_t crc = _rmCrc8(0, &frame[1], 2);
+    if(_rmCrc8(crc, &frame[3], frame[2]) != frame[frameLen - 1])
+        return -1;
+    
+    const uint8_t* payload = &frame[3];
+    if(payload[0] != n || memcmp(&payload[1], name, n) != 0)
+        return -1;
+    if(payload[n + 1] != RM_ATTRIBUTE_STRING)
+        return -1;
+    uint8_t m = payload[n + 2];
+    if(n + 3 + m != frame[2] || memcmp(&payload[n + 3], data, m) != 0)
+        return -1;
+    return m;
+}
+
+
+int main() {
+    _rmSendData = sinkData;
+    
+    // The name, its length, the type and the string length leave 246 bytes
+    CHECK(sendString("status", 20) == 20);
+    CHECK(sendString("status", 246) == 246);
+    CHECK(sendString("status", 247) == 246);
+    CHECK(sendString("status", 255) == 246);
+    CHECK(sendString("description", 241) == 241);
+    CHECK(sendString("description", 255) == 241);
+    CHECK(sendString("s", 0) == 0);
+    
+    if(checkFailures == 0)
+        printf("all checks passed\n");
+    return CHECK_RESULT();
+}
@@ -0,0 +1,132 @@
+/**
+ * @file test_sharedmemory.cpp
+ * @brief Checks the sequence locks of the shared memory mirror
+ * 
+ * A thread writes an integer and a string of one repeated character while
+ * the main thread reads them through a second mapping, so a torn read shows
+ * as a string of mixed characters or a count going back. Then a slot is left
+ * in the middle of a write, as by a writer which died, and the reads are to
+ * give up instead of spinning.
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_NO_WX
+
+
+#include <rm/attribute.hpp>
+#include <rm/sharedmemory.hpp>
+
+#include "check.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+#define READ_COUNT 200000
+#define SLOT_OFFSET 64 // Where the slots start in the memory
+
+
+int main() {
+    std::string name = "/rmonitor_test_" + std::to_string(getpid());
+    rmSharedMemory writer;
+    CHECK(writer.create(name.c_str()));
+    rmAttribute count("count", RM_ATTRIBUTE_INT);
+    rmAttribute label("label", RM_ATTRIBUTE_STRING);
+    count.setValue(0);
+    label.setValue("");
+    writer.update(&count);
+    writer.update(&label);
+    
+    rmSharedMemory reader;
+    CHECK(reader.open(name.c_str()));
+    CHECK(reader.getCount() == 2);
+    CHECK(reader.find("count") == 0);
+    CHECK(reader.find("label") == 1);
+    
+    std::atomic<bool> done(false);
+    std::thread thread([&]() {
+        for(int k=1; !done; k++) {
+            count.setValue(k);
+            label.setValue(std::string(100, 'a' + k % 26).c_str());
+            writer.update(&count);
+            writer.update(&label);
+        }
+    });
+    
+    int last = 0;
+    size_t failed = 0;
+    size_t torn = 0;
+    for(int k=0; k<READ_COUNT; k++) {
+        rmSharedValue v;
+        if(!reader.read(0, &v) || !reader.read(1, &v)) {
+            failed++;
+            continue;
+        }
+        size_t len = strlen(v.str);
+        for(size_t i=1; i<len; i++) {
+            if(v.str[i] != v.str[0]) {
+                torn++;
+                break;
+            }
+        }
+        float f = reader.readFloat(0);
+        if(std::isnan(f) || f < last)
+            torn++;
+        else
+            last = (int) f;
+    }
+    done = true;
+    thread.join();
+    CHECK(failed == 0);
+    CHECK(torn == 0);
+    CHECK(last > 0);
+    
+    rmSharedValue v;
+    CHECK(reader.read(0, &v));
+    CHECK(v.type == RM_ATTRIBUTE_INT && v.data.i == count.getValue().i);
+    CHECK(reader.read(1, &v));
+    CHECK(v.type == RM_ATTRIBUTE_STRING && strlen(v.str) == 100);
+    
+    // A slot left odd by a writer which died gives up after the tries
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    CHECK(fd >= 0);
+    size_t len = SLOT_OFFSET + sizeof(rmSharedSlot) * RM_SHARED_SLOT_COUNT;
+    void* ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    CHECK(ptr != MAP_FAILED);
+    if(ptr != MAP_FAILED) {
+        rmSharedSlot* slots = (rmSharedSlot*) ((uint8_t*) ptr + SLOT_OFFSET);
+        uint32_t seq = slots[0].sequence.load();
+        slots[0].sequence.store(seq | 1);
+        
+        auto start = std::chrono::steady_clock::now();
+        CHECK(!reader.read(0, &v));
+        CHECK(std::isnan(reader.readFloat(0)));
+        auto time = std::chrono::steady_clock::now() - start;
+        CHECK(time < std::chrono::seconds(2));
+        CHECK(reader.read(1, &v));
+        
+        slots[0].sequence.store((seq | 1) + 1);
+        CHECK(reader.read(0, &v));
+        munmap(ptr, len);
+    }
+    
+    reader.close();
+    writer.close();
+    if(checkFailures == 0)
+        printf("all checks passed\n");
+    return CHECK_RESULT();
+}
@@ -0,0 +1,616 @@
+/**
+ * @file rmexport.cpp
+ * @brief Converts a session log into a columnar file per sync table
+ * 
+ * Reads the log written by rmSessionRecorder and writes the rows of each sync
+ * table as CSV or as a column chunked file. The log is read in one pass and
+ * handed over in chunks of rows to a pool of threads, each owning a share of
+ * the tables, so the memory used stays bounded by the queues whatever the
+ * size of the log.
+ * 
+ * A table whose list changes during the session is continued in a new file,
+ * "sync<id>-<part>". The first column of every file is the time the row
+ * arrived.
+ * 
+ * The column chunked file (.rmcol) starts with "RMCOL" padded to 8 bytes,
+ * the 32-bit version and the number of columns, then the wire data type, the
+ * name length and the name of each column. The time column has the type
+ * 0xFF. Then follow the chunks, each the 32-bit number of rows and a block per
+ * column: the encoding byte (0 stored, 1 deflated), the 32-bit stored size,
+ * the 32-bit plain size and the data. Plain numbers are little endian with
+ * the width of their wire type, the time is a 64-bit count of microseconds
+ * since the epoch. A string column holds a dictionary of the distinct
+ * strings of the chunk, the 32-bit count followed by a length byte and the
+ * characters of each, and then the 32-bit dictionary index of each row. A
+ * chunk of 0 rows ends the file. python/rmonitor.py reads it into arrays.
+ * 
+ * Usage: rmexport [-f csv|col] [-o directory] [-j threads] [-l level] <log>
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#include <rm/frame.hpp>
+#include <rm/session.hpp>
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef RM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+
+#define RM_EXPORT_CHUNK_ROWS  65536 ///< Rows handed over at once
+#define RM_EXPORT_CHUNK_BYTES (4 << 20) ///< Bytes of rows handed over at most
+#define RM_EXPORT_QUEUE 4 ///< Chunks queued for a thread at most
+#define RM_COL_TIME 0xFF ///< Type of the time column
+
+
+static void printUsage() {
+    printf(
+        "Usage: rmexport [options] <session log>\n"
+        "Writes the rows of each sync table into a file of its own.\n"
+        "\n"
+        "  -f format     csv, or col for the column chunked files. csv by\n"
+        "                default.\n"
+        "  -o directory  Where the files are written. The current directory\n"
+        "                by default.\n"
+        "  -j threads    Number of threads writing the files\n"
+        "  -l level      Deflate level of the column chunked files from 0 to\n"
+        "                9. 1 by default.\n"
+    );
+}
+
+
+struct rmExportSchema {
+    std::vector<rmSessionColumn> columns;
+};
+
+
+struct rmExportChunk {
+    uint8_t table = 0;
+    int part = 0;
+    std::shared_ptr<const rmExportSchema> schema;
+    std::vector<uint8_t> rows;
+    std::vector<uint32_t> offsets;
+};
+
+
+/*
+ * A value of a row. Strings point into the row.
+ */
+struct rmExportValue {
+    uint32_t raw;
+    const char* str;
+    uint8_t len;
+};
+
+
+/*
+ * Splits a row into its values. False if the row does not match the schema.
+ */
+static bool parseRow(const rmExportSchema& schema, const uint8_t* row,
+                     size_t len, int64_t* time,
+                     std::vector<rmExportValue>* values)
+{
+    if(len < 8)
+        return false;
+    memcpy(time, row, 8);
+    size_t pos = 8;
+    values->resize(schema.columns.size());
+    for(size_t i=0; i<schema.columns.size(); i++) {
+        rmExportValue& v = (*values)[i];
+        if(schema.columns[i].type == RM_WIRE_STRING) {
+            if(pos + 1 > len || pos + 1 + row[pos] > len)
+                return false;
+            v.len = row[pos];
+            v.str = (const char*) &row[pos + 1];
+            v.raw = 0;
+            pos += 1 + v.len;
+        }
+        else {
+            if(pos + 4 > len)
+                return false;
+            memcpy(&v.raw, &row[pos], 4);
+            v.str = nullptr;
+            v.len = 0;
+            pos += 4;
+        }
+    }
+    return true;
+}
+
+
+static size_t getWidth(uint8_t type) {
+    switch(type) {
+      case RM_WIRE_BOOL:
+      case RM_WIRE_CHAR:
+      case RM_WIRE_UINT8:
+      case RM_WIRE_INT8:
+        return 1;
+      
+      case RM_WIRE_UINT16:
+      case RM_WIRE_INT16:
+        return 2;
+      
+      default:
+        return 4;
+    }
+}
+
+
+/*
+ * Writes the rows of a table into one file.
+ */
+class rmExportWriter {
+  public:
+    virtual ~rmExportWriter() = default;
+    virtual bool open(const std::string& path,
+                      const rmExportSchema& schema) = 0;
+    virtual void write(const rmExportChunk& chunk) = 0;
+    virtual void close() = 0;
+};
+
+
+class rmCsvWriter: public rmExportWriter {
+  private:
+    FILE* file = nullptr;
+    std::string line;
+    std::vector<rmExportValue> values;
+    
+    void append(const char* str, size_t len) {
+        bool quote = false;
+        for(size_t i=0; i<len && !quote; i++) {
+            char c = str[i];
+            quote = (c == ',' || c == '"' || c == '\n' || c == '\r');
+        }
+        if(!quote) {
+            line.append(str, len);
+            return;
+        }
+        line += '"';
+        for(size_t i=0; i<len; i++) {
+            if(str[i] == '"')
+                line += '"';
+            line += str[i];
+        }
+        line += '"';
+    }
+  
+  public:
+    bool open(const std::string& path,
+              const rmExportSchema& schema) override
+    {
+        file = fopen(path.c_str(), "wb");
+        if(file == nullptr)
+            return false;
+        setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        line = "time";
+        for(const rmSessionColumn& col : schema.columns) {
+            line += ',';
+            append(col.name.c_str(), col.name.size());
+        }
+        line += '\n';
+        fwrite(line.data(), line.size(), 1, file);
+        return true;
+    }
+    
+    void write(const rmExportChunk& chunk) override {
+        const rmExportSchema& schema = *chunk.schema;
+        char buf[32];
+        for(size_t r=0; r+1<chunk.offsets.size(); r++) {
+            int64_t time;
+            const uint8_t* row = &chunk.rows[chunk.offsets[r]];
+            size_t len = chunk.offsets[r + 1] - chunk.offsets[r];
+            if(!parseRow(schema, row, len, &time, &values))
+                continue;
+            line.clear();
+            int n = snprintf(buf, sizeof(buf), "%lld.%06lld",
+                             (long long) (time / 1000000),
+                             (long long) (time % 1000000));
+            line.append(buf, n);
+            for(size_t i=0; i<values.size(); i++) {
+                const rmExportValue& v = values[i];
+                line += ',';
+                uint8_t type = schema.columns[i].type;
+                float f;
+                switch(type) {
+                  case RM_WIRE_STRING:
+                    append(v.str, v.len);
+                    continue;
+                  
+                  case RM_WIRE_CHAR:
+                    buf[0] = (char) v.raw;
+                    append(buf, (buf[0] != '\0') ? 1 : 0);
+                    continue;
+                  
+                  case RM_WIRE_FLOAT:
+                    memcpy(&f, &v.raw, 4);
+                    n = snprintf(buf, sizeof(buf), "%.9g", f);
+                    break;
+                  
+                  case RM_WIRE_INT8:
+                  case RM_WIRE_INT16:
+                  case RM_WIRE_INT32:
+                    n = snprintf(buf, sizeof(buf), "%d", (int32_t) v.raw);
+                    break;
+                  
+                  default:
+                    n = snprintf(buf, sizeof(buf), "%u", v.raw);
+                    break;
+                }
+                line.append(buf, n);
+            }
+            line += '\n';
+            fwrite(line.data(), line.size(), 1, file);
+        }
+    }
+    
+    void close() override {
+        if(file != nullptr)
+            fclose(file);
+        file = nullptr;
+    }
+};
+
+
+class rmColumnWriter: public rmExportWriter {
+  private:
+    FILE* file = nullptr;
+    int level;
+    std::vector<std::vector<uint8_t>> columns;
+    std::vector<std::unordered_map<std::string, uint32_t>> dictionaries;
+    std::vector<rmExportValue> values;
+    std::vector<uint8_t> packed;
+    
+    void writeBlock(const std::vector<uint8_t>& data) {
+        uint8_t encoding = 0;
+        const uint8_t* out = data.data();
+        uint32_t size = (uint32_t) data.size();
+        #ifdef RM_HAVE_ZLIB
+        if(level > 0 && !data.empty()) {
+            uLongf n = compressBound(data.size());
+            packed.resize(n);
+            if(compress2(packed.data(), &n, data.data(), data.size(),
+                         level) == Z_OK && n < data.size())
+            {
+                encoding = 1;
+                out = packed.data();
+                size = (uint32_t) n;
+            }
+        }
+        #endif
+        uint32_t plain = (uint32_t) data.size();
+        fwrite(&encoding, 1, 1, file);
+        fwrite(&size, 4, 1, file);
+        fwrite(&plain, 4, 1, file);
+        fwrite(out, size, 1, file);
+    }
+  
+  public:
+    rmColumnWriter(int lvl) { level = lvl; }
+    
+    bool open(const std::string& path,
+              const rmExportSchema& schema) override
+    {
+        file = fopen(path.c_str(), "wb");
+        if(file == nullptr)
+            return false;
+        setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        char magic[8] = "RMCOL";
+        uint32_t head[2] = { 1, (uint32_t) schema.columns.size() + 1 };
+        fwrite(magic, 8, 1, file);
+        fwrite(head, 8, 1, file);
+        uint8_t timeColumn[6] = { RM_COL_TIME, 4, 't', 'i', 'm', 'e' };
+        fwrite(timeColumn, 6, 1, file);
+        for(const rmSessionColumn& col : schema.columns) {
+            uint8_t len = (uint8_t) col.name.size();
+            fwrite(&col.type, 1, 1, file);
+            fwrite(&len, 1, 1, file);
+            fwrite(col.name.data(), len, 1, file);
+        }
+        columns.resize(schema.columns.size() + 1);
+        dictionaries.resize(schema.columns.size());
+        return true;
+    }
+    
+    void write(const rmExportChunk& chunk) override {
+        const rmExportSchema& schema = *chunk.schema;
+        size_t count = schema.columns.size();
+        for(std::vector<uint8_t>& col : columns)
+            col.clear();
+        for(auto& dict : dictionaries)
+            dict.clear();
+        
+        // Strings go into the dictionary in order of first appearance
+        std::vector<std::vector<uint8_t>> dictData(count);
+        uint32_t rows = 0;
+        for(size_t r=0; r+1<chunk.offsets.size(); r++) {
+            int64_t time;
+            const uint8_t* row = &chunk.rows[chunk.offsets[r]];
+            size_t len = chunk.offsets[r + 1] - chunk.offsets[r];
+            if(!parseRow(schema, row, len, &time, &values))
+                continue;
+            const uint8_t* t = (const uint8_t*) &time;
+            columns[0].insert(columns[0].end(), t, t + 8);
+            for(size_t i=0; i<count; i++) {
+                const rmExportValue& v = values[i];
+                std::vector<uint8_t>& col = columns[i + 1];
+                if(schema.columns[i].type == RM_WIRE_STRING) {
+                    std::string str(v.str, v.len);
+                    auto it = dictionaries[i].find(str);
+                    uint32_t index;
+                    if(it == dictionaries[i].end()) {
+                        index = (uint32_t) dictionaries[i].size();
+                        dictionaries[i][str] = index;
+                        dictData[i].push_back(v.len);
+                        dictData[i].insert(dictData[i].end(), v.str,
+                                           v.str + v.len);
+                    }
+                    else {
+                        index = it->second;
+                    }
+                    const uint8_t* p = (const uint8_t*) &index;
+                    col.insert(col.end(), p, p + 4);
+                }
+                else {
+                    const uint8_t* p = (const uint8_t*) &v.raw;
+                    col.insert(col.end(), p,
+                               p + getWidth(schema.columns[i].type));
+                }
+            }
+            rows++;
+        }
+        if(rows == 0)
+            return;
+        
+        fwrite(&rows, 4, 1, file);
+        writeBlock(columns[0]);
+        for(size_t i=0; i<count; i++) {
+            if(schema.columns[i].type == RM_WIRE_STRING) {
+                std::vector<uint8_t> data;
+                uint32_t n = (uint32_t) dictionaries[i].size();
+                const uint8_t* p = (const uint8_t*) &n;
+                data.insert(data.end(), p, p + 4);
+                data.insert(data.end(), dictData[i].begin(),
+                            dictData[i].end());
+                data.insert(data.end(), columns[i + 1].begin(),
+                            columns[i + 1].end());
+                writeBlock(data);
+            }
+            else {
+                writeBlock(columns[i + 1]);
+            }
+        }
+    }
+    
+    void close() override {
+        if(file == nullptr)
+            return;
+        uint32_t end = 0;
+        fwrite(&end, 4, 1, file);
+        fclose(file);
+        file = nullptr;
+    }
+};
+
+
+/*
+ * A thread writing the files of its share of the tables. The chunks of a
+ * table always go to the same thread and so are written in order.
+ */
+class rmExportWorker {
+  private:
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<std::unique_ptr<rmExportChunk>> queue;
+    bool done = false;
+    std::thread thread;
+    std::string dir;
+    bool csv;
+    int level;
+    std::map<uint8_t, std::unique_ptr<rmExportWriter>> writers;
+    std::map<uint8_t, int> parts;
+    
+    void run() {
+        while(true) {
+            std::unique_ptr<rmExportChunk> chunk;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [this] { return done || !queue.empty(); });
+                if(queue.empty())
+                    break;
+                chunk = std::move(queue.front());
+                queue.pop_front();
+            }
+            cond.notify_all();
+            write(*chunk);
+        }
+        for(auto& w : writers)
+            w.second->close();
+    }
+    
+    void write(const rmExportChunk& chunk) {
+        auto it = writers.find(chunk.table);
+        if(it == writers.end() || parts[chunk.table] != chunk.part) {
+            if(it != writers.end())
+                it->second->close();
+            std::string name = "sync" + std::to_string(chunk.table);
+            if(chunk.part > 0)
+                name += "-" + std::to_string(chunk.part);
+            name += csv ? ".csv" : ".rmcol";
+            std::string path = (std::filesystem::path(dir) / name).string();
+            std::unique_ptr<rmExportWriter> w;
+            if(csv)
+                w.reset(new rmCsvWriter());
+            else
+                w.reset(new rmColumnWriter(level));
+            if(!w->open(path, *chunk.schema)) {
+                fprintf(stderr, "rmexport: cannot write %s\n", path.c_str());
+                writers.erase(chunk.table);
+                parts[chunk.table] = chunk.part;
+                return;
+            }
+            printf("%s\n", path.c_str());
+            writers[chunk.table] = std::move(w);
+            parts[chunk.table] = chunk.part;
+        }
+        writers[chunk.table]->write(chunk);
+    }
+  
+  public:
+    rmExportWorker(const std::string& d, bool c, int l) {
+        dir = d;
+        csv = c;
+        level = l;
+        thread = std::thread(&rmExportWorker::run, this);
+    }
+    
+    // Blocks while the queue is full to bound the memory
+    void push(std::unique_ptr<rmExportChunk> chunk) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this] { return queue.size() < RM_EXPORT_QUEUE; });
+        queue.push_back(std::move(chunk));
+        lock.unlock();
+        cond.notify_all();
+    }
+    
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        cond.notify_all();
+        thread.join();
+    }
+};
+
+
+int main(int argc, char *argv[]) {
+    bool csv = true;
+    std::string dir = ".";
+    unsigned threads = std::thread::hardware_concurrency();
+    int level = 1;
+    const char* path = nullptr;
+    
+    for(int i=1; i<argc; i++) {
+        const char* arg = argv[i];
+        bool value = (i + 1 < argc);
+        if(strcmp(arg, "-f") == 0 && value) {
+            const char* f = argv[++i];
+            if(strcmp(f, "csv") != 0 && strcmp(f, "col") != 0) {
+                printUsage();
+                return 1;
+            }
+            csv = (strcmp(f, "csv") == 0);
+        }
+        else if(strcmp(arg, "-o") == 0 && value) {
+            dir = argv[++i];
+        }
+        else if(strcmp(arg, "-j") == 0 && value) {
+            threads = strtoul(argv[++i], nullptr, 10);
+        }
+        else if(strcmp(arg, "-l") == 0 && value) {
+            level = atoi(argv[++i]);
+        }
+        else if(arg[0] == '-' || path != nullptr) {
+            printUsage();
+            return 1;
+        }
+        else {
+            path = arg;
+        }
+    }
+    if(path == nullptr) {
+        printUsage();
+        return 1;
+    }
+    if(threads == 0)
+        threads = 1;
+    
+    rmSessionReader reader;
+    if(!reader.open(path)) {
+        fprintf(stderr, "rmexport: cannot read %s\n", path);
+        return 1;
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    
+    std::vector<std::unique_ptr<rmExportWorker>> workers;
+    for(unsigned i=0; i<threads; i++)
+        workers.emplace_back(new rmExportWorker(dir, csv, level));
+    
+    // The chunk being filled and the schema of each table
+    std::unique_ptr<rmExportChunk> chunks[256];
+    std::shared_ptr<const rmExportSchema> schemas[256];
+    int parts[256];
+    for(int i=0; i<256; i++)
+        parts[i] = -1;
+    
+    auto send = [&](uint8_t table) {
+        std::unique_ptr<rmExportChunk>& chunk = chunks[table];
+        if(chunk != nullptr && chunk->offsets.size() > 1)
+            workers[table % threads]->push(std::move(chunk));
+        chunk.reset();
+    };
+    
+    rmSessionRecord rec;
+    size_t rows = 0;
+    while(reader.next(&rec)) {
+        uint8_t table = rec.table;
+        if(rec.kind == RM_SESSION_SCHEMA) {
+            std::shared_ptr<rmExportSchema> schema(new rmExportSchema());
+            if(!rmSessionReader::parseSchema(rec, &schema->columns))
+                continue;
+            send(table);
+            schemas[table] = schema;
+            parts[table]++;
+        }
+        else if(rec.kind == RM_SESSION_ROW && schemas[table] != nullptr) {
+            std::unique_ptr<rmExportChunk>& chunk = chunks[table];
+            if(chunk == nullptr) {
+                chunk.reset(new rmExportChunk());
+                chunk->table = table;
+                chunk->part = parts[table];
+                chunk->schema = schemas[table];
+                chunk->offsets.push_back(0);
+            }
+            chunk->rows.insert(chunk->rows.end(), rec.body.begin(),
+                               rec.body.end());
+            chunk->offsets.push_back((uint32_t) chunk->rows.size());
+            rows++;
+            if(chunk->offsets.size() > RM_EXPORT_CHUNK_ROWS ||
+               chunk->rows.size() >= RM_EXPORT_CHUNK_BYTES)
+            {
+                send(table);
+            }
+        }
+    }
+    for(int i=0; i<256; i++)
+        send(i);
+    for(auto& w : workers)
+        w->finish();
+    fprintf(stderr, "rmexport: %zu rows\n", rows);
+    
+    // The rows before the corrupt record are still written
+    if(reader.isCorrupt()) {
+        fprintf(stderr, "rmexport: %s is corrupt after row %zu\n", path,
+                rows);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file rmlog.cpp
+ * @brief Searches the echoed messages recorded by rmEchoStore
+ * 
+ * Usage: rmlog [-l levels] [-n count] [-a ms] [-b ms] [-r] <directory> [text]
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#include <rm/echostore.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+
+static void printUsage() {
+    printf(
+        "Usage: rmlog [options] <directory> [text]\n"
+        "Prints the recorded messages containing the text.\n"
+        "\n"
+        "  -l levels  Any of the letters i, w and e for the normal, warning\n"
+        "             and error messages. All by default.\n"
+        "  -n count   Stops after the number of messages\n"
+        "  -a ms      Only the messages at or after the time\n"
+        "  -b ms      Only the messages at or before the time\n"
+        "  -r         Prints the time in milliseconds since the epoch\n"
+    );
+}
+
+
+static void printRecord(const rmEchoRecord& rec, bool raw) {
+    static const char levels[] = { 'I', 'E', 'W' };
+    if(raw) {
+        printf("%lld %c %s\n", (long long) rec.time, levels[rec.status],
+               rec.text.c_str());
+        return;
+    }
+    time_t sec = (time_t) (rec.time / 1000);
+    char str[32];
+    strftime(str, sizeof(str), "%Y-%m-%d %H:%M:%S", localtime(&sec));
+    printf("%s.%03d %c %s\n", str, (int) (rec.time % 1000),
+           levels[rec.status], rec.text.c_str());
+}
+
+
+int main(int argc, char *argv[]) {
+    uint8_t mask = RM_ECHO_ALL;
+    size_t limit = SIZE_MAX;
+    int64_t from = INT64_MIN;
+    int64_t to = INT64_MAX;
+    bool raw = false;
+    const char* dir = nullptr;
+    const char* text = "";
+    
+    for(int i=1; i<argc; i++) {
+        const char* arg = argv[i];
+        bool value = (i + 1 < argc);
+        if(strcmp(arg, "-l") == 0 && value) {
+            mask = 0;
+            for(const char* c=argv[++i]; *c!='\0'; c++) {
+                if(*c == 'i')
+                    mask |= RM_ECHO_NORMAL;
+                else if(*c == 'e')
+                    mask |= RM_ECHO_ERROR;
+                else if(*c == 'w')
+                    mask |= RM_ECHO_WARNING;
+            }
+        }
+        else if(strcmp(arg, "-n") == 0 && value) {
+            limit = strtoull(argv[++i], nullptr, 10);
+        }
+        else if(strcmp(arg, "-a") == 0 && value) {
+            from = strtoll(argv[++i], nullptr, 10);
+        }
+        else if(strcmp(arg, "-b") == 0 && value) {
+            to = strtoll(argv[++i], nullptr, 10);
+        }
+        else if(strcmp(arg, "-r") == 0) {
+            raw = true;
+        }
+        else if(arg[0] == '-') {
+            printUsage();
+            return 1;
+        }
+        else if(dir == nullptr) {
+            dir = arg;
+        }
+        else {
+            text = arg;
+        }
+    }
+    if(dir == nullptr) {
+        printUsage();
+        return 1;
+    }
+    
+    rmEchoStore store;
+    if(!store.open(dir, false)) {
+        fprintf(stderr, "rmlog: cannot open %s\n", dir);
+        return 1;
+    }
+    std::vector<rmEchoRecord> records;
+    store.search(text, mask, &records, limit, from, to);
+    for(const rmEchoRecord& rec : records)
+        printRecord(rec, raw);
+    return 0;
+}
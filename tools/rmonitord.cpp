@@ -0,0 +1,151 @@
+/**
+ * @file rmonitord.cpp
+ * @brief Headless station serving the client devices to local processes
+ * 
+ * Owns the serial ports, decodes the traffic once and publishes it on a Unix
+ * domain socket per port through rmPublisher. Any number of viewers, loggers
+ * and scripts can connect to the sockets, for example with
+ * "socat - UNIX-CONNECT:/tmp/rmonitor/ttyACM0.sock".
+ * 
+ * Usage: rmonitord [-b baud] [-d directory] <port>...
+ * 
+ * @copyright Copyright (c) 2022 Khant Kyaw Khaung
+ * 
+ * @license{This project is released under the MIT License.}
+ */
+
+
+#define RM_NO_WX
+
+
+#include <rm/client.hpp>
+#include <rm/publisher.hpp>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+
+static std::atomic<bool> quit(false);
+
+
+static void onSignal(int sig) { quit = true; }
+
+
+static void printUsage() {
+    printf(
+        "Usage: rmonitord [options] <port>...\n"
+        "Publishes the client devices on the ports to local subscribers.\n"
+        "\n"
+        "  -b baud       Baudrate. 115200 by default.\n"
+        "  -d directory  Where the sockets are created. /tmp/rmonitor by\n"
+        "                default.\n"
+    );
+}
+
+
+// Creates the directory and its parents, only accessible to the user
+static bool makeDirectory(const std::string& dir) {
+    for(size_t i=1; i<=dir.size(); i++) {
+        if(i < dir.size() && dir[i] != '/')
+            continue;
+        std::string part = dir.substr(0, i);
+        if(mkdir(part.c_str(), 0700) != 0 && errno != EEXIST)
+            return false;
+    }
+    struct stat st;
+    return stat(dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+
+struct rmDaemonPort {
+    std::string port;
+    rmClient* client;
+    rmPublisher* publisher;
+};
+
+
+int main(int argc, char *argv[]) {
+    uint32_t baud = 115200;
+    std::string dir = "/tmp/rmonitor";
+    std::vector<std::string> ports;
+    
+    for(int i=1; i<argc; i++) {
+        const char* arg = argv[i];
+        bool value = (i + 1 < argc);
+        if(strcmp(arg, "-b") == 0 && value) {
+            baud = strtoul(argv[++i], nullptr, 10);
+        }
+        else if(strcmp(arg, "-d") == 0 && value) {
+            dir = argv[++i];
+        }
+        else if(arg[0] == '-') {
+            printUsage();
+            return 1;
+        }
+        else {
+            ports.push_back(arg);
+        }
+    }
+    if(ports.empty()) {
+        printUsage();
+        return 1;
+    }
+    
+    if(!makeDirectory(dir)) {
+        fprintf(stderr, "rmonitord: cannot create %s\n", dir.c_str());
+        return 1;
+    }
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    
+    std::vector<rmDaemonPort> list;
+    for(const std::string& port : ports) {
+        rmDaemonPort p;
+        p.port = port;
+        p.client = new rmClient();
+        p.publisher = new rmPublisher(p.client);
+        size_t slash = port.find_last_of('/');
+        std::string name = (slash == std::string::npos) ?
+                           port : port.substr(slash + 1);
+        std::string sock = dir + "/" + name + ".sock";
+        if(!p.publisher->open(sock.c_str())) {
+            fprintf(stderr, "rmonitord: cannot listen on %s\n", sock.c_str());
+            return 1;
+        }
+        p.client->setEcho(p.publisher);
+        p.client->setAttributeListener(p.publisher);
+        printf("%s -> %s\n", port.c_str(), sock.c_str());
+        list.push_back(p);
+    }
+    fflush(stdout);
+    
+    // Opens the ports again whenever they are lost
+    while(!quit) {
+        for(rmDaemonPort& p : list) {
+            if(!p.client->isConnected())
+                p.client->connectSerial(p.port.c_str(), baud);
+        }
+        for(int i=0; i<10 && !quit; i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    
+    for(rmDaemonPort& p : list) {
+        p.client->disconnect();
+        p.client->setAttributeListener(nullptr);
+        p.client->setEcho(nullptr);
+        p.publisher->close();
+        delete p.publisher;
+        delete p.client;
+    }
+    return 0;
+}